@@ -25,6 +25,7 @@
 #include "global.h"
 #include "Document.h"
 #include "Polygon.h"
+#include "XmlAttr.h"
 
 Area::Area(PCBDoc *doc) :
 	PCBObject(doc),
@@ -111,25 +112,32 @@ bool Area::pointInside(const QPoint &p) const
 	return mPoly.testPointInside(p);
 }
 
-QSharedPointer<Area> Area::newFromXML(QXmlStreamReader &reader, PCBDoc &doc)
+Area::Data Area::parseXML(QXmlStreamReader &reader)
 {
-	Q_ASSERT(reader.isStartElement() && reader.name() == "area");
+	Q_ASSERT(reader.isStartElement() && Xml::is(reader.name(), "area"));
 
 	QXmlStreamAttributes attr = reader.attributes();
-	QSharedPointer<Area> a(new Area(&doc));
-	a->mNet = attr.value("net").toString();
-	a->mLayer = Layer(attr.value("layer").toString().toInt());
-	QStringRef t = attr.value("hatch");
-	if (t == "none")
-		a->mHatchStyle = Area::NO_HATCH;
-	else if (t == "full")
-		a->mHatchStyle = Area::DIAGONAL_FULL;
-	else if (t == "edge")
-		a->mHatchStyle = Area::DIAGONAL_EDGE;
-	a->mConnectSMT = (attr.value("connectSmt") == "1");
+	Data d;
+	d.net = Xml::attr(attr, "net").toString();
+	d.layer = Layer(Xml::intAttr(attr, "layer"));
+	// in HatchStyle order
+	static const char* const hatchNames[] = { "none", "full", "edge" };
+	d.hatch = HatchStyle(Xml::enumAttr(attr, "hatch", hatchNames, d.hatch));
+	d.connectSmt = Xml::boolAttr(attr, "connectSmt");
 	reader.readNextStartElement();
-	a->mPoly = Polygon::newFromXML(reader);
+	d.poly = Polygon::newFromXML(reader);
+
+	return d;
+}
 
+QSharedPointer<Area> Area::newFromData(PCBDoc &doc, const Data &data)
+{
+	QSharedPointer<Area> a(new Area(&doc));
+	a->mNet = data.net;
+	a->mLayer = data.layer;
+	a->mHatchStyle = data.hatch;
+	a->mConnectSMT = data.connectSmt;
+	a->mPoly = data.poly;
 	return a;
 }
 
@@ -45,6 +45,8 @@ class Area : public PCBObject
 {
 	Q_OBJECT
 
+	friend class BoardFile;
+
 public:
 	/// A list of the possible fill styles for the polygon when drawing.
 	enum HatchStyle { NO_HATCH,		///< No hatch lines; only the outline is drawn.
@@ -56,6 +58,7 @@ public:
 	~Area();
 
 	virtual void draw(QPainter *painter, const Layer& layer) const;
+	virtual LayerMask layers() const { return mLayer; }
 	virtual QRect bbox() const;
     virtual PCBObjState getState() const { return PCBObjState(new AreaState(*this)); }
     virtual bool loadState(PCBObjState &state);
@@ -83,7 +86,25 @@ public:
 	/// \returns true if p is inside area.
 	bool pointInside(const QPoint &p) const;
 
-	static QSharedPointer<Area> newFromXML(QXmlStreamReader &reader, PCBDoc &doc);
+	/// Area properties read from a file.  Reading them does not create any
+	/// objects, so it can be done on any thread.
+	struct Data
+	{
+		Data() : layer(Layer::LAY_UNKNOWN), hatch(NO_HATCH), connectSmt(false) {}
+
+		QString net;
+		Layer layer;
+		HatchStyle hatch;
+		bool connectSmt;
+		Polygon poly;
+	};
+
+	/// Reads an area element.
+	static Data parseXML(QXmlStreamReader &reader);
+	/// Creates an area from the properties read by parseXML().
+	static QSharedPointer<Area> newFromData(PCBDoc &doc, const Data &data);
+	static QSharedPointer<Area> newFromXML(QXmlStreamReader &reader, PCBDoc &doc)
+	{ return newFromData(doc, parseXML(reader)); }
 	void toXML(QXmlStreamWriter &writer);
 
 private:
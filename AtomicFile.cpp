@@ -0,0 +1,111 @@
+/*
+	Copyright (C) 2010-2011 Igor Izyumin
+
+	This file is part of xpcb.
+
+	xpcb is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	xpcb is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with xpcb.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "AtomicFile.h"
+#include <QFileInfo>
+#include <QDir>
+#ifdef Q_OS_WIN
+#include <windows.h>
+#include <io.h>
+#else
+#include <unistd.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+/// Returns the process umask.  umask() can only be read by setting it, so
+/// this is done once, before main() starts any threads.
+static mode_t currentUmask()
+{
+	mode_t mask = ::umask(022);
+	::umask(mask);
+	return mask;
+}
+
+static const mode_t sUmask = currentUmask();
+#endif
+
+AtomicFile::AtomicFile(const QString &target)
+	: QTemporaryFile(QFileInfo(target).absoluteFilePath() + ".XXXXXX"),
+	  mTarget(target)
+{
+}
+
+bool AtomicFile::commit()
+{
+	if (!isOpen() || error() != QFile::NoError || !sync(*this))
+		return false;
+	close();
+	// a temporary file is only readable by its owner; give it the mode of
+	// the file it replaces, or the one a new file would get
+	QFileInfo info(mTarget);
+	if (info.exists())
+		setPermissions(info.permissions());
+#ifndef Q_OS_WIN
+	else
+		::chmod(QFile::encodeName(fileName()).constData(), 0666 & ~sUmask);
+#endif
+	if (!replace(fileName(), mTarget))
+		return false;
+	setAutoRemove(false);
+	syncDir(info.absolutePath());
+	return true;
+}
+
+void AtomicFile::syncDir(const QString &path)
+{
+#ifdef Q_OS_WIN
+	// MoveFileEx() with MOVEFILE_WRITE_THROUGH has already flushed it
+	Q_UNUSED(path);
+#else
+	// the rename is only durable once the directory entry is on disk.  Not
+	// every file system can sync a directory, and the file itself is safe
+	// either way, so errors are ignored.
+	int fd = ::open(QFile::encodeName(path).constData(), O_RDONLY);
+	if (fd < 0)
+		return;
+	::fsync(fd);
+	::close(fd);
+#endif
+}
+
+bool AtomicFile::sync(QFile &file)
+{
+	if (!file.flush())
+		return false;
+#ifdef Q_OS_WIN
+	return ::_commit(file.handle()) == 0;
+#else
+	return ::fsync(file.handle()) == 0;
+#endif
+}
+
+bool AtomicFile::replace(const QString &from, const QString &to)
+{
+#ifdef Q_OS_WIN
+	return MoveFileExW(reinterpret_cast<const wchar_t*>(QDir::toNativeSeparators(from).utf16()),
+					   reinterpret_cast<const wchar_t*>(QDir::toNativeSeparators(to).utf16()),
+					   MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+	// unlike QFile::rename(), rename() replaces the target atomically
+	return ::rename(QFile::encodeName(from).constData(),
+					QFile::encodeName(to).constData()) == 0;
+#endif
+}
@@ -0,0 +1,58 @@
+/*
+	Copyright (C) 2010-2011 Igor Izyumin
+
+	This file is part of xpcb.
+
+	xpcb is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	xpcb is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with xpcb.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef ATOMICFILE_H
+#define ATOMICFILE_H
+
+#include <QTemporaryFile>
+
+/// A file that atomically replaces its target when it is committed.
+
+/// AtomicFile writes to a temporary file next to the target.  commit()
+/// flushes it to disk and renames it over the target, so that the target is
+/// either the old file or the complete new one, even if xpcb or the system
+/// crashes during the save.  If the file is destroyed without being
+/// committed, the temporary file is removed and the target is left alone.
+class AtomicFile : public QTemporaryFile
+{
+public:
+	explicit AtomicFile(const QString &target);
+
+	/// Returns the path of the file that will be replaced.
+	QString target() const { return mTarget; }
+
+	/// Flushes the file to disk, closes it and replaces the target with it.
+	/// Returns false on error.
+	bool commit();
+
+	/// Flushes the data of an open file to disk.  Returns false on error.
+	static bool sync(QFile &file);
+	/// Renames a file, replacing the target if it exists.  Returns false on
+	/// error.
+	static bool replace(const QString &from, const QString &to);
+	/// Flushes a directory entry to disk, so that a rename into the
+	/// directory survives a crash.
+	static void syncDir(const QString &path);
+
+private:
+	QString mTarget;
+};
+
+#endif // ATOMICFILE_H
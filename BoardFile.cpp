@@ -0,0 +1,1034 @@
+/*
+	Copyright (C) 2010-2011 Igor Izyumin
+
+	This file is part of xpcb.
+
+	xpcb is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	xpcb is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with xpcb.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <QFile>
+#include <QHash>
+#include <QMap>
+#include <QVector>
+#include <QtEndian>
+#include <QXmlStreamReader>
+#include <QXmlStreamWriter>
+#include "BoardFile.h"
+#include "Document.h"
+#include "FootprintCache.h"
+#include "Log.h"
+
+/// "XPCB", read as a little-endian integer
+static const quint32 MAGIC = 0x42435058;
+static const quint16 VERSION = 1;
+static const int HEADER_SIZE = 12;
+static const int DIR_ENTRY_SIZE = 16;
+
+/// Section identifiers
+enum SectionId
+{
+	SEC_STRINGS = 1,	///< Offset and length of each string in SEC_STRDATA
+	SEC_STRDATA,		///< UTF-8 string data, padded to a multiple of 4 bytes
+	SEC_PROPS,			///< Board properties (a single record)
+	SEC_PADSTACKS,
+	SEC_FOOTPRINTS,
+	SEC_POLYGONS,		///< Ranges of contours; the first one is the outline
+	SEC_CONTOURS,		///< Ranges of points
+	SEC_POINTS,
+	SEC_PARTS,
+	SEC_NLPARTS,		///< Netlist parts
+	SEC_NETS,			///< Netlist nets, with ranges of pins
+	SEC_NETPINS,
+	SEC_VERTICES,
+	SEC_SEGMENTS,
+	SEC_VIAS,
+	SEC_AREAS,
+	SEC_TEXTS
+};
+
+// Fields of the records in each section.  The last value of each enum is the
+// number of fields.  UUIDs are stored as strings, polygons as indices into
+// SEC_POLYGONS and layers as Layer::Type values.
+enum StringField { STR_OFFSET, STR_LENGTH, STR_FIELDS };
+enum PropField { PROP_NAME, PROP_UNITS, PROP_NUMLAYERS, PROP_DEFPADSTACK,
+				 PROP_OUTLINE, PROP_FIELDS };
+enum XmlField { XML_TEXT, XML_FIELDS };
+enum PolyField { POLY_FIRSTCONTOUR, POLY_NUMCONTOURS, POLY_FIELDS };
+enum ContourField { CONT_FIRSTPOINT, CONT_NUMPOINTS, CONT_FIELDS };
+enum PointField { PT_TYPE, PT_X, PT_Y, PT_FIELDS };
+enum PartTextField { PTEXT_X, PTEXT_Y, PTEXT_ANGLE, PTEXT_SIZE, PTEXT_WIDTH,
+					 PTEXT_FIELDS };
+enum PartField { PART_FOOTPRINT, PART_REFDES, PART_VALUE, PART_X, PART_Y,
+				 PART_ANGLE, PART_SIDE, PART_FLAGS, PART_REFTEXT,
+				 PART_VALTEXT = PART_REFTEXT + PTEXT_FIELDS,
+				 PART_FIELDS = PART_VALTEXT + PTEXT_FIELDS };
+enum PartFlag { PART_LOCKED = 0x1, PART_REF_VISIBLE = 0x2,
+				PART_VAL_VISIBLE = 0x4 };
+enum NLPartField { NLPART_REFDES, NLPART_VALUE, NLPART_FOOTPRINT,
+				   NLPART_FIELDS };
+enum NetField { NET_NAME, NET_VISIBLE, NET_PADSTACK, NET_FIRSTPIN,
+				NET_NUMPINS, NET_FIELDS };
+enum NetPinField { PIN_REFDES, PIN_NAME, PIN_FIELDS };
+enum VertexField { VTX_X, VTX_Y, VTX_FIELDS };
+enum SegmentField { SEG_V1, SEG_V2, SEG_LAYER, SEG_WIDTH, SEG_FIELDS };
+enum ViaField { VIA_X, VIA_Y, VIA_PADSTACK, VIA_FIELDS };
+enum AreaField { AREA_NET, AREA_LAYER, AREA_HATCH, AREA_CONNSMT,
+				 AREA_POLYGON, AREA_FIELDS };
+enum TextField { TEXT_TEXT, TEXT_LAYER, TEXT_X, TEXT_Y, TEXT_ANGLE,
+				 TEXT_SIZE, TEXT_WIDTH, TEXT_FIELDS };
+
+/// Returns true if the range of records [first, first + n) lies within a
+/// section of count records
+static bool inRange(qint32 first, qint32 n, int count)
+{
+	return first >= 0 && n >= 0 && first <= count - n;
+}
+
+static QString uuidStr(const QUuid &uuid)
+{
+	return uuid.isNull() ? QString() : uuid.toString();
+}
+
+/// Returns the XML representation of a padstack or footprint
+template <class T>
+static QString toXml(const T &obj)
+{
+	QString xml;
+	QXmlStreamWriter writer(&xml);
+	obj.toXML(writer);
+	return xml;
+}
+
+/// Parses a padstack or footprint stored as XML
+template <class T>
+static QSharedPointer<T> fromXml(const QString &xml)
+{
+	QXmlStreamReader reader(xml);
+	if (!reader.readNextStartElement())
+		return QSharedPointer<T>();
+	return T::newFromXML(reader);
+}
+
+static void put16(QByteArray &out, quint16 v)
+{
+	uchar b[2];
+	qToLittleEndian(v, b);
+	out.append(reinterpret_cast<const char*>(b), 2);
+}
+
+static void put32(QByteArray &out, quint32 v)
+{
+	uchar b[4];
+	qToLittleEndian(v, b);
+	out.append(reinterpret_cast<const char*>(b), 4);
+}
+
+//////////////////////////////// WRITER ////////////////////////////////
+
+/// Builds the sections of a binary board.
+class BoardWriter
+{
+public:
+	/// Appends a zeroed record to a section and returns it.  The record is
+	/// valid until the next record is appended to the same section.
+	qint32* append(SectionId id, int fields);
+	/// Returns the number of records in a section.
+	int count(SectionId id) const { return mSections.value(id).count(); }
+	/// Returns the string table index of a string, adding it if needed.
+	qint32 str(const QString &s);
+	/// Adds a polygon and returns its index, or -1 if the polygon is void.
+	qint32 polygon(const Polygon &poly);
+	/// Returns the contents of the file.
+	QByteArray data() const;
+
+private:
+	struct Section
+	{
+		Section() : fields(0) {}
+		int count() const { return fields ? data.size() / fields : 0; }
+
+		int fields;
+		QVector<qint32> data;
+	};
+
+	void contour(const PolyContour &c);
+
+	QMap<int, Section> mSections;
+	QHash<QString, qint32> mStrIndex;
+	QByteArray mStrData;
+};
+
+qint32* BoardWriter::append(SectionId id, int fields)
+{
+	Section &s = mSections[id];
+	s.fields = fields;
+	s.data.insert(s.data.end(), fields, 0);
+	return s.data.data() + s.data.size() - fields;
+}
+
+qint32 BoardWriter::str(const QString &s)
+{
+	if (s.isEmpty())
+		return -1;
+	QHash<QString, qint32>::const_iterator i = mStrIndex.constFind(s);
+	if (i != mStrIndex.constEnd())
+		return i.value();
+
+	QByteArray utf8 = s.toUtf8();
+	qint32* r = append(SEC_STRINGS, STR_FIELDS);
+	r[STR_OFFSET] = mStrData.size();
+	r[STR_LENGTH] = utf8.size();
+	mStrData.append(utf8);
+	qint32 index = count(SEC_STRINGS) - 1;
+	mStrIndex.insert(s, index);
+	return index;
+}
+
+qint32 BoardWriter::polygon(const Polygon &poly)
+{
+	if (poly.isVoid())
+		return -1;
+	qint32* r = append(SEC_POLYGONS, POLY_FIELDS);
+	r[POLY_FIRSTCONTOUR] = count(SEC_CONTOURS);
+	r[POLY_NUMCONTOURS] = 1 + poly.numHoles();
+	contour(*poly.outline());
+	for(int i = 0; i < poly.numHoles(); i++)
+		contour(*poly.hole(i));
+	return count(SEC_POLYGONS) - 1;
+}
+
+void BoardWriter::contour(const PolyContour &c)
+{
+	qint32* r = append(SEC_CONTOURS, CONT_FIELDS);
+	r[CONT_FIRSTPOINT] = count(SEC_POINTS);
+	r[CONT_NUMPOINTS] = c.numSegs();
+	for(int i = 0; i < c.numSegs(); i++)
+	{
+		const PolyContour::Segment &seg = c.segment(i);
+		qint32* pt = append(SEC_POINTS, PT_FIELDS);
+		pt[PT_TYPE] = seg.type;
+		pt[PT_X] = seg.end.x();
+		pt[PT_Y] = seg.end.y();
+	}
+}
+
+QByteArray BoardWriter::data() const
+{
+	QByteArray strData = mStrData;
+	while(strData.size() % 4)
+		strData.append('\0');
+
+	// the string data is written after the other sections
+	int numSections = mSections.size() + 1;
+	quint32 offset = HEADER_SIZE + numSections * DIR_ENTRY_SIZE;
+	QByteArray out;
+	put32(out, MAGIC);
+	put16(out, VERSION);
+	put16(out, 0);
+	put32(out, numSections);
+	QMap<int, Section>::const_iterator i;
+	for(i = mSections.constBegin(); i != mSections.constEnd(); ++i)
+	{
+		put32(out, i.key());
+		put32(out, offset);
+		put32(out, i.value().count());
+		put32(out, i.value().fields);
+		offset += 4 * i.value().data.size();
+	}
+	put32(out, SEC_STRDATA);
+	put32(out, offset);
+	put32(out, strData.size() / 4);
+	put32(out, 1);
+
+	out.reserve(offset + strData.size());
+	for(i = mSections.constBegin(); i != mSections.constEnd(); ++i)
+	{
+		foreach(qint32 v, i.value().data)
+			put32(out, v);
+	}
+	out.append(strData);
+	return out;
+}
+
+//////////////////////////////// READER ////////////////////////////////
+
+/// Gives access to the sections of a binary board.
+class BoardReader
+{
+public:
+	/// An array of fixed-width records.
+	class Section
+	{
+	public:
+		Section() : mData(NULL), mCount(0), mFields(0) {}
+		Section(const uchar* data, int count, int fields)
+			: mData(data), mCount(count), mFields(fields) {}
+
+		int count() const { return mCount; }
+		const uchar* data() const { return mData; }
+		qint64 size() const { return 4 * qint64(mCount) * mFields; }
+
+		/// Returns a field of a record.  Fields that the file does not have
+		/// read as 0.
+		qint32 at(int rec, int field) const
+		{
+			Q_ASSERT(rec >= 0 && rec < mCount);
+			if (field >= mFields)
+				return 0;
+			return qFromLittleEndian<qint32>(
+					mData + 4 * (qint64(rec) * mFields + field));
+		}
+
+	private:
+		const uchar* mData;
+		int mCount;
+		int mFields;
+	};
+
+	BoardReader(const uchar* data, qint64 size)
+		: mData(data), mSize(size) {}
+
+	/// Reads the header and the section directory.  Returns false, and logs
+	/// the reason, if the data is not a valid binary board.
+	bool open();
+
+	/// Returns a section, or an empty one if the file does not have it.
+	Section section(SectionId id) const { return mSections.value(id); }
+
+	/// Returns a string from the string table.  Each string is only decoded
+	/// once.
+	QString str(qint32 index);
+	/// Returns a UUID stored in the string table.
+	QUuid uuid(qint32 index);
+	/// Returns a polygon, or a void polygon if the index is -1.
+	Polygon polygon(qint32 index) const;
+
+private:
+	bool error(const QString &msg) const;
+
+	const uchar* mData;
+	qint64 mSize;
+	QHash<int, Section> mSections;
+	Section mStrs;
+	Section mStrData;
+	QVector<QString> mStrings;
+	QHash<qint32, QUuid> mUuids;
+};
+
+bool BoardReader::error(const QString &msg) const
+{
+	Log::instance().error(QString("Unable to load file: %1").arg(msg));
+	return false;
+}
+
+bool BoardReader::open()
+{
+	if (mSize < HEADER_SIZE || qFromLittleEndian<quint32>(mData) != MAGIC)
+		return error("not a binary board");
+	quint16 version = qFromLittleEndian<quint16>(mData + 4);
+	if (version != VERSION)
+		return error(QString("unsupported file version %1").arg(version));
+	quint32 numSections = qFromLittleEndian<quint32>(mData + 8);
+	if (HEADER_SIZE + qint64(numSections) * DIR_ENTRY_SIZE > mSize)
+		return error("file is truncated");
+
+	for(quint32 i = 0; i < numSections; i++)
+	{
+		const uchar* e = mData + HEADER_SIZE + i * DIR_ENTRY_SIZE;
+		quint32 id = qFromLittleEndian<quint32>(e);
+		quint32 offset = qFromLittleEndian<quint32>(e + 4);
+		quint32 count = qFromLittleEndian<quint32>(e + 8);
+		quint32 fields = qFromLittleEndian<quint32>(e + 12);
+		if (offset > mSize || (fields == 0 && count != 0) ||
+				(fields != 0 && count > (mSize - offset) / (4 * qint64(fields))))
+			return error(QString("section %1 is out of bounds").arg(id));
+		mSections.insert(id, Section(mData + offset, count, fields));
+	}
+
+	mStrs = section(SEC_STRINGS);
+	mStrData = section(SEC_STRDATA);
+	for(int i = 0; i < mStrs.count(); i++)
+	{
+		qint32 offset = mStrs.at(i, STR_OFFSET);
+		qint32 len = mStrs.at(i, STR_LENGTH);
+		if (offset < 0 || len < 0 || offset > mStrData.size() - len)
+			return error("string table is corrupted");
+	}
+	mStrings.resize(mStrs.count());
+	return true;
+}
+
+QString BoardReader::str(qint32 index)
+{
+	if (index < 0 || index >= mStrings.size())
+		return QString();
+	QString &s = mStrings[index];
+	if (s.isNull())
+		s = QString::fromUtf8(
+				reinterpret_cast<const char*>(mStrData.data())
+					+ mStrs.at(index, STR_OFFSET),
+				mStrs.at(index, STR_LENGTH));
+	return s;
+}
+
+QUuid BoardReader::uuid(qint32 index)
+{
+	if (index < 0)
+		return QUuid();
+	QHash<qint32, QUuid>::const_iterator i = mUuids.constFind(index);
+	if (i != mUuids.constEnd())
+		return i.value();
+	QUuid u(str(index));
+	mUuids.insert(index, u);
+	return u;
+}
+
+Polygon BoardReader::polygon(qint32 index) const
+{
+	Polygon poly;
+	Section polys = section(SEC_POLYGONS);
+	if (index < 0 || index >= polys.count())
+		return poly;
+	Section contours = section(SEC_CONTOURS);
+	Section pts = section(SEC_POINTS);
+	qint32 first = polys.at(index, POLY_FIRSTCONTOUR);
+	qint32 num = polys.at(index, POLY_NUMCONTOURS);
+	if (!inRange(first, num, contours.count()))
+	{
+		Log::instance().error("Error loading polygon");
+		return poly;
+	}
+	for(qint32 c = first; c < first + num; c++)
+	{
+		qint32 firstPt = contours.at(c, CONT_FIRSTPOINT);
+		qint32 numPts = contours.at(c, CONT_NUMPOINTS);
+		if (!inRange(firstPt, numPts, pts.count()))
+			continue;
+		PolyContour pc;
+		for(qint32 p = firstPt; p < firstPt + numPts; p++)
+		{
+			PolyContour::Segment::SegType type =
+					static_cast<PolyContour::Segment::SegType>(
+						qBound(0, pts.at(p, PT_TYPE), 3));
+			pc.appendSegment(PolyContour::Segment(type,
+					QPoint(pts.at(p, PT_X), pts.at(p, PT_Y))));
+		}
+		if (c == first)
+			*poly.outline() = pc;
+		else
+			poly.appendHole(pc);
+	}
+	poly.markChanged();
+	return poly;
+}
+
+/////////////////////////////// BOARDFILE ///////////////////////////////
+
+static void writePartText(qint32* r, const Text &t)
+{
+	r[PTEXT_X] = t.pos().x();
+	r[PTEXT_Y] = t.pos().y();
+	r[PTEXT_ANGLE] = t.angle();
+	r[PTEXT_SIZE] = t.fontSize();
+	r[PTEXT_WIDTH] = t.strokeWidth();
+}
+
+static void readPartText(Text &t, const BoardReader::Section &parts,
+						 int rec, int first)
+{
+	t.setPos(QPoint(parts.at(rec, first + PTEXT_X),
+					parts.at(rec, first + PTEXT_Y)));
+	t.setAngle(parts.at(rec, first + PTEXT_ANGLE));
+	t.setFontSize(parts.at(rec, first + PTEXT_SIZE));
+	t.setStrokeWidth(parts.at(rec, first + PTEXT_WIDTH));
+}
+
+bool BoardFile::isBinary(QIODevice &dev)
+{
+	QByteArray magic = dev.peek(4);
+	return magic.size() == 4 && qFromLittleEndian<quint32>(
+				reinterpret_cast<const uchar*>(magic.constData())) == MAGIC;
+}
+
+bool BoardFile::save(PCBDoc &doc, QIODevice &dev,
+					 QList<const PCBObject*>* objects)
+{
+	BoardWriter out;
+	qint32* r;
+
+	r = out.append(SEC_PROPS, PROP_FIELDS);
+	r[PROP_NAME] = out.str(doc.name());
+	r[PROP_UNITS] = doc.units();
+	r[PROP_NUMLAYERS] = doc.numLayers();
+	r[PROP_DEFPADSTACK] = out.str(uuidStr(doc.mDefaultPadstack));
+	r[PROP_OUTLINE] = out.polygon(doc.mBoardOutline);
+
+	foreach(QSharedPointer<Padstack> ps, doc.mPadstacks)
+		out.append(SEC_PADSTACKS, XML_FIELDS)[XML_TEXT] = out.str(toXml(*ps));
+	foreach(QSharedPointer<Footprint> fp, doc.mFootprints)
+		out.append(SEC_FOOTPRINTS, XML_FIELDS)[XML_TEXT] = out.str(toXml(*fp));
+
+	foreach(QSharedPointer<Part> p, doc.mParts)
+	{
+		r = out.append(SEC_PARTS, PART_FIELDS);
+		r[PART_FOOTPRINT] = out.str(uuidStr(p->fpUuid()));
+		r[PART_REFDES] = out.str(p->refdes());
+		r[PART_VALUE] = out.str(p->value());
+		r[PART_X] = p->pos().x();
+		r[PART_Y] = p->pos().y();
+		r[PART_ANGLE] = p->angle();
+		r[PART_SIDE] = p->side();
+		r[PART_FLAGS] = (p->locked() ? PART_LOCKED : 0)
+				| (p->refVisible() ? PART_REF_VISIBLE : 0)
+				| (p->valueVisible() ? PART_VAL_VISIBLE : 0);
+		writePartText(r + PART_REFTEXT, *p->refdesText());
+		writePartText(r + PART_VALTEXT, *p->valueText());
+		if (objects)
+			objects->append(p.data());
+	}
+
+	foreach(const NLPart &p, doc.mNetlist->parts())
+	{
+		r = out.append(SEC_NLPARTS, NLPART_FIELDS);
+		r[NLPART_REFDES] = out.str(p.refdes());
+		r[NLPART_VALUE] = out.str(p.value());
+		r[NLPART_FOOTPRINT] = out.str(p.footprint());
+	}
+	foreach(const NLNet &n, doc.mNetlist->nets())
+	{
+		// as in XML files, empty nets are not saved
+		if (n.pins().isEmpty())
+			continue;
+		r = out.append(SEC_NETS, NET_FIELDS);
+		r[NET_NAME] = out.str(n.name());
+		r[NET_VISIBLE] = n.visible();
+		r[NET_PADSTACK] = out.str(uuidStr(n.padstack()));
+		r[NET_FIRSTPIN] = out.count(SEC_NETPINS);
+		r[NET_NUMPINS] = n.pins().size();
+		foreach(const NLPin &pin, n.pins())
+		{
+			qint32* pr = out.append(SEC_NETPINS, PIN_FIELDS);
+			pr[PIN_REFDES] = out.str(pin.refdes());
+			pr[PIN_NAME] = out.str(pin.pinName());
+		}
+	}
+
+	const TraceList &tl = *doc.mTraceList;
+	QHash<const Vertex*, qint32> vtxIndex;
+	vtxIndex.reserve(tl.myVtx.size());
+	foreach(QSharedPointer<Vertex> v, tl.myVtx)
+	{
+		vtxIndex.insert(v.data(), out.count(SEC_VERTICES));
+		r = out.append(SEC_VERTICES, VTX_FIELDS);
+		r[VTX_X] = v->pos().x();
+		r[VTX_Y] = v->pos().y();
+		if (objects)
+			objects->append(v.data());
+	}
+	foreach(QSharedPointer<Segment> s, tl.mySeg)
+	{
+		r = out.append(SEC_SEGMENTS, SEG_FIELDS);
+		r[SEG_V1] = vtxIndex.value(s->v1().data(), -1);
+		r[SEG_V2] = vtxIndex.value(s->v2().data(), -1);
+		r[SEG_LAYER] = s->layer().toInt();
+		r[SEG_WIDTH] = s->width();
+		if (objects)
+			objects->append(s.data());
+	}
+	foreach(QSharedPointer<Via> v, tl.myVias)
+	{
+		r = out.append(SEC_VIAS, VIA_FIELDS);
+		r[VIA_X] = v->pos().x();
+		r[VIA_Y] = v->pos().y();
+		r[VIA_PADSTACK] = out.str(v->padstack() ?
+									  uuidStr(v->padstack()->uuid())
+									: QString());
+		if (objects)
+			objects->append(v.data());
+	}
+
+	foreach(QSharedPointer<Area> a, doc.mAreas)
+	{
+		r = out.append(SEC_AREAS, AREA_FIELDS);
+		r[AREA_NET] = out.str(a->mNet);
+		r[AREA_LAYER] = a->mLayer.toInt();
+		r[AREA_HATCH] = a->mHatchStyle;
+		r[AREA_CONNSMT] = a->mConnectSMT;
+		r[AREA_POLYGON] = out.polygon(a->mPoly);
+		if (objects)
+			objects->append(a.data());
+	}
+
+	foreach(QSharedPointer<Text> t, doc.mTexts)
+	{
+		r = out.append(SEC_TEXTS, TEXT_FIELDS);
+		r[TEXT_TEXT] = out.str(t->text());
+		r[TEXT_LAYER] = t->layer().toInt();
+		r[TEXT_X] = t->pos().x();
+		r[TEXT_Y] = t->pos().y();
+		r[TEXT_ANGLE] = t->angle();
+		r[TEXT_SIZE] = t->fontSize();
+		r[TEXT_WIDTH] = t->strokeWidth();
+		if (objects)
+			objects->append(t.data());
+	}
+
+	QByteArray data = out.data();
+	if (dev.write(data) != data.size())
+	{
+		Log::instance().error(QString("Error writing file: %1").arg(dev.errorString()));
+		return false;
+	}
+	return true;
+}
+
+bool BoardFile::load(PCBDoc &doc, QFile &file)
+{
+	qint64 size = file.size();
+	uchar* data = file.map(0, size);
+	if (data)
+	{
+		bool ok = load(doc, data, size);
+		file.unmap(data);
+		return ok;
+	}
+	// not every file can be mapped (resources, for one)
+	QByteArray buf = file.readAll();
+	return load(doc, reinterpret_cast<const uchar*>(buf.constData()),
+				buf.size());
+}
+
+bool BoardFile::load(PCBDoc &doc, const uchar* data, qint64 size,
+					 QList<PCBObject*>* objects)
+{
+	BoardReader in(data, size);
+	if (!in.open())
+		return false;
+
+	doc.clearDoc();
+	doc.mNetlist = QSharedPointer<Netlist>(new Netlist());
+
+	BoardReader::Section props = in.section(SEC_PROPS);
+	if (props.count() > 0)
+	{
+		doc.mName = in.str(props.at(0, PROP_NAME));
+		doc.mUnits = static_cast<XPcb::UNIT>(props.at(0, PROP_UNITS));
+		doc.mNumLayers = props.at(0, PROP_NUMLAYERS);
+		doc.mDefaultPadstack = in.uuid(props.at(0, PROP_DEFPADSTACK));
+		doc.mBoardOutline = in.polygon(props.at(0, PROP_OUTLINE));
+	}
+
+	BoardReader::Section padstacks = in.section(SEC_PADSTACKS);
+	for(int i = 0; i < padstacks.count(); i++)
+	{
+		QSharedPointer<Padstack> ps = fromXml<Padstack>(
+					in.str(padstacks.at(i, XML_TEXT)));
+		if (!ps)
+			Log::instance().error("Error loading padstack");
+		else
+			doc.mPadstacks.insert(ps->uuid(), ps);
+	}
+
+	BoardReader::Section footprints = in.section(SEC_FOOTPRINTS);
+	for(int i = 0; i < footprints.count(); i++)
+	{
+		QSharedPointer<Footprint> fp = fromXml<Footprint>(
+					in.str(footprints.at(i, XML_TEXT)));
+		if (!fp)
+			Log::instance().error("Error loading footprint");
+		else
+			doc.mFootprints.insert(fp->uuid(),
+								   FootprintCache::instance().intern(fp));
+	}
+
+	loadParts(doc, in);
+	loadNetlist(doc, in);
+	if (objects)
+	{
+		foreach(QSharedPointer<Part> p, doc.mParts)
+			objects->append(p.data());
+	}
+	loadTraces(doc, in, objects);
+	loadAreas(doc, in);
+
+	BoardReader::Section texts = in.section(SEC_TEXTS);
+	for(int i = 0; i < texts.count(); i++)
+	{
+		doc.mTexts.append(QSharedPointer<Text>(new Text(
+				QPoint(texts.at(i, TEXT_X), texts.at(i, TEXT_Y)),
+				texts.at(i, TEXT_ANGLE), false, false,
+				Layer(texts.at(i, TEXT_LAYER)), texts.at(i, TEXT_SIZE),
+				texts.at(i, TEXT_WIDTH), in.str(texts.at(i, TEXT_TEXT)))));
+	}
+	if (objects)
+	{
+		foreach(QSharedPointer<Area> a, doc.mAreas)
+			objects->append(a.data());
+		foreach(QSharedPointer<Text> t, doc.mTexts)
+			objects->append(t.data());
+	}
+
+	doc.rebuildIndex();
+	emit doc.appearanceChanged();
+	return true;
+}
+
+/// Copies a padstack or footprint stored as XML to a writer
+static void copyXml(const QString &xml, QXmlStreamWriter &writer)
+{
+	QXmlStreamReader reader(xml);
+	while(!reader.atEnd())
+	{
+		reader.readNext();
+		if (!reader.isStartDocument() && !reader.isEndDocument())
+			writer.writeCurrentToken(reader);
+	}
+}
+
+static void writePartTextXml(QXmlStreamWriter &writer, const char* name,
+							 const BoardReader::Section &parts, int rec,
+							 int first, bool visible)
+{
+	writer.writeStartElement(name);
+	writer.writeAttribute("x", QString::number(parts.at(rec, first + PTEXT_X)));
+	writer.writeAttribute("y", QString::number(parts.at(rec, first + PTEXT_Y)));
+	writer.writeAttribute("rot", QString::number(parts.at(rec, first + PTEXT_ANGLE)));
+	writer.writeAttribute("textSize", QString::number(parts.at(rec, first + PTEXT_SIZE)));
+	writer.writeAttribute("lineWidth", QString::number(parts.at(rec, first + PTEXT_WIDTH)));
+	writer.writeAttribute("visible", visible ? "1" : "0");
+	writer.writeEndElement();
+}
+
+// The elements written here must match the toXML() methods of the document
+// objects (PCBDoc::saveToXml() and the functions it calls);
+// BoardFileTest::testWriteXml checks that they do.
+bool BoardFile::writeXml(const uchar* data, qint64 size, QXmlStreamWriter &writer)
+{
+	BoardReader in(data, size);
+	if (!in.open())
+		return false;
+
+	writer.setAutoFormatting(true);
+	writer.writeStartDocument();
+	writer.writeStartElement("xpcbBoard");
+
+	BoardReader::Section props = in.section(SEC_PROPS);
+	qint32 outline = -1;
+	writer.writeStartElement("props");
+	if (props.count() > 0)
+	{
+		writer.writeTextElement("units", props.at(0, PROP_UNITS) == XPcb::MM
+								? "mm" : "mils");
+		writer.writeTextElement("numLayers",
+								QString::number(props.at(0, PROP_NUMLAYERS)));
+		writer.writeTextElement("name", in.str(props.at(0, PROP_NAME)));
+		writer.writeTextElement("defaultPadstack",
+								in.uuid(props.at(0, PROP_DEFPADSTACK)).toString());
+		outline = props.at(0, PROP_OUTLINE);
+	}
+	writer.writeEndElement();
+
+	writer.writeStartElement("padstacks");
+	BoardReader::Section padstacks = in.section(SEC_PADSTACKS);
+	for(int i = 0; i < padstacks.count(); i++)
+		copyXml(in.str(padstacks.at(i, XML_TEXT)), writer);
+	writer.writeEndElement();
+
+	writer.writeStartElement("footprints");
+	BoardReader::Section footprints = in.section(SEC_FOOTPRINTS);
+	for(int i = 0; i < footprints.count(); i++)
+		copyXml(in.str(footprints.at(i, XML_TEXT)), writer);
+	writer.writeEndElement();
+
+	writer.writeStartElement("outline");
+	in.polygon(outline).toXML(writer);
+	writer.writeEndElement();
+
+	writer.writeStartElement("parts");
+	BoardReader::Section parts = in.section(SEC_PARTS);
+	for(int i = 0; i < parts.count(); i++)
+	{
+		qint32 flags = parts.at(i, PART_FLAGS);
+		writer.writeStartElement("part");
+		writer.writeAttribute("footprint_uuid",
+							  in.uuid(parts.at(i, PART_FOOTPRINT)).toString());
+		writer.writeAttribute("refdes", in.str(parts.at(i, PART_REFDES)));
+		writer.writeAttribute("value", in.str(parts.at(i, PART_VALUE)));
+		writer.writeAttribute("x", QString::number(parts.at(i, PART_X)));
+		writer.writeAttribute("y", QString::number(parts.at(i, PART_Y)));
+		writer.writeAttribute("rot", QString::number(parts.at(i, PART_ANGLE)));
+		writer.writeAttribute("side", parts.at(i, PART_SIDE) ? "bot" : "top");
+		writer.writeAttribute("locked", (flags & PART_LOCKED) ? "1" : "0");
+		writePartTextXml(writer, "refText", parts, i, PART_REFTEXT,
+						 flags & PART_REF_VISIBLE);
+		writePartTextXml(writer, "valueText", parts, i, PART_VALTEXT,
+						 flags & PART_VAL_VISIBLE);
+		writer.writeEndElement();
+	}
+	writer.writeEndElement();
+
+	writer.writeStartElement("netlist");
+	BoardReader::Section nlparts = in.section(SEC_NLPARTS);
+	for(int i = 0; i < nlparts.count(); i++)
+	{
+		writer.writeStartElement("part");
+		writer.writeAttribute("refdes", in.str(nlparts.at(i, NLPART_REFDES)));
+		QString value = in.str(nlparts.at(i, NLPART_VALUE));
+		if (!value.isEmpty())
+			writer.writeAttribute("value", value);
+		writer.writeAttribute("footprint", in.str(nlparts.at(i, NLPART_FOOTPRINT)));
+		writer.writeEndElement();
+	}
+	BoardReader::Section nets = in.section(SEC_NETS);
+	BoardReader::Section pins = in.section(SEC_NETPINS);
+	for(int i = 0; i < nets.count(); i++)
+	{
+		qint32 first = nets.at(i, NET_FIRSTPIN);
+		qint32 num = nets.at(i, NET_NUMPINS);
+		if (!inRange(first, num, pins.count()) || num == 0)
+			continue;
+		writer.writeStartElement("net");
+		writer.writeAttribute("name", in.str(nets.at(i, NET_NAME)));
+		if (!nets.at(i, NET_VISIBLE))
+			writer.writeAttribute("visible", "0");
+		QUuid ps = in.uuid(nets.at(i, NET_PADSTACK));
+		if (!ps.isNull())
+			writer.writeAttribute("defViaPadstack", ps.toString());
+		for(qint32 p = first; p < first + num; p++)
+		{
+			writer.writeStartElement("pinRef");
+			writer.writeAttribute("partref", in.str(pins.at(p, PIN_REFDES)));
+			writer.writeAttribute("pinname", in.str(pins.at(p, PIN_NAME)));
+			writer.writeEndElement();
+		}
+		writer.writeEndElement();
+	}
+	writer.writeEndElement();
+
+	// vertices are identified by their record index
+	writer.writeStartElement("traces");
+	writer.writeStartElement("vertices");
+	BoardReader::Section vertices = in.section(SEC_VERTICES);
+	for(int i = 0; i < vertices.count(); i++)
+	{
+		writer.writeStartElement("vertex");
+		writer.writeAttribute("id", QString::number(i));
+		writer.writeAttribute("x", QString::number(vertices.at(i, VTX_X)));
+		writer.writeAttribute("y", QString::number(vertices.at(i, VTX_Y)));
+		writer.writeEndElement();
+	}
+	writer.writeEndElement();
+	writer.writeStartElement("segments");
+	BoardReader::Section segments = in.section(SEC_SEGMENTS);
+	for(int i = 0; i < segments.count(); i++)
+	{
+		qint32 v1 = segments.at(i, SEG_V1);
+		qint32 v2 = segments.at(i, SEG_V2);
+		if (!inRange(v1, 1, vertices.count()) || !inRange(v2, 1, vertices.count()))
+			continue;
+		writer.writeStartElement("segment");
+		writer.writeAttribute("start", QString::number(v1));
+		writer.writeAttribute("end", QString::number(v2));
+		writer.writeAttribute("layer", QString::number(segments.at(i, SEG_LAYER)));
+		writer.writeAttribute("width", QString::number(segments.at(i, SEG_WIDTH)));
+		writer.writeEndElement();
+	}
+	writer.writeEndElement();
+	writer.writeStartElement("vias");
+	BoardReader::Section vias = in.section(SEC_VIAS);
+	for(int i = 0; i < vias.count(); i++)
+	{
+		writer.writeStartElement("via");
+		writer.writeAttribute("x", QString::number(vias.at(i, VIA_X)));
+		writer.writeAttribute("y", QString::number(vias.at(i, VIA_Y)));
+		writer.writeAttribute("padstack",
+							  in.uuid(vias.at(i, VIA_PADSTACK)).toString());
+		writer.writeEndElement();
+	}
+	writer.writeEndElement();
+	writer.writeEndElement();
+
+	writer.writeStartElement("areas");
+	BoardReader::Section areas = in.section(SEC_AREAS);
+	for(int i = 0; i < areas.count(); i++)
+	{
+		writer.writeStartElement("area");
+		writer.writeAttribute("net", in.str(areas.at(i, AREA_NET)));
+		writer.writeAttribute("layer", QString::number(areas.at(i, AREA_LAYER)));
+		switch(areas.at(i, AREA_HATCH))
+		{
+		case Area::DIAGONAL_FULL:
+			writer.writeAttribute("hatch", "full");
+			break;
+		case Area::DIAGONAL_EDGE:
+			writer.writeAttribute("hatch", "edge");
+			break;
+		default:
+			writer.writeAttribute("hatch", "none");
+			break;
+		}
+		writer.writeAttribute("connectSmt", areas.at(i, AREA_CONNSMT) ? "1" : "0");
+		in.polygon(areas.at(i, AREA_POLYGON)).toXML(writer);
+		writer.writeEndElement();
+	}
+	writer.writeEndElement();
+
+	writer.writeStartElement("texts");
+	BoardReader::Section texts = in.section(SEC_TEXTS);
+	for(int i = 0; i < texts.count(); i++)
+	{
+		writer.writeStartElement("text");
+		writer.writeAttribute("layer", QString::number(texts.at(i, TEXT_LAYER)));
+		writer.writeAttribute("x", QString::number(texts.at(i, TEXT_X)));
+		writer.writeAttribute("y", QString::number(texts.at(i, TEXT_Y)));
+		writer.writeAttribute("rot", QString::number(texts.at(i, TEXT_ANGLE)));
+		writer.writeAttribute("lineWidth", QString::number(texts.at(i, TEXT_WIDTH)));
+		writer.writeAttribute("textSize", QString::number(texts.at(i, TEXT_SIZE)));
+		writer.writeCharacters(in.str(texts.at(i, TEXT_TEXT)));
+		writer.writeEndElement();
+	}
+	writer.writeEndElement();
+
+	writer.writeEndElement();
+	writer.writeEndDocument();
+	return !writer.hasError();
+}
+
+void BoardFile::loadParts(PCBDoc &doc, BoardReader &in)
+{
+	BoardReader::Section parts = in.section(SEC_PARTS);
+	for(int i = 0; i < parts.count(); i++)
+	{
+		QSharedPointer<Part> p(new Part(&doc));
+		p->setFootprint(in.uuid(parts.at(i, PART_FOOTPRINT)));
+		// keep parts whose footprint is missing, like the XML loader does,
+		// so that saving the board doesn't drop them
+		if (!p->footprint())
+			Log::instance().error(QString("Error loading part %1: footprint not found")
+								  .arg(in.str(parts.at(i, PART_REFDES))));
+		p->refdesText()->setText(in.str(parts.at(i, PART_REFDES)));
+		p->valueText()->setText(in.str(parts.at(i, PART_VALUE)));
+		p->setPos(QPoint(parts.at(i, PART_X), parts.at(i, PART_Y)));
+		p->setAngle(parts.at(i, PART_ANGLE));
+		p->setSide(parts.at(i, PART_SIDE) ? Part::SIDE_BOTTOM : Part::SIDE_TOP);
+		qint32 flags = parts.at(i, PART_FLAGS);
+		p->setLocked(flags & PART_LOCKED);
+		p->setRefVisible(flags & PART_REF_VISIBLE);
+		p->setValueVisible(flags & PART_VAL_VISIBLE);
+		// the texts are placed relative to the part, so it must be positioned first
+		readPartText(*p->refdesText(), parts, i, PART_REFTEXT);
+		readPartText(*p->valueText(), parts, i, PART_VALTEXT);
+		doc.mParts.append(p);
+	}
+}
+
+void BoardFile::loadNetlist(PCBDoc &doc, BoardReader &in)
+{
+	Netlist &nl = *doc.mNetlist;
+
+	BoardReader::Section parts = in.section(SEC_NLPARTS);
+	for(int i = 0; i < parts.count(); i++)
+	{
+		nl.addPart(NLPart(in.str(parts.at(i, NLPART_REFDES)),
+						  in.str(parts.at(i, NLPART_FOOTPRINT)),
+						  in.str(parts.at(i, NLPART_VALUE))));
+	}
+
+	BoardReader::Section nets = in.section(SEC_NETS);
+	BoardReader::Section pins = in.section(SEC_NETPINS);
+	for(int i = 0; i < nets.count(); i++)
+	{
+		NLNet net(in.str(nets.at(i, NET_NAME)));
+		qint32 first = nets.at(i, NET_FIRSTPIN);
+		qint32 num = nets.at(i, NET_NUMPINS);
+		if (!inRange(first, num, pins.count()))
+		{
+			Log::instance().error(QString("Error loading net %1").arg(net.name()));
+			continue;
+		}
+		net.setVisible(nets.at(i, NET_VISIBLE) != 0);
+		net.setPadstack(in.uuid(nets.at(i, NET_PADSTACK)));
+		for(qint32 p = first; p < first + num; p++)
+			net.addPin(NLPin(in.str(pins.at(p, PIN_REFDES)),
+							 in.str(pins.at(p, PIN_NAME))));
+		nl.addNet(net);
+	}
+}
+
+void BoardFile::loadTraces(PCBDoc &doc, BoardReader &in,
+						   QList<PCBObject*>* objects)
+{
+	TraceList &tl = *doc.mTraceList;
+
+	BoardReader::Section vertices = in.section(SEC_VERTICES);
+	QVector<QSharedPointer<Vertex> > vmap(vertices.count());
+	tl.myVtx.reserve(vertices.count());
+	for(int i = 0; i < vertices.count(); i++)
+	{
+		vmap[i] = QSharedPointer<Vertex>(new Vertex(
+				QPoint(vertices.at(i, VTX_X), vertices.at(i, VTX_Y))));
+		tl.myVtx.insert(vmap[i]);
+		if (objects)
+			objects->append(vmap[i].data());
+	}
+
+	BoardReader::Section segments = in.section(SEC_SEGMENTS);
+	tl.mySeg.reserve(segments.count());
+	for(int i = 0; i < segments.count(); i++)
+	{
+		qint32 v1 = segments.at(i, SEG_V1);
+		qint32 v2 = segments.at(i, SEG_V2);
+		if (!inRange(v1, 1, vmap.size()) || !inRange(v2, 1, vmap.size()))
+		{
+			Log::instance().error("Error loading segment");
+			if (objects)
+				objects->append(NULL);
+			continue;
+		}
+		QSharedPointer<Segment> s(new Segment(
+				Layer(segments.at(i, SEG_LAYER)), segments.at(i, SEG_WIDTH)));
+		tl.addSegment(s, vmap[v1], vmap[v2]);
+		if (objects)
+			objects->append(s.data());
+	}
+
+	BoardReader::Section vias = in.section(SEC_VIAS);
+	for(int i = 0; i < vias.count(); i++)
+	{
+		QSharedPointer<Via> v(new Via(
+				QPoint(vias.at(i, VIA_X), vias.at(i, VIA_Y)),
+				doc.padstack(in.uuid(vias.at(i, VIA_PADSTACK)))));
+		tl.myVias.insert(v);
+		if (objects)
+			objects->append(v.data());
+	}
+	tl.mIsDirty = true;
+}
+
+void BoardFile::loadAreas(PCBDoc &doc, BoardReader &in)
+{
+	BoardReader::Section areas = in.section(SEC_AREAS);
+	for(int i = 0; i < areas.count(); i++)
+	{
+		QSharedPointer<Area> a(new Area(&doc));
+		a->mNet = in.str(areas.at(i, AREA_NET));
+		a->mLayer = Layer(areas.at(i, AREA_LAYER));
+		a->mHatchStyle = static_cast<Area::HatchStyle>(
+					qBound(0, areas.at(i, AREA_HATCH), 2));
+		a->mConnectSMT = areas.at(i, AREA_CONNSMT) != 0;
+		a->mPoly = in.polygon(areas.at(i, AREA_POLYGON));
+		doc.mAreas.append(a);
+	}
+}
@@ -0,0 +1,92 @@
+/*
+	Copyright (C) 2010-2011 Igor Izyumin
+
+	This file is part of xpcb.
+
+	xpcb is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	xpcb is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with xpcb.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef BOARDFILE_H
+#define BOARDFILE_H
+
+#include <QList>
+
+class QIODevice;
+class QFile;
+class QXmlStreamWriter;
+class PCBDoc;
+class PCBObject;
+class BoardReader;
+
+/// Reads and writes boards in the binary xpcb format.
+
+/// A binary board (.xpcbb) holds the same data as an XML board, laid out so
+/// that it can be loaded straight out of a memory-mapped file.  The file
+/// starts with a header and a section directory:
+///
+///		char[4] magic ("XPCB"), quint16 version, quint16 reserved,
+///		quint32 number of sections,
+///		{quint32 id, quint32 offset, quint32 count, quint32 fields} per section
+///
+/// Each section is an array of count fixed-width records made up of fields
+/// little-endian 32-bit integers.  Names and other text are stored once in a
+/// string table and referred to by index (-1 for an empty string); other
+/// references (segment to vertex, area to polygon, etc.) are record indices.
+/// Padstacks and footprints are few and small, so they are stored as
+/// embedded XML.
+///
+/// Readers skip unknown sections and read missing fields as 0, so sections
+/// and fields can be added without changing the version.  The version only
+/// changes when the meaning of an existing field does.
+class BoardFile
+{
+public:
+	/// File name extension of binary boards
+	static const char* extension() { return "xpcbb"; }
+
+	/// Returns true if the data at the current position of a device is a
+	/// binary board.  Does not consume any data.
+	static bool isBinary(QIODevice &dev);
+
+	/// Writes a board to a device.  Returns false if there was an error.
+	/// If objects is not NULL, the parts, vertices, segments, vias, areas
+	/// and texts are appended to it in the order of their records.
+	static bool save(PCBDoc &doc, QIODevice &dev,
+					 QList<const PCBObject*>* objects = NULL);
+
+	/// Loads a board from a file, mapping the file into memory if possible.
+	/// Returns false if there was an error.
+	static bool load(PCBDoc &doc, QFile &file);
+	/// Loads a board from a buffer.  Returns false if there was an error.
+	/// If objects is not NULL, the objects loaded are appended to it in the
+	/// same order as by save(), with NULL for records that were skipped.
+	static bool load(PCBDoc &doc, const uchar* data, qint64 size,
+					 QList<PCBObject*>* objects = NULL);
+
+	/// Converts a board in a buffer to the XML format.  Works directly on
+	/// the records without building a document, so it is safe to call from
+	/// any thread.  Returns false if the data is not a valid binary board.
+	static bool writeXml(const uchar* data, qint64 size,
+						 QXmlStreamWriter &writer);
+
+private:
+	static void loadParts(PCBDoc &doc, BoardReader &in);
+	static void loadNetlist(PCBDoc &doc, BoardReader &in);
+	static void loadTraces(PCBDoc &doc, BoardReader &in,
+						   QList<PCBObject*>* objects);
+	static void loadAreas(PCBDoc &doc, BoardReader &in);
+};
+
+#endif // BOARDFILE_H
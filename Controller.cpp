@@ -52,8 +52,8 @@ void Controller::registerLayerWidget(LayerWidget *widget)
 	mLayerWidget = widget;
 	if (doc())
 		mLayerWidget->layersChanged(doc()->layerList());
-	connect(mLayerWidget, SIGNAL(layerVisibilityChanged()), this, SLOT(onDocumentChanged()));
-	connect(mLayerWidget, SIGNAL(currLayerChanged(const Layer&)), this, SLOT(onDocumentChanged()));
+	connect(mLayerWidget, SIGNAL(layerVisibilityChanged()), this, SLOT(onLayerVisibilityChanged()));
+	connect(mLayerWidget, SIGNAL(currLayerChanged(const Layer&)), this, SLOT(onCurrLayerChanged()));
 }
 
 void Controller::registerDoc(Document* doc)
@@ -64,16 +64,20 @@ void Controller::registerDoc(Document* doc)
 		if (mLayerWidget)
 			mLayerWidget->layersChanged(mDoc->layerList());
 		connect(mDoc, SIGNAL(changed()), this, SLOT(onDocumentChanged()));
-		onDocumentChanged();
+		connect(mDoc, SIGNAL(areaChanged(QRect)), this, SLOT(onDocAreaChanged(QRect)));
+		connect(mDoc, SIGNAL(appearanceChanged()), this, SLOT(onDocAppearanceChanged()));
+		onDocAppearanceChanged();
 	}
 	else if (mDoc && !doc)
 	{
-		disconnect(mDoc, SIGNAL(changed()), this, SIGNAL(onDocumentChanged()));
+		disconnect(mDoc, SIGNAL(changed()), this, SLOT(onDocumentChanged()));
+		disconnect(mDoc, SIGNAL(areaChanged(QRect)), this, SLOT(onDocAreaChanged(QRect)));
+		disconnect(mDoc, SIGNAL(appearanceChanged()), this, SLOT(onDocAppearanceChanged()));
 		mDoc = NULL;
 		mSelectedObjs.clear();
 		mHiddenObjs.clear();
 		mEditor.clear();
-		onDocumentChanged();
+		onDocAppearanceChanged();
 	}
 	updateEditor();
 }
@@ -95,16 +99,78 @@ void Controller::draw(QPainter* painter, QRect &rect, const Layer& layer)
 	}
 	else
 	{
-		QList<QSharedPointer<PCBObject> > objs = doc()->findObjs(rect);
-		foreach(QSharedPointer<PCBObject> obj, objs)
+		drawObjects(painter, doc()->findObjs(rect), layer);
+	}
+}
+
+void Controller::drawObjects(QPainter* painter, const QList<QSharedPointer<PCBObject> > &objs,
+							 const Layer &layer)
+{
+	QList<QSharedPointer<PCBObject> > hidden = hiddenObjs();
+	if (hidden.isEmpty())
+	{
+		drawObjList(painter, objs, layer);
+		return;
+	}
+	QList<QSharedPointer<PCBObject> > shown;
+	foreach(QSharedPointer<PCBObject> obj, objs)
+	{
+		if (!hidden.contains(obj))
+			shown.append(obj);
+	}
+	drawObjList(painter, shown, layer);
+}
+
+void Controller::drawObjList(QPainter* painter, const QList<QSharedPointer<PCBObject> > &objs,
+							 const Layer &layer,
+							 const Footprint::ShapeSet* shapes)
+{
+	bool batch = XPcb::lod(painter) != XPcb::LOD_FULL;
+	double px = XPcb::pixelSize(painter);
+	QVector<QLine> hairlines;
+	foreach(QSharedPointer<PCBObject> obj, objs)
+	{
+		if (!obj->layers().contains(layer))
+			continue;
+		if (batch)
+		{
+			Segment* s = qobject_cast<Segment*>(obj.data());
+			if (s && s->layer() == layer && s->width() < px
+					&& s->v1() && s->v2())
+			{
+				hairlines.append(QLine(s->v1()->pos(), s->v2()->pos()));
+				continue;
+			}
+		}
+		if (shapes)
 		{
-			if (!mLayerWidget->isLayerVisible(Layer::LAY_SELECTION) ||
-				!mHiddenObjs.contains(obj))
-				obj->draw(painter, layer);
+			Part* part = qobject_cast<Part*>(obj.data());
+			if (part)
+			{
+				part->draw(painter, layer, *shapes);
+				continue;
+			}
 		}
+		obj->draw(painter, layer);
+	}
+	if (!hairlines.isEmpty())
+	{
+		painter->save();
+		QPen pen = painter->pen();
+		pen.setWidth(0);
+		painter->setPen(pen);
+		painter->drawLines(hairlines);
+		painter->restore();
 	}
 }
 
+QList<QSharedPointer<PCBObject> > Controller::hiddenObjs() const
+{
+	if (!mLayerWidget || !mLayerWidget->isLayerVisible(Layer::LAY_SELECTION))
+		return QList<QSharedPointer<PCBObject> >();
+	return mHiddenObjs;
+}
+
 bool Controller::eventFilter(QObject *, QEvent *event)
 {
 	event->accept();
@@ -212,6 +278,7 @@ void Controller::mouseReleaseEvent(QMouseEvent *event)
 void Controller::updateEditor()
 {
 	mEditor.clear();
+	invalidateHidden();
 	mHiddenObjs.clear();
 	if (mSelectedObjs.size() == 1)
 	{
@@ -247,15 +314,27 @@ void Controller::selectObj(QSharedPointer<PCBObject> obj)
 void Controller::hideObj(QSharedPointer<PCBObject> obj)
 {
 	mHiddenObjs.append(obj);
+	if (mView)
+		mView->invalidate(obj->bbox());
 }
 
 void Controller::unhideObj(QSharedPointer<PCBObject> obj)
 {
-	mHiddenObjs.removeAll(obj);
+	if (mHiddenObjs.removeAll(obj) && mView)
+		mView->invalidate(obj->bbox());
+}
+
+void Controller::invalidateHidden()
+{
+	if (!mView)
+		return;
+	foreach(QSharedPointer<PCBObject> obj, mHiddenObjs)
+		mView->invalidate(obj->bbox());
 }
 
 void Controller::onEditorOverlayChanged()
 {
+	// the board is cached, so only the overlay gets redrawn
 	mView->update();
 }
 
@@ -273,7 +352,34 @@ void Controller::onEditorActionsChanged()
 
 void Controller::onDocumentChanged()
 {
-	mView->update();
+	// edited objects have already been invalidated through areaChanged();
+	// ratlines aren't cached, so only the ones that moved need a repaint
+	PCBDoc* doc = dynamic_cast<PCBDoc*>(mDoc);
+	if (doc)
+		mView->updateArea(doc->traceList()->takeRatsChangedArea());
+}
+
+void Controller::onCurrLayerChanged()
+{
+	// the active layer is drawn on top of the others
+	mView->updateBoard();
+}
+
+void Controller::onDocAreaChanged(const QRect &area)
+{
+	mView->invalidate(area);
+}
+
+void Controller::onDocAppearanceChanged()
+{
+	mView->invalidateAll();
+}
+
+void Controller::onLayerVisibilityChanged()
+{
+	// hidden objects are only hidden while the selection layer is visible
+	invalidateHidden();
+	mView->updateBoard();
 }
 
 QPoint Controller::snapToPlaceGrid(const QPoint &p) const
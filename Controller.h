@@ -28,6 +28,7 @@
 #include <QUndoCommand>
 #include "PCBView.h"
 #include "PCBObject.h"
+#include "Footprint.h"
 #include "Editor.h"
 
 class Document;
@@ -58,12 +59,25 @@ public:
 	void registerDoc(Document* doc);
 
 	void draw(QPainter* painter, QRect &rect, const Layer &layer);
+	/// Draws the given document objects on a layer, skipping hidden ones.
+	void drawObjects(QPainter* painter, const QList<QSharedPointer<PCBObject> > &objs,
+					 const Layer &layer);
+	/// Draws objects on a layer.  When zoomed out, traces that are thinner
+	/// than a pixel are collected and drawn with a single drawLines() call.
+	/// Doesn't use any controller state, so it can be called from any thread,
+	/// provided that parts are given private footprint shapes.
+	static void drawObjList(QPainter* painter, const QList<QSharedPointer<PCBObject> > &objs,
+							const Layer &layer,
+							const Footprint::ShapeSet* shapes = NULL);
 
 	bool docIsOpen() {return doc() != NULL;}
 
 	void selectObj(QSharedPointer<PCBObject> obj);
 	void hideObj(QSharedPointer<PCBObject> obj);
 	void unhideObj(QSharedPointer<PCBObject> obj);
+	/// Returns the objects that should not be drawn (the objects hidden by
+	/// the editor, if the selection layer is visible).
+	QList<QSharedPointer<PCBObject> > hiddenObjs() const;
 
 	Document* doc() {return mDoc; }
 	PCBView* view() {return mView; }
@@ -92,6 +106,10 @@ protected slots:
 	void onEditorFinished();
 	void onEditorActionsChanged();
 	void onDocumentChanged();
+	void onCurrLayerChanged();
+	void onDocAreaChanged(const QRect &area);
+	void onDocAppearanceChanged();
+	void onLayerVisibilityChanged();
 
 protected:
 	virtual bool eventFilter(QObject *watched, QEvent *event);
@@ -100,6 +118,8 @@ protected:
 	void mouseReleaseEvent(QMouseEvent *event);
 	void updateEditor();
 	void updateActions();
+	/// Invalidates the cached drawing of the hidden objects.
+	void invalidateHidden();
 
 	PCBView* mView;
 	Document* mDoc;
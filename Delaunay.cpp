@@ -0,0 +1,446 @@
+/*
+	Copyright (C) 2010-2011 Igor Izyumin
+
+	This file is part of xpcb.
+
+	xpcb is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	xpcb is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with xpcb.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cmath>
+#include <limits>
+#include <QtAlgorithms>
+#include "Delaunay.h"
+
+namespace
+{
+/// Orders point indices by x, then by y.
+class PointLess
+{
+public:
+	PointLess(const QVector<QPoint> &pts) : mPts(pts) {}
+	bool operator()(int a, int b) const
+	{
+		const QPoint &p = mPts[a];
+		const QPoint &q = mPts[b];
+		return p.x() < q.x() || (p.x() == q.x() && p.y() < q.y());
+	}
+private:
+	const QVector<QPoint> &mPts;
+};
+
+/// Orders point indices by a precomputed distance.
+class DistLess
+{
+public:
+	DistLess(const QVector<double> &dists) : mDists(dists) {}
+	bool operator()(int a, int b) const { return mDists[a] < mDists[b]; }
+private:
+	const QVector<double> &mDists;
+};
+
+const double INF = std::numeric_limits<double>::infinity();
+
+/// Returns true if p, q, r make a counterclockwise turn.
+inline bool orient(double px, double py, double qx, double qy,
+				   double rx, double ry)
+{
+	return (qy - py) * (rx - qx) - (qx - px) * (ry - qy) < 0;
+}
+
+/// Returns true if p lies inside the circumcircle of a, b, c.
+inline bool inCircle(double ax, double ay, double bx, double by,
+					 double cx, double cy, double px, double py)
+{
+	double dx = ax - px, dy = ay - py;
+	double ex = bx - px, ey = by - py;
+	double fx = cx - px, fy = cy - py;
+	double ap = dx * dx + dy * dy;
+	double bp = ex * ex + ey * ey;
+	double cp = fx * fx + fy * fy;
+	return dx * (ey * cp - bp * fy)
+			- dy * (ex * cp - bp * fx)
+			+ ap * (ex * fy - ey * fx) < 0;
+}
+
+inline double dist2(double ax, double ay, double bx, double by)
+{
+	double dx = ax - bx, dy = ay - by;
+	return dx * dx + dy * dy;
+}
+
+/// Returns the offset of the circumcenter of a, b, c from a.  The result is
+/// infinite or NaN if the points are collinear.
+inline void circumOffset(double ax, double ay, double bx, double by,
+						 double cx, double cy, double &x, double &y)
+{
+	double dx = bx - ax, dy = by - ay;
+	double ex = cx - ax, ey = cy - ay;
+	double bl = dx * dx + dy * dy;
+	double cl = ex * ex + ey * ey;
+	double d = 0.5 / (dx * ey - dy * ex);
+	x = (ey * bl - dy * cl) * d;
+	y = (dx * cl - ex * bl) * d;
+}
+
+inline double circumradius(double ax, double ay, double bx, double by,
+						   double cx, double cy)
+{
+	double x, y;
+	circumOffset(ax, ay, bx, by, cx, cy, x, y);
+	return x * x + y * y;
+}
+
+/// Monotonic function of the angle of (dx, dy), in [0, 1).
+inline double pseudoAngle(double dx, double dy)
+{
+	double s = qAbs(dx) + qAbs(dy);
+	if (s == 0)
+		return 0;
+	double p = dx / s;
+	return (dy > 0 ? 3 - p : 1 + p) / 4;
+}
+}
+
+Delaunay::Delaunay(const QVector<QPoint> &points)
+	: mPoints(points), mHullStart(-1), mCx(0), mCy(0)
+{
+	// set aside duplicate points; the sweep cannot handle them
+	QVector<int> order(points.size());
+	for(int i = 0; i < order.size(); i++)
+		order[i] = i;
+	qStableSort(order.begin(), order.end(), PointLess(mPoints));
+	for(int k = 0; k < order.size(); k++)
+	{
+		if (k > 0 && mPoints[order[k]] == mPoints[mUnique.last()])
+			mDups.append(qMakePair(order[k], mUnique.last()));
+		else
+			mUnique.append(order[k]);
+	}
+	triangulate();
+}
+
+QVector<QPair<int, int> > Delaunay::edges() const
+{
+	QVector<QPair<int, int> > out;
+	QVector<bool> used(mPoints.size(), false);
+	for(int e = 0; e < mTriangles.size(); e++)
+	{
+		// each interior edge is shared by two half-edges; take one of them
+		if (mHalfedges[e] < e)
+		{
+			int a = mTriangles[e];
+			int b = mTriangles[e % 3 == 2 ? e - 2 : e + 1];
+			out.append(qMakePair(a, b));
+			used[a] = used[b] = true;
+		}
+	}
+	// join points that are not part of any triangle (collinear input, or
+	// points the sweep had to skip) to their neighbours in sorted order
+	for(int k = 0; k < mUnique.size(); k++)
+	{
+		if (used[mUnique[k]])
+			continue;
+		if (k > 0)
+			out.append(qMakePair(mUnique[k-1], mUnique[k]));
+		if (k < mUnique.size() - 1 && !mTriangles.isEmpty())
+			out.append(qMakePair(mUnique[k], mUnique[k+1]));
+	}
+	for(int i = 0; i < mDups.size(); i++)
+		out.append(mDups[i]);
+	return out;
+}
+
+void Delaunay::triangulate()
+{
+	int n = mUnique.size();
+	if (n < 3)
+		return;
+
+	// work relative to the bounding box to preserve precision
+	int minX = mPoints[mUnique[0]].x();
+	int minY = mPoints[mUnique[0]].y();
+	for(int i = 1; i < n; i++)
+		minY = qMin(minY, mPoints[mUnique[i]].y());
+	mX.resize(n);
+	mY.resize(n);
+	double maxX = 0, maxY = 0;
+	for(int i = 0; i < n; i++)
+	{
+		mX[i] = double(mPoints[mUnique[i]].x()) - minX;
+		mY[i] = double(mPoints[mUnique[i]].y()) - minY;
+		maxX = qMax(maxX, mX[i]);
+		maxY = qMax(maxY, mY[i]);
+	}
+	double cx = maxX / 2, cy = maxY / 2;
+
+	// pick a seed point close to the center
+	int i0 = 0;
+	double minDist = INF;
+	for(int i = 0; i < n; i++)
+	{
+		double d = dist2(cx, cy, mX[i], mY[i]);
+		if (d < minDist)
+		{
+			i0 = i;
+			minDist = d;
+		}
+	}
+	// find the point closest to the seed
+	int i1 = 0;
+	minDist = INF;
+	for(int i = 0; i < n; i++)
+	{
+		if (i == i0)
+			continue;
+		double d = dist2(mX[i0], mY[i0], mX[i], mY[i]);
+		if (d < minDist)
+		{
+			i1 = i;
+			minDist = d;
+		}
+	}
+	// find the third point which forms the smallest circumcircle
+	int i2 = 0;
+	double minRadius = INF;
+	for(int i = 0; i < n; i++)
+	{
+		if (i == i0 || i == i1)
+			continue;
+		double r = circumradius(mX[i0], mY[i0], mX[i1], mY[i1], mX[i], mY[i]);
+		if (r < minRadius)
+		{
+			i2 = i;
+			minRadius = r;
+		}
+	}
+	if (minRadius == INF)
+		return; // all points are collinear
+
+	if (orient(mX[i0], mY[i0], mX[i1], mY[i1], mX[i2], mY[i2]))
+		qSwap(i1, i2);
+
+	double ox, oy;
+	circumOffset(mX[i0], mY[i0], mX[i1], mY[i1], mX[i2], mY[i2], ox, oy);
+	mCx = mX[i0] + ox;
+	mCy = mY[i0] + oy;
+
+	// sort the points by distance from the seed triangle circumcenter
+	QVector<double> dists(n);
+	QVector<int> ids(n);
+	for(int i = 0; i < n; i++)
+	{
+		ids[i] = i;
+		dists[i] = dist2(mX[i], mY[i], mCx, mCy);
+	}
+	qSort(ids.begin(), ids.end(), DistLess(dists));
+
+	int hashSize = int(std::ceil(std::sqrt(double(n))));
+	mHullPrev.fill(0, n);
+	mHullNext.fill(0, n);
+	mHullTri.fill(0, n);
+	mHullHash.fill(-1, hashSize);
+	mEdgeStack.fill(0, 512);
+
+	mHullStart = i0;
+	mHullNext[i0] = mHullPrev[i2] = i1;
+	mHullNext[i1] = mHullPrev[i0] = i2;
+	mHullNext[i2] = mHullPrev[i1] = i0;
+	mHullTri[i0] = 0;
+	mHullTri[i1] = 1;
+	mHullTri[i2] = 2;
+	mHullHash[hashKey(mX[i0], mY[i0])] = i0;
+	mHullHash[hashKey(mX[i1], mY[i1])] = i1;
+	mHullHash[hashKey(mX[i2], mY[i2])] = i2;
+
+	int maxTriangles = qMax(2 * n - 5, 0);
+	mTriangles.reserve(maxTriangles * 3);
+	mHalfedges.reserve(maxTriangles * 3);
+	addTriangle(i0, i1, i2, -1, -1, -1);
+
+	for(int k = 0; k < n; k++)
+	{
+		int i = ids[k];
+		double x = mX[i], y = mY[i];
+		if (i == i0 || i == i1 || i == i2)
+			continue;
+
+		// find a visible edge on the convex hull using the edge hash
+		int start = 0;
+		int key = hashKey(x, y);
+		for(int j = 0; j < hashSize; j++)
+		{
+			start = mHullHash[(key + j) % hashSize];
+			if (start != -1 && start != mHullNext[start])
+				break;
+		}
+		start = mHullPrev[start];
+		int e = start;
+		int q;
+		for(;;)
+		{
+			q = mHullNext[e];
+			if (orient(x, y, mX[e], mY[e], mX[q], mY[q]))
+				break;
+			e = q;
+			if (e == start)
+			{
+				e = -1;
+				break;
+			}
+		}
+		if (e == -1)
+			continue; // numerically degenerate; edges() joins it up
+
+		// add the first triangle from the point
+		int t = addTriangle(e, i, mHullNext[e], -1, -1, mHullTri[e]);
+		// flip triangles from the point until they are Delaunay
+		mHullTri[i] = legalize(t + 2);
+		mHullTri[e] = t;
+
+		// walk forward through the hull, adding more triangles
+		int next = mHullNext[e];
+		for(;;)
+		{
+			q = mHullNext[next];
+			if (!orient(x, y, mX[next], mY[next], mX[q], mY[q]))
+				break;
+			t = addTriangle(next, i, q, mHullTri[i], -1, mHullTri[next]);
+			mHullTri[i] = legalize(t + 2);
+			mHullNext[next] = next; // mark as removed
+			next = q;
+		}
+		// walk backward from the other side
+		if (e == start)
+		{
+			for(;;)
+			{
+				q = mHullPrev[e];
+				if (!orient(x, y, mX[q], mY[q], mX[e], mY[e]))
+					break;
+				t = addTriangle(q, i, e, -1, mHullTri[e], mHullTri[q]);
+				legalize(t + 2);
+				mHullTri[q] = t;
+				mHullNext[e] = e; // mark as removed
+				e = q;
+			}
+		}
+
+		// update the hull
+		mHullStart = mHullPrev[i] = e;
+		mHullNext[e] = mHullPrev[next] = i;
+		mHullNext[i] = next;
+		mHullHash[hashKey(x, y)] = i;
+		mHullHash[hashKey(mX[e], mY[e])] = e;
+	}
+
+	// map back to input indices
+	for(int t = 0; t < mTriangles.size(); t++)
+		mTriangles[t] = mUnique[mTriangles[t]];
+}
+
+int Delaunay::legalize(int a)
+{
+	int i = 0;
+	int ar = 0;
+	for(;;)
+	{
+		int b = mHalfedges[a];
+		int a0 = a - a % 3;
+		ar = a0 + (a + 2) % 3;
+
+		if (b == -1)
+		{
+			// convex hull edge
+			if (i == 0)
+				break;
+			a = mEdgeStack[--i];
+			continue;
+		}
+
+		int b0 = b - b % 3;
+		int al = a0 + (a + 1) % 3;
+		int bl = b0 + (b + 2) % 3;
+
+		int p0 = mTriangles[ar];
+		int pr = mTriangles[a];
+		int pl = mTriangles[al];
+		int p1 = mTriangles[bl];
+
+		if (inCircle(mX[p0], mY[p0], mX[pr], mY[pr], mX[pl], mY[pl],
+					 mX[p1], mY[p1]))
+		{
+			// flip the shared edge
+			mTriangles[a] = p1;
+			mTriangles[b] = p0;
+
+			int hbl = mHalfedges[bl];
+			if (hbl == -1)
+			{
+				// the edge was swapped on the other side of the hull
+				int e = mHullStart;
+				do
+				{
+					if (mHullTri[e] == bl)
+					{
+						mHullTri[e] = a;
+						break;
+					}
+					e = mHullPrev[e];
+				} while(e != mHullStart);
+			}
+			link(a, hbl);
+			link(b, mHalfedges[ar]);
+			link(ar, bl);
+
+			int br = b0 + (b + 1) % 3;
+			if (i < mEdgeStack.size())
+				mEdgeStack[i++] = br;
+		}
+		else
+		{
+			if (i == 0)
+				break;
+			a = mEdgeStack[--i];
+		}
+	}
+	return ar;
+}
+
+int Delaunay::addTriangle(int i0, int i1, int i2, int a, int b, int c)
+{
+	int t = mTriangles.size();
+	mTriangles.append(i0);
+	mTriangles.append(i1);
+	mTriangles.append(i2);
+	mHalfedges.append(-1);
+	mHalfedges.append(-1);
+	mHalfedges.append(-1);
+	link(t, a);
+	link(t + 1, b);
+	link(t + 2, c);
+	return t;
+}
+
+void Delaunay::link(int a, int b)
+{
+	mHalfedges[a] = b;
+	if (b != -1)
+		mHalfedges[b] = a;
+}
+
+int Delaunay::hashKey(double x, double y) const
+{
+	int size = mHullHash.size();
+	return int(std::floor(pseudoAngle(x - mCx, y - mCy) * size)) % size;
+}
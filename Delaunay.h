@@ -0,0 +1,74 @@
+/*
+	Copyright (C) 2010-2011 Igor Izyumin
+
+	This file is part of xpcb.
+
+	xpcb is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	xpcb is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with xpcb.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef DELAUNAY_H
+#define DELAUNAY_H
+
+#include <QVector>
+#include <QPair>
+#include <QPoint>
+
+/// Delaunay triangulation of a set of points.
+
+/// The triangulation is built with a sweep-hull algorithm: points are added
+/// in order of distance from a seed triangle, each new point is connected to
+/// the visible part of the convex hull, and the new triangles are then
+/// legalized by edge flipping.  Expected running time is O(n log n).
+///
+/// The Delaunay triangulation contains the Euclidean minimum spanning tree of
+/// its points, so edges() is a sparse candidate set for building ratsnests.
+class Delaunay
+{
+public:
+	Delaunay(const QVector<QPoint> &points);
+
+	/// Returns the triangles as triples of point indices.
+	const QVector<int>& triangles() const { return mTriangles; }
+	/// Returns the edges of the triangulation as pairs of point indices.
+	/// Duplicate points are joined to the first point at the same position.
+	/// If all points are collinear, there are no triangles, and the edges
+	/// join neighbouring points along the line.
+	QVector<QPair<int, int> > edges() const;
+
+private:
+	void triangulate();
+	int legalize(int a);
+	int addTriangle(int i0, int i1, int i2, int a, int b, int c);
+	void link(int a, int b);
+	int hashKey(double x, double y) const;
+
+	QVector<QPoint> mPoints;
+	/// Indices of the distinct points, in sorted order
+	QVector<int> mUnique;
+	/// Duplicate points, paired with the point they duplicate
+	QVector<QPair<int, int> > mDups;
+
+	/// Coordinates of the distinct points, relative to their bounding box
+	QVector<double> mX, mY;
+	QVector<int> mTriangles;
+	QVector<int> mHalfedges;
+
+	// sweep hull state
+	QVector<int> mHullPrev, mHullNext, mHullTri, mHullHash;
+	int mHullStart;
+	double mCx, mCy;
+	QVector<int> mEdgeStack;
+};
+
+#endif // DELAUNAY_H
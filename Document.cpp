@@ -19,12 +19,23 @@
 
 #include "Document.h"
 #include "Log.h"
+#include "FootprintCache.h"
+#include "XmlCheck.h"
+#include "BoardFile.h"
+#include "XmlAttr.h"
+#include "AtomicFile.h"
 #include <QFile>
+#include <QBuffer>
+#include <QThread>
+#include <QtConcurrentRun>
 #include <QXmlStreamReader>
 #include <QXmlStreamWriter>
 #include <QtXmlPatterns/QXmlSchema>
 #include <QtXmlPatterns/QXmlSchemaValidator>
 #include <QSettings>
+#include <QFileInfo>
+#include <QScopedPointer>
+#include <QCryptographicHash>
 #include "Polygon.h"
 #include "Area.h"
 #include "Trace.h"
@@ -53,18 +64,24 @@ bool Document::isModified()
 void Document::doCommand(QUndoCommand *cmd)
 {
 	mUndoStack.push(cmd);
+	Footprint::geometryChanged();
+	emit appearanceChanged();
 	emit changed();
 }
 
 void Document::undo()
 {
 	mUndoStack.undo();
+	Footprint::geometryChanged();
+	emit appearanceChanged();
 	emit changed();
 }
 
 void Document::redo()
 {
 	mUndoStack.redo();
+	Footprint::geometryChanged();
+	emit appearanceChanged();
 	emit changed();
 }
 
@@ -83,8 +100,8 @@ bool Document::loadFromFile(const QString& path)
 
 bool Document::saveToFile(const QString &file)
 {
-	QFile outFile(file);
-	if (!outFile.open(QIODevice::WriteOnly))
+	AtomicFile outFile(file);
+	if (!outFile.open())
 	{
 		Log::instance().error(QString("Unable to open file %1 for writing").arg(file));
 		return false;
@@ -92,17 +109,99 @@ bool Document::saveToFile(const QString &file)
 
 	QXmlStreamWriter writer(&outFile);
 
-	bool ret = saveToXml(writer);
+	bool ret = saveToXml(writer) && outFile.commit();
 
-	outFile.close();
+	// only a committed file makes the document clean
+	if (ret)
+	{
+		mUndoStack.setClean();
+		trustFile(file);
+	}
+	else
+		Log::instance().error(QString("Unable to write file %1").arg(file));
 	return ret;
 }
 
+/// Returns the part of a file stamp that is cheap to compute: the
+/// modification time and the size.
+static QString quickStamp(const QFileInfo &info)
+{
+	return QString("%1|%2|").arg(info.lastModified().toString(Qt::ISODate))
+			.arg(info.size());
+}
+
+/// Returns a hash of the contents of a file.
+static QString contentHash(const QString &path)
+{
+	QCryptographicHash hash(QCryptographicHash::Md5);
+	QFile file(path);
+	if (file.open(QIODevice::ReadOnly))
+	{
+		QByteArray chunk;
+		while(!(chunk = file.read(1 << 16)).isEmpty())
+			hash.addData(chunk);
+	}
+	return hash.result().toHex();
+}
+
+/// Identifies a version of a file.  Modification times have a resolution of
+/// a second, so a file rewritten within the same second with the same size
+/// is told apart by the hash of its contents.
+static QString fileStamp(const QFileInfo &info)
+{
+	return QString("%1%2|%3").arg(quickStamp(info))
+			.arg(contentHash(info.absoluteFilePath()))
+			.arg(info.absoluteFilePath());
+}
+
+Document::LoadMode Document::loadMode(const QFile &file)
+{
+	QSettings s;
+	if (s.value("xml/fullValidation", false).toBool())
+		return LoadValidated;
+	// only hash the file if its time and size match a file xpcb wrote
+	QFileInfo info(file);
+	QString quick = quickStamp(info);
+	QString suffix = "|" + info.absoluteFilePath();
+	QStringList files = s.value("xml/savedFiles").toStringList();
+	foreach(const QString &f, files)
+	{
+		if (f.startsWith(quick) && f.endsWith(suffix))
+			return f == fileStamp(info) ? LoadTrusted : LoadChecked;
+	}
+	return LoadChecked;
+}
+
+void Document::trustFile(const QString &path)
+{
+	const int maxFiles = 50;
+	QFileInfo info(path);
+	QSettings s;
+	QStringList files = s.value("xml/savedFiles").toStringList();
+	// forget earlier versions of the file
+	QString suffix = "|" + info.absoluteFilePath();
+	for(int i = files.size() - 1; i >= 0; i--)
+	{
+		if (files[i].endsWith(suffix))
+			files.removeAt(i);
+	}
+	files.prepend(fileStamp(info));
+	while(files.size() > maxFiles)
+		files.removeLast();
+	s.setValue("xml/savedFiles", files);
+}
+
 /////////////////////////////// FPDOC /////////////////////////////////
 
-FPDoc::FPDoc()
-	: mFp(QSharedPointer<Footprint>(new Footprint()))
+FPDoc::FPDoc(bool readOnly)
+	: mFp(QSharedPointer<Footprint>(new Footprint())), mReadOnly(readOnly)
+{
+}
+
+void FPDoc::setFootprint(QSharedPointer<Footprint> fp)
 {
+	mFp = mReadOnly ? fp : fp->clone();
+	emit appearanceChanged();
 }
 
 QList<Layer> FPDoc::layerList(LayerOrder order, Document::LayerMask mask)
@@ -273,8 +372,17 @@ QList<QSharedPointer<PCBObject> > FPDoc::findObjs(QRect &rect)
 
 PCBDoc::PCBDoc()
 		: mNumLayers(2), mTraceList(new TraceList(this)),
-		  mNetlist(new Netlist())
+		  mNetlist(new Netlist()), mNumTouched(0), mRevision(0),
+		  mPadstackRevision(0), mShapesRevision(0), mSavePending(false), mSaveOk(true), mSaveRevision(0), mRecovered(false)
+{
+	connect(&mSave, SIGNAL(finished()), this, SLOT(finishSave()));
+}
+
+PCBDoc::~PCBDoc()
 {
+	// the worker doesn't use the document, but the file should be complete
+	// before xpcb exits
+	mSave.waitForFinished();
 }
 
 QSharedPointer<Footprint> PCBDoc::getFootprint(QUuid uuid)
@@ -288,7 +396,11 @@ QSharedPointer<Footprint> PCBDoc::getFootprint(QUuid uuid)
 		return QSharedPointer<Footprint>();
 	QSharedPointer<Footprint> ptr = f->loadFootprint();
 	if (!ptr.isNull())
+	{
 		mFootprints.insert(uuid, ptr);
+		if (mJournal)
+			mJournal->footprintAdded(ptr);
+	}
 	return ptr;
 }
 
@@ -315,7 +427,10 @@ QList<QSharedPointer<PartPin> > PCBDoc::partPins() const
 void PCBDoc::addText(QSharedPointer<Text> t)
 {
 	if (!mTexts.contains(t))
+	{
 		mTexts.append(t);
+		objectAdded(t);
+	}
 	else
 		Log::instance().error("Text object already in document");
 }
@@ -325,6 +440,7 @@ void PCBDoc::removeText(QSharedPointer<Text> t)
 	if (mTexts.contains(t))
 	{
 		mTexts.removeOne(t);
+		objectRemoved(t);
 		Log::instance().message("Text object deleted");
 	}
 	else
@@ -367,89 +483,263 @@ QList<QSharedPointer<PCBObject> > PCBDoc::objects()
 	return out;
 }
 
+/// Returns false for part reference and value texts that are hidden.
+static bool isVisibleObj(const PCBObject* obj)
+{
+	const Part* p = qobject_cast<const Part*>(obj->parent());
+	if (!p)
+		return true;
+	if (obj == p->refdesText().data())
+		return p->refVisible();
+	if (obj == p->valueText().data())
+		return p->valueVisible();
+	return true;
+}
+
+/// Selection priority of an object when several are hit at once.
+static int hitPriority(const QSharedPointer<PCBObject> &obj)
+{
+	if (qobject_cast<Part*>(obj.data()))
+		return 0;
+	if (qobject_cast<Text*>(obj.data()))
+		return 1;
+	if (qobject_cast<Segment*>(obj.data()))
+		return 2;
+	if (qobject_cast<Vertex*>(obj.data()))
+		return 3;
+	return 4;
+}
+
+static bool hitPriorityLessThan(const QSharedPointer<PCBObject> &a,
+								const QSharedPointer<PCBObject> &b)
+{
+	return hitPriority(a) < hitPriority(b);
+}
+
 QList<QSharedPointer<PCBObject> > PCBDoc::findObjs(QRect &rect)
 {
-	QList<QSharedPointer<PCBObject> > out;
+	QList<QSharedPointer<PCBObject> > out = mIndex.query(rect);
 
-	foreach(QSharedPointer<Segment> s, mTraceList->segments())
+	QMutableListIterator<QSharedPointer<PCBObject> > i(out);
+	while(i.hasNext())
 	{
-		if (rect.intersects(s->bbox()))
-			out.append(s);
+		if (!isVisibleObj(i.next().data()))
+			i.remove();
 	}
 
-	foreach(QSharedPointer<Vertex> v, mTraceList->vertices())
+	return out;
+}
+
+QList<QSharedPointer<PCBObject> > PCBDoc::findObjs(QPoint &pt, int dist)
+{
+	QRect hitRect(pt.x()-dist/2, pt.y()-dist/2, dist, dist);
+	QList<QSharedPointer<PCBObject> > out = findObjs(hitRect);
+
+	// parts and texts take precedence over traces, and traces over areas
+	qStableSort(out.begin(), out.end(), hitPriorityLessThan);
+
+	return out;
+}
+
+void PCBDoc::objectAdded(QSharedPointer<PCBObject> obj)
+{
+	if (mJournal)
+		mJournal->objectTouched(obj.data());
+	reindex(obj);
+	QSharedPointer<Part> p = obj.dynamicCast<Part>();
+	if (p)
 	{
-		if (rect.intersects(v->bbox()))
-			out.append(v);
+		indexPartTexts(p);
+		mTraceList->partChanged(p.data());
 	}
+}
 
-	foreach(QSharedPointer<Part> p, mParts)
+void PCBDoc::objectChanged(QSharedPointer<PCBObject> obj)
+{
+	if (!mIndex.contains(obj.data()))
+		return;
+	if (mJournal)
+		mJournal->objectTouched(obj.data());
+	reindex(obj);
+
+	QSharedPointer<Vertex> v = obj.dynamicCast<Vertex>();
+	if (v)
 	{
-		if (rect.intersects(p->bbox()))
-			out.append(p);
-		if (p->refVisible() && p->refdesText()->bbox().intersects(rect))
-			out.append(p->refdesText());
-		if (p->valueVisible() && p->valueText()->bbox().intersects(rect))
-			out.append(p->valueText());
+		foreach(QSharedPointer<Segment> s, v->segments())
+		{
+			if (mIndex.contains(s.data()))
+				reindex(s);
+		}
+		mTraceList->vertexMoved(v);
+	}
+	QSharedPointer<Part> p = obj.dynamicCast<Part>();
+	if (p)
+	{
+		indexPartTexts(p);
+		mTraceList->partChanged(p.data());
 	}
+	// pin nets are looked up by refdes
+	Part* owner = qobject_cast<Part*>(obj->parent());
+	if (owner && obj == owner->refdesText())
+		mTraceList->partChanged(owner);
+}
 
-	foreach(QSharedPointer<Text> t, mTexts)
+void PCBDoc::objectRemoved(QSharedPointer<PCBObject> obj)
+{
+	if (mJournal)
+		mJournal->objectRemoved(obj.data());
+	unindex(obj.data());
+	QSharedPointer<Part> p = obj.dynamicCast<Part>();
+	if (p)
 	{
-		if (rect.intersects(t->bbox()))
-			out.append(t);
+		foreach(QSharedPointer<PCBObject> t, mPartTexts.take(p.data()))
+			unindex(t.data());
+		mTraceList->partChanged(p.data(), true);
 	}
+}
 
-	foreach(QSharedPointer<Area> a, mAreas)
+void PCBDoc::indexPartTexts(QSharedPointer<Part> p)
+{
+	QList<QSharedPointer<PCBObject> > texts;
+	if (p->refdesText())
+		texts.append(p->refdesText());
+	if (p->valueText())
+		texts.append(p->valueText());
+
+	foreach(QSharedPointer<PCBObject> t, mPartTexts.value(p.data()))
 	{
-		if (rect.intersects(a->bbox()))
-			out.append(a);
+		if (!texts.contains(t))
+			unindex(t.data());
 	}
+	foreach(QSharedPointer<PCBObject> t, texts)
+		reindex(t);
+	mPartTexts.insert(p.data(), texts);
+}
 
-	return out;
+void PCBDoc::reindex(QSharedPointer<PCBObject> obj)
+{
+	QRect oldArea = mIndex.indexedRect(obj.data());
+	mIndex.insert(obj);
+	QRect newArea = mIndex.indexedRect(obj.data());
+	// report the two areas separately: an object moved across the board
+	// should not invalidate everything in between
+	if (oldArea != newArea)
+		touch(oldArea);
+	touch(newArea);
 }
 
-QList<QSharedPointer<PCBObject> > PCBDoc::findObjs(QPoint &pt, int dist)
+void PCBDoc::unindex(const PCBObject *obj)
 {
-	QList<QSharedPointer<PCBObject> > out;
-	QRect hitRect(pt.x()-dist/2, pt.y()-dist/2, dist, dist);
+	touch(mIndex.indexedRect(obj));
+	mIndex.remove(obj);
+}
+
+void PCBDoc::touch(const QRect &area)
+{
+	if (area.isEmpty())
+		return;
+	mNumTouched++;
+	emit areaChanged(area);
+}
+
+void PCBDoc::rebuildIndex()
+{
+	QList<QSharedPointer<PCBObject> > objs;
+	foreach(QSharedPointer<PCBObject> obj, objects())
+	{
+		if (obj)
+			objs.append(obj);
+	}
+	mIndex.load(objs);
 
+	mPartTexts.clear();
 	foreach(QSharedPointer<Part> p, mParts)
+		indexPartTexts(p);
+}
+
+/// Collects the objects modified by PCBObjEditCmds in a command tree.
+static void editedObjs(const QUndoCommand *cmd,
+					   QList<QSharedPointer<PCBObject> > &out)
+{
+	if (!cmd)
+		return;
+	const PCBObjEditCmd* edit = dynamic_cast<const PCBObjEditCmd*>(cmd);
+	if (edit)
+		out.append(edit->obj());
+	for(int i = 0; i < cmd->childCount(); i++)
+		editedObjs(cmd->child(i), out);
+}
+
+void PCBDoc::refreshEditedObjs(const QList<QSharedPointer<PCBObject> > &objs,
+							   int numTouched)
+{
+	foreach(QSharedPointer<PCBObject> obj, objs)
+		objectChanged(obj);
+	if (mPadstackRevision != mShapesRevision)
 	{
-		if (p->bbox().intersects(hitRect))
+		mShapesRevision = mPadstackRevision;
+		Footprint::geometryChanged();
+		// parts using an edited padstack change size
+		foreach(QSharedPointer<Part> p, mParts)
 		{
-			out.append(p);
+			if (p->bbox() != mIndex.indexedRect(p.data()))
+				objectChanged(p);
 		}
-		if (p->refVisible() && p->refdesText()->bbox().intersects(hitRect))
-			out.append(p->refdesText());
-		if (p->valueVisible() && p->valueText()->bbox().intersects(hitRect))
-			out.append(p->valueText());
+		emit appearanceChanged();
 	}
-	foreach(QSharedPointer<Text> t, mTexts)
+	else if (mNumTouched == numTouched)
 	{
-		if(t->bbox().intersects(hitRect))
-			out.append(t);
+		// other commands that don't go through the object hooks (e.g. layer
+		// or netlist edits) only need a redraw
+		emit appearanceChanged();
 	}
-	foreach(QSharedPointer<Segment> s, mTraceList->segments())
-	{
-		if (s->bbox().intersects(hitRect))
-			out.append(s);
-	}
-	foreach(QSharedPointer<Vertex> v, mTraceList->vertices())
-	{
-		if (v->bbox().intersects(hitRect))
-			out.append(v);
-	}
-    foreach(QSharedPointer<Area> a, mAreas)
-    {
-        if (a->bbox().intersects(hitRect))
-            out.append(a);
-    }
+}
 
-	return out;
+void PCBDoc::doCommand(QUndoCommand *cmd)
+{
+	// collect objects first: the stack owns the command once it is pushed
+	QList<QSharedPointer<PCBObject> > objs;
+	int numTouched = mNumTouched;
+	editedObjs(cmd, objs);
+	mUndoStack.push(cmd);
+	mRevision++;
+	refreshEditedObjs(objs, numTouched);
+	if (mJournal)
+		mJournal->commit();
+	emit changed();
+}
+
+void PCBDoc::undo()
+{
+	QList<QSharedPointer<PCBObject> > objs;
+	int numTouched = mNumTouched;
+	if (mUndoStack.canUndo())
+		editedObjs(mUndoStack.command(mUndoStack.index() - 1), objs);
+	mUndoStack.undo();
+	mRevision++;
+	refreshEditedObjs(objs, numTouched);
+	if (mJournal)
+		mJournal->commit();
+	emit changed();
+}
+
+void PCBDoc::redo()
+{
+	QList<QSharedPointer<PCBObject> > objs;
+	int numTouched = mNumTouched;
+	if (mUndoStack.canRedo())
+		editedObjs(mUndoStack.command(mUndoStack.index()), objs);
+	mUndoStack.redo();
+	mRevision++;
+	refreshEditedObjs(objs, numTouched);
+	if (mJournal)
+		mJournal->commit();
+	emit changed();
 }
 
 void PCBDoc::clearDoc()
 {
+	mRevision++;
 	mTraceList = QSharedPointer<TraceList>(new TraceList(this));
 
 	mParts.clear();
@@ -461,6 +751,9 @@ void PCBDoc::clearDoc()
 	mBoardOutline = Polygon();
 
 	mDefaultPadstack = QUuid();
+
+	mIndex.clear();
+	mPartTexts.clear();
 }
 
 QList<Layer> PCBDoc::layerList(LayerOrder order, Document::LayerMask mask)
@@ -535,11 +828,20 @@ QList<Layer> PCBDoc::layerList(LayerOrder order, Document::LayerMask mask)
 void PCBDoc::addPadstack(QSharedPointer<Padstack> ps)
 {
 	mPadstacks.insert(ps->uuid(), ps);
+	padstackChanged(ps);
 }
 
 void PCBDoc::removePadstack(QSharedPointer<Padstack> ps)
 {
 	mPadstacks.remove(ps->uuid());
+	padstackChanged(ps);
+}
+
+void PCBDoc::padstackChanged(QSharedPointer<Padstack>)
+{
+	mPadstackRevision++;
+	if (mJournal)
+		mJournal->padstacksChanged();
 }
 
 QSharedPointer<Padstack> PCBDoc::padstack(QUuid uuid)
@@ -553,6 +855,7 @@ void PCBDoc::addPart(QSharedPointer<Part> p)
 {
 	Q_ASSERT(!mParts.contains(p));
 	mParts.append(p);
+	objectAdded(p);
 	emit partsChanged();
 }
 
@@ -560,6 +863,7 @@ void PCBDoc::removePart(QSharedPointer<Part> p)
 {
 	Q_ASSERT(mParts.contains(p));
 	mParts.removeOne(p);
+	objectRemoved(p);
 	emit partsChanged();
 }
 
@@ -567,12 +871,14 @@ void PCBDoc::addArea(QSharedPointer<Area> a)
 {
 	Q_ASSERT(!mAreas.contains(a));
 	mAreas.append(a);
+	objectAdded(a);
 }
 
 void PCBDoc::removeArea(QSharedPointer<Area> a)
 {
 	Q_ASSERT(mAreas.contains(a));
 	mAreas.removeOne(a);
+	objectRemoved(a);
 }
 
 //////// XML PARSING /////////
@@ -613,19 +919,328 @@ bool validateFile(QIODevice &file, const QUrl &uri)
 	return validator.validate(&file, uri);
 }
 
+/// Validates a file against the schema, if its load mode calls for it, and
+/// rewinds it.  Returns false if the file failed validation.
+static bool checkSchema(QFile &file, Document::LoadMode mode)
+{
+	if (mode != Document::LoadValidated)
+		return true;
+	if (!validateFile(file, QUrl(file.fileName())))
+	{
+		Log::instance().error("Unable to load file: XML validation failed");
+		return false;
+	}
+	file.reset();
+	return true;
+}
+
+/// Sets up a reader to parse a device.  In checked mode the reader reads
+/// through check, which must be passed to checkFailed() after parsing.
+static void setupReader(QIODevice &dev, Document::LoadMode mode,
+						QXmlStreamReader &reader,
+						QScopedPointer<XmlCheckDevice> &check)
+{
+	if (mode == Document::LoadChecked)
+	{
+		check.reset(new XmlCheckDevice(&dev, XmlStructure::xpcb()));
+		reader.setDevice(check.data());
+	}
+	else
+		reader.setDevice(&dev);
+}
+
+/// Sets up a reader to parse a file, checking the file as required by its
+/// load mode (see setupReader()).  Returns false if the file failed schema
+/// validation.
+static bool prepareFile(QFile &file, QXmlStreamReader &reader,
+						QScopedPointer<XmlCheckDevice> &check)
+{
+	Document::LoadMode mode = Document::loadMode(file);
+	if (!checkSchema(file, mode))
+		return false;
+	setupReader(file, mode, reader, check);
+	return true;
+}
+
+/// Returns true, and logs the reason, if a file failed the checks made while
+/// it was parsed.
+static bool checkFailed(const QScopedPointer<XmlCheckDevice> &check)
+{
+	if (!check || !check->failed())
+		return false;
+	Log::instance().error(QString("Unable to load file: %1").arg(check->errorString()));
+	return true;
+}
+
+//////// SECTION LOADING /////////
+
+static bool startsWith(const char* p, const char* end, const char* str)
+{
+	int len = qstrlen(str);
+	return end - p >= len && memcmp(p, str, len) == 0;
+}
+
+/// Returns the first occurrence of str in [p, end), or NULL.
+static const char* findStr(const char* p, const char* end, const char* str)
+{
+	for(; p < end; p++)
+	{
+		if (startsWith(p, end, str))
+			return p;
+	}
+	return NULL;
+}
+
+static bool isSpace(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+/// Adds a section found by indexSections().  Returns false if the section
+/// was already found.
+static bool addSection(QHash<QString, QByteArray> &sections,
+					   const QString &name, const char* begin, const char* end)
+{
+	if (sections.contains(name))
+		return false;
+	sections.insert(name, QByteArray::fromRawData(begin, end - begin));
+	return true;
+}
+
+/// Finds the top-level sections (props, footprints, traces, etc.) of a board
+/// file with a quick scan over its bytes, without parsing them.  The
+/// sections refer to the file data, which must outlive them.  Returns false
+/// if the file can't be split this way: it is not UTF-8, has a document type
+/// declaration, repeats a section or has unbalanced tags.
+static bool indexSections(const QByteArray &data,
+						  QHash<QString, QByteArray> &sections)
+{
+	const char* p = data.constData();
+	const char* end = p + data.size();
+	// UTF-16 files start with a byte order mark
+	if (startsWith(p, end, "\xff\xfe") || startsWith(p, end, "\xfe\xff"))
+		return false;
+
+	int depth = 0;
+	bool seenRoot = false;
+	QString sectionName;
+	const char* sectionStart = NULL;
+	while((p = static_cast<const char*>(memchr(p, '<', end - p))) != NULL)
+	{
+		if (startsWith(p, end, "<?"))
+		{
+			const char* close = findStr(p, end, "?>");
+			if (!close)
+				return false;
+			QByteArray pi = QByteArray(p, close - p).toLower();
+			if (pi.startsWith("<?xml") && pi.contains("encoding")
+					&& !pi.contains("utf-8"))
+				return false;
+			p = close + 2;
+		}
+		else if (startsWith(p, end, "<!--"))
+		{
+			const char* close = findStr(p + 4, end, "-->");
+			if (!close)
+				return false;
+			p = close + 3;
+		}
+		else if (startsWith(p, end, "<![CDATA["))
+		{
+			const char* close = findStr(p, end, "]]>");
+			if (!close)
+				return false;
+			p = close + 3;
+		}
+		else if (startsWith(p, end, "<!"))
+		{
+			// a document type may declare entities, which sections parsed
+			// on their own would not know about
+			return false;
+		}
+		else if (startsWith(p, end, "</"))
+		{
+			const char* close = static_cast<const char*>(memchr(p, '>', end - p));
+			if (!close || --depth < 0)
+				return false;
+			if (depth == 1 && !addSection(sections, sectionName,
+										  sectionStart, close + 1))
+				return false;
+			p = close + 1;
+		}
+		else
+		{
+			// start tag; attribute values may contain '>'
+			const char* close = p + 1;
+			char quote = 0;
+			for(; close < end; close++)
+			{
+				if (quote)
+				{
+					if (*close == quote)
+						quote = 0;
+				}
+				else if (*close == '"' || *close == '\'')
+					quote = *close;
+				else if (*close == '>')
+					break;
+			}
+			if (close == end)
+				return false;
+			bool isEmpty = close[-1] == '/';
+			const char* nameEnd = p + 1;
+			while(nameEnd < close && !isSpace(*nameEnd) && *nameEnd != '/')
+				nameEnd++;
+			QString name = QString::fromUtf8(p + 1, nameEnd - p - 1);
+
+			if (depth == 0)
+			{
+				if (seenRoot || name != "xpcbBoard")
+					return false;
+				seenRoot = true;
+			}
+			else if (depth == 1)
+			{
+				sectionName = name;
+				sectionStart = p;
+				if (isEmpty && !addSection(sections, name, p, close + 1))
+					return false;
+			}
+			if (!isEmpty)
+				depth++;
+			p = close + 1;
+		}
+	}
+	return seenRoot && depth == 0;
+}
+
+/// Reads one top-level section of a board file.  In checked mode, the
+/// structure of the section is checked by the reader that parses it, as a
+/// child of <xpcbBoard>; this is the only other part of a board file, and
+/// indexSections() has already made sure it is there.
+class SectionReader
+{
+public:
+	SectionReader(const QByteArray &data, bool check)
+		: mData(data), mBuf(&mData)
+	{
+		if (check)
+		{
+			mBuf.open(QIODevice::ReadOnly);
+			mCheck.reset(new XmlCheckDevice(&mBuf, XmlStructure::xpcb(),
+											"xpcbBoard"));
+			mReader.setDevice(mCheck.data());
+		}
+		else
+			mReader.addData(mData);
+	}
+
+	/// Moves the reader to the section element.  Returns false if the
+	/// section is absent.
+	bool open()
+	{
+		return !mData.isEmpty() && mReader.readNextStartElement();
+	}
+
+	QXmlStreamReader& reader() { return mReader; }
+
+	/// Returns a description of the error found in the section, or a null
+	/// string.
+	QString error(const QString &section) const
+	{
+		if (mCheck && mCheck->failed())
+			return QString("<%1>: %2").arg(section).arg(mCheck->errorString());
+		if (mReader.hasError())
+			return QString("<%1>: %2").arg(section).arg(mReader.errorString());
+		return QString();
+	}
+
+private:
+	QByteArray mData;
+	QBuffer mBuf;
+	QScopedPointer<XmlCheckDevice> mCheck;
+	QXmlStreamReader mReader;
+};
+
+// The following parse sections on the thread pool.  They do not touch the
+// document; the results are linked into it by PCBDoc::loadSections().
+
+static QHash<QUuid, QSharedPointer<Footprint> > parseFootprints(
+		QByteArray data, bool check, QString *error)
+{
+	// like footprints loaded for previews, these stay in the thread that
+	// created them; they are shared read-only and have no connections
+	QHash<QUuid, QSharedPointer<Footprint> > footprints;
+	SectionReader section(data, check);
+	if (section.open())
+		loadFootprints(section.reader(), footprints);
+	*error = section.error("footprints");
+	return footprints;
+}
+
+static QSharedPointer<Netlist> parseNetlist(QByteArray data, bool check,
+											QString *error)
+{
+	QSharedPointer<Netlist> netlist(new Netlist());
+	SectionReader section(data, check);
+	if (section.open())
+		netlist->loadFromXML(section.reader());
+	*error = section.error("netlist");
+	return netlist;
+}
+
+static TraceList::Staging parseTraces(QByteArray data, bool check,
+									  QString *error)
+{
+	TraceList::Staging traces;
+	SectionReader section(data, check);
+	if (section.open())
+		TraceList::parseXml(section.reader(), traces);
+	*error = section.error("traces");
+	return traces;
+}
+
+static QList<Area::Data> parseAreas(QByteArray data, bool check,
+									QString *error)
+{
+	QList<Area::Data> areas;
+	SectionReader section(data, check);
+	if (section.open())
+	{
+		QXmlStreamReader &reader = section.reader();
+		while(reader.readNextStartElement())
+		{
+			areas.append(Area::parseXML(reader));
+			do
+					reader.readNext();
+			while(!reader.isEndElement());
+		}
+	}
+	*error = section.error("areas");
+	return areas;
+}
+
+static QList<QSharedPointer<Text> > parseTexts(QByteArray data, bool check,
+											   QThread *target, QString *error)
+{
+	QList<QSharedPointer<Text> > texts;
+	SectionReader section(data, check);
+	if (section.open())
+		loadTexts(section.reader(), texts);
+	// hand the texts over to the document's thread
+	foreach(QSharedPointer<Text> t, texts)
+		t->moveToThread(target);
+	*error = section.error("texts");
+	return texts;
+}
+
 bool PCBDoc::saveToXml(QXmlStreamWriter &writer)
 {
 	writer.setAutoFormatting(true);
 	writer.writeStartDocument();
 	writer.writeStartElement("xpcbBoard");
 
-	writer.writeStartElement("props");
-	writer.writeTextElement("units", this->mUnits == XPcb::MM ? "mm" : "mils");
-	writer.writeTextElement("numLayers", QString::number(this->mNumLayers));
-	writer.writeTextElement("name", this->mName);
-	writer.writeTextElement("defaultPadstack",
-							mDefaultPadstack.toString());
-	writer.writeEndElement();
+	writePropsXml(writer);
 
 	writer.writeStartElement("padstacks");
 	foreach(QSharedPointer<Padstack> ps, mPadstacks)
@@ -663,23 +1278,216 @@ bool PCBDoc::saveToXml(QXmlStreamWriter &writer)
 	writer.writeEndElement();
 	writer.writeEndDocument();
 
-	mUndoStack.setClean();
 	return true;
 }
 
-bool PCBDoc::loadFromFile(QFile &inFile)
+void PCBDoc::writePropsXml(QXmlStreamWriter &writer)
+{
+	writer.writeStartElement("props");
+	writer.writeTextElement("units", this->mUnits == XPcb::MM ? "mm" : "mils");
+	writer.writeTextElement("numLayers", QString::number(this->mNumLayers));
+	writer.writeTextElement("name", this->mName);
+	writer.writeTextElement("defaultPadstack",
+							mDefaultPadstack.toString());
+	writer.writeEndElement();
+}
+
+bool PCBDoc::saveToFile(const QString &file)
 {
-	if (!validateFile(inFile, QUrl(inFile.fileName())))
+	if (QFileInfo(file).suffix().compare(BoardFile::extension(),
+										 Qt::CaseInsensitive) != 0)
 	{
-		Log::instance().error("Unable to load file: XML validation failed");
-		inFile.close();
+		if (!Document::saveToFile(file))
+			return false;
+		fileSaved(file);
+		return true;
+	}
+
+	AtomicFile outFile(file);
+	if (!outFile.open())
+	{
+		Log::instance().error(QString("Unable to open file %1 for writing").arg(file));
+		return false;
+	}
+	bool ret = BoardFile::save(*this, outFile) && outFile.commit();
+	if (ret)
+	{
+		mUndoStack.setClean();
+		fileSaved(file);
+	}
+	else
+		Log::instance().error(QString("Unable to write file %1").arg(file));
+	return ret;
+}
+
+/// Writes a board image made by BoardFile::save() to a file: as is if the
+/// file has the binary extension, and as XML otherwise.  Runs on a worker
+/// thread.  Returns an error message, or an empty string on success.
+static QString writeBoard(const QByteArray &image, const QString &path)
+{
+	AtomicFile file(path);
+	if (!file.open())
+		return QString("Unable to open file %1 for writing").arg(path);
+
+	bool ok;
+	if (QFileInfo(path).suffix().compare(BoardFile::extension(),
+										 Qt::CaseInsensitive) == 0)
+		ok = file.write(image) == image.size();
+	else
+	{
+		// convert the records directly: loading them into a document would
+		// create objects that look footprints up in the library
+		QXmlStreamWriter writer(&file);
+		ok = BoardFile::writeXml(reinterpret_cast<const uchar*>(image.constData()),
+								 image.size(), writer);
+	}
+	if (!ok || !file.commit())
+		return QString("Unable to write file %1").arg(path);
+	return QString();
+}
+
+bool PCBDoc::saveInBackground(const QString &file)
+{
+	waitForSave();
+
+	// snapshot the board in the binary format, which is fast to write and
+	// to read back
+	QBuffer image;
+	image.open(QIODevice::WriteOnly);
+	if (!BoardFile::save(*this, image))
+	{
+		Log::instance().error(QString("Unable to save file %1").arg(file));
+		return false;
+	}
+	mSavePath = file;
+	mSaveRevision = mRevision;
+	mSavePending = true;
+	mSave.setFuture(QtConcurrent::run(writeBoard, image.data(), file));
+	return true;
+}
+
+bool PCBDoc::waitForSave()
+{
+	mSave.waitForFinished();
+	finishSave();
+	return mSaveOk;
+}
+
+void PCBDoc::fileSaved(const QString &file)
+{
+	mRecovered = false;
+	if (mJournal && mJournal->boardFile() == file)
+		mJournal->saved();
+}
+
+bool PCBDoc::isModified()
+{
+	return Document::isModified() || mRecovered;
+}
+
+bool PCBDoc::startJournal(const QString &boardFile)
+{
+	if (mJournal && mJournal->boardFile() == boardFile)
+		return true;
+	stopJournal();
+	mJournal.reset(new Journal(*this));
+	if (mJournal->open(boardFile))
+		return true;
+	mJournal.reset();
+	return false;
+}
+
+void PCBDoc::stopJournal()
+{
+	if (mJournal)
+	{
+		mJournal->remove();
+		mJournal.reset();
+	}
+}
+
+bool PCBDoc::hasJournal(const QString &boardFile)
+{
+	return Journal::hasUnsaved(Journal::fileFor(boardFile));
+}
+
+QString PCBDoc::setJournalAside(const QString &boardFile)
+{
+	QString journal = Journal::fileFor(boardFile);
+	for(int i = 1; i < 1000; i++)
+	{
+		QString path = QString("%1.%2").arg(journal).arg(i);
+		if (QFile::exists(path))
+			continue;
+		if (QFile::rename(journal, path))
+			return path;
+		break;
+	}
+	Log::instance().error(QString("Unable to rename journal %1").arg(journal));
+	return QString();
+}
+
+bool PCBDoc::recoverJournal(const QString &boardFile)
+{
+	QByteArray xml = Journal::replay(Journal::fileFor(boardFile));
+	if (xml.isEmpty())
+	{
+		Log::instance().error(QString("Unable to read the journal of %1").arg(boardFile));
+		return false;
+	}
+	QXmlStreamReader reader(xml);
+	if (!loadFromXml(reader))
 		return false;
+	mRecovered = true;
+	return true;
+}
+
+void PCBDoc::finishSave()
+{
+	if (!mSavePending || !mSave.isFinished())
+		return;
+	mSavePending = false;
+	QString error = mSave.result();
+	mSaveOk = error.isEmpty();
+	if (mSaveOk)
+	{
+		if (QFileInfo(mSavePath).suffix().compare(BoardFile::extension(),
+												  Qt::CaseInsensitive) != 0)
+			trustFile(mSavePath);
+		// edits made during the save aren't in the file
+		if (mRevision == mSaveRevision)
+		{
+			mUndoStack.setClean();
+			fileSaved(mSavePath);
+		}
 	}
+	else
+		Log::instance().error(error);
+	emit saveFinished(mSavePath, mSaveOk);
+}
 
-	inFile.reset();
-	QXmlStreamReader reader(&inFile);
+bool PCBDoc::loadFromFile(QFile &inFile)
+{
+	if (BoardFile::isBinary(inFile))
+		return BoardFile::load(*this, inFile);
 
-	return loadFromXml(reader);
+	LoadMode mode = loadMode(inFile);
+	if (!checkSchema(inFile, mode))
+		return false;
+	QByteArray data = inFile.readAll();
+	QHash<QString, QByteArray> sections;
+	if (indexSections(data, sections))
+		return loadSections(sections, mode == LoadChecked);
+
+	// files that can't be split into sections are parsed in one pass, which
+	// also reports what is wrong with them
+	QBuffer buf(&data);
+	buf.open(QIODevice::ReadOnly);
+	QXmlStreamReader reader;
+	QScopedPointer<XmlCheckDevice> check;
+	setupReader(buf, mode, reader, check);
+	bool ok = loadFromXml(reader);
+	return !checkFailed(check) && ok;
 }
 
 bool PCBDoc::loadFromXml(QXmlStreamReader &reader)
@@ -689,7 +1497,7 @@ bool PCBDoc::loadFromXml(QXmlStreamReader &reader)
 	mNetlist = QSharedPointer<Netlist>(new Netlist());
 
 	reader.readNextStartElement();
-	if (reader.name() != "xpcbBoard")
+	if (!Xml::is(reader.name(), "xpcbBoard"))
 	{
 		Log::instance().error("Not a PCB document.");
 		return false;
@@ -697,35 +1505,37 @@ bool PCBDoc::loadFromXml(QXmlStreamReader &reader)
 	while(reader.readNextStartElement())
 	{
 		QStringRef t = reader.name();
-		if (t == "props")
+		if (Xml::is(t, "props"))
 			loadProps(reader, mName, mUnits, mDefaultPadstack, mNumLayers);
-		else if (t == "padstacks")
+		else if (Xml::is(t, "padstacks"))
 		{
 			loadPadstacks(reader, mPadstacks);
 		}
-		else if (t == "footprints")
+		else if (Xml::is(t, "footprints"))
 			loadFootprints(reader, this->mFootprints);
-		else if (t == "outline")
+		else if (Xml::is(t, "outline"))
 			loadOutline(reader, this->mBoardOutline);
-		else if (t == "parts")
+		else if (Xml::is(t, "parts"))
 			loadParts(reader, this->mParts, this);
-		else if (t == "netlist")
+		else if (Xml::is(t, "netlist"))
 		{
 			mNetlist->loadFromXML(reader);
 		}
-		else if (t == "traces")
+		else if (Xml::is(t, "traces"))
 		{
 			mTraceList->loadFromXml(reader);
 			do
 					reader.readNext();
 			while(!reader.isEndElement());
-			Q_ASSERT(reader.isEndElement() && reader.name() == "traces");
+			Q_ASSERT(reader.isEndElement() && Xml::is(reader.name(), "traces"));
 		}
-		else if (t == "areas")
+		else if (Xml::is(t, "areas"))
 			loadAreas(reader, this->mAreas, this);
-		else if (t == "texts")
+		else if (Xml::is(t, "texts"))
 			loadTexts(reader, this->mTexts);
 	}
+	rebuildIndex();
+	emit appearanceChanged();
 	if (reader.hasError())
 	{
 		Log::instance().error(QString("Unable to load file: %1").arg(reader.errorString()));
@@ -734,49 +1544,136 @@ bool PCBDoc::loadFromXml(QXmlStreamReader &reader)
 	return true;
 }
 
-bool FPDoc::loadFromFile(QFile &file)
+bool PCBDoc::loadSections(const QHash<QString, QByteArray> &sections,
+						  bool check)
 {
-	if (!validateFile(file, QUrl(file.fileName())))
+	clearDoc();
+
+	// start parsing the independent sections on the thread pool
+	QString fpError, netError, traceError, areaError, textError;
+	QFuture<QHash<QUuid, QSharedPointer<Footprint> > > footprints =
+			QtConcurrent::run(parseFootprints, sections.value("footprints"),
+							  check, &fpError);
+	QFuture<QSharedPointer<Netlist> > netlist =
+			QtConcurrent::run(parseNetlist, sections.value("netlist"),
+							  check, &netError);
+	QFuture<TraceList::Staging> traces =
+			QtConcurrent::run(parseTraces, sections.value("traces"),
+							  check, &traceError);
+	QFuture<QList<Area::Data> > areas =
+			QtConcurrent::run(parseAreas, sections.value("areas"),
+							  check, &areaError);
+	QFuture<QList<QSharedPointer<Text> > > texts =
+			QtConcurrent::run(parseTexts, sections.value("texts"),
+							  check, thread(), &textError);
+
+	// meanwhile, read the small sections that the others refer to
+	QStringList errors;
+	SectionReader props(sections.value("props"), check);
+	if (props.open())
+		loadProps(props.reader(), mName, mUnits, mDefaultPadstack, mNumLayers);
+	errors << props.error("props");
+	SectionReader padstacks(sections.value("padstacks"), check);
+	if (padstacks.open())
+		loadPadstacks(padstacks.reader(), mPadstacks);
+	errors << padstacks.error("padstacks");
+	SectionReader outline(sections.value("outline"), check);
+	if (outline.open())
+		loadOutline(outline.reader(), mBoardOutline);
+	errors << outline.error("outline");
+
+	// link the staged sections into the document.  Parts look up their
+	// footprints, and vias their padstacks, as they are created.
+	mFootprints = footprints.result();
+	errors << fpError;
+	SectionReader parts(sections.value("parts"), check);
+	if (parts.open())
+		loadParts(parts.reader(), mParts, this);
+	errors << parts.error("parts");
+	mNetlist = netlist.result();
+	errors << netError;
+	mTraceList->load(traces.result());
+	errors << traceError;
+	foreach(const Area::Data &a, areas.result())
+		mAreas.append(Area::newFromData(*this, a));
+	errors << areaError;
+	mTexts = texts.result();
+	errors << textError;
+
+	rebuildIndex();
+	emit appearanceChanged();
+	bool ok = true;
+	foreach(const QString &e, errors)
 	{
-		Log::instance().error("Unable to load file: XML validation failed");
-		file.close();
-		return false;
+		if (!e.isEmpty())
+		{
+			Log::instance().error(QString("Unable to load file: %1").arg(e));
+			ok = false;
+		}
 	}
+	return ok;
+}
 
-	file.reset();
-	QXmlStreamReader reader(&file);
-
-	return loadFromXml(reader);
+bool FPDoc::loadFromFile(QFile &file)
+{
+	QSharedPointer<Footprint> fp = FootprintCache::instance().load(file);
+	if (!fp)
+		return false;
+	setFootprint(fp);
+	return true;
 }
 
 bool FPDoc::loadFromXml(QXmlStreamReader &reader)
 {
+	QSharedPointer<Footprint> fp = readXml(reader);
+	if (!fp)
+		return false;
+	setFootprint(FootprintCache::instance().intern(fp));
+	return true;
+}
+
+QSharedPointer<Footprint> FPDoc::readFile(QFile &file)
+{
+	QXmlStreamReader reader;
+	QScopedPointer<XmlCheckDevice> check;
+	if (!prepareFile(file, reader, check))
+		return QSharedPointer<Footprint>();
+
+	QSharedPointer<Footprint> fp = readXml(reader);
+	if (checkFailed(check))
+		return QSharedPointer<Footprint>();
+	return fp;
+}
+
+QSharedPointer<Footprint> FPDoc::readXml(QXmlStreamReader &reader)
+{
+	QSharedPointer<Footprint> fp;
 	reader.readNextStartElement();
-	if (reader.name() != "xpcbFootprint")
+	if (!Xml::is(reader.name(), "xpcbFootprint"))
 	{
 		Log::instance().error("Not a footprint.");
-		return false;
+		return fp;
 	}
 	while(reader.readNextStartElement())
 	{
 		QStringRef t = reader.name();
 
-		if (t == "footprint")
+		if (Xml::is(t, "footprint"))
 		{
-			mFp = Footprint::newFromXML(reader);
-			if (!mFp)
+			fp = Footprint::newFromXML(reader);
+			if (!fp)
 			{
 				Log::instance().error("Error loading footprint");
-				return false;
+				return fp;
 			}
 		}
 	}
 	if (reader.hasError())
 	{
 		Log::instance().error(QString("Unable to load file: %1").arg(reader.errorString()));
-		return false;
+		return QSharedPointer<Footprint>();
 	}
-	return true;
+	return fp;
 }
 
 bool FPDoc::saveToXml(QXmlStreamWriter &writer)
@@ -790,22 +1687,21 @@ bool FPDoc::saveToXml(QXmlStreamWriter &writer)
 	writer.writeEndElement();
 	writer.writeEndDocument();
 
-	mUndoStack.setClean();
 	return true;
 }
 
 void loadProps(QXmlStreamReader &reader, QString &name, XPcb::UNIT &units,
 			   QUuid &defaultps, int &numLayers)
 {
-	Q_ASSERT(reader.isStartElement() && reader.name() == "props");
+	Q_ASSERT(reader.isStartElement() && Xml::is(reader.name(), "props"));
 	while(reader.readNextStartElement())
 	{
 		QStringRef t = reader.name();
-		if (t == "name")
+		if (Xml::is(t, "name"))
 		{
 			name = reader.readElementText();
 		}
-		else if (t == "units")
+		else if (Xml::is(t, "units"))
 		{
 			QString unitsStr = reader.readElementText();
 			if (unitsStr == "mm")
@@ -813,22 +1709,22 @@ void loadProps(QXmlStreamReader &reader, QString &name, XPcb::UNIT &units,
 			else if (unitsStr == "mils")
 				units = XPcb::MIL;
 		}
-		else if (t == "defaultPadstack")
+		else if (Xml::is(t, "defaultPadstack"))
 		{
 			defaultps = QUuid(reader.readElementText());
 		}
-		else if (t == "numLayers")
+		else if (Xml::is(t, "numLayers"))
 		{
 			numLayers = reader.readElementText().toInt();
 		}
 	}
-	Q_ASSERT(reader.isEndElement() && reader.name() == "props");
+	Q_ASSERT(reader.isEndElement() && Xml::is(reader.name(), "props"));
 }
 
 void loadPadstacks(QXmlStreamReader &reader,
 				   QHash<QUuid, QSharedPointer<Padstack> > &padstacks)
 {
-	Q_ASSERT(reader.isStartElement() && reader.name() == "padstacks");
+	Q_ASSERT(reader.isStartElement() && Xml::is(reader.name(), "padstacks"));
 	while(!reader.atEnd() && !reader.hasError())
 	{
 		QXmlStreamReader::TokenType tok = reader.readNext();
@@ -836,7 +1732,7 @@ void loadPadstacks(QXmlStreamReader &reader,
 			return; // end of padstacks block
 		if (tok != QXmlStreamReader::StartElement)
 			continue; // comments, etc.
-		if (reader.name() == "padstack")
+		if (Xml::is(reader.name(), "padstack"))
 		{
 			QSharedPointer<Padstack> ps = Padstack::newFromXML(reader);
 			if (!ps)
@@ -850,13 +1746,13 @@ void loadPadstacks(QXmlStreamReader &reader,
 	do
 			reader.readNext();
 	while(!reader.isEndElement());
-	Q_ASSERT(reader.isEndElement() && reader.name() == "padstacks");
+	Q_ASSERT(reader.isEndElement() && Xml::is(reader.name(), "padstacks"));
 
 }
 
 void loadFootprints(QXmlStreamReader &reader, QHash<QUuid, QSharedPointer<Footprint> > &footprints)
 {
-	Q_ASSERT(reader.isStartElement() && reader.name() == "footprints");
+	Q_ASSERT(reader.isStartElement() && Xml::is(reader.name(), "footprints"));
 	while(!reader.atEnd() && !reader.hasError())
 	{
 		QXmlStreamReader::TokenType tok = reader.readNext();
@@ -864,7 +1760,7 @@ void loadFootprints(QXmlStreamReader &reader, QHash<QUuid, QSharedPointer<Footpr
 			return; // end of footprints block
 		if (tok != QXmlStreamReader::StartElement)
 			continue; // comments, etc.
-		if (reader.name() == "footprint")
+		if (Xml::is(reader.name(), "footprint"))
 		{
 			QSharedPointer<Footprint> fp = Footprint::newFromXML(reader);
 			if (!fp)
@@ -872,32 +1768,33 @@ void loadFootprints(QXmlStreamReader &reader, QHash<QUuid, QSharedPointer<Footpr
 				Log::instance().error("Error loading footprint");
 			}
 			else
-				footprints.insert(fp->uuid(), QSharedPointer<Footprint>(fp));
+				footprints.insert(fp->uuid(),
+								  FootprintCache::instance().intern(fp));
 		}
 	}
 	do
 			reader.readNext();
 	while(!reader.isEndElement());
-	Q_ASSERT(reader.isEndElement() && reader.name() == "footprints");
+	Q_ASSERT(reader.isEndElement() && Xml::is(reader.name(), "footprints"));
 
 }
 
 void loadOutline(QXmlStreamReader &reader, Polygon& poly)
 {
-	Q_ASSERT(reader.isStartElement() && reader.name() == "outline");
+	Q_ASSERT(reader.isStartElement() && Xml::is(reader.name(), "outline"));
 	if (!reader.readNextStartElement())
 		return;
 	poly = Polygon::newFromXML(reader);
 	do
 			reader.readNext();
 	while(!reader.isEndElement());
-	Q_ASSERT(reader.isEndElement() && reader.name() == "outline");
+	Q_ASSERT(reader.isEndElement() && Xml::is(reader.name(), "outline"));
 
 }
 
 void loadParts(QXmlStreamReader &reader, QList<QSharedPointer<Part> >& parts, PCBDoc *doc)
 {
-	Q_ASSERT(reader.isStartElement() && reader.name() == "parts");
+	Q_ASSERT(reader.isStartElement() && Xml::is(reader.name(), "parts"));
 	while(reader.readNextStartElement())
 	{
 		QSharedPointer<Part> part = Part::newFromXML(reader, doc);
@@ -908,13 +1805,13 @@ void loadParts(QXmlStreamReader &reader, QList<QSharedPointer<Part> >& parts, PC
 		else
 			parts.append(part);
 	}
-	Q_ASSERT(reader.isEndElement() && reader.name() == "parts");
+	Q_ASSERT(reader.isEndElement() && Xml::is(reader.name(), "parts"));
 
 }
 
 void loadAreas(QXmlStreamReader &reader, QList<QSharedPointer<Area> > &areas, PCBDoc *doc)
 {
-	Q_ASSERT(reader.isStartElement() && reader.name() == "areas");
+	Q_ASSERT(reader.isStartElement() && Xml::is(reader.name(), "areas"));
 	while(reader.readNextStartElement())
 	{
 		QSharedPointer<Area> area = Area::newFromXML(reader, *doc);
@@ -929,18 +1826,18 @@ void loadAreas(QXmlStreamReader &reader, QList<QSharedPointer<Area> > &areas, PC
 		while(!reader.isEndElement());
 	}
 
-	Q_ASSERT(reader.isEndElement() && reader.name() == "areas");
+	Q_ASSERT(reader.isEndElement() && Xml::is(reader.name(), "areas"));
 
 }
 
 void loadTexts(QXmlStreamReader &reader, QList<QSharedPointer<Text> > &texts)
 {
-	Q_ASSERT(reader.isStartElement() && reader.name() == "texts");
+	Q_ASSERT(reader.isStartElement() && Xml::is(reader.name(), "texts"));
 	while(reader.readNextStartElement())
 	{
 		texts.append(QSharedPointer<Text>(Text::newFromXML(reader)));
 	}
-	Q_ASSERT(reader.isEndElement() && reader.name() == "texts");
+	Q_ASSERT(reader.isEndElement() && Xml::is(reader.name(), "texts"));
 
 }
 
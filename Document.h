@@ -23,12 +23,16 @@
 #include <QList>
 #include <QFile>
 #include <QUndoStack>
+#include <QFutureWatcher>
+#include <QScopedPointer>
 #include "Trace.h"
 #include "Part.h"
 #include "Net.h"
 #include "Text.h"
 #include "Polygon.h"
 #include "Area.h"
+#include "SpatialIndex.h"
+#include "Journal.h"
 
 class Document : public QObject
 {
@@ -57,6 +61,19 @@ public:
 
 	Q_DECLARE_FLAGS(LayerMask, LayerType)
 
+	/// Specifies how a file is checked when it is loaded.
+	enum LoadMode
+	{
+		LoadValidated,	///< Validate against the XML schema, then parse.
+		LoadChecked,	///< Check the element structure while parsing.
+		LoadTrusted		///< Parse without checks; for files xpcb wrote.
+	};
+
+	/// Returns the mode a file should be loaded in.  Files that xpcb saved
+	/// and that haven't changed since are trusted; other files are checked
+	/// while they are parsed, unless full validation is turned on with the
+	/// xml/fullValidation setting.
+	static LoadMode loadMode(const QFile &file);
 
 	Document();
 	virtual ~Document();
@@ -76,7 +93,8 @@ public:
 	/// \returns true if load was successful; false if there was an error.
 	virtual bool loadFromFile(const QString & file);
 
-	/// Loads the document from the provided file handle.
+	/// Loads the document from the provided file handle.  The file is
+	/// checked according to loadMode().
 	/// \param file The file handle to read from.
 	/// \returns true if load was successful; false if there was an error.
 	virtual bool loadFromFile(QFile & file) = 0;
@@ -121,10 +139,17 @@ public:
 	virtual void addPadstack(QSharedPointer<Padstack>) = 0;
 	/// Removes the provided padstack from the document.
 	virtual void removePadstack(QSharedPointer<Padstack>) = 0;
+	/// Called after a padstack of the document has been edited in place.
+	virtual void padstackChanged(QSharedPointer<Padstack>) = 0;
 	/// Returns a padstack for the given UUID (or null if not present).
 	virtual QSharedPointer<Padstack> padstack(QUuid uuid) = 0;
 signals:
 	void changed();
+	/// Emitted when the appearance of the document has changed within the
+	/// given area (in world coordinates).
+	void areaChanged(const QRect &area);
+	/// Emitted when the appearance of the document may have changed anywhere.
+	void appearanceChanged();
 	void cleanChanged(bool clean);
 	void canUndoChanged(bool e);
 	void canRedoChanged(bool e);
@@ -140,6 +165,9 @@ protected:
 	XPcb::UNIT mUnits;
 	/// Undo stack
 	QUndoStack mUndoStack;
+
+	/// Remembers that xpcb wrote a file, so that it can be loaded trusted
+	static void trustFile(const QString &path);
 };
 
 Q_DECLARE_OPERATORS_FOR_FLAGS(Document::LayerMask)
@@ -149,11 +177,55 @@ class PCBDoc : public Document
 	Q_OBJECT
 
 	friend class XmlLoadTest;
+	friend class TraceListTest;
+	friend class BoardFileTest;
+	friend class DocumentSaveTest;
+	friend class JournalTest;
+	friend class BoardFile;
+	friend class Journal;
 public:
     PCBDoc();
+	/// Waits for a background save to finish.
+	virtual ~PCBDoc();
 
 	// overrides
-	using Document::saveToFile;
+	/// Saves the board to the provided path.  Boards with a .xpcbb extension
+	/// are saved in the binary format (see BoardFile), others as XML.
+	virtual bool saveToFile(const QString & file);
+	/// Starts saving the board to the provided path on a worker thread and
+	/// returns immediately.  Only a snapshot of the board is taken on the
+	/// calling thread, so the board can be edited while the file is
+	/// written.  The file is written next to the target, flushed to disk
+	/// and renamed over the target, so that the target is never left
+	/// half-written.  saveFinished() is emitted when the save is done; the
+	/// board is marked clean then unless it was edited in the meantime.
+	/// If a save is already running, waits for it first.
+	/// \returns false if the snapshot could not be taken.
+	bool saveInBackground(const QString & file);
+	/// Returns true while a background save is running.
+	bool isSaving() const { return mSavePending; }
+	/// Waits for a running background save to finish.
+	/// \returns false if the last background save failed.
+	bool waitForSave();
+	/// Starts recording edits to a journal next to the board file, so that
+	/// they can be recovered after a crash (see Journal).  The snapshot that
+	/// the journal starts with is written in the background.  Does nothing
+	/// if edits are already recorded for that file.
+	bool startJournal(const QString & boardFile);
+	/// Stops recording edits and deletes the journal.  Called when the
+	/// board is closed normally.
+	void stopJournal();
+	/// Returns true if a board file has a journal with unsaved edits, which
+	/// means that xpcb did not exit normally while it was edited.
+	static bool hasJournal(const QString & boardFile);
+	/// Renames the journal of a board file, so that a new journal doesn't
+	/// replace it.  Returns the new name, or an empty string on error.
+	static QString setJournalAside(const QString & boardFile);
+	/// Loads the board recorded in the journal of a board file.  The board
+	/// is modified until it is saved.
+	bool recoverJournal(const QString & boardFile);
+	/// Returns true if the board has unsaved edits.
+	virtual bool isModified();
 	using Document::loadFromFile;
 	virtual bool saveToXml(QXmlStreamWriter &writer);
 	virtual bool loadFromFile(QFile & file);
@@ -166,6 +238,20 @@ public:
 	virtual QList<QSharedPointer<PCBObject> > findObjs(QPoint &pt, int dist = 1);
 	virtual QList<QSharedPointer<PCBObject> > findObjs(QRect &rect);
 
+	virtual void doCommand(QUndoCommand *cmd);
+
+	/// Adds an object to the spatial index, or refreshes its entry if it is
+	/// already indexed.  Called when an object is added to the document.
+	void objectAdded(QSharedPointer<PCBObject> obj);
+	/// Refreshes the index entry of an object whose geometry has changed,
+	/// along with the entries of objects whose geometry depends on it
+	/// (segments attached to a vertex, or texts belonging to a part).
+	/// Objects that are not in the index are ignored.
+	void objectChanged(QSharedPointer<PCBObject> obj);
+	/// Removes an object from the spatial index.  Called when an object is
+	/// removed from the document.
+	void objectRemoved(QSharedPointer<PCBObject> obj);
+
 	QSharedPointer<TraceList> traceList() const {return mTraceList;}
 	QSharedPointer<Netlist> netlist() const { return mNetlist; }
 
@@ -189,13 +275,49 @@ public:
 	virtual QList<QSharedPointer<Padstack> > padstacks() { return mPadstacks.values(); }
 	virtual void addPadstack(QSharedPointer<Padstack> ps);
 	virtual void removePadstack(QSharedPointer<Padstack> ps);
+	virtual void padstackChanged(QSharedPointer<Padstack> ps);
 	virtual QSharedPointer<Padstack> padstack(QUuid uuid);
 
 signals:
 	void partsChanged();
+	/// Emitted when a background save is done.
+	void saveFinished(const QString &file, bool ok);
+
+public slots:
+	virtual void undo();
+	virtual void redo();
+
+private slots:
+	/// Handles the result of a background save.  Does nothing if there is
+	/// no finished save to handle.
+	void finishSave();
 
 private:
 	void clearDoc();
+	/// Writes the board properties.
+	void writePropsXml(QXmlStreamWriter &writer);
+	/// Records that the board was saved to a file.
+	void fileSaved(const QString &file);
+	/// Loads a board from its top-level sections (see indexSections() in
+	/// Document.cpp).  Independent sections are parsed concurrently into
+	/// staging data, which is then linked into the document.  If check is
+	/// true, each section is checked by the reader that parses it.
+	bool loadSections(const QHash<QString, QByteArray> &sections, bool check);
+	/// Rebuilds the spatial index from scratch.
+	void rebuildIndex();
+	/// Refreshes the index entries of all objects edited by a command.
+	/// numTouched is the value of mNumTouched before the command was run.
+	void refreshEditedObjs(const QList<QSharedPointer<PCBObject> > &objs,
+						   int numTouched);
+	/// Indexes the reference and value texts of a part.
+	void indexPartTexts(QSharedPointer<Part> p);
+	/// Adds or refreshes the index entry of an object and reports the area
+	/// it covered before and after the change.
+	void reindex(QSharedPointer<PCBObject> obj);
+	/// Removes an object from the index and reports the area it covered.
+	void unindex(const PCBObject* obj);
+	/// Emits areaChanged() for a non-empty area.
+	void touch(const QRect &area);
 
 	/// Number of copper layers
 	int mNumLayers;
@@ -208,6 +330,38 @@ private:
 	QHash<QUuid, QSharedPointer<Padstack> > mPadstacks;
 	Polygon mBoardOutline;
 	QUuid mDefaultPadstack;
+	/// Spatial index of all selectable objects
+	SpatialIndex mIndex;
+	/// Texts indexed for each part (a part's texts are replaced when its
+	/// footprint changes)
+	QHash<const Part*, QList<QSharedPointer<PCBObject> > > mPartTexts;
+	/// Number of areaChanged() signals emitted so far
+	int mNumTouched;
+	/// Counts changes to the board, to tell whether it was edited during a
+	/// background save
+	int mRevision;
+	/// Counts padstack additions, removals and edits.  Padstack edits don't
+	/// go through the object hooks, and can change any number of objects.
+	int mPadstackRevision;
+	/// Value of mPadstackRevision when the footprint shapes and part bounds
+	/// were last brought up to date
+	int mShapesRevision;
+
+	/// Running background save; its result is an error message, or an
+	/// empty string on success
+	QFutureWatcher<QString> mSave;
+	/// True from the start of a background save until finishSave() handles it
+	bool mSavePending;
+	/// Result of the last background save
+	bool mSaveOk;
+	QString mSavePath;
+	/// Value of mRevision when the snapshot for the running save was taken
+	int mSaveRevision;
+
+	/// Journal of edits, or NULL if edits are not recorded
+	QScopedPointer<Journal> mJournal;
+	/// True if the board was recovered from a journal and not saved since
+	bool mRecovered;
 };
 
 class FPDoc : public Document
@@ -215,7 +369,15 @@ class FPDoc : public Document
 	Q_OBJECT
 
 public:
-	FPDoc();
+	/// Creates a footprint document.  A read-only document shares its
+	/// footprint with FootprintCache; an editable one works on its own copy.
+	explicit FPDoc(bool readOnly = false);
+
+	/// Reads and checks a footprint file, bypassing the footprint cache.
+	/// Returns a null pointer on error.
+	static QSharedPointer<Footprint> readFile(QFile &file);
+	/// Reads a footprint document.  Returns a null pointer on error.
+	static QSharedPointer<Footprint> readXml(QXmlStreamReader &reader);
 
 	using Document::saveToFile;
 	using Document::loadFromFile;
@@ -237,6 +399,8 @@ public:
 	virtual QList<QSharedPointer<Padstack> > padstacks() { return mFp->padstacks(); }
 	virtual void addPadstack(QSharedPointer<Padstack> ps) { return mFp->addPadstack(ps); }
 	virtual void removePadstack(QSharedPointer<Padstack> ps) { return mFp->removePadstack(ps); }
+	/// Every footprint edit already discards the compiled shapes
+	virtual void padstackChanged(QSharedPointer<Padstack>) {}
 	virtual QSharedPointer<Padstack> padstack(QUuid uuid) { return mFp->padstack(uuid); }
 
 	void addPin(QSharedPointer<Pin> p) { mFp->addPin(p); }
@@ -248,7 +412,11 @@ public:
 	QSharedPointer<Footprint> footprint() { return mFp; }
 
 private:
+	/// Takes a footprint from the cache, copying it if it will be edited
+	void setFootprint(QSharedPointer<Footprint> fp);
+
 	QSharedPointer<Footprint> mFp;
+	bool mReadOnly;
 };
 
 #endif // PCBDOC_H
@@ -71,7 +71,7 @@ void EditPartDialog::init(QSharedPointer<Part> p)
 		this->refdesVis->setChecked(p->refVisible());
 		this->valueEdit->setText(p->value());
 		this->valueVis->setChecked(p->valueVisible());
-		this->mCurrFpUuid = p->footprint()->uuid();
+		this->mCurrFpUuid = p->fpUuid();
 		updateFp();
 		this->setPosRadio->setChecked(true);
 		this->sideBox->setCurrentIndex(static_cast<int>(p->side()));
@@ -0,0 +1,246 @@
+/*
+	Copyright (C) 2010-2011 Igor Izyumin
+
+	This file is part of xpcb.
+
+	xpcb is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	xpcb is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with xpcb.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QCoreApplication>
+#include <QFileInfo>
+#include <QPainter>
+#include <QtConcurrentRun>
+#include "FPPreviewCache.h"
+#include "Palette.h"
+#include "FootprintCache.h"
+
+FPPreviewCache* FPPreviewCache::mInstance = NULL;
+
+FPPreviewCache& FPPreviewCache::instance()
+{
+	if (!mInstance)
+		mInstance = new FPPreviewCache();
+	return *mInstance;
+}
+
+FPPreviewCache::FPPreviewCache()
+	: mDocs(MaxDocs), mImages(MaxImageKB)
+{
+	// the prefetch threads use the footprint cache; create it now
+	FootprintCache::instance();
+}
+
+FPPreviewCache::Key FPPreviewCache::key(const QString &path,
+										const QUuid &uuid)
+{
+	Key k;
+	k.uuid = uuid;
+	k.mtime = QFileInfo(path).lastModified();
+	return k;
+}
+
+QSharedPointer<FPDoc> FPPreviewCache::doc(const QString &path,
+										  const QUuid &uuid)
+{
+	if (path.isEmpty())
+		return QSharedPointer<FPDoc>();
+	Key k = key(path, uuid);
+	waitFor(k);
+	QSharedPointer<FPDoc>* cached = mDocs.object(k);
+	if (cached)
+		return *cached;
+
+	Request req;
+	req.key = k;
+	req.path = path;
+	Result r = load(req);
+	store(k, r);
+	return r.doc;
+}
+
+QImage FPPreviewCache::image(const QString &path, const QUuid &uuid,
+							 const QSize &size)
+{
+	if (path.isEmpty() || size.isEmpty())
+		return QImage();
+	Key k = key(path, uuid);
+	waitFor(k);
+	QImage* cached = mImages.object(k);
+	if (cached && cached->size() == size)
+		return *cached;
+
+	QSharedPointer<FPDoc> d = doc(path, uuid);
+	if (!d)
+		return QImage();
+	Result r;
+	r.doc = d;
+	r.image = QImage(size, QImage::Format_ARGB32_Premultiplied);
+	render(r.image, d);
+	store(k, r);
+	return r.image;
+}
+
+void FPPreviewCache::prefetch(const QList<QPair<QString, QUuid> > &files,
+							  const QSize &size)
+{
+	mQueue.clear();
+	if (size.isEmpty())
+		return;
+	QList<Key> running = mRunning.values();
+	for(int i = 0; i < files.size(); i++)
+	{
+		Request req;
+		req.key = key(files[i].first, files[i].second);
+		req.path = files[i].first;
+		req.size = size;
+		QImage* cached = mImages.object(req.key);
+		if ((cached && cached->size() == size) || running.contains(req.key))
+			continue;
+		mQueue.append(req);
+	}
+	startPrefetch();
+}
+
+void FPPreviewCache::clearImages()
+{
+	mImages.clear();
+}
+
+void FPPreviewCache::startPrefetch()
+{
+	while(mRunning.size() < MaxRunning && !mQueue.isEmpty())
+	{
+		Request req = mQueue.takeFirst();
+		QFutureWatcher<Result>* w = new QFutureWatcher<Result>(this);
+		connect(w, SIGNAL(finished()), SLOT(onPrefetched()));
+		mRunning.insert(w, req.key);
+		w->setFuture(QtConcurrent::run(&FPPreviewCache::load, req));
+	}
+}
+
+void FPPreviewCache::onPrefetched()
+{
+	QFutureWatcher<Result>* w = static_cast<QFutureWatcher<Result>*>(sender());
+	// the result has already been collected if someone waited for it
+	if (!mRunning.contains(w))
+		return;
+	store(mRunning.take(w), w->result());
+	w->deleteLater();
+	startPrefetch();
+}
+
+void FPPreviewCache::waitFor(const Key &key)
+{
+	QFutureWatcher<Result>* w = mRunning.key(key, NULL);
+	if (!w)
+		return;
+	w->waitForFinished();
+	mRunning.remove(w);
+	store(key, w->result());
+	w->deleteLater();
+	startPrefetch();
+}
+
+void FPPreviewCache::store(const Key &key, const Result &result)
+{
+	// failed loads are cached too, so that they are not retried every time
+	mDocs.insert(key, new QSharedPointer<FPDoc>(result.doc));
+	if (!result.image.isNull())
+		mImages.insert(key, new QImage(result.image),
+					   qMax(1, result.image.byteCount() / 1024));
+}
+
+FPPreviewCache::Result FPPreviewCache::load(Request req)
+{
+	// The footprint comes from FootprintCache, which has already computed
+	// the lazy state of its texts, so it can be drawn here even while a
+	// board uses it.  The document is destroyed by the GUI thread when it
+	// drops out of the cache, so it is handed over to that thread.
+	Result r;
+	QSharedPointer<FPDoc> d(new FPDoc(true));
+	if (!d->loadFromFile(req.path))
+		return r;
+	d->moveToThread(qApp->thread());
+	r.doc = d;
+	if (!req.size.isEmpty())
+	{
+		r.image = QImage(req.size, QImage::Format_ARGB32_Premultiplied);
+		render(r.image, d);
+	}
+	return r;
+}
+
+/// Returns the transform that fits a world rectangle into a device rectangle,
+/// keeping the aspect ratio and flipping the y axis.
+static QTransform fitTransform(const QRectF &bb, const QRectF &r)
+{
+	double w, h, hoff, woff;
+	QRectF mrect;
+	double wscale = bb.width() / r.width();
+	double hscale = bb.height() / r.height();
+	if (wscale > hscale)
+	{
+		// width is the limiting factor
+		w = r.width();
+		h = bb.height() / wscale;
+		hoff = (r.height() - h) / 2;
+		mrect = QRectF(0, hoff, w, h).normalized();
+	}
+	else
+	{
+		// height is the limiting factor
+		w = bb.width() / hscale;
+		h = r.height();
+		woff = (r.width() - w) / 2;
+		mrect = QRectF(woff, 0, w, h).normalized();
+	}
+	QTransform t;
+	QPolygonF poly(mrect);
+	QPolygonF poly_rev;
+	poly_rev << poly[3] << poly[2] << poly[1] << poly[0];
+	poly = QPolygonF(bb);
+	poly.remove(4);
+	QTransform::quadToQuad(poly, poly_rev, t);
+	return t;
+}
+
+void FPPreviewCache::render(QImage &image, QSharedPointer<FPDoc> doc)
+{
+	const Palette &pal = Palette::instance();
+	QPainter painter(&image);
+	painter.fillRect(image.rect(), pal.brush(Layer::LAY_BACKGND));
+
+	QSharedPointer<Footprint> fp = doc->footprint();
+	QRect bbox = (fp->bbox()
+				  | fp->refText()->bbox()
+				  | fp->valueText()->bbox()).normalized();
+	if (bbox.isEmpty())
+		return;
+	painter.setRenderHint(QPainter::Antialiasing);
+	painter.setTransform(fitTransform(bbox, image.rect()));
+	QList<Layer> layers = doc->layerList(Document::DrawPriorityOrder);
+	QList<QSharedPointer<PCBObject> > objs = doc->findObjs(bbox);
+	foreach(const Layer& l, layers)
+	{
+		if (l == Layer::LAY_SELECTION)
+			continue;
+		painter.setPen(pal.pen(l.type()));
+		painter.setBrush(pal.brush(l.type()));
+		foreach(QSharedPointer<PCBObject> o, objs)
+		{
+			if (o->layers().contains(l))
+				o->draw(&painter, l);
+		}
+	}
+}
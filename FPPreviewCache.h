@@ -0,0 +1,122 @@
+/*
+	Copyright (C) 2010-2011 Igor Izyumin
+
+	This file is part of xpcb.
+
+	xpcb is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	xpcb is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with xpcb.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef FPPREVIEWCACHE_H
+#define FPPREVIEWCACHE_H
+
+#include <QObject>
+#include <QCache>
+#include <QImage>
+#include <QUuid>
+#include <QDateTime>
+#include <QFutureWatcher>
+#include "Document.h"
+
+/// A cache of footprint documents and their preview images.
+
+/// Loading a footprint means validating and parsing its file, which is far
+/// too slow to do every time the selection moves in the footprint browser.
+/// FPPreviewCache keeps the most recently used documents and rendered
+/// previews, keyed by footprint uuid and file modification time so that
+/// edited files are reloaded.  Footprints the user is likely to look at
+/// next can be prefetched: they are loaded and rendered on the thread pool.
+///
+/// The cached documents are shared between all previews; they must not be
+/// modified.
+class FPPreviewCache : public QObject
+{
+	Q_OBJECT
+
+public:
+	static FPPreviewCache& instance();
+
+	/// Returns the footprint in a file, or a null pointer if the file could
+	/// not be loaded.
+	QSharedPointer<FPDoc> doc(const QString &path, const QUuid &uuid);
+	/// Returns a preview of the footprint in a file, or a null image if the
+	/// file could not be loaded.
+	QImage image(const QString &path, const QUuid &uuid, const QSize &size);
+	/// Loads and renders footprints in the background.  Requests from an
+	/// earlier call that have not started yet are dropped.
+	void prefetch(const QList<QPair<QString, QUuid> > &files,
+				  const QSize &size);
+
+	/// Draws a footprint onto an image, scaled to fit.
+	static void render(QImage &image, QSharedPointer<FPDoc> doc);
+
+public slots:
+	/// Drops the rendered previews.
+	void clearImages();
+
+private slots:
+	void onPrefetched();
+
+private:
+	struct Key
+	{
+		QUuid uuid;
+		QDateTime mtime;
+		bool operator==(const Key &other) const
+		{ return uuid == other.uuid && mtime == other.mtime; }
+	};
+	friend uint qHash(const Key &k)
+	{ return qHash(k.uuid) ^ k.mtime.toTime_t(); }
+
+	struct Request
+	{
+		Key key;
+		QString path;
+		QSize size;
+	};
+
+	struct Result
+	{
+		QSharedPointer<FPDoc> doc;
+		QImage image;
+	};
+
+	/// Maximum number of cached documents
+	static const int MaxDocs = 256;
+	/// Maximum size of the cached previews, in kilobytes
+	static const int MaxImageKB = 32 * 1024;
+	/// Maximum number of footprints prefetched at once
+	static const int MaxRunning = 2;
+
+	FPPreviewCache();
+	FPPreviewCache(const FPPreviewCache&);
+
+	static Key key(const QString &path, const QUuid &uuid);
+	/// Loads and renders a footprint; runs on the thread pool.
+	static Result load(Request req);
+	void store(const Key &key, const Result &result);
+	/// Waits for a prefetch of the key, if one is running.
+	void waitFor(const Key &key);
+	void startPrefetch();
+
+	QCache<Key, QSharedPointer<FPDoc> > mDocs;
+	QCache<Key, QImage> mImages;
+	/// Prefetch requests that have not started yet
+	QList<Request> mQueue;
+	/// Running prefetches
+	QHash<QFutureWatcher<Result>*, Key> mRunning;
+
+	static FPPreviewCache* mInstance;
+};
+
+#endif // FPPREVIEWCACHE_H
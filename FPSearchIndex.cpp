@@ -0,0 +1,299 @@
+/*
+	Copyright (C) 2010-2011 Igor Izyumin
+
+	This file is part of xpcb.
+
+	xpcb is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	xpcb is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with xpcb.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QRegExp>
+#include <climits>
+#include "FPSearchIndex.h"
+
+/// Appends a slot to a posting list, unless it is already the last entry.
+static void addPosting(QVector<int> &list, int slot)
+{
+	if (list.isEmpty() || list.last() != slot)
+		list.append(slot);
+}
+
+/// Renumbers the slots of a posting list, dropping the dead ones.  Returns
+/// false if the list is left empty.
+static bool remapPostings(QVector<int> &list, const QVector<int> &newSlots)
+{
+	int n = 0;
+	for(int i = 0; i < list.size(); i++)
+	{
+		int slot = newSlots[list[i]];
+		if (slot >= 0)
+			list[n++] = slot;
+	}
+	list.resize(n);
+	list.squeeze();
+	return n > 0;
+}
+
+int FPSearchIndex::add(const Entry &entry)
+{
+	int slot = mNames.size();
+	int id = mNextId++;
+	QString name = entry.name.toLower();
+	mNames.append(name);
+	mPinCounts.append(entry.pinCount);
+	mPadTypes.append(entry.padTypes);
+	mLive.append(true);
+	mNumLive++;
+	mIds.append(id);
+	mSlots.insert(id, slot);
+
+	for(int i = 0; i + 3 <= name.size(); i++)
+		addPosting(mTrigrams[trigram(name.constData() + i)], slot);
+	QStringList w = words(entry.author) + words(entry.source) + words(entry.desc);
+	foreach(const QString &word, w)
+		addPosting(mWords[word], slot);
+	return id;
+}
+
+void FPSearchIndex::remove(int id)
+{
+	QHash<int, int>::iterator it = mSlots.find(id);
+	if (it == mSlots.end())
+		return;
+	int slot = it.value();
+	mSlots.erase(it);
+	// the postings are left alone until the index is compacted; dead slots
+	// are skipped when searching
+	mLive[slot] = false;
+	mNames[slot] = QString();
+	mNumLive--;
+	if (mLive.size() - mNumLive > mNumLive)
+		compact();
+}
+
+void FPSearchIndex::compact()
+{
+	QVector<int> newSlots(mLive.size(), -1);
+	int n = 0;
+	for(int slot = 0; slot < mLive.size(); slot++)
+	{
+		if (!mLive[slot])
+			continue;
+		newSlots[slot] = n;
+		mNames[n] = mNames[slot];
+		mPinCounts[n] = mPinCounts[slot];
+		mPadTypes[n] = mPadTypes[slot];
+		mIds[n] = mIds[slot];
+		mSlots[mIds[n]] = n;
+		n++;
+	}
+	mNames.resize(n);
+	mPinCounts.resize(n);
+	mPadTypes.resize(n);
+	mIds.resize(n);
+	mLive.fill(true, n);
+
+	// slots keep their order, so the posting lists stay sorted
+	QHash<quint64, QVector<int> >::iterator t = mTrigrams.begin();
+	while(t != mTrigrams.end())
+	{
+		if (remapPostings(t.value(), newSlots))
+			++t;
+		else
+			t = mTrigrams.erase(t);
+	}
+	QMap<QString, QVector<int> >::iterator w = mWords.begin();
+	while(w != mWords.end())
+	{
+		if (remapPostings(w.value(), newSlots))
+			++w;
+		else
+			w = mWords.erase(w);
+	}
+}
+
+void FPSearchIndex::clear()
+{
+	mNames.clear();
+	mPinCounts.clear();
+	mPadTypes.clear();
+	mLive.clear();
+	mNumLive = 0;
+	mIds.clear();
+	mSlots.clear();
+	mTrigrams.clear();
+	mWords.clear();
+}
+
+QStringList FPSearchIndex::words(const QString &text)
+{
+	QStringList out;
+	QString lower = text.toLower();
+	int start = -1;
+	for(int i = 0; i <= lower.size(); i++)
+	{
+		bool inWord = i < lower.size() && lower[i].isLetterOrNumber();
+		if (inWord && start < 0)
+			start = i;
+		else if (!inWord && start >= 0)
+		{
+			out.append(lower.mid(start, i - start));
+			start = -1;
+		}
+	}
+	return out;
+}
+
+int FPSearchIndex::padType(const QString &name)
+{
+	QString n = name.toLower();
+	if (n == "smd")
+		return PAD_SMD;
+	else if (n == "th")
+		return PAD_TH;
+	else if (n == "round")
+		return PAD_ROUND;
+	else if (n == "square")
+		return PAD_SQUARE;
+	else if (n == "rect")
+		return PAD_RECT;
+	else if (n == "obround")
+		return PAD_OBROUND;
+	else if (n == "octagon")
+		return PAD_OCTAGON;
+	return 0;
+}
+
+QSet<int> FPSearchIndex::matchText(const QString &term) const
+{
+	QSet<int> out;
+
+	// names containing the term
+	if (term.size() >= 3)
+	{
+		// check the names in the shortest posting list of the term's trigrams
+		const QVector<int>* best = NULL;
+		for(int i = 0; i + 3 <= term.size(); i++)
+		{
+			QHash<quint64, QVector<int> >::const_iterator it
+					= mTrigrams.constFind(trigram(term.constData() + i));
+			if (it == mTrigrams.constEnd())
+			{
+				best = NULL;
+				break;
+			}
+			if (!best || it.value().size() < best->size())
+				best = &it.value();
+		}
+		if (best)
+		{
+			foreach(int slot, *best)
+			{
+				if (mLive[slot] && mNames[slot].contains(term))
+					out.insert(slot);
+			}
+		}
+	}
+	else
+	{
+		// too short for the trigram index
+		for(int slot = 0; slot < mNames.size(); slot++)
+		{
+			if (mLive[slot] && mNames[slot].contains(term))
+				out.insert(slot);
+		}
+	}
+
+	// words starting with the term
+	QMap<QString, QVector<int> >::const_iterator it = mWords.lowerBound(term);
+	for(; it != mWords.constEnd() && it.key().startsWith(term); ++it)
+	{
+		foreach(int slot, it.value())
+		{
+			if (mLive[slot])
+				out.insert(slot);
+		}
+	}
+	return out;
+}
+
+QSet<int> FPSearchIndex::search(const QString &query) const
+{
+	int minPins = 0, maxPins = INT_MAX;
+	int padMask = 0;
+	QList<QSet<int> > matches;
+	foreach(QString term, query.toLower().split(QRegExp("\\s+"),
+												QString::SkipEmptyParts))
+	{
+		// incomplete facets are ignored, so that the results don't
+		// disappear while the user is still typing
+		if (term.startsWith("pins:"))
+		{
+			QStringList range = term.mid(5).split('-');
+			bool ok;
+			int n = range.first().toInt(&ok);
+			if (!ok)
+				continue;
+			minPins = n;
+			maxPins = n;
+			if (range.size() > 1)
+			{
+				n = range.last().toInt(&ok);
+				maxPins = ok ? n : INT_MAX;
+			}
+		}
+		else if (term.startsWith("pad:"))
+		{
+			padMask |= padType(term.mid(4));
+		}
+		else
+		{
+			matches.append(matchText(term));
+		}
+	}
+
+	// intersect the text matches, starting with the smallest set
+	QSet<int> result;
+	if (matches.isEmpty())
+	{
+		for(int slot = 0; slot < mLive.size(); slot++)
+		{
+			if (mLive[slot])
+				result.insert(slot);
+		}
+	}
+	else
+	{
+		int smallest = 0;
+		for(int i = 1; i < matches.size(); i++)
+		{
+			if (matches[i].size() < matches[smallest].size())
+				smallest = i;
+		}
+		result = matches.takeAt(smallest);
+		foreach(const QSet<int> &m, matches)
+			result.intersect(m);
+	}
+
+	// apply the facets, and return the ids of the remaining slots
+	QSet<int> ids;
+	ids.reserve(result.size());
+	foreach(int slot, result)
+	{
+		if (mPinCounts[slot] < minPins || mPinCounts[slot] > maxPins
+				|| (mPadTypes[slot] & padMask) != padMask)
+			continue;
+		ids.insert(mIds[slot]);
+	}
+	return ids;
+}
@@ -0,0 +1,125 @@
+/*
+	Copyright (C) 2010-2011 Igor Izyumin
+
+	This file is part of xpcb.
+
+	xpcb is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	xpcb is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with xpcb.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef FPSEARCHINDEX_H
+#define FPSEARCHINDEX_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QHash>
+#include <QMap>
+#include <QSet>
+
+/// An in-memory full text index over footprint descriptions.
+
+/// FPSearchIndex answers queries as the user types them.  Footprint names
+/// are indexed by trigrams so that any substring can be found, while the
+/// author, source and description are split into words that are matched
+/// by prefix.  The pin count and pad types are kept as facets.
+///
+/// A query is a list of terms separated by whitespace, all of which must
+/// match:
+///  - \c pins:N, \c pins:N- or \c pins:N-M matches footprints with N
+///    (or more, or up to M) pins;
+///  - \c pad:T matches footprints with pads of type T, which is one of
+///    smd, th, round, square, rect, obround or octagon;
+///  - anything else matches footprints whose name contains the term, or
+///    whose author, source or description has a word starting with it.
+/// Matching is case insensitive.
+class FPSearchIndex
+{
+public:
+	/// Pad type facets
+	enum PadType
+	{
+		PAD_SMD = 0x01,
+		PAD_TH = 0x02,
+		PAD_ROUND = 0x04,
+		PAD_SQUARE = 0x08,
+		PAD_RECT = 0x10,
+		PAD_OBROUND = 0x20,
+		PAD_OCTAGON = 0x40
+	};
+
+	/// The indexed fields of a footprint
+	struct Entry
+	{
+		Entry() : pinCount(0), padTypes(0) {}
+		QString name;
+		QString author;
+		QString source;
+		QString desc;
+		int pinCount;
+		/// Combination of PadType flags
+		int padTypes;
+	};
+
+	FPSearchIndex() : mNumLive(0), mNextId(0) {}
+
+	/// Adds a footprint to the index and returns its id.  Ids are not
+	/// reused.
+	int add(const Entry &entry);
+	/// Removes a footprint from the index.  The index is compacted once
+	/// more footprints have been removed than are left.
+	void remove(int id);
+	void clear();
+	/// Returns the number of footprints in the index.
+	int size() const { return mNumLive; }
+
+	/// Returns the ids of the footprints that match a query.
+	QSet<int> search(const QString &query) const;
+
+	/// Returns the pad type flag for a pad type name, or 0 if the name is
+	/// not known.
+	static int padType(const QString &name);
+
+private:
+	/// Packs three characters into a trigram key
+	static quint64 trigram(const QChar *s)
+	{ return (quint64(s[0].unicode()) << 32) | (quint64(s[1].unicode()) << 16) | s[2].unicode(); }
+	static QStringList words(const QString &text);
+
+	/// Returns the slots of the footprints matching a text term.
+	QSet<int> matchText(const QString &term) const;
+	/// Drops the dead slots and their postings, and renumbers the rest.
+	void compact();
+
+	// Footprints are stored in slots.  A removed footprint's slot is only
+	// marked as dead until the index is compacted, which renumbers the
+	// slots; ids stay the same.
+
+	/// Lower case footprint names, by slot
+	QVector<QString> mNames;
+	QVector<int> mPinCounts;
+	QVector<int> mPadTypes;
+	QVector<bool> mLive;
+	int mNumLive;
+	/// Ids of the footprints, by slot
+	QVector<int> mIds;
+	/// Slots of the live footprints, by id
+	QHash<int, int> mSlots;
+	int mNextId;
+	/// Slots of the names containing each trigram, in ascending order
+	QHash<quint64, QVector<int> > mTrigrams;
+	/// Slots of the footprints containing each word, in ascending order
+	QMap<QString, QVector<int> > mWords;
+};
+
+#endif // FPSEARCHINDEX_H
@@ -23,7 +23,14 @@
 #include "Log.h"
 #include "Line.h"
 #include "Document.h"
+#include "FootprintCache.h"
+#include "XmlAttr.h"
 #include <QDir>
+#include <QFileInfo>
+#include <QDataStream>
+#include <QDesktopServices>
+#include <QtConcurrentRun>
+#include <QtConcurrentMap>
 
 /////////////////////// PAD /////////////////////////
 // class pad
@@ -46,38 +53,38 @@ bool Pad::operator==(const Pad & p) const
 
 Pad Pad::newFromXML(QXmlStreamReader &reader)
 {
-	Q_ASSERT(reader.isStartElement() && reader.name() == "pad");
+	Q_ASSERT(reader.isStartElement() && Xml::is(reader.name(), "pad"));
 	Pad p;
 	QXmlStreamAttributes attr(reader.attributes());
-	QStringRef t = attr.value("shape");
-	if (t == "round")
+	QStringRef t = Xml::attr(attr, "shape");
+	if (Xml::is(t, "round"))
 	{
 		p.mShape = PAD_ROUND;
-		p.mWidth = attr.value("width").toString().toInt();
+		p.mWidth = Xml::intAttr(attr, "width");
 	}
-	else if (t == "octagon")
+	else if (Xml::is(t, "octagon"))
 	{
 		p.mShape = PAD_OCTAGON;
-		p.mWidth = attr.value("width").toString().toInt();
+		p.mWidth = Xml::intAttr(attr, "width");
 	}
-	else if (t == "square")
+	else if (Xml::is(t, "square"))
 	{
 		p.mShape = PAD_SQUARE;
-		p.mWidth = attr.value("width").toString().toInt();
+		p.mWidth = Xml::intAttr(attr, "width");
 	}
-	else if (t == "rect")
+	else if (Xml::is(t, "rect"))
 	{
 		p.mShape = PAD_RECT;
-		p.mWidth = attr.value("width").toString().toInt();
-		p.mLength = attr.value("height").toString().toInt();
+		p.mWidth = Xml::intAttr(attr, "width");
+		p.mLength = Xml::intAttr(attr, "height");
 	}
-	else if (t == "obround")
+	else if (Xml::is(t, "obround"))
 	{
 		p.mShape = PAD_OBROUND;
-		p.mWidth = attr.value("width").toString().toInt();
-		p.mLength = attr.value("height").toString().toInt();
+		p.mWidth = Xml::intAttr(attr, "width");
+		p.mLength = Xml::intAttr(attr, "height");
 	}
-	else if (t == "default")
+	else if (Xml::is(t, "default"))
 	{
 		p.mShape = PAD_DEFAULT;
 	}
@@ -169,6 +176,12 @@ QRect Pad::bbox() const
 
 void Pad::draw(QPainter *painter) const
 {
+	if (!isNull() && XPcb::lod(painter) != XPcb::LOD_FULL)
+	{
+		// too small for the shape to matter
+		painter->drawRect(bbox());
+		return;
+	}
 	switch(mShape)
 	{
 	case PAD_ROUND:
@@ -211,6 +224,51 @@ void Pad::draw(QPainter *painter) const
 		break;
 	}
 }
+QPainterPath Pad::path(bool simple) const
+{
+	QPainterPath p;
+	if (isNull())
+		return p;
+	if (simple)
+	{
+		p.addRect(bbox());
+		return p;
+	}
+	switch(mShape)
+	{
+	case PAD_ROUND:
+		p.addEllipse(QRect(-mWidth/2, -mWidth/2, mWidth, mWidth));
+		break;
+	case PAD_SQUARE:
+		p.addRect(QRect(-mWidth/2, -mWidth/2, mWidth, mWidth));
+		break;
+	case PAD_RECT:
+		p.addRect(QRect(-mWidth/2, -mLength/2, mWidth, mLength));
+		break;
+	case PAD_OCTAGON:
+		{
+			int x = mWidth * 0.2071 + 0.5;
+			int w = mWidth * 0.5 + 0.5;
+			QPolygon poly;
+			poly << QPoint(x, w) << QPoint(w, x) << QPoint(w, -x) << QPoint(x, -w)
+				 << QPoint(-x, -w) << QPoint(-w, -x) << QPoint(-w, x) << QPoint(-x, w);
+			p.addPolygon(poly);
+			p.closeSubpath();
+		}
+		break;
+	case PAD_OBROUND:
+		{
+			// a rectangle with semicircular ends
+			qreal r = qMin(mWidth, mLength) / 2.0;
+			p.addRoundedRect(QRectF(-mWidth/2, -mLength/2, mWidth, mLength), r, r);
+		}
+		break;
+	default:
+		break;
+	}
+	return p;
+}
+
 /////////////////////// PADSTACK /////////////////////////
 
 // class padstack
@@ -238,12 +296,12 @@ bool Padstack::operator==(const Padstack &p) const
 
 QSharedPointer<Padstack> Padstack::newFromXML(QXmlStreamReader &reader)
 {
-	Q_ASSERT(reader.isStartElement() && reader.name() == "padstack");
+	Q_ASSERT(reader.isStartElement() && Xml::is(reader.name(), "padstack"));
 	QSharedPointer<Padstack> p(new Padstack());
-	if (reader.attributes().hasAttribute("name"))
-		p->mName = reader.attributes().value("name").toString();
-	p->hole_size = reader.attributes().value("holesize").toString().toInt();
-	p->mUuid = QUuid(reader.attributes().value("uuid").toString());
+	if (Xml::hasAttr(reader.attributes(), "name"))
+		p->mName = Xml::attr(reader.attributes(), "name").toString();
+	p->hole_size = Xml::intAttr(reader.attributes(), "holesize");
+	p->mUuid = Xml::uuidAttr(reader.attributes(), "uuid");
 	reader.readNextStartElement();
 	do
 	{
@@ -252,19 +310,19 @@ QSharedPointer<Padstack> Padstack::newFromXML(QXmlStreamReader &reader)
 		if (!reader.readNextStartElement())
 			continue; // no pad
 		// we have a pad.  create it
-		if (padtype == "startpad")
+		if (Xml::is(padtype, "startpad"))
 			p->start = Pad::newFromXML(reader);
-		else if (padtype == "innerpad")
+		else if (Xml::is(padtype, "innerpad"))
 			p->inner = Pad::newFromXML(reader);
-		else if (padtype == "endpad")
+		else if (Xml::is(padtype, "endpad"))
 			p->end = Pad::newFromXML(reader);
-		else if (padtype == "startmask")
+		else if (Xml::is(padtype, "startmask"))
 			p->start_mask = Pad::newFromXML(reader);
-		else if (padtype == "endmask")
+		else if (Xml::is(padtype, "endmask"))
 			p->end_mask = Pad::newFromXML(reader);
-		else if (padtype == "startpaste")
+		else if (Xml::is(padtype, "startpaste"))
 			p->start_paste = Pad::newFromXML(reader);
-		else if (padtype == "endpaste")
+		else if (Xml::is(padtype, "endpaste"))
 			p->end_paste = Pad::newFromXML(reader);
 		else
 			Q_ASSERT(false);
@@ -304,6 +362,28 @@ void Padstack::draw(QPainter *painter, const Layer& layer) const
 	}
 }
 
+QPainterPath Padstack::path(const Layer& layer, bool simple) const
+{
+	QPainterPath p;
+	switch(layer.type())
+	{
+	case Layer::LAY_START:
+		return start.path(simple);
+	case Layer::LAY_INNER:
+		return inner.path(simple);
+	case Layer::LAY_END:
+		return end.path(simple);
+	case Layer::LAY_HOLE:
+		if (hole_size)
+			p.addEllipse(QRect(QPoint(-hole_size/2, -hole_size/2),
+							   QPoint(hole_size/2, hole_size/2)));
+		break;
+	default:
+		break;
+	}
+	return p;
+}
+
 void Padstack::toXML(QXmlStreamWriter &writer) const
 {
 	writer.writeStartElement("padstack");
@@ -366,15 +446,15 @@ QRect Padstack::bbox() const
 
 QSharedPointer<Pin> Pin::newFromXML(QXmlStreamReader &reader, const QHash<int, QSharedPointer<Padstack> > & padstacks, Footprint *fp)
 {
-	Q_ASSERT(reader.isStartElement() && reader.name() == "pin");
+	Q_ASSERT(reader.isStartElement() && Xml::is(reader.name(), "pin"));
 	QXmlStreamAttributes attr = reader.attributes();
 
 	QSharedPointer<Pin> p(new Pin(fp));
-	p->mName = attr.value("name").toString();
-	p->mPos = QPoint(attr.value("x").toString().toInt(), attr.value("y").toString().toInt());
-	p->mAngle = attr.value("rot").toString().toInt();
+	p->mName = Xml::attr(attr, "name").toString();
+	p->mPos = QPoint(Xml::intAttr(attr, "x"), Xml::intAttr(attr, "y"));
+	p->mAngle = Xml::intAttr(attr, "rot");
 	p->updateTransform();
-	int psind = attr.value("padstack").toString().toInt();
+	int psind = Xml::intAttr(attr, "padstack");
 	if (padstacks.contains(psind))
 		p->mPadstack = padstacks.value(psind);
 	else
@@ -425,6 +505,8 @@ Pad Pin::getPadOnLayer(const Layer& layer) const
 
 QRect Pin::bbox() const
 {
+	if (mIsDirty)
+		updateTransform();
 	return mFpTransform.mapRect(padstack()->bbox());
 }
 
@@ -433,6 +515,7 @@ void Pin::updateTransform() const
 	mFpTransform.reset();
 	mFpTransform.translate(mPos.x(), mPos.y());
 	mFpTransform.rotate(mAngle);
+	mIsDirty = false;
 }
 
 void Pin::draw(QPainter *painter, const Layer& layer) const
@@ -445,6 +528,13 @@ void Pin::draw(QPainter *painter, const Layer& layer) const
 	painter->restore();
 }
 
+QPainterPath Pin::path(const Layer& layer, bool simple) const
+{
+	if (mIsDirty)
+		updateTransform();
+	return mFpTransform.map(mPadstack->path(layer, simple));
+}
+
 PCBObjState Pin::getState() const
 {
 	return PCBObjState(new PinState(*this));
@@ -459,6 +549,7 @@ bool Pin::loadState(PCBObjState &state)
 	mPos = s->pos;
 	mAngle = s->angle;
 	mPadstack = s->ps;
+	markDirty();
 	return true;
 }
 
@@ -468,7 +559,7 @@ Footprint::Footprint(QObject* parent)
 	: PCBObject(parent), mName("EMPTY_SHAPE"), mUnits(XPcb::MIL),
 	  mRefText(QSharedPointer<Text>(new Text())),
 	  mValueText(QSharedPointer<Text>(new Text())),
-	  mCustomCentroid(false), mUuid(QUuid::createUuid())
+	  mCustomCentroid(false), mUuid(QUuid::createUuid()), mShapesGen(-1)
 {
 	mValueText->setText("VALUE");
 	mValueText->setLayer(Layer::LAY_SILK_TOP);
@@ -526,9 +617,106 @@ void Footprint::draw(QPainter *painter, FP_DRAW_LAYER layer) const
 		t->draw(painter, pcblayer);
 }
 
+QAtomicInt Footprint::sGeneration(0);
+
+static int shapeKey(const Layer& layer, bool simple)
+{
+	return layer.toInt() * 2 + (simple ? 1 : 0);
+}
+
+Footprint::Shapes Footprint::shapes(const Layer& layer, bool simple) const
+{
+	QMutexLocker lock(&mShapesLock);
+	checkGeneration();
+	int key = shapeKey(layer, simple);
+	QHash<int, Shapes>::const_iterator i = mShapes.constFind(key);
+	if (i != mShapes.constEnd())
+		return i.value();
+	Shapes s = compile(layer, simple);
+	mShapes.insert(key, s);
+	return s;
+}
+
+void Footprint::copyShapes(ShapeSet &set, const Layer& layer, bool simple) const
+{
+	QPair<const Footprint*, int> key(this, shapeKey(layer, simple));
+	if (set.contains(key))
+		return;
+	Shapes s = shapes(layer, simple);
+	// addPath() copies the elements, so the copies share nothing with
+	// the cached paths
+	Shapes copy;
+	copy.fill.setFillRule(Qt::WindingFill);
+	copy.stroke.setFillRule(Qt::WindingFill);
+	copy.fill.addPath(s.fill);
+	copy.stroke.addPath(s.stroke);
+	set.insert(key, copy);
+}
+
+const Footprint::Shapes* Footprint::findShapes(const ShapeSet &set,
+											   const Layer& layer,
+											   bool simple) const
+{
+	ShapeSet::const_iterator i =
+			set.constFind(qMakePair(this, shapeKey(layer, simple)));
+	return i != set.constEnd() ? &i.value() : NULL;
+}
+
+QRect Footprint::cachedBBox() const
+{
+	QMutexLocker lock(&mShapesLock);
+	checkGeneration();
+	if (mCachedBBox.isNull())
+		mCachedBBox = bbox();
+	return mCachedBBox;
+}
+
+void Footprint::checkGeneration() const
+{
+	int gen = sGeneration;
+	if (gen != mShapesGen)
+	{
+		mShapes.clear();
+		mCachedBBox = QRect();
+		mShapesGen = gen;
+	}
+}
+
+Footprint::Shapes Footprint::compile(const Layer& layer, bool simple) const
+{
+	Shapes s;
+	s.fill.setFillRule(Qt::WindingFill);
+	s.stroke.setFillRule(Qt::WindingFill);
+	if (layer == Layer::LAY_SILK_TOP || layer == Layer::LAY_SILK_BOTTOM)
+	{
+		foreach(QSharedPointer<Line> l, mOutlineLines)
+		{
+			if (l->layer() == layer)
+				s.stroke.addPath(l->outline());
+		}
+		foreach(QSharedPointer<Text> t, mTexts)
+		{
+			if (t->layer() == layer)
+				s.stroke.addPath(t->outline(simple));
+		}
+	}
+	else
+	{
+		foreach(QSharedPointer<Pin> p, mPins)
+			s.fill.addPath(p->path(layer, simple));
+	}
+	// QPainterPath computes its bounds lazily; do it now, since the paths
+	// are shared between drawing threads
+	s.fill.boundingRect();
+	s.fill.controlPointRect();
+	s.stroke.boundingRect();
+	s.stroke.controlPointRect();
+	return s;
+}
+
 QSharedPointer<Footprint> Footprint::newFromXML(QXmlStreamReader &reader)
 {
-	Q_ASSERT(reader.isStartElement() && reader.name() == "footprint");
+	Q_ASSERT(reader.isStartElement() && Xml::is(reader.name(), "footprint"));
 
 	QHash<int, QSharedPointer<Padstack> > psHash;
 
@@ -536,62 +724,62 @@ QSharedPointer<Footprint> Footprint::newFromXML(QXmlStreamReader &reader)
 	while(reader.readNextStartElement())
 	{
 		QStringRef el = reader.name();
-		if (el == "name")
+		if (Xml::is(el, "name"))
 		{
 			fp->mName = reader.readElementText();
 		}
-		else if (el == "uuid")
+		else if (Xml::is(el, "uuid"))
 		{
 			fp->mUuid = QUuid(reader.readElementText());
 		}
-		else if (el == "units")
+		else if (Xml::is(el, "units"))
 		{
 			if (reader.readElementText() == "mm")
 				fp->mUnits = XPcb::MM;
 			else
 				fp->mUnits = XPcb::MIL;
 		}
-		else if (el == "author")
+		else if (Xml::is(el, "author"))
 		{
 			fp->mAuthor = reader.readElementText();
 		}
-		else if (el == "source")
+		else if (Xml::is(el, "source"))
 		{
 			fp->mSource = reader.readElementText();
 		}
-		else if (el == "desc")
+		else if (Xml::is(el, "desc"))
 		{
 			fp->mDesc = reader.readElementText();
 		}
-		else if (el == "centroid")
+		else if (Xml::is(el, "centroid"))
 		{
 			QXmlStreamAttributes attr = reader.attributes();
-			fp->mCentroid = QPoint(attr.value("x").toString().toInt(),
-								   attr.value("y").toString().toInt());
-			if (attr.hasAttribute("custom"))
-				fp->mCustomCentroid = (attr.value("custom") == "1");
+			fp->mCentroid = QPoint(Xml::intAttr(attr, "x"),
+								   Xml::intAttr(attr, "y"));
+			fp->mCustomCentroid = Xml::boolAttr(attr, "custom",
+												fp->mCustomCentroid);
 			do
 					reader.readNext();
 			while(!reader.isEndElement());
 		}
-		else if (el == "line" || el == "arc")
+		else if (Xml::is(el, "line") || Xml::is(el, "arc"))
 		{
 			fp->mOutlineLines.append(Line::newFromXml(reader));
 		}
-		else if (el == "text")
+		else if (Xml::is(el, "text"))
 		{
 			fp->mTexts.append(Text::newFromXML(reader));
 		}
-		else if (el == "padstacks")
+		else if (Xml::is(el, "padstacks"))
 		{
 			while(reader.readNextStartElement())
 			{
-				int psid = reader.attributes().value("id").toString().toInt();
+				int psid = Xml::intAttr(reader.attributes(), "id");
 				QSharedPointer<Padstack> ps = Padstack::newFromXML(reader);
 				psHash.insert(psid, ps);
 			}
 		}
-		else if (el == "pins")
+		else if (Xml::is(el, "pins"))
 		{
 			while(reader.readNextStartElement())
 			{
@@ -599,30 +787,30 @@ QSharedPointer<Footprint> Footprint::newFromXML(QXmlStreamReader &reader)
 				fp->mPins.append(pin);
 			}
 		}
-		else if (el == "text")
+		else if (Xml::is(el, "text"))
 		{
 			fp->mTexts.append(Text::newFromXML(reader));
 		}
-		else if (el == "refText")
+		else if (Xml::is(el, "refText"))
 		{
 			QXmlStreamAttributes attr = reader.attributes();
-			fp->mRefText->setPos(QPoint(attr.value("x").toString().toInt(),
-									   attr.value("y").toString().toInt()));
-			fp->mRefText->setAngle(attr.value("rot").toString().toInt());
-			fp->mRefText->setFontSize(attr.value("textSize").toString().toInt());
-			fp->mRefText->setStrokeWidth(attr.value("lineWidth").toString().toInt());
+			fp->mRefText->setPos(QPoint(Xml::intAttr(attr, "x"),
+									   Xml::intAttr(attr, "y")));
+			fp->mRefText->setAngle(Xml::intAttr(attr, "rot"));
+			fp->mRefText->setFontSize(Xml::intAttr(attr, "textSize"));
+			fp->mRefText->setStrokeWidth(Xml::intAttr(attr, "lineWidth"));
 			do
 					reader.readNext();
 			while(!reader.isEndElement());
 		}
-		else if (el == "valueText")
+		else if (Xml::is(el, "valueText"))
 		{
 			QXmlStreamAttributes attr = reader.attributes();
-			fp->mValueText->setPos(QPoint(attr.value("x").toString().toInt(),
-									   attr.value("y").toString().toInt()));
-			fp->mValueText->setAngle(attr.value("rot").toString().toInt());
-			fp->mValueText->setFontSize(attr.value("textSize").toString().toInt());
-			fp->mValueText->setStrokeWidth(attr.value("lineWidth").toString().toInt());
+			fp->mValueText->setPos(QPoint(Xml::intAttr(attr, "x"),
+									   Xml::intAttr(attr, "y")));
+			fp->mValueText->setAngle(Xml::intAttr(attr, "rot"));
+			fp->mValueText->setFontSize(Xml::intAttr(attr, "textSize"));
+			fp->mValueText->setStrokeWidth(Xml::intAttr(attr, "lineWidth"));
 			do
 					reader.readNext();
 			while(!reader.isEndElement());
@@ -632,6 +820,20 @@ QSharedPointer<Footprint> Footprint::newFromXML(QXmlStreamReader &reader)
 	return fp;
 }
 
+QSharedPointer<Footprint> Footprint::clone() const
+{
+	// the copy constructor is unfinished; a round trip through XML copies
+	// everything that is saved
+	QByteArray xml;
+	{
+		QXmlStreamWriter writer(&xml);
+		toXML(writer);
+	}
+	QXmlStreamReader reader(xml);
+	reader.readNextStartElement();
+	return newFromXML(reader);
+}
+
 void Footprint::toXML(QXmlStreamWriter &writer) const
 {
 	writer.writeStartElement("footprint");
@@ -766,12 +968,33 @@ QRect Footprint::bbox() const
 
 FPDatabase* FPDatabase::mInst = NULL;
 
+/// Footprint index file signature ("XFPI")
+static const quint32 FPINDEX_MAGIC = 0x58465049;
+/// Footprint index format version.  Bump this when IndexEntry changes.
+static const quint32 FPINDEX_VERSION = 2;
+/// Directory containing the footprint library
+static const QString FP_ROOT = "footprints";
+
 FPDatabase::FPDatabase()
+	: mIndexChanged(false), mScanning(true), mScanStarted(false),
+	  mNumPublished(0)
 {
-	// create root folders
-	QSharedPointer<FPDBFolder> f = createFolder("footprints", true);
-	if (f)
-		mRootFolders.append(f);
+	loadIndex();
+	// batch up new files so that views don't update for every footprint
+	mFlushTimer.setSingleShot(true);
+	mFlushTimer.setInterval(100);
+	connect(&mFlushTimer, SIGNAL(timeout()), this, SLOT(flushAdded()));
+	mSaveTimer.setSingleShot(true);
+	mSaveTimer.setInterval(5000);
+	connect(&mSaveTimer, SIGNAL(timeout()), this, SLOT(saveIndex()));
+	connect(&mListing, SIGNAL(finished()), this, SLOT(onListingFinished()));
+	connect(&mScan, SIGNAL(resultReadyAt(int)), this, SLOT(onResultReady(int)));
+	connect(&mScan, SIGNAL(finished()), this, SLOT(onScanFinished()));
+	connect(&mWatcher, SIGNAL(directoryChanged(QString)),
+			this, SLOT(onDirectoryChanged(QString)));
+	// list the files first, then read them in parallel
+	mListing.setFuture(QtConcurrent::run(&FPDatabase::listFiles,
+										 QDir(FP_ROOT).absolutePath()));
 }
 
 FPDatabase& FPDatabase::instance()
@@ -781,61 +1004,463 @@ FPDatabase& FPDatabase::instance()
 	return *mInst;
 }
 
-QSharedPointer<FPDBFolder> FPDatabase::createFolder(QString path, bool fullName)
+QSharedPointer<const FPDBFile> FPDatabase::getByUuid(QUuid uuid)
 {
-	QDir dir(path);
-	if (!dir.exists() || !dir.count() || !dir.isReadable())
-		return QSharedPointer<FPDBFolder>();
-	QList<QSharedPointer<FPDBFolder> > subfolders;
-	// find all subdirs
+	if (!mUuidHash.contains(uuid))
+		waitForScan();
+	return mUuidHash.value(uuid);
+}
+
+QSharedPointer<const FPDBFile> FPDatabase::getByName(QString name)
+{
+	if (!mNameHash.contains(name))
+		waitForScan();
+	return mNameHash.value(name);
+}
+
+void FPDatabase::waitForScan()
+{
+	if (!mScanning)
+		return;
+	mListing.waitForFinished();
+	onListingFinished();
+	mScan.waitForFinished();
+	onScanFinished();
+}
+
+QStringList FPDatabase::listFiles(QString path)
+{
+	QStringList files;
+	listDir(QDir(path), files);
+	return files;
+}
+
+void FPDatabase::listDir(const QDir &dir, QStringList &files)
+{
+	if (!dir.exists() || !dir.isReadable())
+		return;
+	// recursively process all subdirs
 	QStringList subdirs = dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot
 										| QDir::Readable);
-	// recursively process all subdirs
 	foreach(QString s, subdirs)
-	{
-		QSharedPointer<FPDBFolder> f = createFolder(dir.filePath(s));
-		if (f)
-			subfolders.append(f);
-	}
-	QList<QSharedPointer<FPDBFile> > files;
+		listDir(QDir(dir.absoluteFilePath(s)), files);
 	// find any files in this dir
-	QString pattern = "*.xfp";
-	QStringList flist = dir.entryList(QStringList(pattern),
+	QStringList flist = dir.entryList(QStringList("*.xfp"),
 									  QDir::Files | QDir::Readable);
 	foreach(QString s, flist)
+		files.append(dir.absoluteFilePath(s));
+}
+
+FPDatabase::ScanResult FPDatabase::ScanFile::operator()(const QString &path) const
+{
+	ScanResult r;
+	r.path = path;
+	QFileInfo info(path);
+	r.entry = mIndex.value(path);
+	if (r.entry.size != info.size() || r.entry.mtime != info.lastModified())
+	{
+		// new or changed file
+		r.entry = IndexEntry();
+		r.entry.size = info.size();
+		r.entry.mtime = info.lastModified();
+		if (!scanHeader(path, r.entry))
+			r.entry.uuid = QUuid();
+		r.changed = true;
+	}
+	return r;
+}
+
+void FPDatabase::onListingFinished()
+{
+	if (mScanStarted)
+		return;
+	mScanStarted = true;
+	mScan.setFuture(QtConcurrent::mapped(mListing.result(), ScanFile(mOldIndex)));
+}
+
+void FPDatabase::onResultReady(int index)
+{
+	publishResults(index);
+}
+
+void FPDatabase::publishResults(int last)
+{
+	// results may have already been published by waitForScan()
+	while(mNumPublished <= last)
+		publish(mScan.resultAt(mNumPublished++));
+}
+
+void FPDatabase::onScanFinished()
+{
+	if (!mScanning)
+		return;
+	publishResults(mScan.future().resultCount() - 1);
+	mScanning = false;
+	flushAdded();
+	// entries of files that were removed are dropped from the index
+	if (mIndexChanged || mIndex.size() != mOldIndex.size())
+		saveIndex();
+	mOldIndex.clear();
+
+	// watch the library for changes
+	QString root = QDir(FP_ROOT).absolutePath();
+	if (QDir(root).exists())
+		mWatcher.addPath(root);
+	if (!mFolders.isEmpty())
+		mWatcher.addPaths(mFolders.keys());
+	emit scanFinished();
+}
+
+void FPDatabase::onDirectoryChanged(const QString &path)
+{
+	QDir dir(path);
+	if (!dir.exists())
+	{
+		removeFolder(path);
+		mWatcher.removePath(path);
+		mSaveTimer.start();
+		return;
+	}
+	if (!mWatcher.directories().contains(path))
+		mWatcher.addPath(path);
+
+	QStringList files;
+	foreach(QString s, dir.entryList(QStringList("*.xfp"),
+									 QDir::Files | QDir::Readable))
+		files.append(dir.absoluteFilePath(s));
+
+	// drop files and folders that are gone
+	QSharedPointer<FPDBFolder> f = mFolders.value(path);
+	if (f)
+	{
+		foreach(QSharedPointer<FPDBFile> file, f->items())
+		{
+			if (!files.contains(file->path()))
+				removeFile(file->path());
+		}
+		foreach(QSharedPointer<FPDBFolder> sub, f->folders())
+		{
+			if (!QDir(sub->path()).exists())
+			{
+				mWatcher.removePath(sub->path());
+				removeFolder(sub->path());
+			}
+		}
+	}
+
+	// rescan new and changed files
+	ScanFile scan(mIndex);
+	foreach(QString p, files)
+	{
+		ScanResult r = scan(p);
+		if (!r.changed && (mFiles.contains(p) || r.entry.uuid.isNull()))
+			continue;
+		removeFile(p);
+		publish(r);
+	}
+
+	// pick up new subfolders
+	QStringList watched = mWatcher.directories();
+	foreach(QString s, dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot
+									 | QDir::Readable))
 	{
-		QSharedPointer<FPDBFile> f = createFile(dir.filePath(s));
-		if (f)
-			files.append(f);
-	}
-	// if we didn't find any footprints, stop
-	if (subfolders.length() == 0 && files.length() == 0)
-		return QSharedPointer<FPDBFolder>();
-	// otherwise, create a folder entry
-	return QSharedPointer<FPDBFolder>(
-				new FPDBFolder(
-					fullName ? path : dir.dirName(),
-					subfolders, files));
-}
-
-QSharedPointer<FPDBFile> FPDatabase::createFile(QString path)
-{
-	FPDoc doc;
-	if(!doc.loadFromFile(path))
-		return QSharedPointer<FPDBFile>();
-	QSharedPointer<FPDBFile> f = QSharedPointer<FPDBFile>(
-				new FPDBFile(path, doc.footprint()->name(),
-							   doc.footprint()->author(),
-							   doc.footprint()->source(),
-							   doc.footprint()->desc(),
-							   doc.footprint()->uuid()));
-	mUuidHash.insert(doc.footprint()->uuid(), f);
-	if (!mNameHash.contains(doc.footprint()->name()))
-		mNameHash.insert(doc.footprint()->name(), f);
+		QString sub = dir.absoluteFilePath(s);
+		if (!watched.contains(sub))
+			onDirectoryChanged(sub);
+	}
+
+	flushAdded();
+	mSaveTimer.start();
+}
 
+void FPDatabase::publish(const ScanResult &result)
+{
+	mIndex.insert(result.path, result.entry);
+	if (result.changed)
+		mIndexChanged = true;
+	// invalid files stay in the index, so that they aren't reread
+	if (!result.entry.uuid.isNull())
+		addFile(result.path, result.entry);
+}
+
+void FPDatabase::addFile(const QString &path, const IndexEntry &e)
+{
+	QSharedPointer<FPDBFile> f(new FPDBFile(path, e.name, e.author,
+											 e.source, e.desc, e.uuid));
+	folder(QFileInfo(path).absolutePath())->addFile(f);
+	mFiles.insert(path, f);
+	FPSearchIndex::Entry se;
+	se.name = e.name;
+	se.author = e.author;
+	se.source = e.source;
+	se.desc = e.desc;
+	se.pinCount = e.pinCount;
+	se.padTypes = e.padTypes;
+	int id = mSearch.add(se);
+	mSearchFiles.insert(id, f.data());
+	mSearchIds.insert(f.data(), id);
+	mUuidHash.insert(e.uuid, f);
+	if (!mNameHash.contains(e.name))
+		mNameHash.insert(e.name, f);
+	mAdded.append(f);
+	if (!mFlushTimer.isActive())
+		mFlushTimer.start();
+}
+
+QSet<const FPDBFile*> FPDatabase::search(const QString &query) const
+{
+	QSet<const FPDBFile*> files;
+	foreach(int id, mSearch.search(query))
+		files.insert(mSearchFiles.value(id));
+	return files;
+}
+
+void FPDatabase::flushAdded()
+{
+	mFlushTimer.stop();
+	if (mAdded.isEmpty())
+		return;
+	QList<QSharedPointer<FPDBFile> > added = mAdded;
+	mAdded.clear();
+	emit filesAdded(added);
+}
+
+QSharedPointer<FPDBFile> FPDatabase::forgetFile(const QString &path)
+{
+	QSharedPointer<FPDBFile> f = mFiles.take(path);
+	if (!f)
+		return f;
+	int id = mSearchIds.take(f.data());
+	mSearch.remove(id);
+	mSearchFiles.remove(id);
+	if (mUuidHash.value(f->uuid()) == f)
+		mUuidHash.remove(f->uuid());
+	if (mNameHash.value(f->name()) == f)
+	{
+		// fall back to another footprint with the same name
+		mNameHash.remove(f->name());
+		foreach(QSharedPointer<FPDBFile> other, mFiles)
+		{
+			if (other->name() == f->name())
+			{
+				mNameHash.insert(other->name(), other);
+				break;
+			}
+		}
+	}
+	mAdded.removeAll(f);
 	return f;
 }
 
+void FPDatabase::removeFile(const QString &path)
+{
+	mIndex.remove(path);
+	QSharedPointer<FPDBFile> f = forgetFile(path);
+	if (!f)
+		return;
+	// listeners must have seen the file before it is removed
+	flushAdded();
+	if (f->parent())
+		f->parent()->removeFile(f);
+	emit fileRemoved(f);
+}
+
+void FPDatabase::removeFolder(const QString &path)
+{
+	// forget everything under the folder
+	QString prefix = path + "/";
+	foreach(QString p, mIndex.keys())
+	{
+		if (p.startsWith(prefix))
+		{
+			mIndex.remove(p);
+			forgetFile(p);
+		}
+	}
+	foreach(QString p, mFolders.keys())
+	{
+		if (p.startsWith(prefix))
+		{
+			mFolders.remove(p);
+			mWatcher.removePath(p);
+		}
+	}
+
+	QSharedPointer<FPDBFolder> f = mFolders.take(path);
+	if (!f)
+		return;
+	flushAdded();
+	if (f->parent())
+		f->parent()->removeFolder(f);
+	else
+		mRootFolders.removeAll(f);
+	emit folderRemoved(f);
+}
+
+QSharedPointer<FPDBFolder> FPDatabase::folder(const QString &path)
+{
+	QSharedPointer<FPDBFolder> f = mFolders.value(path);
+	if (f)
+		return f;
+	if (path == QDir(FP_ROOT).absolutePath())
+	{
+		f = QSharedPointer<FPDBFolder>(new FPDBFolder(FP_ROOT, path));
+		mRootFolders.append(f);
+	}
+	else
+	{
+		QFileInfo info(path);
+		QSharedPointer<FPDBFolder> parent = folder(info.absolutePath());
+		f = QSharedPointer<FPDBFolder>(new FPDBFolder(info.fileName(), path));
+		parent->addFolder(f);
+	}
+	mFolders.insert(path, f);
+	emit folderAdded(f);
+	return f;
+}
+
+bool FPDatabase::scanHeader(const QString &path, IndexEntry &entry)
+{
+	QFile file(path);
+	if (!file.open(QIODevice::ReadOnly))
+		return false;
+	QXmlStreamReader reader(&file);
+	if (!reader.readNextStartElement() || !Xml::is(reader.name(), "xpcbFootprint"))
+		return false;
+	if (!reader.readNextStartElement() || !Xml::is(reader.name(), "footprint"))
+		return false;
+	// the header fields come first
+	while(reader.readNextStartElement())
+	{
+		QStringRef el = reader.name();
+		if (Xml::is(el, "name"))
+			entry.name = reader.readElementText();
+		else if (Xml::is(el, "uuid"))
+			entry.uuid = QUuid(reader.readElementText());
+		else if (Xml::is(el, "author"))
+			entry.author = reader.readElementText();
+		else if (Xml::is(el, "source"))
+			entry.source = reader.readElementText();
+		else if (Xml::is(el, "desc"))
+			entry.desc = reader.readElementText();
+		else if (Xml::is(el, "units"))
+			reader.skipCurrentElement();
+		else
+			break;
+	}
+	// the rest of the file is only skimmed for the search facets.  Only
+	// padstacks that are used by a pin count, and only their copper pads
+	// (not the mask and paste openings).
+	QHash<QUuid, int> psTypes;
+	QSet<QUuid> used;
+	QUuid ps;
+	bool copper = false;
+	while(!reader.atEnd())
+	{
+		QXmlStreamReader::TokenType t = reader.readNext();
+		if (t == QXmlStreamReader::EndElement)
+		{
+			if (Xml::is(reader.name(), "padstack"))
+				ps = QUuid();
+			continue;
+		}
+		if (t != QXmlStreamReader::StartElement)
+			continue;
+		QStringRef el = reader.name();
+		if (Xml::is(el, "pin"))
+		{
+			entry.pinCount++;
+			used.insert(Xml::uuidAttr(reader.attributes(), "padstack"));
+		}
+		else if (Xml::is(el, "padstack"))
+		{
+			QXmlStreamAttributes attr = reader.attributes();
+			ps = Xml::uuidAttr(attr, "uuid");
+			psTypes[ps] = Xml::intAttr(attr, "holesize") > 0
+					? FPSearchIndex::PAD_TH : FPSearchIndex::PAD_SMD;
+		}
+		else if (Xml::is(el, "startpad") || Xml::is(el, "innerpad")
+				 || Xml::is(el, "endpad"))
+		{
+			copper = true;
+		}
+		else if (Xml::is(el, "startmask") || Xml::is(el, "endmask")
+				 || Xml::is(el, "startpaste") || Xml::is(el, "endpaste"))
+		{
+			copper = false;
+		}
+		else if (Xml::is(el, "pad") && copper && !ps.isNull())
+		{
+			psTypes[ps] |= FPSearchIndex::padType(
+						Xml::attr(reader.attributes(), "shape").toString());
+		}
+	}
+	foreach(const QUuid &u, used)
+		entry.padTypes |= psTypes.value(u);
+	return !reader.hasError() && !entry.uuid.isNull();
+}
+
+QString FPDatabase::indexPath()
+{
+	return QDir(QDesktopServices::storageLocation(QDesktopServices::CacheLocation))
+			.filePath("fpindex.dat");
+}
+
+void FPDatabase::loadIndex()
+{
+	QFile file(indexPath());
+	if (!file.open(QIODevice::ReadOnly))
+		return;
+	QDataStream in(&file);
+	quint32 magic, version;
+	in >> magic >> version;
+	if (magic != FPINDEX_MAGIC || version != FPINDEX_VERSION)
+		return;
+	in.setVersion(QDataStream::Qt_4_6);
+	qint32 count;
+	in >> count;
+	for(int i = 0; i < count && in.status() == QDataStream::Ok; i++)
+	{
+		QString path;
+		IndexEntry e;
+		in >> path >> e.mtime >> e.size >> e.name >> e.author >> e.source
+				>> e.desc >> e.uuid >> e.pinCount >> e.padTypes;
+		mOldIndex.insert(path, e);
+	}
+	// don't trust a truncated index
+	if (in.status() != QDataStream::Ok)
+		mOldIndex.clear();
+}
+
+void FPDatabase::saveIndex()
+{
+	mSaveTimer.stop();
+	QString path = indexPath();
+	QDir().mkpath(QFileInfo(path).absolutePath());
+	// write to a temporary file first, so that a crash doesn't leave a
+	// truncated index behind
+	QFile file(path + ".tmp");
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+	{
+		Log::instance().warning("Unable to write footprint index");
+		return;
+	}
+	QDataStream out(&file);
+	out << FPINDEX_MAGIC << FPINDEX_VERSION;
+	out.setVersion(QDataStream::Qt_4_6);
+	out << qint32(mIndex.size());
+	QHash<QString, IndexEntry>::const_iterator i;
+	for(i = mIndex.constBegin(); i != mIndex.constEnd(); ++i)
+	{
+		const IndexEntry &e = i.value();
+		out << i.key() << e.mtime << e.size << e.name << e.author << e.source
+			<< e.desc << e.uuid << qint32(e.pinCount) << qint32(e.padTypes);
+	}
+	file.close();
+	QFile::remove(path);
+	QFile::rename(path + ".tmp", path);
+}
+
 FPDBFile::FPDBFile(QString path, QString name, QString author, QString source, QString desc, QUuid uuid)
 	: mFpPath(path), mName(name), mAuthor(author), mSource(source), mDesc(desc), mUuid(uuid), mParent(NULL)
 {
@@ -843,19 +1468,34 @@ FPDBFile::FPDBFile(QString path, QString name, QString author, QString source, Q
 
 QSharedPointer<Footprint> FPDBFile::loadFootprint() const
 {
-	FPDoc doc;
-	if(!doc.loadFromFile(path()))
-		return QSharedPointer<Footprint>();
-	return doc.footprint();
+	return FootprintCache::instance().load(path());
+}
+
+FPDBFolder::FPDBFolder(QString name, QString path)
+	: mName(name), mPath(path), mParent(NULL)
+{
+}
+
+void FPDBFolder::addFolder(QSharedPointer<FPDBFolder> folder)
+{
+	folder->setParent(this);
+	mFolders.append(folder);
+}
+
+void FPDBFolder::removeFolder(QSharedPointer<FPDBFolder> folder)
+{
+	if (mFolders.removeAll(folder))
+		folder->setParent(NULL);
+}
+
+void FPDBFolder::addFile(QSharedPointer<FPDBFile> file)
+{
+	file->setParent(this);
+	mFiles.append(file);
 }
 
-FPDBFolder::FPDBFolder(QString name, QList<QSharedPointer<FPDBFolder> > folders,
-					   QList<QSharedPointer<FPDBFile> > files)
-	: mName(name), mFolders(folders), mFiles(files), mParent(NULL)
+void FPDBFolder::removeFile(QSharedPointer<FPDBFile> file)
 {
-	// set the parent of all the children
-	foreach(QSharedPointer<FPDBFolder> f, mFolders)
-		f->setParent(this);
-	foreach(QSharedPointer<FPDBFile> f, mFiles)
-		f->setParent(this);
+	if (mFiles.removeAll(file))
+		file->setParent(NULL);
 }
@@ -24,7 +24,16 @@
 #include <QXmlStreamReader>
 #include <QXmlStreamWriter>
 #include <QUuid>
+#include <QMutex>
+#include <QAtomicInt>
+#include <QDateTime>
+#include <QDir>
+#include <QStringList>
+#include <QTimer>
+#include <QFutureWatcher>
+#include <QFileSystemWatcher>
 #include "PCBObject.h"
+#include "FPSearchIndex.h"
 #include "Text.h"
 #include "Line.h"
 
@@ -76,6 +85,9 @@ public:
 
 	QRect bbox() const;
 	void draw(QPainter *painter) const;
+	/// Returns the pad shape as a path.  If simple is true, the path is the
+	/// pad's bounding box.
+	QPainterPath path(bool simple = false) const;
 
 private:
 	PADSHAPE mShape;
@@ -111,6 +123,8 @@ public:
 	bool isSmt() const {return hole_size == 0;}
 	QRect bbox() const;
 	void draw(QPainter *painter, const Layer& layer) const;
+	/// Returns the shape drawn by draw() on a layer as a path.
+	QPainterPath path(const Layer& layer, bool simple = false) const;
 
 	QUuid uuid() const { return mUuid; }
 private:
@@ -135,10 +149,45 @@ public:
 
 	enum FP_DRAW_LAYER { LAY_START, LAY_INNER, LAY_END };
 
+	/// Compiled footprint shapes on one layer
+	struct Shapes
+	{
+		/// Pads and holes; drawn with the layer pen and brush
+		QPainterPath fill;
+		/// Silkscreen lines and text, already stroked; filled with the pen color
+		QPainterPath stroke;
+	};
+	/// Private copies of compiled shapes, keyed by footprint and by layer
+	/// and level of detail.  QPainterPath caches some of its data lazily,
+	/// so a path must not be drawn by two threads at once; each drawing
+	/// thread gets its own set, filled in by copyShapes().
+	typedef QHash<QPair<const Footprint*, int>, Shapes> ShapeSet;
+
 	virtual void draw(QPainter *, const Layer& ) const {}
 	void draw(QPainter *painter, FP_DRAW_LAYER layer) const;
 	QRect bbox() const;
 
+	/// Returns the shapes of the footprint on a layer, in footprint
+	/// coordinates.  The layer is LAY_SILK_TOP or LAY_SILK_BOTTOM for the
+	/// silkscreen, or one of the pin layers (LAY_START, LAY_INNER, LAY_END,
+	/// LAY_HOLE).  If simple is true, pads and text are reduced to their
+	/// bounding boxes.  Shapes are compiled on first use and cached until
+	/// geometryChanged() is called.  Thread-safe, provided that the pins and
+	/// texts are up to date (i.e. bbox() has been called since they changed).
+	Shapes shapes(const Layer& layer, bool simple = false) const;
+	/// Adds detached copies of the shapes on a layer to a shape set, unless
+	/// the set already has them.
+	void copyShapes(ShapeSet &set, const Layer& layer, bool simple) const;
+	/// Returns shapes added to a set by copyShapes(), or NULL if they are
+	/// not in the set.
+	const Shapes* findShapes(const ShapeSet &set, const Layer& layer,
+							 bool simple) const;
+	/// Returns bbox(), cached along with the shapes.
+	QRect cachedBBox() const;
+	/// Discards the compiled shapes of all footprints.  Must be called when
+	/// footprint or padstack geometry is modified.
+	static void geometryChanged() { sGeneration.ref(); }
+
 	QString name() const { return mName; }
 	void setName(QString name) { mName = name; }
 
@@ -184,6 +233,8 @@ public:
 
 	static QSharedPointer<Footprint> newFromXML(QXmlStreamReader &reader);
 	void toXML(QXmlStreamWriter &writer) const;
+	/// Returns a deep copy of the footprint, with the same uuid.
+	QSharedPointer<Footprint> clone() const;
 
 	const QUuid& uuid() const { return mUuid; }
 
@@ -228,6 +279,22 @@ private:
 	QList<QSharedPointer<Text> > mTexts;
 	/// UUID for this footprint
 	QUuid mUuid;
+
+	/// Compiles the shapes on a layer (see shapes())
+	Shapes compile(const Layer& layer, bool simple) const;
+	/// Drops the compiled shapes if the geometry has changed since they were
+	/// compiled.  Must be called with mShapesLock held.
+	void checkGeneration() const;
+
+	/// Protects the compiled shapes
+	mutable QMutex mShapesLock;
+	/// Compiled shapes, keyed by layer and level of detail
+	mutable QHash<int, Shapes> mShapes;
+	mutable QRect mCachedBBox;
+	/// Value of sGeneration when the shapes were compiled
+	mutable int mShapesGen;
+	/// Incremented whenever any footprint geometry changes
+	static QAtomicInt sGeneration;
 };
 
 /// A pin is an instance of a padstack associated with a footprint.
@@ -261,6 +328,8 @@ public:
 	void toXML(QXmlStreamWriter &writer) const;
 
 	Pad getPadOnLayer(const Layer& layer) const;
+	/// Returns the pin's padstack shape on a layer, in footprint coordinates.
+	QPainterPath path(const Layer& layer, bool simple = false) const;
 
 	virtual QTransform transform() const { return mFpTransform; }
 
@@ -309,24 +378,149 @@ class FPDBFolder;
 
 /// The FPDatabase class is a singleton that is responsible for maintaining a database of available footprints.
 /// It searches the configured footprint directories for footprint files and adds them to a tree structure.
-class FPDatabase
+///
+/// Only the header fields (name, author, etc.) of each footprint are read
+/// while scanning.  They are kept in an on-disk index together with the
+/// modification time and size of each file, so that only files that have
+/// changed since the last run need to be read again.
+///
+/// The library is scanned in the background: the files are read on the
+/// global thread pool, and the folder tree is filled in on the GUI thread
+/// as the results come in.  Lookups of a footprint that hasn't been found
+/// yet wait for the scan to finish.  Once the scan is done, the library
+/// folders are watched and changed folders are rescanned.
+///
+/// The database and its folders must only be used from the GUI thread.
+class FPDatabase : public QObject
 {
+	Q_OBJECT
+
 public:
 	static FPDatabase& instance();
 
 	QList<QSharedPointer<FPDBFolder> > rootFolders() const { return mRootFolders; }
-	QSharedPointer<const FPDBFile> getByUuid(QUuid uuid) const { return mUuidHash.value(uuid); }
-	QSharedPointer<const FPDBFile> getByName(QString name) const { return mNameHash.value(name); }
+	QSharedPointer<const FPDBFile> getByUuid(QUuid uuid);
+	QSharedPointer<const FPDBFile> getByName(QString name);
+
+	/// Returns true while the library is being scanned.
+	bool isScanning() const { return mScanning; }
+	/// Blocks until the library scan has finished.
+	void waitForScan();
+
+	/// Returns the footprints matching a search query.  See FPSearchIndex
+	/// for the query syntax.
+	QSet<const FPDBFile*> search(const QString &query) const;
+
+signals:
+	/// Emitted when a folder is added to the tree.  New folders are empty.
+	void folderAdded(QSharedPointer<FPDBFolder> folder);
+	/// Emitted when a folder and everything in it is removed from the tree.
+	void folderRemoved(QSharedPointer<FPDBFolder> folder);
+	/// Emitted when footprints are added to the tree.
+	void filesAdded(QList<QSharedPointer<FPDBFile> > files);
+	/// Emitted when a footprint is removed from the tree.
+	void fileRemoved(QSharedPointer<FPDBFile> file);
+	/// Emitted when the initial scan has finished.
+	void scanFinished();
+
+private slots:
+	void onListingFinished();
+	void onResultReady(int index);
+	void onScanFinished();
+	void onDirectoryChanged(const QString &path);
+	void flushAdded();
+	void saveIndex();
 
 private:
+	/// Header fields of a footprint file, as stored in the index
+	struct IndexEntry
+	{
+		IndexEntry() : size(-1), pinCount(0), padTypes(0) {}
+		QDateTime mtime;
+		qint64 size;
+		QString name;
+		QString author;
+		QString source;
+		QString desc;
+		/// Null if the file is not a valid footprint
+		QUuid uuid;
+		int pinCount;
+		/// Combination of FPSearchIndex::PadType flags
+		int padTypes;
+	};
+	/// Result of scanning a single file
+	struct ScanResult
+	{
+		ScanResult() : changed(false) {}
+		QString path;
+		IndexEntry entry;
+		/// True if the file had to be read
+		bool changed;
+	};
+	/// Scans a file, reusing the index entry if the file hasn't changed.
+	/// Used on the thread pool.
+	struct ScanFile
+	{
+		typedef ScanResult result_type;
+		ScanFile(const QHash<QString, IndexEntry> &index) : mIndex(index) {}
+		ScanResult operator()(const QString &path) const;
+		QHash<QString, IndexEntry> mIndex;
+	};
+
 	FPDatabase();
 	static FPDatabase* mInst;
 	QList<QSharedPointer<FPDBFolder> > mRootFolders;
 	QHash<QUuid, QSharedPointer<FPDBFile> > mUuidHash;
 	QHash<QString, QSharedPointer<FPDBFile> > mNameHash;
-
-	QSharedPointer<FPDBFolder> createFolder(QString path, bool fullName = false);
-	QSharedPointer<FPDBFile> createFile(QString path);
+	/// Folders and files, by absolute path
+	QHash<QString, QSharedPointer<FPDBFolder> > mFolders;
+	QHash<QString, QSharedPointer<FPDBFile> > mFiles;
+
+	/// Index loaded from disk, and index of the files found so far
+	QHash<QString, IndexEntry> mOldIndex;
+	QHash<QString, IndexEntry> mIndex;
+	bool mIndexChanged;
+
+	/// Background scan state
+	bool mScanning;
+	bool mScanStarted;
+	QFutureWatcher<QStringList> mListing;
+	QFutureWatcher<ScanResult> mScan;
+	/// Number of scan results that have been added to the tree
+	int mNumPublished;
+	/// Search index, and the files of the search index ids
+	FPSearchIndex mSearch;
+	QHash<int, FPDBFile*> mSearchFiles;
+	QHash<const FPDBFile*, int> mSearchIds;
+
+	/// Files added since the last filesAdded() signal
+	QList<QSharedPointer<FPDBFile> > mAdded;
+	QTimer mFlushTimer;
+	QTimer mSaveTimer;
+	QFileSystemWatcher mWatcher;
+
+	/// Lists the footprint files under a directory.  Used on the thread pool.
+	static QStringList listFiles(QString path);
+	static void listDir(const QDir &dir, QStringList &files);
+	/// Adds the scan results up to the given index to the tree.
+	void publishResults(int last);
+	/// Records a scanned file in the index and adds it to the tree.
+	void publish(const ScanResult &result);
+	void addFile(const QString &path, const IndexEntry &entry);
+	void removeFile(const QString &path);
+	void removeFolder(const QString &path);
+	/// Removes a file from the lookup tables, without notifying anyone.
+	QSharedPointer<FPDBFile> forgetFile(const QString &path);
+	/// Returns the folder for a directory, creating it and its parents
+	/// as needed.
+	QSharedPointer<FPDBFolder> folder(const QString &path);
+
+	static QString indexPath();
+	void loadIndex();
+	/// Reads the header fields and search facets of a footprint file,
+	/// without building the footprint.  Returns false if the file could
+	/// not be read.
+	static bool scanHeader(const QString &path, IndexEntry &entry);
 };
 
 class FPDBFile
@@ -342,6 +536,8 @@ public:
 	QString desc() const { return mDesc; }
 	QUuid uuid() const { return mUuid; }
 
+	/// Loads the footprint.  The footprint is shared through FootprintCache
+	/// and must not be modified.
 	QSharedPointer<Footprint> loadFootprint() const;
 
 	void setParent(FPDBFolder* parent) { mParent = parent; }
@@ -363,17 +559,25 @@ private:
 class FPDBFolder
 {
 public:
-	FPDBFolder(QString name, QList<QSharedPointer<FPDBFolder> > folders,
-			   QList<QSharedPointer<FPDBFile> > files);
+	FPDBFolder(QString name, QString path);
 
 	void setParent(FPDBFolder* parent) { mParent = parent; }
 	FPDBFolder* parent() const { return mParent; }
 
 	QString name() const { return mName; }
+	/// Absolute path to the folder
+	QString path() const { return mPath; }
 	QList<QSharedPointer<FPDBFolder> > folders() const { return mFolders; }
 	QList<QSharedPointer<FPDBFile> > items() const { return mFiles; }
+
+	void addFolder(QSharedPointer<FPDBFolder> folder);
+	void removeFolder(QSharedPointer<FPDBFolder> folder);
+	void addFile(QSharedPointer<FPDBFile> file);
+	void removeFile(QSharedPointer<FPDBFile> file);
+
 private:
 	QString mName;
+	QString mPath;
 	QList<QSharedPointer<FPDBFolder> > mFolders;
 	QList<QSharedPointer<FPDBFile> > mFiles;
 	FPDBFolder* mParent;
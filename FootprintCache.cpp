@@ -0,0 +1,140 @@
+/*
+	Copyright (C) 2010-2011 Igor Izyumin
+
+	This file is part of xpcb.
+
+	xpcb is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	xpcb is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with xpcb.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QFileInfo>
+#include <QCryptographicHash>
+#include <QXmlStreamWriter>
+#include "FootprintCache.h"
+#include "Document.h"
+#include "Log.h"
+
+FootprintCache* FootprintCache::mInstance = NULL;
+
+FootprintCache& FootprintCache::instance()
+{
+	// FPPreviewCache creates the cache from the GUI thread, before any
+	// footprints are loaded in the background
+	if (!mInstance)
+		mInstance = new FootprintCache();
+	return *mInstance;
+}
+
+FootprintCache::FootprintCache()
+	: mRecent(MaxRecent)
+{
+}
+
+QByteArray FootprintCache::contentHash(const Footprint &fp)
+{
+	QByteArray xml;
+	{
+		QXmlStreamWriter writer(&xml);
+		fp.toXML(writer);
+	}
+	return QCryptographicHash::hash(xml, QCryptographicHash::Sha1);
+}
+
+FootprintCache::Key FootprintCache::key(const Footprint &fp)
+{
+	Key k;
+	k.uuid = fp.uuid();
+	k.hash = contentHash(fp);
+	return k;
+}
+
+QSharedPointer<Footprint> FootprintCache::find(const Key &key)
+{
+	QSharedPointer<Footprint> fp = mFootprints.value(key).toStrongRef();
+	if (!fp)
+	{
+		mFootprints.remove(key);
+		return fp;
+	}
+	// touch the footprint, or bring it back into the recently used list
+	if (!mRecent.object(key))
+		mRecent.insert(key, new QSharedPointer<Footprint>(fp));
+	return fp;
+}
+
+QSharedPointer<Footprint> FootprintCache::intern(QSharedPointer<Footprint> fp)
+{
+	if (!fp)
+		return fp;
+	return insert(key(*fp), fp);
+}
+
+QSharedPointer<Footprint> FootprintCache::insert(const Key &key,
+												 QSharedPointer<Footprint> fp)
+{
+	QMutexLocker lock(&mLock);
+	QSharedPointer<Footprint> shared = find(key);
+	if (shared)
+		return shared;
+	// texts compute their outlines lazily, which isn't safe once the
+	// footprint is shared between threads; do it before anyone sees it
+	fp->bbox();
+	fp->refText()->bbox();
+	fp->valueText()->bbox();
+	mFootprints.insert(key, fp.toWeakRef());
+	mRecent.insert(key, new QSharedPointer<Footprint>(fp));
+	return fp;
+}
+
+QSharedPointer<Footprint> FootprintCache::load(const QString &path)
+{
+	QFile file(path);
+	if (!file.open(QIODevice::ReadOnly))
+	{
+		Log::instance().error(QString("Unable to open file %1 for reading").arg(path));
+		return QSharedPointer<Footprint>();
+	}
+	return load(file);
+}
+
+QSharedPointer<Footprint> FootprintCache::load(QFile &file)
+{
+	QFileInfo info(file);
+	QString path = info.absoluteFilePath();
+	{
+		QMutexLocker lock(&mLock);
+		QHash<QString, FileEntry>::const_iterator i = mFiles.constFind(path);
+		if (i != mFiles.constEnd() && i->mtime == info.lastModified()
+				&& i->size == info.size())
+		{
+			QSharedPointer<Footprint> fp = find(i->key);
+			if (fp)
+				return fp;
+		}
+	}
+
+	// not cached; two threads may end up reading the same file, in which
+	// case intern() makes sure that they both get the same footprint
+	QSharedPointer<Footprint> fp = FPDoc::readFile(file);
+	if (!fp)
+		return fp;
+	FileEntry e;
+	e.mtime = info.lastModified();
+	e.size = info.size();
+	e.key = key(*fp);
+	fp = insert(e.key, fp);
+
+	QMutexLocker lock(&mLock);
+	mFiles.insert(path, e);
+	return fp;
+}
@@ -0,0 +1,106 @@
+/*
+	Copyright (C) 2010-2011 Igor Izyumin
+
+	This file is part of xpcb.
+
+	xpcb is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	xpcb is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with xpcb.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef FOOTPRINTCACHE_H
+#define FOOTPRINTCACHE_H
+
+#include <QHash>
+#include <QCache>
+#include <QMutex>
+#include <QUuid>
+#include <QDateTime>
+#include <QFile>
+#include <QSharedPointer>
+#include <QWeakPointer>
+#include "Footprint.h"
+
+/// A process-wide cache of shared footprints.
+
+/// Footprints are identified by their uuid and a hash of their contents, so
+/// that a footprint used by several boards, or shown in the footprint
+/// browser while a board uses it, is loaded and stored only once.  The
+/// cached footprints are shared by every document that uses them and must
+/// not be modified; a document that needs to edit a footprint makes its own
+/// copy with Footprint::clone().
+///
+/// Footprints stay in the cache while a document is using them, and a
+/// number of recently used ones are kept around after that, so that
+/// reopening a board doesn't load them again.  The cache may be used from
+/// any thread.
+class FootprintCache
+{
+public:
+	static FootprintCache& instance();
+
+	/// Returns the shared footprint with the same uuid and contents as fp.
+	/// If there is none, fp is added to the cache and returned.
+	QSharedPointer<Footprint> intern(QSharedPointer<Footprint> fp);
+	/// Returns the footprint in a file.  The file is only read if it has
+	/// not been loaded before or has changed since.  Returns a null pointer
+	/// if the file could not be loaded.
+	QSharedPointer<Footprint> load(const QString &path);
+	QSharedPointer<Footprint> load(QFile &file);
+
+	/// Returns the hash of a footprint's contents.
+	static QByteArray contentHash(const Footprint &fp);
+
+private:
+	struct Key
+	{
+		QUuid uuid;
+		QByteArray hash;
+		bool operator==(const Key &other) const
+		{ return uuid == other.uuid && hash == other.hash; }
+	};
+	friend uint qHash(const Key &k)
+	{ return qHash(k.uuid) ^ qHash(k.hash); }
+
+	/// A footprint file that has been loaded
+	struct FileEntry
+	{
+		QDateTime mtime;
+		qint64 size;
+		Key key;
+	};
+
+	/// Number of unused footprints kept in the cache
+	static const int MaxRecent = 256;
+
+	FootprintCache();
+	FootprintCache(const FootprintCache&);
+
+	static Key key(const Footprint &fp);
+	/// Looks up a footprint; the lock must be held.
+	QSharedPointer<Footprint> find(const Key &key);
+	/// Returns the cached footprint with the given key, or adds fp.
+	QSharedPointer<Footprint> insert(const Key &key,
+									 QSharedPointer<Footprint> fp);
+
+	QMutex mLock;
+	/// All footprints that are still in use
+	QHash<Key, QWeakPointer<Footprint> > mFootprints;
+	/// Keeps the recently used footprints alive
+	QCache<Key, QSharedPointer<Footprint> > mRecent;
+	/// Loaded files, by absolute path
+	QHash<QString, FileEntry> mFiles;
+
+	static FootprintCache* mInstance;
+};
+
+#endif // FOOTPRINTCACHE_H
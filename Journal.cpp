@@ -0,0 +1,725 @@
+/*
+	Copyright (C) 2010-2011 Igor Izyumin
+
+	This file is part of xpcb.
+
+	xpcb is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	xpcb is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with xpcb.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "Journal.h"
+#include "AtomicFile.h"
+#include "BoardFile.h"
+#include "Document.h"
+#include "Log.h"
+#include <QBuffer>
+#include <QDataStream>
+#include <QFileInfo>
+#include <QMap>
+#include <QPair>
+#include <QXmlStreamWriter>
+#include <QtConcurrentRun>
+#include <QtEndian>
+
+// A journal file is a header followed by records.  A record is a type, an
+// object id, the size of the payload, the payload and a checksum of all of
+// the above.  Records are in groups that end with REC_COMMIT; the first
+// group is the snapshot.
+
+static const quint32 MAGIC = 0x4A435058;	// "XPCJ"
+static const quint16 VERSION = 2;
+
+enum RecordType
+{
+	REC_IMAGE = 1,		///< The board, as written by BoardFile::save().
+	REC_IDS,			///< Ids of the objects in the image, in record order.
+	REC_PART,			///< A part, as XML.
+	REC_TEXT,			///< A text, as XML.
+	REC_AREA,			///< A copper area, as XML.
+	REC_VERTEX,			///< A trace vertex: x, y.
+	REC_SEGMENT,		///< A trace segment: vertex ids, layer, width.
+	REC_VIA,			///< A via: x, y, padstack UUID.
+	REC_PADSTACK,		///< A padstack: UUID, then XML, or none if removed.
+	REC_FOOTPRINT,		///< A footprint: UUID, then XML.
+	REC_NETLIST,		///< The netlist, as XML.
+	REC_REMOVE,			///< Removal of the object with the record's id.
+	REC_COMMIT,			///< End of a group.
+	REC_SAVED			///< The board was saved in its current state.
+};
+
+/// Journals are compacted once they are larger than this and twice their
+/// snapshot.
+static const qint64 MIN_COMPACT_SIZE = 1 << 20;
+
+static void writeRecord(QByteArray &out, quint8 type, quint32 id,
+						const QByteArray &payload = QByteArray())
+{
+	QByteArray rec;
+	QDataStream s(&rec, QIODevice::WriteOnly);
+	s << type << id << quint32(payload.size());
+	s.writeRawData(payload.constData(), payload.size());
+	s << qChecksum(rec.constData(), rec.size());
+	out += rec;
+}
+
+/// A record read from a journal
+struct JournalRecord
+{
+	quint8 type;
+	quint32 id;
+	QByteArray payload;
+};
+
+/// Size of the type, id and payload size that start a record
+static const int RECORD_HEADER_SIZE = 9;
+/// Size of the checksum that ends a record
+static const int RECORD_SUM_SIZE = 2;
+
+/// Checks the file header of a journal and returns the position of its first
+/// record, or -1 if the data is not a journal.
+static qint64 firstRecord(const uchar* data, qint64 size)
+{
+	if (size < 6 || qFromBigEndian<quint32>(data) != MAGIC
+			|| qFromBigEndian<quint16>(data + 4) != VERSION)
+		return -1;
+	return 6;
+}
+
+/// Reads the record at pos and moves pos past it.  Returns false at the end
+/// of the data and at a damaged or incomplete record.  The payload is only
+/// copied if payload is true.
+static bool readRecord(const uchar* data, qint64 size, qint64 &pos,
+					   JournalRecord &rec, bool payload = true)
+{
+	if (size - pos < RECORD_HEADER_SIZE + RECORD_SUM_SIZE)
+		return false;
+	const uchar* p = data + pos;
+	quint32 len = qFromBigEndian<quint32>(p + 5);
+	if (len > quint64(size - pos - RECORD_HEADER_SIZE - RECORD_SUM_SIZE))
+		return false;
+	uint end = RECORD_HEADER_SIZE + len;
+	if (qFromBigEndian<quint16>(p + end)
+			!= qChecksum(reinterpret_cast<const char*>(p), end))
+		return false;
+	rec.type = p[0];
+	rec.id = qFromBigEndian<quint32>(p + 1);
+	if (payload)
+		rec.payload = QByteArray(reinterpret_cast<const char*>(p)
+								 + RECORD_HEADER_SIZE, int(len));
+	pos += end + RECORD_SUM_SIZE;
+	return true;
+}
+
+/// Returns the XML of an object.
+template <class T>
+static QByteArray toXml(T* obj)
+{
+	QByteArray xml;
+	QBuffer buf(&xml);
+	buf.open(QIODevice::WriteOnly);
+	QXmlStreamWriter writer(&buf);
+	obj->toXML(writer);
+	return xml;
+}
+
+/// Returns the payload of a padstack or footprint record.
+static QByteArray uuidRecord(const QUuid &uuid, const QByteArray &xml)
+{
+	QByteArray payload;
+	QDataStream s(&payload, QIODevice::WriteOnly);
+	s << uuid;
+	s.writeRawData(xml.constData(), xml.size());
+	return payload;
+}
+
+/// Splits the payload of a padstack or footprint record.
+static QUuid readUuidRecord(const QByteArray &payload, QByteArray &xml)
+{
+	QDataStream s(payload);
+	QUuid uuid;
+	s >> uuid;
+	xml = payload.mid(int(s.device()->pos()));
+	return uuid;
+}
+
+/// Writes a snapshot to a file and flushes it to disk.  Runs on a worker
+/// thread.
+static bool writeSnapshot(const QByteArray &data, const QString &path)
+{
+	QFile file(path);
+	return file.open(QIODevice::WriteOnly | QIODevice::Truncate)
+			&& file.write(data) == data.size() && AtomicFile::sync(file);
+}
+
+Journal::Journal(PCBDoc &doc)
+	: mDoc(doc), mActive(false), mNextId(1), mPadstacksDirty(false),
+	  mNetlistRev(0), mSnapshotSize(0), mSnapshotPending(false)
+{
+	connect(&mSnapshot, SIGNAL(finished()), this, SLOT(finishSnapshot()));
+}
+
+Journal::~Journal()
+{
+	waitForSnapshot();
+}
+
+QString Journal::fileFor(const QString &boardFile)
+{
+	return boardFile + ".journal";
+}
+
+bool Journal::open(const QString &boardFile)
+{
+	waitForSnapshot();
+	mFile.close();
+	mBoardFile = boardFile;
+	mFile.setFileName(fileFor(boardFile));
+	mIds.clear();
+	mNextId = 1;
+	mTouched.clear();
+	mRemoved.clear();
+	// a journal left by an earlier session has nothing that isn't in the
+	// board file, unless the board was recovered from it; then it is kept
+	// until the snapshot replaces it
+	if (!mDoc.isModified())
+		QFile::remove(mFile.fileName());
+	mActive = true;
+	return startSnapshot();
+}
+
+void Journal::remove()
+{
+	mSnapshot.waitForFinished();
+	mSnapshotPending = false;
+	mQueued.clear();
+	mActive = false;
+	mFile.close();
+	if (!mBoardFile.isEmpty())
+	{
+		QFile::remove(snapshotFile());
+		QFile::remove(mFile.fileName());
+	}
+	mBoardFile.clear();
+}
+
+void Journal::waitForSnapshot()
+{
+	mSnapshot.waitForFinished();
+	finishSnapshot();
+}
+
+void Journal::objectTouched(PCBObject* obj)
+{
+	// part texts are saved with their part
+	Part* owner = qobject_cast<Part*>(obj->parent());
+	if (owner)
+		obj = owner;
+	mRemoved.remove(obj);
+	mTouched.insert(obj);
+}
+
+void Journal::objectRemoved(const PCBObject* obj)
+{
+	if (qobject_cast<const Part*>(obj->parent()))
+		return;
+	mTouched.remove(const_cast<PCBObject*>(obj));
+	// objects added and removed by the same command were never written
+	if (mIds.contains(obj))
+		mRemoved.insert(obj);
+}
+
+void Journal::commit()
+{
+	if (!mActive)
+		return;
+
+	QByteArray records;
+	writeBoardData(records);
+	foreach(PCBObject* obj, mTouched)
+		writeObject(records, obj);
+	foreach(const PCBObject* obj, mRemoved)
+		writeRecord(records, REC_REMOVE, mIds.take(obj));
+	writeRecord(records, REC_COMMIT, 0);
+	mTouched.clear();
+	mRemoved.clear();
+
+	if (append(records) && !mSnapshotPending
+			&& mFile.size() > qMax(2 * mSnapshotSize, MIN_COMPACT_SIZE))
+		startSnapshot();
+}
+
+void Journal::saved()
+{
+	if (!mActive)
+		return;
+	QByteArray records;
+	writeRecord(records, REC_SAVED, 0);
+	append(records);
+}
+
+bool Journal::startSnapshot()
+{
+	// the binary image is quick to make; writing it out is left to a worker
+	QBuffer image;
+	image.open(QIODevice::WriteOnly);
+	QList<const PCBObject*> objects;
+	if (!BoardFile::save(mDoc, image, &objects))
+	{
+		fail();
+		return false;
+	}
+	QByteArray ids;
+	{
+		QDataStream s(&ids, QIODevice::WriteOnly);
+		foreach(const PCBObject* obj, objects)
+			s << id(obj);
+	}
+
+	QByteArray data;
+	{
+		QDataStream s(&data, QIODevice::WriteOnly);
+		s << MAGIC << VERSION;
+	}
+	writeRecord(data, REC_IMAGE, 0, image.data());
+	writeRecord(data, REC_IDS, 0, ids);
+	writeRecord(data, REC_COMMIT, 0);
+	if (!mDoc.isModified())
+		writeRecord(data, REC_SAVED, 0);
+
+	// the image holds the current padstacks, footprints and netlist
+	mPadstacks.clear();
+	foreach(QSharedPointer<Padstack> ps, mDoc.mPadstacks)
+		mPadstacks.insert(ps->uuid(), toXml(ps.data()));
+	mPadstacksDirty = false;
+	mNewFootprints.clear();
+	mNetlistRev = mDoc.mNetlist->revision();
+
+	mSnapshotSize = data.size();
+	mSnapshotPending = true;
+	mQueued.clear();
+	mSnapshot.setFuture(QtConcurrent::run(writeSnapshot, data, snapshotFile()));
+	return true;
+}
+
+void Journal::finishSnapshot()
+{
+	if (!mSnapshotPending || !mSnapshot.isFinished())
+		return;
+	mSnapshotPending = false;
+	QByteArray queued = mQueued;
+	mQueued.clear();
+
+	// edits made while the snapshot was written go after it
+	QFile snapshot(snapshotFile());
+	if (!mSnapshot.result()
+			|| !snapshot.open(QIODevice::WriteOnly | QIODevice::Append)
+			|| snapshot.write(queued) != queued.size()
+			|| !AtomicFile::sync(snapshot))
+	{
+		snapshot.close();
+		QFile::remove(snapshot.fileName());
+		// the old journal file still has every edit; try again once it
+		// has doubled
+		if (!mFile.isOpen())
+			fail();
+		else
+			mSnapshotSize = mFile.size();
+		return;
+	}
+	snapshot.close();
+
+	mFile.close();
+	if (!AtomicFile::replace(snapshot.fileName(), mFile.fileName())
+			|| !mFile.open(QIODevice::WriteOnly | QIODevice::Append))
+	{
+		fail();
+		return;
+	}
+	AtomicFile::syncDir(QFileInfo(mFile.fileName()).absolutePath());
+}
+
+quint32 Journal::id(const PCBObject* obj)
+{
+	QHash<const PCBObject*, quint32>::const_iterator i = mIds.constFind(obj);
+	if (i != mIds.constEnd())
+		return i.value();
+	mIds.insert(obj, mNextId);
+	return mNextId++;
+}
+
+quint8 Journal::objectRecord(PCBObject* obj, QByteArray &payload)
+{
+	if (Part* p = qobject_cast<Part*>(obj))
+	{
+		payload = toXml(p);
+		return REC_PART;
+	}
+	if (Text* t = qobject_cast<Text*>(obj))
+	{
+		payload = toXml(t);
+		return REC_TEXT;
+	}
+	if (Area* a = qobject_cast<Area*>(obj))
+	{
+		payload = toXml(a);
+		return REC_AREA;
+	}
+	QDataStream s(&payload, QIODevice::WriteOnly);
+	if (Vertex* v = qobject_cast<Vertex*>(obj))
+	{
+		s << qint32(v->pos().x()) << qint32(v->pos().y());
+		return REC_VERTEX;
+	}
+	if (Segment* seg = qobject_cast<Segment*>(obj))
+	{
+		s << id(seg->v1().data()) << id(seg->v2().data())
+		  << qint32(seg->layer().toInt()) << qint32(seg->width());
+		return REC_SEGMENT;
+	}
+	if (Via* via = qobject_cast<Via*>(obj))
+	{
+		s << qint32(via->pos().x()) << qint32(via->pos().y())
+		  << (via->padstack() ? via->padstack()->uuid() : QUuid());
+		return REC_VIA;
+	}
+	return 0;
+}
+
+void Journal::writeObject(QByteArray &out, PCBObject* obj)
+{
+	QByteArray payload;
+	quint8 type = objectRecord(obj, payload);
+	if (type)
+		writeRecord(out, type, id(obj), payload);
+}
+
+void Journal::writeBoardData(QByteArray &out)
+{
+	if (mPadstacksDirty)
+	{
+		// padstacks are few and small; comparing their XML finds the ones
+		// edited in place
+		QSet<QUuid> removed = QSet<QUuid>::fromList(mPadstacks.keys());
+		foreach(QSharedPointer<Padstack> ps, mDoc.mPadstacks)
+		{
+			removed.remove(ps->uuid());
+			QByteArray xml = toXml(ps.data());
+			QHash<QUuid, QByteArray>::iterator i = mPadstacks.find(ps->uuid());
+			if (i != mPadstacks.end() && i.value() == xml)
+				continue;
+			mPadstacks.insert(ps->uuid(), xml);
+			writeRecord(out, REC_PADSTACK, 0, uuidRecord(ps->uuid(), xml));
+		}
+		foreach(const QUuid &uuid, removed)
+		{
+			mPadstacks.remove(uuid);
+			writeRecord(out, REC_PADSTACK, 0, uuidRecord(uuid, QByteArray()));
+		}
+		mPadstacksDirty = false;
+	}
+
+	foreach(QSharedPointer<Footprint> fp, mNewFootprints)
+		writeRecord(out, REC_FOOTPRINT, 0, uuidRecord(fp->uuid(), toXml(fp.data())));
+	mNewFootprints.clear();
+
+	if (mDoc.mNetlist->revision() != mNetlistRev)
+	{
+		mNetlistRev = mDoc.mNetlist->revision();
+		writeRecord(out, REC_NETLIST, 0, toXml(mDoc.mNetlist.data()));
+	}
+}
+
+bool Journal::append(const QByteArray &records)
+{
+	if (mSnapshotPending)
+		mQueued += records;
+	// the first snapshot of a journal has no file to fall back on
+	if (!mFile.isOpen())
+		return true;
+	if (mFile.write(records) != records.size() || !AtomicFile::sync(mFile))
+	{
+		fail();
+		return false;
+	}
+	return true;
+}
+
+void Journal::fail()
+{
+	Log::instance().error(QString("Unable to write journal %1; unsaved changes "
+								  "will not be recoverable after a crash")
+						  .arg(mFile.fileName()));
+	mActive = false;
+	mFile.close();
+	mSnapshot.waitForFinished();
+	if (mSnapshotPending)
+		QFile::remove(snapshotFile());
+	mSnapshotPending = false;
+	mQueued.clear();
+}
+
+/// The state of a board recorded in a journal
+struct Journal::Board
+{
+	/// XML of the board properties and outline
+	QByteArray props;
+	QByteArray outline;
+	QHash<QUuid, QByteArray> padstacks;
+	QHash<QUuid, QByteArray> footprints;
+	QByteArray netlist;
+	/// Record type and payload of each object, by id
+	QMap<quint32, QPair<quint8, QByteArray> > objs;
+};
+
+bool Journal::readImage(const QByteArray &image, const QByteArray &ids,
+						Board &board)
+{
+	PCBDoc doc;
+	QList<PCBObject*> objects;
+	if (!BoardFile::load(doc, reinterpret_cast<const uchar*>(image.constData()),
+						 image.size(), &objects)
+			|| ids.size() != objects.size() * int(sizeof(quint32)))
+		return false;
+
+	// the objects get the ids they had when the snapshot was taken, which
+	// the records after it refer to
+	Journal journal(doc);
+	QDataStream s(ids);
+	foreach(PCBObject* obj, objects)
+	{
+		quint32 id;
+		s >> id;
+		if (obj)
+			journal.mIds.insert(obj, id);
+	}
+
+	board = Board();
+	foreach(PCBObject* obj, objects)
+	{
+		QByteArray payload;
+		quint8 type = obj ? journal.objectRecord(obj, payload) : 0;
+		if (type)
+			board.objs.insert(journal.mIds.value(obj), qMakePair(type, payload));
+	}
+	foreach(QSharedPointer<Padstack> ps, doc.mPadstacks)
+		board.padstacks.insert(ps->uuid(), toXml(ps.data()));
+	foreach(QSharedPointer<Footprint> fp, doc.mFootprints)
+		board.footprints.insert(fp->uuid(), toXml(fp.data()));
+	board.netlist = toXml(doc.mNetlist.data());
+
+	QBuffer buf(&board.props);
+	buf.open(QIODevice::WriteOnly);
+	QXmlStreamWriter props(&buf);
+	doc.writePropsXml(props);
+	QBuffer outlineBuf(&board.outline);
+	outlineBuf.open(QIODevice::WriteOnly);
+	QXmlStreamWriter outline(&outlineBuf);
+	outline.writeStartElement("outline");
+	doc.mBoardOutline.toXML(outline);
+	outline.writeEndElement();
+	return true;
+}
+
+bool Journal::hasUnsaved(const QString &path)
+{
+	QFile file(path);
+	if (!file.open(QIODevice::ReadOnly))
+		return false;
+	qint64 size = file.size();
+	QByteArray buf;
+	uchar* map = file.map(0, size);
+	const uchar* data = map;
+	if (!map)
+	{
+		buf = file.readAll();
+		data = reinterpret_cast<const uchar*>(buf.constData());
+		size = buf.size();
+	}
+
+	// only the order of the commit and saved records matters, so the
+	// payloads are checked but not copied
+	bool snapshot = false, saved = false, inGroup = false;
+	qint64 pos = firstRecord(data, size);
+	JournalRecord rec;
+	while(pos >= 0 && readRecord(data, size, pos, rec, false)
+		  && rec.type >= REC_IMAGE && rec.type <= REC_SAVED)
+	{
+		if (rec.type == REC_COMMIT)
+		{
+			snapshot = true;
+			saved = inGroup = false;
+		}
+		else if (rec.type == REC_SAVED)
+			saved = !inGroup;
+		else
+			inGroup = true;
+	}
+	if (map)
+		file.unmap(map);
+	return snapshot && !saved;
+}
+
+QByteArray Journal::replay(const QString &path)
+{
+	typedef QPair<quint8, QByteArray> Record;
+
+	QFile file(path);
+	if (!file.open(QIODevice::ReadOnly))
+		return QByteArray();
+	QByteArray data = file.readAll();
+	const uchar* d = reinterpret_cast<const uchar*>(data.constData());
+	qint64 pos = firstRecord(d, data.size());
+	if (pos < 0)
+		return QByteArray();
+
+	// the state of the board after the last complete group
+	Board board;
+	bool haveImage = false;
+	// the group being read
+	QByteArray groupImage, groupIds, groupNetlist;
+	QMap<quint32, Record> groupObjs;
+	QList<quint32> groupRemoved;
+	QList<QPair<QUuid, QByteArray> > groupPadstacks, groupFootprints;
+
+	// stop at the first damaged or incomplete record
+	JournalRecord rec;
+	while(readRecord(d, data.size(), pos, rec))
+	{
+		quint8 type = rec.type;
+		if (type == REC_COMMIT)
+		{
+			// only the first group has an image
+			if (!groupImage.isEmpty())
+			{
+				if (haveImage || !readImage(groupImage, groupIds, board))
+					break;
+				haveImage = true;
+			}
+			if (!haveImage)
+				break;
+			for(int i = 0; i < groupPadstacks.size(); i++)
+			{
+				if (groupPadstacks[i].second.isEmpty())
+					board.padstacks.remove(groupPadstacks[i].first);
+				else
+					board.padstacks.insert(groupPadstacks[i].first,
+										   groupPadstacks[i].second);
+			}
+			for(int i = 0; i < groupFootprints.size(); i++)
+				board.footprints.insert(groupFootprints[i].first,
+										groupFootprints[i].second);
+			if (!groupNetlist.isEmpty())
+				board.netlist = groupNetlist;
+			for(QMap<quint32, Record>::const_iterator i = groupObjs.constBegin();
+				i != groupObjs.constEnd(); ++i)
+				board.objs.insert(i.key(), i.value());
+			foreach(quint32 removed, groupRemoved)
+				board.objs.remove(removed);
+			groupImage.clear();
+			groupIds.clear();
+			groupNetlist.clear();
+			groupObjs.clear();
+			groupRemoved.clear();
+			groupPadstacks.clear();
+			groupFootprints.clear();
+		}
+		else if (type == REC_SAVED)
+			continue;
+		else if (type == REC_IMAGE)
+			groupImage = rec.payload;
+		else if (type == REC_IDS)
+			groupIds = rec.payload;
+		else if (type == REC_PADSTACK || type == REC_FOOTPRINT)
+		{
+			QByteArray xml;
+			QUuid uuid = readUuidRecord(rec.payload, xml);
+			if (type == REC_PADSTACK)
+				groupPadstacks.append(qMakePair(uuid, xml));
+			else
+				groupFootprints.append(qMakePair(uuid, xml));
+		}
+		else if (type == REC_NETLIST)
+			groupNetlist = rec.payload;
+		else if (type == REC_REMOVE)
+			groupRemoved.append(rec.id);
+		else if (type >= REC_PART && type <= REC_VIA)
+			groupObjs.insert(rec.id, Record(type, rec.payload));
+		else
+			break;
+	}
+	if (!haveImage)
+		return QByteArray();
+
+	QByteArray padstacks, footprints;
+	foreach(const QByteArray &xml, board.padstacks)
+		padstacks += xml;
+	foreach(const QByteArray &xml, board.footprints)
+		footprints += xml;
+	QByteArray parts, vertices, segments, vias, areas, texts;
+	for(QMap<quint32, Record>::const_iterator i = board.objs.constBegin();
+		i != board.objs.constEnd(); ++i)
+	{
+		const QByteArray &payload = i.value().second;
+		QDataStream p(payload);
+		switch(i.value().first)
+		{
+		case REC_PART:
+			parts += payload;
+			break;
+		case REC_TEXT:
+			texts += payload;
+			break;
+		case REC_AREA:
+			areas += payload;
+			break;
+		case REC_VERTEX:
+		{
+			qint32 x, y;
+			p >> x >> y;
+			vertices += QString("<vertex id='%1' x='%2' y='%3'/>")
+						.arg(i.key()).arg(x).arg(y).toAscii();
+			break;
+		}
+		case REC_SEGMENT:
+		{
+			quint32 v1, v2;
+			qint32 layer, width;
+			p >> v1 >> v2 >> layer >> width;
+			segments += QString("<segment start='%1' end='%2' layer='%3' width='%4'/>")
+						.arg(v1).arg(v2).arg(layer).arg(width).toAscii();
+			break;
+		}
+		case REC_VIA:
+		{
+			qint32 x, y;
+			QUuid ps;
+			p >> x >> y >> ps;
+			vias += QString("<via x='%1' y='%2' padstack='%3'/>")
+					.arg(x).arg(y).arg(ps.toString()).toAscii();
+			break;
+		}
+		}
+	}
+
+	return "<?xml version='1.0' encoding='UTF-8'?><xpcbBoard>" + board.props
+			+ "<padstacks>" + padstacks + "</padstacks>"
+			+ "<footprints>" + footprints + "</footprints>"
+			+ board.outline + board.netlist
+			+ "<parts>" + parts + "</parts>"
+			+ "<traces><vertices>" + vertices + "</vertices>"
+			+ "<segments>" + segments + "</segments>"
+			+ "<vias>" + vias + "</vias></traces>"
+			+ "<areas>" + areas + "</areas>"
+			+ "<texts>" + texts + "</texts></xpcbBoard>";
+}
@@ -0,0 +1,178 @@
+/*
+	Copyright (C) 2010-2011 Igor Izyumin
+
+	This file is part of xpcb.
+
+	xpcb is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	xpcb is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with xpcb.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <QFile>
+#include <QFutureWatcher>
+#include <QHash>
+#include <QList>
+#include <QSet>
+#include <QSharedPointer>
+#include <QUuid>
+
+class PCBDoc;
+class PCBObject;
+class Footprint;
+
+/// An append-only record of the edits made to a board, for crash recovery.
+
+/// The journal is a sidecar file next to the board file.  It starts with a
+/// snapshot of the board, followed by one group of records for each command
+/// run on the board.  A group holds the new state of each object that the
+/// command added or changed and the ids of the objects it removed, so the
+/// amount written is proportional to the edit rather than to the board.
+/// Every group is flushed to disk before the next command runs; a group
+/// torn by a crash is detected by its checksum and ignored.
+///
+/// The snapshot is the board in the binary format (see BoardFile), along
+/// with the ids of its objects.  Only the image is made on the calling
+/// thread; it is written to disk by a worker, while edits are still
+/// recorded in the previous journal file and queued for the new one.
+///
+/// Objects are identified by ids that are assigned when they are first
+/// written, and keep their ids when the journal is compacted.  Trace
+/// objects are stored as fixed binary records; parts, texts and areas as
+/// their XML, which is what they know how to save.  Padstacks and footprints
+/// are stored one per record, keyed by UUID, when they are added, changed
+/// or removed, and the netlist when its revision changes.  The board
+/// properties and outline have no edit commands, so they are only stored
+/// in the snapshot.
+///
+/// When the journal has grown larger than its snapshot, it is compacted:
+/// rewritten as a fresh snapshot.  replay() folds a journal back into a
+/// board document.
+///
+/// Only boards that have a file are journaled; edits to a new board are
+/// recorded once it is first saved.
+class Journal : public QObject
+{
+	Q_OBJECT
+
+public:
+	explicit Journal(PCBDoc &doc);
+	/// Waits for a running snapshot to be written.
+	virtual ~Journal();
+
+	/// Returns the journal file of a board file.
+	static QString fileFor(const QString &boardFile);
+
+	/// Starts a journal for a board file.  The journal file is replaced with
+	/// a snapshot of the board in the background.  Returns false if the
+	/// snapshot could not be taken.
+	bool open(const QString &boardFile);
+	/// Returns the board file that the journal belongs to.
+	QString boardFile() const { return mBoardFile; }
+	/// Closes the journal and deletes its file.
+	void remove();
+	/// Waits for a running snapshot to be written and switches to it.
+	void waitForSnapshot();
+
+	/// Notes that an object was added or changed by the running command.
+	void objectTouched(PCBObject* obj);
+	/// Notes that an object was removed by the running command.
+	void objectRemoved(const PCBObject* obj);
+	/// Notes that padstacks may have been added, changed or removed.  The
+	/// padstacks are compared with their last written state on commit.
+	void padstacksChanged() { mPadstacksDirty = true; }
+	/// Notes that a footprint was added to the board.
+	void footprintAdded(QSharedPointer<Footprint> fp) { mNewFootprints.append(fp); }
+	/// Writes the changes made by a command, compacting the journal if it
+	/// has grown too large.
+	void commit();
+	/// Notes that the board was saved in its current state.
+	void saved();
+
+	/// Returns true if a journal file holds edits made after the board was
+	/// last saved.  Only checks the records, without replaying them.
+	static bool hasUnsaved(const QString &file);
+	/// Reads a journal file and returns the board it records as an XML
+	/// document, or an empty array if the journal is unreadable.
+	static QByteArray replay(const QString &file);
+
+private slots:
+	/// Switches to the snapshot written by the worker, once it is done.
+	/// Does nothing if there is no finished snapshot to handle.
+	void finishSnapshot();
+
+private:
+	friend class JournalTest;
+	struct Board;
+
+	Journal(const Journal&);
+	Journal& operator=(const Journal&);
+
+	/// Takes a snapshot of the board and starts writing it to a new journal
+	/// file.  Returns false if the snapshot could not be taken.
+	bool startSnapshot();
+	/// Returns the file that a snapshot is written to before it replaces
+	/// the journal.
+	QString snapshotFile() const { return mFile.fileName() + ".new"; }
+	/// Returns the id of an object, assigning a new id if needed.
+	quint32 id(const PCBObject* obj);
+	/// Returns the record type of an object and sets its payload, or
+	/// returns 0 if the object isn't journaled.
+	quint8 objectRecord(PCBObject* obj, QByteArray &payload);
+	/// Appends the record of an object to out.
+	void writeObject(QByteArray &out, PCBObject* obj);
+	/// Appends records for the padstacks, footprints and netlist that
+	/// changed since they were last written.
+	void writeBoardData(QByteArray &out);
+	/// Appends records to the journal and flushes them to disk.
+	bool append(const QByteArray &records);
+	/// Stops journaling after an I/O error.  The file is kept.
+	void fail();
+	/// Decodes a snapshot into the state of a board.
+	static bool readImage(const QByteArray &image, const QByteArray &ids,
+						  Board &board);
+
+	PCBDoc &mDoc;
+	QString mBoardFile;
+	/// The journal file, open once it exists
+	QFile mFile;
+	/// True from open() until the journal is removed or an error occurs
+	bool mActive;
+	QHash<const PCBObject*, quint32> mIds;
+	quint32 mNextId;
+	/// Objects added or changed by the running command
+	QSet<PCBObject*> mTouched;
+	/// Objects removed by the running command
+	QSet<const PCBObject*> mRemoved;
+	/// XML of each padstack as last written
+	QHash<QUuid, QByteArray> mPadstacks;
+	bool mPadstacksDirty;
+	/// Footprints added since they were last written
+	QList<QSharedPointer<Footprint> > mNewFootprints;
+	/// Revision of the netlist as last written
+	int mNetlistRev;
+	/// Size of the last snapshot
+	qint64 mSnapshotSize;
+
+	/// Running snapshot write; its result is true on success
+	QFutureWatcher<bool> mSnapshot;
+	/// True from the start of a snapshot until finishSnapshot() handles it
+	bool mSnapshotPending;
+	/// Records written since the running snapshot was taken, which are
+	/// appended to it when it is done
+	QByteArray mQueued;
+};
+
+#endif // JOURNAL_H
@@ -18,9 +18,11 @@
 */
 
 #include "Line.h"
+#include "XmlAttr.h"
 #include <QXmlStreamReader>
 #include <QXmlStreamWriter>
 #include <QDebug>
+#include <QPainterPathStroker>
 
 Line::Line(QObject* parent)
 	: PCBObject(parent), mWidth(0), mType(LINE)
@@ -29,22 +31,22 @@ Line::Line(QObject* parent)
 
 QSharedPointer<Line> Line::newFromXml(QXmlStreamReader &reader)
 {
-	Q_ASSERT(reader.isStartElement() && (reader.name() == "line" || reader.name() == "arc"));
+	Q_ASSERT(reader.isStartElement() && (Xml::is(reader.name(), "line") || Xml::is(reader.name(), "arc")));
 
 	QXmlStreamAttributes attr = reader.attributes();
 
 	QSharedPointer<Line> l(new Line());
-	l->mWidth = attr.value("width").toString().toInt();
-	l->mLayer = Layer(attr.value("layer").toString().toInt());
+	l->mWidth = Xml::intAttr(attr, "width");
+	l->mLayer = Layer(Xml::intAttr(attr, "layer"));
 	l->mStart = QPoint(
-			attr.value("x1").toString().toInt(),
-			attr.value("y1").toString().toInt());
+			Xml::intAttr(attr, "x1"),
+			Xml::intAttr(attr, "y1"));
 	l->mEnd = QPoint(
-			attr.value("x2").toString().toInt(),
-			attr.value("y2").toString().toInt());
-	if (attr.hasAttribute("dir"))
+			Xml::intAttr(attr, "x2"),
+			Xml::intAttr(attr, "y2"));
+	if (Xml::hasAttr(attr, "dir"))
 	{
-		l->mType = (attr.value("dir") == "cw") ? ARC_CW : ARC_CCW;
+		l->mType = Xml::is(Xml::attr(attr, "dir"), "cw") ? ARC_CW : ARC_CCW;
 	}
 	else
 		l->mType = LINE;
@@ -90,6 +92,20 @@ void Line::draw(QPainter *painter, const Layer& layer) const
 		XPcb::drawArc(painter, mStart, mEnd, mType == ARC_CW);
 }
 
+QPainterPath Line::outline() const
+{
+	QPainterPath path(mStart);
+	if (mType == LINE || mStart.x() == mEnd.x() || mStart.y() == mEnd.y())
+		path.lineTo(mEnd);
+	else
+		XPcb::arcTo(path, mStart, mEnd, mType == ARC_CW);
+	QPainterPathStroker stroker;
+	stroker.setWidth(mWidth);
+	stroker.setCapStyle(Qt::RoundCap);
+	stroker.setJoinStyle(Qt::RoundJoin);
+	return stroker.createStroke(path);
+}
+
 QRect Line::bbox() const
 {
 	return QRect(mStart, mEnd).normalized().adjusted(-mWidth/2, -mWidth/2, mWidth/2, mWidth/2);
@@ -41,10 +41,14 @@ public:
 	Line(QObject *parent = NULL);
 
 	virtual void draw(QPainter *painter, const Layer& layer) const;
+	virtual LayerMask layers() const { return LayerMask(mLayer) | Layer::LAY_SELECTION; }
 	virtual QRect bbox() const;
 	virtual PCBObjState getState() const;
 	virtual bool loadState(PCBObjState &state);
 	virtual bool testHit(QPoint p, int dist, const Layer &l) const;
+	/// Returns the area covered by the line (including its width) as a
+	/// fillable path.
+	QPainterPath outline() const;
 
 	QPoint start() const { return mStart; }
 	void setStart(QPoint p) { mStart = p; }
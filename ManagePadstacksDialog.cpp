@@ -49,7 +49,7 @@ void ManagePadstacksDialog::on_editButton_clicked()
 	dialog.init(curr);
 	if (dialog.exec() == QDialog::Rejected)
 		return;
-	EditPadstackCmd *cmd = new EditPadstackCmd(NULL, curr, dialog.toPadstack());
+	EditPadstackCmd *cmd = new EditPadstackCmd(NULL, mDoc, curr, dialog.toPadstack());
 	mDoc->doCommand(cmd);
 	updateItems();
 }
@@ -107,18 +107,20 @@ void NewPadstackCmd::undo()
 	mDoc->removePadstack(mPs);
 }
 
-EditPadstackCmd::EditPadstackCmd(QUndoCommand *parent, QSharedPointer<Padstack> ps,
-								 Padstack newPs)
-	: QUndoCommand(parent), mPrev(*ps), mNew(newPs), mPs(ps)
+EditPadstackCmd::EditPadstackCmd(QUndoCommand *parent, Document *doc,
+								 QSharedPointer<Padstack> ps, Padstack newPs)
+	: QUndoCommand(parent), mPrev(*ps), mNew(newPs), mPs(ps), mDoc(doc)
 {
 }
 
 void EditPadstackCmd::redo()
 {
 	*mPs = mNew;
+	mDoc->padstackChanged(mPs);
 }
 
 void EditPadstackCmd::undo()
 {
 	*mPs = mPrev;
+	mDoc->padstackChanged(mPs);
 }
@@ -61,7 +61,8 @@ private:
 class EditPadstackCmd : public QUndoCommand
 {
 public:
-	EditPadstackCmd(QUndoCommand *parent, QSharedPointer<Padstack> ps, Padstack newPs);
+	EditPadstackCmd(QUndoCommand *parent, Document* doc, QSharedPointer<Padstack> ps,
+					Padstack newPs);
 
 	virtual void undo();
 	virtual void redo();
@@ -69,6 +70,7 @@ private:
 	Padstack mPrev;
 	Padstack mNew;
 	QSharedPointer<Padstack> mPs;
+	Document* mDoc;
 };
 
 #endif // MANAGEPADSTACKSDIALOG_H
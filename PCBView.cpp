@@ -22,14 +22,44 @@
 #include "Document.h"
 #include "Log.h"
 #include "Controller.h"
+#include "Palette.h"
 #include <QSize>
 #include <QPainter>
 #include <QMouseEvent>
 #include <QSettings>
+#include <QThread>
+#include <QtConcurrentMap>
+#include <qmath.h>
+
+/// A tile to be rendered, along with everything needed to render it.  Jobs
+/// are filled in on the GUI thread and may be rendered on any thread.
+struct PCBView::TileJob
+{
+	int x;
+	int y;
+	int size;
+	/// World to tile transform
+	QTransform transform;
+	/// World area covered by the tile
+	QRect area;
+	QList<Layer> layers;
+	/// Objects to draw
+	QList<QSharedPointer<PCBObject> > objs;
+	/// Layers that at least one of the objects draws on
+	LayerMask drawn;
+	/// Private copies of the footprint shapes of the parts in objs
+	Footprint::ShapeSet shapes;
+	/// Rendered images, one for each layer
+	QList<QImage> images;
+};
 
 PCBView::PCBView(QWidget *parent)
 	: QWidget(parent), mCtrl(NULL), mWheelAngle(0)
 {
+	XPcb::loadLodSettings();
+	QSettings s;
+	mThreaded = s.value("view/threadedRendering",
+						QThread::idealThreadCount() > 1).toBool();
 	// initialize transform
 	// 100 pixels = 1 inch
 	mTransform.translate(0, 300);
@@ -54,30 +84,88 @@ void PCBView::setCtrl(Controller *ctrl)
 	mCtrl = ctrl;
 }
 
+void PCBView::invalidate(const QRect &area)
+{
+	mTiles.invalidate(area);
+	updateArea(area);
+}
+
+void PCBView::updateArea(const QRect &area)
+{
+	if (area.isEmpty())
+		return;
+	// pad by a couple of pixels for antialiasing
+	QRect r = mTransform.mapRect(area).adjusted(-2, -2, 2, 2) & rect();
+	if (r.isEmpty())
+		return;
+	mBoardDirty += r;
+	update(r);
+}
+
+void PCBView::invalidateAll()
+{
+	mTiles.clear();
+	updateBoard();
+}
+
+void PCBView::updateBoard()
+{
+	mBoardDirty = QRegion(rect());
+	update();
+}
+
 void PCBView::visGridChanged(int grid)
 {
 	this->mVisibleGrid = grid;
-	update();
+	updateBoard();
 }
 
 void PCBView::paintEvent(QPaintEvent *e)
 {
+	// the whole board plane is stale if the view was scrolled, zoomed or resized
+	if (mBoard.size() != size() || mBoardTransform != mTransform)
+	{
+		mBoard = QPixmap(size());
+		mBoardTransform = mTransform;
+		mBoardDirty = QRegion(rect());
+	}
+	if (!mBoardDirty.isEmpty())
+	{
+		drawBoard(mBoardDirty);
+		mBoardDirty = QRegion();
+	}
+
 	QPainter painter(this);
+	painter.drawPixmap(e->rect(), mBoard, e->rect());
+	// draw the editor overlay on top of the board
+	if (mCtrl && mCtrl->docIsOpen() && mCtrl->isLayerVisible(Layer::LAY_SELECTION))
+	{
+		painter.setTransform(mTransform);
+		painter.setRenderHint(QPainter::Antialiasing);
+		setLayerPen(&painter, Layer::LAY_SELECTION);
+		QRect bb = mTransform.inverted().mapRect(e->rect());
+		mCtrl->draw(&painter, bb, Layer::LAY_SELECTION);
+	}
+	painter.end();
+}
+
+void PCBView::drawBoard(const QRegion &region)
+{
+	QRect dirty = region.boundingRect();
+	QPainter painter(&mBoard);
 	// erase background
-	painter.setBackground(QBrush(Layer::color(Layer::LAY_BACKGND)));
-	painter.setClipping(true);
-	painter.eraseRect(this->rect());
+	const Palette &pal = Palette::instance();
+	painter.setBackground(pal.brush(Layer::LAY_BACKGND));
+	painter.setClipRegion(region);
+	painter.eraseRect(dirty);
 	// draw document
 	if (mCtrl && mCtrl->docIsOpen())
 	{
 		QList<Layer> layers = mCtrl->doc()
 				->layerList(PCBDoc::DrawPriorityOrder);
 		// draw grid
-		QPen pen(Layer::color(Layer::LAY_VISIBLE_GRID));
-		pen.setCapStyle(Qt::RoundCap);
-		pen.setJoinStyle(Qt::RoundJoin);
 		painter.setTransform(mTransform);
-		painter.setPen(pen);
+		painter.setPen(pal.pen(Layer::LAY_VISIBLE_GRID));
 		if (mCtrl->isLayerVisible(Layer::LAY_VISIBLE_GRID))
 		{
 			drawOrigin(&painter);
@@ -86,16 +174,16 @@ void PCBView::paintEvent(QPaintEvent *e)
 		// turn on AA
 		painter.setRenderHint(QPainter::Antialiasing);
 		// set transform
-		QRect bb = mTransform.inverted().mapRect(e->rect());
+		QRect bb = mTransform.inverted().mapRect(dirty);
 		// figure out active layer
 		Layer active = mCtrl->activeLayer();
 
-		// draw the layers
+		// figure out which layers to draw and in what order
+		QList<Layer> drawn;
 		bool activeDrawn = false;
 		QListIterator<Layer> i(layers);
 		while(i.hasNext())
 		{
-			Q_ASSERT(painter.isActive());
 			Layer curr;
 			// find first copper layer to draw current active layer
 			if (!activeDrawn && !i.peekNext().isCopper()
@@ -110,20 +198,31 @@ void PCBView::paintEvent(QPaintEvent *e)
 				if (curr == active)
 					continue; // will draw later
 			}
-			if (mCtrl->isLayerVisible(curr))
+			// the selection layer is drawn over the board by paintEvent()
+			if (mCtrl->isLayerVisible(curr) && curr != Layer::LAY_SELECTION)
+				drawn.append(curr);
+		}
+
+		// render the tiles of all cached layers
+		QList<Layer> cached;
+		foreach(const Layer &l, drawn)
+		{
+			if (isCachedLayer(l))
+				cached.append(l);
+		}
+		QHash<TileCache::Key, QImage> tiles = renderTiles(dirty, cached);
+
+		// draw the layers
+		foreach(const Layer &curr, drawn)
+		{
+			Q_ASSERT(painter.isActive());
+			if (isCachedLayer(curr))
 			{
-				// set color / fill
-				QPen p = painter.pen();
-				p.setColor(curr.color());
-				p.setWidth(0);
-				painter.setPen(p);
-				QBrush b = painter.brush();
-				b.setColor(curr.color());
-				if (curr.type() != Layer::LAY_SELECTION)
-					b.setStyle(Qt::SolidPattern);
-				else
-					b.setStyle(Qt::NoBrush);
-				painter.setBrush(b);
+				drawTiles(&painter, tiles, curr);
+			}
+			else
+			{
+				setLayerPen(&painter, curr);
 				// tell controller to draw it
 				mCtrl->draw(&painter, bb, curr);
 			}
@@ -132,6 +231,169 @@ void PCBView::paintEvent(QPaintEvent *e)
 	painter.end();
 }
 
+bool PCBView::isCachedLayer(const Layer &layer)
+{
+	// the editor overlay and the ratlines change too often to be worth caching
+	return layer != Layer::LAY_SELECTION && layer != Layer::LAY_RAT_LINE;
+}
+
+void PCBView::setLayerPen(QPainter *painter, const Layer &layer)
+{
+	const Palette &pal = Palette::instance();
+	painter->setPen(pal.pen(layer.type()));
+	painter->setBrush(pal.brush(layer.type()));
+}
+
+void PCBView::renderTile(TileJob &job)
+{
+	for (int i = 0; i < job.layers.size(); i++)
+	{
+		// tiles with nothing in them are cached as null images
+		QImage img;
+		if (job.drawn.contains(job.layers[i]))
+		{
+			img = QImage(job.size, job.size, QImage::Format_ARGB32_Premultiplied);
+			img.fill(0);
+			QPainter p(&img);
+			p.setRenderHint(QPainter::Antialiasing);
+			p.setTransform(job.transform);
+			setLayerPen(&p, job.layers[i]);
+			Controller::drawObjList(&p, job.objs, job.layers[i], &job.shapes);
+		}
+		job.images.append(img);
+	}
+}
+
+QHash<TileCache::Key, QImage> PCBView::renderTiles(const QRect &rect,
+												   const QList<Layer> &layers)
+{
+	QHash<TileCache::Key, QImage> out;
+	if (layers.isEmpty())
+		return out;
+
+	// tiles are aligned to the world origin, so that the tile grid only
+	// depends on the scale and not on the scroll position
+	const int ts = mTiles.tileSize();
+	const double sx = mTransform.m11();
+	const double sy = mTransform.m22();
+	int x0 = qFloor((rect.left() - mTransform.dx()) / ts);
+	int x1 = qFloor((rect.right() - mTransform.dx()) / ts);
+	int y0 = qFloor((rect.top() - mTransform.dy()) / ts);
+	int y1 = qFloor((rect.bottom() - mTransform.dy()) / ts);
+	// pad the area of each tile by a couple of pixels for antialiasing
+	int margin = qCeil(2 / qAbs(sx));
+
+	QList<QSharedPointer<PCBObject> > hidden = mCtrl->hiddenObjs();
+
+	// collect the tiles that need to be rendered
+	QList<TileJob> jobs;
+	for (int x = x0; x <= x1; x++)
+	{
+		for (int y = y0; y <= y1; y++)
+		{
+			TileJob job;
+			for (int i = 0; i < layers.size(); i++)
+			{
+				TileCache::Key k(layers[i].toInt(), sx, x, y);
+				const QImage* img = mTiles.tile(k);
+				if (img)
+				{
+					out.insert(k, *img);
+				}
+				else
+				{
+					job.layers.append(layers[i]);
+				}
+			}
+			if (job.layers.isEmpty())
+				continue;
+
+			job.x = x;
+			job.y = y;
+			job.size = ts;
+			job.transform = QTransform(sx, 0, 0, sy, -x * ts, -y * ts);
+			job.area = job.transform.inverted().mapRect(QRect(0, 0, ts, ts))
+					   .adjusted(-margin, -margin, margin, margin);
+			LayerMask wanted;
+			foreach(const Layer &l, job.layers)
+				wanted |= l;
+			XPcb::LOD lod = XPcb::lod(job.transform);
+			job.objs = mCtrl->doc()->findObjs(job.area);
+			QMutableListIterator<QSharedPointer<PCBObject> > i(job.objs);
+			while (i.hasNext())
+			{
+				// skip objects that don't draw on any of the layers
+				LayerMask objLayers = i.next()->layers();
+				if (!objLayers.intersects(wanted) || hidden.contains(i.value()))
+				{
+					i.remove();
+					continue;
+				}
+				job.drawn |= objLayers;
+				// bbox() brings lazily computed geometry (text strokes, pin
+				// transforms) up to date, so that drawing doesn't modify
+				// the objects
+				i.value()->bbox();
+				// compile the footprint shapes here and give the job its
+				// own copies, since the cached ones are shared by all tiles
+				Part* part = qobject_cast<Part*>(i.value().data());
+				if (part && part->footprint())
+				{
+					part->footprint()->cachedBBox();
+					if (lod == XPcb::LOD_BOX)
+						continue;
+					foreach(const Layer &l, job.layers)
+					{
+						Layer fl = part->fpLayer(l);
+						if (fl.type() != Layer::LAY_UNKNOWN)
+							part->footprint()->copyShapes(job.shapes, fl,
+									lod != XPcb::LOD_FULL);
+					}
+				}
+			}
+			jobs.append(job);
+		}
+	}
+
+	if (mThreaded && jobs.size() > 1)
+		QtConcurrent::blockingMap(jobs, &PCBView::renderTile);
+	else
+	{
+		for (int i = 0; i < jobs.size(); i++)
+			renderTile(jobs[i]);
+	}
+
+	foreach(const TileJob &job, jobs)
+	{
+		for (int i = 0; i < job.layers.size(); i++)
+		{
+			TileCache::Key k(job.layers[i].toInt(), sx, job.x, job.y);
+			mTiles.insert(k, job.images[i], job.area);
+			out.insert(k, job.images[i]);
+		}
+	}
+	return out;
+}
+
+void PCBView::drawTiles(QPainter *painter, const QHash<TileCache::Key, QImage> &tiles,
+						const Layer &layer)
+{
+	const int ts = mTiles.tileSize();
+	// the translation is whole (see snapTransform())
+	QPoint origin(qRound(mTransform.dx()), qRound(mTransform.dy()));
+	painter->save();
+	painter->resetTransform();
+	QHashIterator<TileCache::Key, QImage> i(tiles);
+	while (i.hasNext())
+	{
+		i.next();
+		if (i.key().layer != layer.toInt() || i.value().isNull())
+			continue;
+		painter->drawImage(origin + QPoint(i.key().x * ts, i.key().y * ts), i.value());
+	}
+	painter->restore();
+}
+
 void PCBView::drawOrigin(QPainter *painter)
 {
 	// circle with 4 lines
@@ -247,12 +509,25 @@ void PCBView::recenter(QPoint pt, bool world)
 		}
 
 	}
+	snapTransform();
 	// move cursor to middle of the window
 	QCursor::setPos(mapToGlobal(rect().center()));
 	// force repaint
 	update();
 }
 
+/// The tiles are drawn at whole pixel offsets (see drawTiles()), so the
+/// translation is kept whole as well; otherwise the overlay, selection and
+/// cursor, which are drawn with the transform, would be up to half a pixel
+/// off the tiles.
+void PCBView::snapTransform()
+{
+	mTransform.setMatrix(mTransform.m11(), mTransform.m12(), mTransform.m13(),
+						 mTransform.m21(), mTransform.m22(), mTransform.m23(),
+						 qRound(mTransform.dx()), qRound(mTransform.dy()),
+						 mTransform.m33());
+}
+
 /// Pos is in screen coords
 void PCBView::zoom(double factor, QPoint pos)
 {
@@ -1,82 +1,129 @@
-/*
-	Copyright (C) 2010-2011 Igor Izyumin
-
-	This file is part of xpcb.
-
-	xpcb is free software: you can redistribute it and/or modify
-	it under the terms of the GNU General Public License as published by
-	the Free Software Foundation, either version 3 of the License, or
-	(at your option) any later version.
-
-	xpcb is distributed in the hope that it will be useful,
-	but WITHOUT ANY WARRANTY; without even the implied warranty of
-	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
-	GNU General Public License for more details.
-
-	You should have received a copy of the GNU General Public License
-	along with xpcb.  If not, see <http://www.gnu.org/licenses/>.
-*/
-
-#ifndef QPCBVIEW_H
-#define QPCBVIEW_H
-
-#include <QWidget>
-#include <QTransform>
-#include "global.h"
-
-class PCBDoc;
-class Controller;
-
-class PCBView : public QWidget
-{
-	Q_OBJECT
-
-public:
-        PCBView(QWidget *parent);
-        ~PCBView();
-
-
-	virtual QSize sizeHint() const;
-
-	/// This gets called by the controller when the view is registered.
-	void setCtrl(Controller* ctrl);
-
-	const QTransform& transform() const { return mTransform; }
-
-signals:
-	void mouseMoved(QPoint pt);
-
-public slots:
-	void visGridChanged(int grid);
-	//	void layerVisChanged();
-
-protected:
-	virtual void paintEvent(QPaintEvent *e);
-	virtual void mouseMoveEvent(QMouseEvent *event);
-	virtual void mousePressEvent(QMouseEvent *event);
-	virtual void mouseReleaseEvent(QMouseEvent *event);
-	virtual void keyPressEvent(QKeyEvent * event);
-	virtual void enterEvent(QEvent *event);
-	virtual void leaveEvent(QEvent *event);
-	virtual void wheelEvent(QWheelEvent *);
-
-private:
-	void drawOrigin(QPainter *painter);
-	void drawGrid(QPainter *painter);
-	void recenter(QPoint pt, bool world=false);
-	void zoom(double factor, QPoint pos);
-
-	/// Controller
-	Controller* mCtrl;
-
-	/// Transform from world coordinates to window coordinates
-	QTransform mTransform;
-	/// Visible grid size in PCB units
-	int mVisibleGrid;
-	/// Mouse position (world coordinates)
-	QPoint mMousePos;
-	/// Accumulated mouse wheel angle
-	int mWheelAngle;
-};
-
-#endif // QPCBVIEW_H
+/*
+	Copyright (C) 2010-2011 Igor Izyumin
+
+	This file is part of xpcb.
+
+	xpcb is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	xpcb is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with xpcb.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef QPCBVIEW_H
+#define QPCBVIEW_H
+
+#include <QWidget>
+#include <QTransform>
+#include <QPixmap>
+#include <QRegion>
+#include "global.h"
+#include "TileCache.h"
+
+class PCBDoc;
+class Controller;
+
+class PCBView : public QWidget
+{
+	Q_OBJECT
+
+public:
+        PCBView(QWidget *parent);
+        ~PCBView();
+
+
+	virtual QSize sizeHint() const;
+
+	/// This gets called by the controller when the view is registered.
+	void setCtrl(Controller* ctrl);
+
+	const QTransform& transform() const { return mTransform; }
+
+	/// Discards the cached drawing of the given area (in world coordinates)
+	/// and schedules a repaint.
+	void invalidate(const QRect &area);
+	/// Schedules a repaint of the given area (in world coordinates) of the
+	/// board plane, without discarding the cached layers.  Used for things
+	/// that are not cached, such as ratlines.
+	void updateArea(const QRect &area);
+	/// Schedules a repaint of the board plane.  This is needed when the board
+	/// appearance changes without any object being invalidated (e.g. when
+	/// layer visibility changes).  A plain update() only redraws the editor
+	/// overlay on top of the cached board.
+	void updateBoard();
+
+signals:
+	void mouseMoved(QPoint pt);
+
+public slots:
+	/// Discards all cached drawing and schedules a repaint.
+	void invalidateAll();
+	void visGridChanged(int grid);
+	//	void layerVisChanged();
+
+protected:
+	virtual void paintEvent(QPaintEvent *e);
+	virtual void mouseMoveEvent(QMouseEvent *event);
+	virtual void mousePressEvent(QMouseEvent *event);
+	virtual void mouseReleaseEvent(QMouseEvent *event);
+	virtual void keyPressEvent(QKeyEvent * event);
+	virtual void enterEvent(QEvent *event);
+	virtual void leaveEvent(QEvent *event);
+	virtual void wheelEvent(QWheelEvent *);
+
+private:
+	struct TileJob;
+
+	void drawOrigin(QPainter *painter);
+	void drawGrid(QPainter *painter);
+	void recenter(QPoint pt, bool world=false);
+	/// Rounds the translation of the view transform to whole pixels.
+	void snapTransform();
+	void zoom(double factor, QPoint pos);
+	/// Redraws the given region (in window coordinates) of the board plane.
+	void drawBoard(const QRegion &region);
+	/// Returns true if the layer is drawn from the tile cache.
+	static bool isCachedLayer(const Layer &layer);
+	/// Sets up the pen and brush for drawing a layer.
+	static void setLayerPen(QPainter *painter, const Layer &layer);
+	/// Renders a tile.  Safe to call from any thread.
+	static void renderTile(TileJob &job);
+	/// Renders the tiles that cover the rectangle (in window coordinates) on
+	/// each of the given layers, reusing cached tiles where possible.
+	QHash<TileCache::Key, QImage> renderTiles(const QRect &rect,
+											  const QList<Layer> &layers);
+	/// Draws the tiles of a layer.
+	void drawTiles(QPainter *painter, const QHash<TileCache::Key, QImage> &tiles,
+				   const Layer &layer);
+
+	/// Controller
+	Controller* mCtrl;
+
+	/// Transform from world coordinates to window coordinates
+	QTransform mTransform;
+	/// Visible grid size in PCB units
+	int mVisibleGrid;
+	/// Mouse position (world coordinates)
+	QPoint mMousePos;
+	/// Accumulated mouse wheel angle
+	int mWheelAngle;
+	/// Rendered layer tiles
+	TileCache mTiles;
+	/// Board plane: everything but the editor overlay
+	QPixmap mBoard;
+	/// Transform that the board plane was drawn with
+	QTransform mBoardTransform;
+	/// Region of the board plane that needs to be redrawn
+	QRegion mBoardDirty;
+	/// If true, tiles are rendered in parallel on the global thread pool
+	bool mThreaded;
+};
+
+#endif // QPCBVIEW_H
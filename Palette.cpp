@@ -0,0 +1,58 @@
+/*
+	Copyright (C) 2010-2011 Igor Izyumin
+
+	This file is part of xpcb.
+
+	xpcb is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	xpcb is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with xpcb.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QSettings>
+#include "Palette.h"
+
+Palette* Palette::mInstance = NULL;
+
+Palette& Palette::instance()
+{
+	if (!mInstance)
+		mInstance = new Palette();
+	return *mInstance;
+}
+
+Palette::Palette()
+	: mColors(Layer::LAY_UNKNOWN + 1),
+	  mPens(Layer::LAY_UNKNOWN + 1),
+	  mBrushes(Layer::LAY_UNKNOWN + 1)
+{
+	load();
+}
+
+void Palette::load()
+{
+	QSettings s;
+	for(int i = 0; i <= Layer::LAY_UNKNOWN; i++)
+	{
+		Layer::Type t = static_cast<Layer::Type>(i);
+		QColor c = s.value(QString("colors/%1").arg(Layer::name(t))).value<QColor>();
+		mColors[i] = c;
+
+		QPen p(c);
+		p.setWidth(0);
+		p.setCapStyle(Qt::RoundCap);
+		p.setJoinStyle(Qt::RoundJoin);
+		mPens[i] = p;
+
+		mBrushes[i] = QBrush(c, t == Layer::LAY_SELECTION ? Qt::NoBrush
+														  : Qt::SolidPattern);
+	}
+}
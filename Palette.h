@@ -0,0 +1,66 @@
+/*
+	Copyright (C) 2010-2011 Igor Izyumin
+
+	This file is part of xpcb.
+
+	xpcb is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	xpcb is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with xpcb.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PALETTE_H
+#define PALETTE_H
+
+#include <QVector>
+#include <QColor>
+#include <QPen>
+#include <QBrush>
+#include "global.h"
+
+/// Palette holds the colors, pens and brushes used to draw each layer.
+
+/// The layer colors are stored in the application settings.  Reading them
+/// through QSettings is far too slow to do while painting, so Palette loads
+/// them once, when it is first used, and hands out the precomputed drawing
+/// styles.  The colors are set up by initSettings() at startup and are not
+/// changed while the program is running.
+///
+/// The palette may be read from rendering threads, but must first be
+/// created on the GUI thread.
+class Palette
+{
+public:
+	static Palette& instance();
+
+	/// Returns the color of a layer.
+	const QColor& color(Layer::Type layer) const { return mColors[layer]; }
+	/// Returns a cosmetic pen in the layer's color.
+	const QPen& pen(Layer::Type layer) const { return mPens[layer]; }
+	/// Returns the brush used to fill shapes on a layer.  The selection
+	/// layer is drawn as outlines only.
+	const QBrush& brush(Layer::Type layer) const { return mBrushes[layer]; }
+
+private:
+	Palette();
+	Palette(const Palette&);
+
+	/// Loads the layer colors from the settings.
+	void load();
+
+	QVector<QColor> mColors;
+	QVector<QPen> mPens;
+	QVector<QBrush> mBrushes;
+
+	static Palette* mInstance;
+};
+
+#endif // PALETTE_H
@@ -21,6 +21,7 @@
 #include "Document.h"
 #include "Log.h"
 #include "smfontutil.h"
+#include "XmlAttr.h"
 
 ///////////////////// PART PIN /////////////////////
 
@@ -33,23 +34,12 @@ Layer PartPin::mapLayer(const Layer& layer) const
 {
 	if ((!layer.isCopper() && layer.type() != Layer::LAY_HOLE))
 		return Layer();
-
-	Part::SIDE side = mPart->side();
-	if ((layer == Layer::LAY_TOP_COPPER && side == Part::SIDE_TOP) ||
-		(layer == Layer::LAY_BOTTOM_COPPER && side == Part::SIDE_BOTTOM))
-		return Layer::LAY_START;
-	else if ((layer == Layer::LAY_TOP_COPPER && side == Part::SIDE_BOTTOM) ||
-		(layer == Layer::LAY_BOTTOM_COPPER && side == Part::SIDE_TOP))
-		return Layer::LAY_END;
-	else if (layer.isCopper())
-		return Layer::LAY_INNER;
-	else
-		return Layer::LAY_HOLE;
+	return mPart->fpLayer(layer);
 }
 
 bool PartPin::testHit( const QPoint& pt, int dist, const Layer& layer) const
 {
-	return mPin->testHit(mPart->transform().inverted().map(pt), dist,
+	return mPin->testHit(mPart->inverseTransform().map(pt), dist,
 						 mapLayer(layer));
 }
 
@@ -137,7 +127,14 @@ void Part::updateFp()
 {
 	resetFp();
 	mFp = doc()->getFootprint(mFpUuid);
-	if (mFp.isNull()) return;
+	if (mFp.isNull())
+	{
+		// keep the part, so that it isn't lost when the board is saved;
+		// it has no pins and only keeps its texts
+		mRefdes = QSharedPointer<Text>(new Text(this));
+		mValue = QSharedPointer<Text>(new Text(this));
+		return;
+	}
 
 	// create new pins
 	for(int i = 0; i < mFp->numPins(); i++)
@@ -155,37 +152,36 @@ void Part::updateFp()
 
 QSharedPointer<Part> Part::newFromXML(QXmlStreamReader &reader, PCBDoc *doc)
 {
-	Q_ASSERT(reader.isStartElement() && reader.name() == "part");
+	Q_ASSERT(reader.isStartElement() && Xml::is(reader.name(), "part"));
 
 
 	QXmlStreamAttributes attr = reader.attributes();
 
 	QSharedPointer<Part> pp(new Part(doc));
 
-	pp->mFpUuid = QUuid(attr.value("footprint_uuid").toString());
+	pp->mFpUuid = Xml::uuidAttr(attr, "footprint_uuid");
 	pp->updateFp();
 
 	// reference designator
-	pp->mRefdes->setText(attr.value("refdes").toString());
+	pp->mRefdes->setText(Xml::attr(attr, "refdes").toString());
 	pp->mRefVisible = true;
 	// value
-	if (attr.hasAttribute("value"))
+	if (Xml::hasAttr(attr, "value"))
 	{
-		pp->mValue->setText(attr.value("value").toString());
+		pp->mValue->setText(Xml::attr(attr, "value").toString());
 		pp->mValueVisible = true;
 	}
 
 	// position/rotation
-	pp->mPos = QPoint(attr.value("x").toString().toInt(),
-					  attr.value("y").toString().toInt());
-	pp->mAngle = attr.value("rot").toString().toInt();
+	pp->mPos = QPoint(Xml::intAttr(attr, "x"),
+					  Xml::intAttr(attr, "y"));
+	pp->mAngle = Xml::intAttr(attr, "rot");
 
 	// side
-	pp->mSide = (attr.value("side") == "top") ? SIDE_TOP : SIDE_BOTTOM;
+	pp->mSide = Xml::is(Xml::attr(attr, "side"), "top") ? SIDE_TOP : SIDE_BOTTOM;
 
 	// locked?
-	if (attr.hasAttribute("locked"))
-	pp->mLocked = (attr.value("locked") == "1");
+	pp->mLocked = Xml::boolAttr(attr, "locked", pp->mLocked);
 
 	pp->updateTransform();
 
@@ -198,30 +194,28 @@ QSharedPointer<Part> Part::newFromXML(QXmlStreamReader &reader, PCBDoc *doc)
 	while(reader.readNextStartElement())
 	{
 		QStringRef t = reader.name();
-		if (t == "refText")
+		if (Xml::is(t, "refText"))
 		{
 			QXmlStreamAttributes attr = reader.attributes();
-			pp->mRefdes->setPos(QPoint(attr.value("x").toString().toInt(),
-									   attr.value("y").toString().toInt()));
-			pp->mRefdes->setAngle(attr.value("rot").toString().toInt());
-			pp->mRefdes->setFontSize(attr.value("textSize").toString().toInt());
-			pp->mRefdes->setStrokeWidth(attr.value("lineWidth").toString().toInt());
-			if (attr.hasAttribute("visible"))
-				pp->mRefVisible = attr.value("visible") == "1";
+			pp->mRefdes->setPos(QPoint(Xml::intAttr(attr, "x"),
+									   Xml::intAttr(attr, "y")));
+			pp->mRefdes->setAngle(Xml::intAttr(attr, "rot"));
+			pp->mRefdes->setFontSize(Xml::intAttr(attr, "textSize"));
+			pp->mRefdes->setStrokeWidth(Xml::intAttr(attr, "lineWidth"));
+			pp->mRefVisible = Xml::boolAttr(attr, "visible", pp->mRefVisible);
 			do
 					reader.readNext();
 			while(!reader.isEndElement());
 		}
-		else if (t == "valueText")
+		else if (Xml::is(t, "valueText"))
 		{
 			QXmlStreamAttributes attr = reader.attributes();
-			pp->mValue->setPos(QPoint(attr.value("x").toString().toInt(),
-									   attr.value("y").toString().toInt()));
-			pp->mValue->setAngle(attr.value("rot").toString().toInt());
-			pp->mValue->setFontSize(attr.value("textSize").toString().toInt());
-			pp->mValue->setStrokeWidth(attr.value("lineWidth").toString().toInt());
-			if (attr.hasAttribute("visible"))
-				pp->mValueVisible = attr.value("visible") == "1";
+			pp->mValue->setPos(QPoint(Xml::intAttr(attr, "x"),
+									   Xml::intAttr(attr, "y")));
+			pp->mValue->setAngle(Xml::intAttr(attr, "rot"));
+			pp->mValue->setFontSize(Xml::intAttr(attr, "textSize"));
+			pp->mValue->setStrokeWidth(Xml::intAttr(attr, "lineWidth"));
+			pp->mValueVisible = Xml::boolAttr(attr, "visible", pp->mValueVisible);
 			do
 					reader.readNext();
 			while(!reader.isEndElement());
@@ -279,23 +273,69 @@ void Part::updateTransform()
 	if (mSide == SIDE_BOTTOM)
 		mTransform.scale(-1, 1);
 	mTransform.rotate(mAngle);
+	mInvTransform = mTransform.inverted();
 	transformChanged(mTransform);
 }
 
 void Part::draw(QPainter *painter, const Layer& layer) const
 {
+	drawShapes(painter, layer, NULL);
+}
+
+void Part::draw(QPainter *painter, const Layer& layer,
+				const Footprint::ShapeSet &shapes) const
+{
+	drawShapes(painter, layer, &shapes);
+}
+
+void Part::drawShapes(QPainter *painter, const Layer& layer,
+					  const Footprint::ShapeSet *shapes) const
+{
+	if (!mFp)
+		return;
 	painter->save();
 	painter->setTransform(mTransform, true);
 
+	XPcb::LOD lod = XPcb::lod(painter);
+	if (lod == XPcb::LOD_BOX)
+	{
+		// zoomed too far out to see the pins; just show where the part is
+		if ((layer.type() == Layer::LAY_SILK_TOP && mSide == SIDE_TOP) ||
+			(layer.type() == Layer::LAY_SILK_BOTTOM && mSide == SIDE_BOTTOM) ||
+				layer.type() == Layer::LAY_SELECTION)
+			painter->drawRect(mFp->cachedBBox());
+		painter->restore();
+		return;
+	}
+
+	if (layer.type() != Layer::LAY_SELECTION)
+	{
+		// replay the compiled footprint shapes, which are shared by all
+		// parts with this footprint
+		Layer l = fpLayer(layer);
+		if (l.type() != Layer::LAY_UNKNOWN)
+		{
+			bool simple = lod != XPcb::LOD_FULL;
+			Footprint::Shapes own;
+			const Footprint::Shapes* s = &own;
+			if (shapes)
+				s = mFp->findShapes(*shapes, l, simple);
+			else
+				own = mFp->shapes(l, simple);
+			QPen pen = painter->pen();
+			pen.setWidth(0);
+			painter->setPen(pen);
+			if (s && !s->fill.isEmpty())
+				painter->drawPath(s->fill);
+			if (s && !s->stroke.isEmpty())
+				painter->fillPath(s->stroke, pen.color());
+		}
+		painter->restore();
+		return;
+	}
 
-	// draw footprint
-	if ((layer.type() == Layer::LAY_SILK_TOP && mSide == SIDE_TOP) ||
-		(layer.type() == Layer::LAY_SILK_BOTTOM && mSide == SIDE_BOTTOM) ||
-			layer.type() == Layer::LAY_SELECTION)
-		mFp->draw(painter, Footprint::LAY_START);
-	else if ((layer.type() == Layer::LAY_SILK_TOP && mSide == SIDE_BOTTOM) ||
-		(layer.type() == Layer::LAY_SILK_BOTTOM && mSide == SIDE_TOP))
-		mFp->draw(painter, Footprint::LAY_END);
+	// selection outline: draw footprint
+	mFp->draw(painter, Footprint::LAY_START);
 
 	// draw pins
 	foreach(QSharedPointer<PartPin> p, mPins)
@@ -306,8 +346,39 @@ void Part::draw(QPainter *painter, const Layer& layer) const
 	painter->restore();
 }
 
+LayerMask Part::layers() const
+{
+	return LayerMask::copper() | Layer::LAY_SILK_TOP | Layer::LAY_SILK_BOTTOM
+			| Layer::LAY_HOLE | Layer::LAY_SELECTION;
+}
+
+Layer Part::fpLayer(const Layer& layer) const
+{
+	if (layer.type() == Layer::LAY_SILK_TOP || layer.type() == Layer::LAY_SILK_BOTTOM)
+	{
+		// silkscreen on the part's side is the footprint's top silkscreen
+		bool sameSide = (layer.type() == Layer::LAY_SILK_TOP) == (mSide == SIDE_TOP);
+		return sameSide ? Layer::LAY_SILK_TOP : Layer::LAY_SILK_BOTTOM;
+	}
+	if (!layer.isCopper() && layer.type() != Layer::LAY_HOLE)
+		return Layer();
+
+	if ((layer == Layer::LAY_TOP_COPPER && mSide == SIDE_TOP) ||
+		(layer == Layer::LAY_BOTTOM_COPPER && mSide == SIDE_BOTTOM))
+		return Layer::LAY_START;
+	else if ((layer == Layer::LAY_TOP_COPPER && mSide == SIDE_BOTTOM) ||
+		(layer == Layer::LAY_BOTTOM_COPPER && mSide == SIDE_TOP))
+		return Layer::LAY_END;
+	else if (layer.isCopper())
+		return Layer::LAY_INNER;
+	else
+		return Layer::LAY_HOLE;
+}
+
 QRect Part::bbox() const
 {
+	if (!mFp)
+		return QRect(mPos, QSize(1, 1));
 	return mTransform.mapRect(mFp->bbox());
 }
 
@@ -332,6 +403,7 @@ bool Part::loadState(PCBObjState &state)
 	QSharedPointer<PartState> s = state.ptr().dynamicCast<PartState>();
 	if (s.isNull()) return false;
 	mTransform = s->transform;
+	mInvTransform = mTransform.inverted();
 	mPos = s->pos;
 	mAngle = s->angle;
 	mSide = s->side;
@@ -43,6 +43,12 @@ public:
 	virtual ~Part();
 
 	virtual void draw(QPainter *painter, const Layer& layer) const;
+	/// Draws the part using footprint shapes from a shape set instead of
+	/// the footprint's shared cache (see Footprint::copyShapes()).  Shapes
+	/// missing from the set are not drawn.
+	void draw(QPainter *painter, const Layer& layer,
+			  const Footprint::ShapeSet &shapes) const;
+	virtual LayerMask layers() const;
 	virtual QRect bbox() const;
 	virtual PCBObjState getState() const;
 	virtual bool loadState(PCBObjState &state);
@@ -65,8 +71,13 @@ public:
 	void setRefVisible(bool vis) { mRefVisible = vis; }
 	void setValueVisible(bool vis) { mValueVisible = vis; }
 
+	/// Returns the footprint, or NULL if it could not be found (the part
+	/// then has no pins and keeps only its footprint UUID and texts).
 	QSharedPointer<Footprint> footprint() const { return mFp;}
 	const QUuid& fpUuid() const { return mFpUuid; }
+	/// Maps a PCB layer to the footprint layer that is drawn on it (see
+	/// Footprint::shapes()), or to an unknown layer if nothing is drawn.
+	Layer fpLayer(const Layer& layer) const;
 	void setFootprint(QUuid uuid);
 
 	QList<QSharedPointer<PartPin> > pins() const { return mPins; }
@@ -76,6 +87,8 @@ public:
 	void toXML(QXmlStreamWriter &writer) const;
 
 	QTransform transform() const { return mTransform; }
+	/// Returns the coordinate transform from world to part coords
+	const QTransform& inverseTransform() const { return mInvTransform; }
 	bool testHit(QPoint pt, int dist, const Layer& /*layer*/) const
 	{ return bbox().adjusted(-dist/2, -dist/2, dist/2, dist/2).contains(pt); }
 
@@ -111,9 +124,15 @@ private:
 	void updateFp();
 
 	void updateTransform();
+	/// Draws the part, taking the footprint shapes from a shape set if one
+	/// is given
+	void drawShapes(QPainter *painter, const Layer& layer,
+					const Footprint::ShapeSet *shapes) const;
 
 	/// Coordinate transform from part to world coords
 	QTransform mTransform;
+	/// Inverse of mTransform, cached for hit testing
+	QTransform mInvTransform;
 
 	/// Part position on board.  This is the origin of the part's coordinate system.
 	QPoint mPos;
@@ -171,6 +190,8 @@ public:
 	bool isSmt() const;
 
 	virtual void draw(QPainter *painter, const Layer& layer) const;
+	virtual LayerMask layers() const
+	{ return LayerMask::copper() | Layer::LAY_HOLE | Layer::LAY_SELECTION; }
 	virtual QRect bbox() const;
 	virtual PCBObjState getState() const;
 	virtual bool loadState(PCBObjState &state);
@@ -21,6 +21,7 @@
 #include "Polygon.h"
 #include "polybool.h"
 #include "global.h"
+#include "XmlAttr.h"
 
 using namespace POLYBOOLEAN;
 
@@ -136,7 +137,7 @@ void PolyContour::draw(QPainter *painter) const
 
 PolyContour PolyContour::newFromXML(QXmlStreamReader &reader)
 {
-	Q_ASSERT(reader.isStartElement() && reader.name() == "start");
+	Q_ASSERT(reader.isStartElement() && Xml::is(reader.name(), "start"));
 
 	PolyContour pc;
 
@@ -144,21 +145,21 @@ PolyContour PolyContour::newFromXML(QXmlStreamReader &reader)
 	{
 		QXmlStreamAttributes attr = reader.attributes();
 		QPoint endPt = QPoint(
-				attr.value("x").toString().toInt(),
-				attr.value("y").toString().toInt());
+				Xml::intAttr(attr, "x"),
+				Xml::intAttr(attr, "y"));
 
 		QStringRef t = reader.name();
-		if (t == "start")
+		if (Xml::is(t, "start"))
 		{
 			pc.mSegs.append(Segment(Segment::START, endPt));
 		}
-		else if (t == "lineTo")
+		else if (Xml::is(t, "lineTo"))
 		{
 			pc.mSegs.append(Segment(Segment::LINE, endPt));
 		}
-		else if (t == "arcTo")
+		else if (Xml::is(t, "arcTo"))
 		{
-			Segment::SegType t = (attr.value("dir") == "cw")
+			Segment::SegType t = Xml::is(Xml::attr(attr, "dir"), "cw")
 						 ? Segment::ARC_CW : Segment::ARC_CCW;
 			pc.mSegs.append(Segment(t, endPt));
 		}
@@ -382,17 +383,17 @@ PAREA* Polygon::getParea() const
 
 Polygon Polygon::newFromXML(QXmlStreamReader &reader)
 {
-	Q_ASSERT(reader.isStartElement() && reader.name() == "polygon");
+	Q_ASSERT(reader.isStartElement() && Xml::is(reader.name(), "polygon"));
 
 	Polygon poly;
 
 	reader.readNextStartElement();
-	Q_ASSERT(reader.name() == "outline");
+	Q_ASSERT(Xml::is(reader.name(), "outline"));
 	reader.readNextStartElement();
 	poly.mOutline = PolyContour::newFromXML(reader);
 	while(reader.readNextStartElement())
 	{
-		Q_ASSERT(reader.name() == "hole");
+		Q_ASSERT(Xml::is(reader.name(), "hole"));
 		QStringRef t = reader.name();
 
 		reader.readNextStartElement();
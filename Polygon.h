@@ -105,6 +105,8 @@ public:
 	PolyContour* outline() {return &mOutline;}
 	PolyContour const* outline() const {return &mOutline;}
 	PolyContour* hole(int n) {return &(mHoles[n]); }
+	PolyContour const* hole(int n) const {return &(mHoles[n]); }
+	void appendHole(const PolyContour& hole) { mHoles.append(hole); mPbDirty = true; }
 	int numHoles() const {return mHoles.size();}
 	void removeHole(int n);
 
@@ -21,12 +21,25 @@
 #include <QSettings>
 #include "SelectFPDialog.h"
 #include "Document.h"
+#include "Palette.h"
+#include "FPPreviewCache.h"
 
 SelectFPDialog::SelectFPDialog(QWidget *parent) :
 	QDialog(parent), mPreviewLayout(new QVBoxLayout())
 {
     setupUi(this);
-	this->fpTree->setModel(&mModel);
+	mProxy.setSourceModel(&mModel);
+	mProxy.setDynamicSortFilter(true);
+	mProxy.sort(0);
+	this->fpTree->setModel(&mProxy);
+	connect(searchEdit, SIGNAL(textChanged(QString)), SLOT(updateFilter()));
+	// keep the results up to date while the library is being scanned
+	connect(&FPDatabase::instance(),
+			SIGNAL(filesAdded(QList<QSharedPointer<FPDBFile> >)),
+			SLOT(updateFilter()));
+	connect(&FPDatabase::instance(),
+			SIGNAL(fileRemoved(QSharedPointer<FPDBFile>)),
+			SLOT(updateFilter()));
 	connect(this->fpTree->selectionModel(),
 			SIGNAL(currentChanged(QModelIndex,QModelIndex)),
 			this, SLOT(onSelChanged(QModelIndex,QModelIndex)));
@@ -38,13 +51,53 @@ SelectFPDialog::SelectFPDialog(QWidget *parent) :
 void SelectFPDialog::onSelChanged(const QModelIndex &current,
 								  const QModelIndex & /*previous*/)
 {
-	mPreview.showFootprint(mModel.path(current));
+	QModelIndex index = mProxy.mapToSource(current);
+	mPreview.showFootprint(mModel.path(index), mModel.uuid(index));
+	prefetchNeighbors(current);
+}
+
+void SelectFPDialog::prefetchNeighbors(const QModelIndex &current)
+{
+	// the footprints the user is most likely to move to next with the
+	// arrow keys, nearest first
+	const int numNeighbors = 2;
+	QList<QPair<QString, QUuid> > files;
+	QModelIndex above = current, below = current;
+	for(int i = 0; i < numNeighbors; i++)
+	{
+		below = fpTree->indexBelow(below);
+		above = fpTree->indexAbove(above);
+		QModelIndex indices[] = { below, above };
+		for(int j = 0; j < 2; j++)
+		{
+			QModelIndex index = mProxy.mapToSource(indices[j]);
+			if (index.isValid() && !mModel.isFolder(index))
+				files.append(qMakePair(mModel.path(index), mModel.uuid(index)));
+		}
+	}
+	FPPreviewCache::instance().prefetch(files, mPreview.size());
+}
+
+void SelectFPDialog::updateFilter()
+{
+	QString query = searchEdit->text().trimmed();
+	if (query.isEmpty())
+	{
+		mProxy.clearFilter();
+		return;
+	}
+	QSet<const FPDBFile*> files = FPDatabase::instance().search(query);
+	mProxy.setFilter(files);
+	// show the results right away, unless there are too many of them
+	if (files.size() <= 100)
+		fpTree->expandAll();
 }
 
 void SelectFPDialog::accept()
 {
 	if (this->fpTree->selectionModel()->hasSelection()
-			&& !mModel.isFolder(fpTree->selectionModel()->currentIndex()))
+			&& !mModel.isFolder(mProxy.mapToSource(
+									fpTree->selectionModel()->currentIndex())))
 	{
 		QDialog::accept();
 		mFpIndex = QPersistentModelIndex(
@@ -99,131 +152,54 @@ FootprintPreview::FootprintPreview(QWidget *parent)
 				  QSizePolicy::Expanding);
 }
 
-void FootprintPreview::showFootprint(QString path)
+void FootprintPreview::showFootprint(QString path, QUuid uuid)
 {
-	mDoc = QSharedPointer<FPDoc>(new FPDoc());
-	if (path.isEmpty() || !mDoc->loadFromFile(path))
-	{
-		mDoc.clear();
-		update();
-		return;
-	}
-
-	mIsDirty = true;
+	mPath = path;
+	mUuid = uuid;
 	update();
 }
 
 void FootprintPreview::paintEvent(QPaintEvent *)
 {
 	QPainter painter(this);
-	// erase backgnd
-	painter.setBackground(QBrush(Layer::color(Layer::LAY_BACKGND)));
-	painter.setClipping(true);
-	painter.eraseRect(rect());
-	if (mDoc)
-	{
-		updateTransform();
-		QList<Layer> layers = mDoc->layerList(Document::DrawPriorityOrder);
-		painter.setRenderHint(QPainter::Antialiasing);
-		painter.setTransform(mTransform);
-		QList<QSharedPointer<PCBObject> > objs = mDoc->findObjs(mBbox);
-		foreach(const Layer& l, layers)
-		{
-			if (l == Layer::LAY_SELECTION)
-				continue;
-			QPen p = painter.pen();
-			p.setColor(l.color());
-			p.setWidth(0);
-			p.setCapStyle(Qt::RoundCap);
-			p.setJoinStyle(Qt::RoundJoin);
-			painter.setPen(p);
-			QBrush b = painter.brush();
-			b.setColor(l.color());
-			b.setStyle(Qt::SolidPattern);
-			painter.setBrush(b);
-			foreach(QSharedPointer<PCBObject> o, objs)
-			{
-				o->draw(&painter, l);
-			}
-		}
-	}
-	painter.end();
+	QImage image = FPPreviewCache::instance().image(mPath, mUuid, size());
+	if (image.isNull())
+		painter.fillRect(rect(), Palette::instance().brush(Layer::LAY_BACKGND));
+	else
+		painter.drawImage(0, 0, image);
 }
 
-void FootprintPreview::updateTransform()
+//////////////////////////////////////////////////////
+
+TreeItem::TreeItem(QSharedPointer<FPDBFile> file, TreeItem *parent)
+	: mFile(file), mRow(0), mParent(parent)
 {
-	if (!mDoc || !mIsDirty)
-		return;
-	mBbox = (mDoc->footprint()->bbox()
-			| mDoc->footprint()->refText()->bbox()
-			| mDoc->footprint()->valueText()->bbox()).normalized();
-	QRectF bb(mBbox);
-	QRectF r(rect());
-	double w, h, hoff, woff;
-	QRectF mrect;
-	double wscale = bb.width() / r.width();
-	double hscale = bb.height() / r.height();
-	if (wscale > hscale)
-	{
-		// width is the limiting factor
-		w = r.width();
-		h = bb.height() / wscale;
-		hoff = (r.height() - h) / 2;
-		mrect = QRectF(0, hoff, w, h).normalized();
-	}
-	else
-	{
-		// height is the limiting factor
-		w = bb.width() / hscale;
-		h = r.height();
-		woff = (r.width() - w) / 2;
-		mrect = QRectF(woff, 0, w, h).normalized();
-	}
-	mTransform.reset();
-	QPolygonF poly(mrect);
-	QPolygonF poly_rev;
-	poly_rev << poly[3] << poly[2] << poly[1] << poly[0];
-	poly = QPolygonF(bb);
-	poly.remove(4);
-	QTransform::quadToQuad(poly, poly_rev, mTransform);
 }
 
-//////////////////////////////////////////////////////
+TreeItem::TreeItem(QSharedPointer<FPDBFolder> folder, TreeItem *parent)
+	: mFolder(folder), mRow(0), mParent(parent)
+{
+}
 
-QSharedPointer<TreeItem> TreeItem::makeTree()
+void TreeItem::appendChild(QSharedPointer<TreeItem> item)
 {
-	QSharedPointer<TreeItem> root(new TreeItem(QSharedPointer<FPDBFolder>()));
-	int i = 0;
-	foreach(QSharedPointer<FPDBFolder> folder,
-			FPDatabase::instance().rootFolders())
-	{
-		root->mChildren.append(
-					QSharedPointer<TreeItem>(
-						new TreeItem(folder, i++, root.data())));
-	}
-	return root;
+	item->mParent = this;
+	item->mRow = mChildren.size();
+	mChildren.append(item);
 }
 
-TreeItem::TreeItem(QSharedPointer<FPDBFile> file, int row, TreeItem *parent)
-	: mFile(file), mRow(row), mParent(parent)
+void TreeItem::removeChild(int row)
 {
+	mChildren.removeAt(row);
+	for(int i = row; i < mChildren.size(); i++)
+		mChildren[i]->mRow = i;
 }
 
-TreeItem::TreeItem(QSharedPointer<FPDBFolder> folder, int row, TreeItem *parent)
-	: mFolder(folder), mRow(row), mParent(parent)
+const void* TreeItem::key() const
 {
-	if (mFolder.isNull())
-		return;
-	// recursively add stuff to tree
-	int i = 0;
-	foreach(QSharedPointer<FPDBFolder> f, mFolder->folders())
-	{
-		mChildren.append(QSharedPointer<TreeItem>(new TreeItem(f, i++, this)));
-	}
-	foreach(QSharedPointer<FPDBFile> f, mFolder->items())
-	{
-		mChildren.append(QSharedPointer<TreeItem>(new TreeItem(f, i++, this)));
-	}
+	if (isFolder())
+		return mFolder.data();
+	return mFile.data();
 }
 
 QString TreeItem::data(int col) const
@@ -272,8 +248,112 @@ QUuid TreeItem::uuid() const
 /////////////////////////////////////////////////////
 
 FPTreeModel::FPTreeModel(QObject *parent)
-	: QAbstractItemModel(parent), mRootItem(TreeItem::makeTree())
+	: QAbstractItemModel(parent),
+	mRootItem(new TreeItem(QSharedPointer<FPDBFolder>()))
+{
+	// take whatever has been scanned so far, and follow the rest
+	FPDatabase &db = FPDatabase::instance();
+	foreach(QSharedPointer<FPDBFolder> folder, db.rootFolders())
+		addTree(mRootItem.data(), folder);
+	connect(&db, SIGNAL(folderAdded(QSharedPointer<FPDBFolder>)),
+			this, SLOT(onFolderAdded(QSharedPointer<FPDBFolder>)));
+	connect(&db, SIGNAL(folderRemoved(QSharedPointer<FPDBFolder>)),
+			this, SLOT(onFolderRemoved(QSharedPointer<FPDBFolder>)));
+	connect(&db, SIGNAL(filesAdded(QList<QSharedPointer<FPDBFile> >)),
+			this, SLOT(onFilesAdded(QList<QSharedPointer<FPDBFile> >)));
+	connect(&db, SIGNAL(fileRemoved(QSharedPointer<FPDBFile>)),
+			this, SLOT(onFileRemoved(QSharedPointer<FPDBFile>)));
+}
+
+void FPTreeModel::addTree(TreeItem *parent, QSharedPointer<FPDBFolder> folder)
+{
+	QSharedPointer<TreeItem> item(new TreeItem(folder));
+	parent->appendChild(item);
+	mItems.insert(folder.data(), item.data());
+	foreach(QSharedPointer<FPDBFolder> f, folder->folders())
+		addTree(item.data(), f);
+	foreach(QSharedPointer<FPDBFile> f, folder->items())
+	{
+		QSharedPointer<TreeItem> fileItem(new TreeItem(f));
+		item->appendChild(fileItem);
+		mItems.insert(f.data(), fileItem.data());
+	}
+}
+
+QModelIndex FPTreeModel::indexOf(TreeItem *item) const
 {
+	if (!item || item == mRootItem.data())
+		return QModelIndex();
+	return createIndex(item->row(), 0, reinterpret_cast<void*>(item));
+}
+
+void FPTreeModel::onFolderAdded(QSharedPointer<FPDBFolder> folder)
+{
+	if (mItems.contains(folder.data()))
+		return;
+	TreeItem* parent = folder->parent() ? mItems.value(folder->parent())
+										: mRootItem.data();
+	if (!parent)
+		return;
+	int row = parent->childCount();
+	beginInsertRows(indexOf(parent), row, row);
+	addTree(parent, folder);
+	endInsertRows();
+}
+
+void FPTreeModel::onFilesAdded(QList<QSharedPointer<FPDBFile> > files)
+{
+	// insert the files of each folder in one go
+	QHash<TreeItem*, QList<QSharedPointer<FPDBFile> > > byParent;
+	foreach(QSharedPointer<FPDBFile> f, files)
+	{
+		TreeItem* parent = mItems.value(f->parent());
+		if (parent && !mItems.contains(f.data()))
+			byParent[parent].append(f);
+	}
+	QHash<TreeItem*, QList<QSharedPointer<FPDBFile> > >::const_iterator i;
+	for(i = byParent.constBegin(); i != byParent.constEnd(); ++i)
+	{
+		TreeItem* parent = i.key();
+		int first = parent->childCount();
+		beginInsertRows(indexOf(parent), first, first + i.value().size() - 1);
+		foreach(QSharedPointer<FPDBFile> f, i.value())
+		{
+			QSharedPointer<TreeItem> item(new TreeItem(f));
+			parent->appendChild(item);
+			mItems.insert(f.data(), item.data());
+		}
+		endInsertRows();
+	}
+}
+
+void FPTreeModel::onFolderRemoved(QSharedPointer<FPDBFolder> folder)
+{
+	removeItem(mItems.value(folder.data()));
+}
+
+void FPTreeModel::onFileRemoved(QSharedPointer<FPDBFile> file)
+{
+	removeItem(mItems.value(file.data()));
+}
+
+void FPTreeModel::removeItem(TreeItem *item)
+{
+	if (!item)
+		return;
+	TreeItem* parent = item->parent();
+	int row = item->row();
+	beginRemoveRows(indexOf(parent), row, row);
+	forget(item);
+	parent->removeChild(row);
+	endRemoveRows();
+}
+
+void FPTreeModel::forget(TreeItem *item)
+{
+	mItems.remove(item->key());
+	for(int i = 0; i < item->childCount(); i++)
+		forget(item->child(i));
 }
 
 QModelIndex FPTreeModel::index(int row, int column,
@@ -299,11 +379,7 @@ QModelIndex FPTreeModel::parent(const QModelIndex &child) const
 		return QModelIndex();
 	TreeItem* item = reinterpret_cast<TreeItem*>(
 				child.internalPointer());
-	if (!item->parent())
-		return QModelIndex();
-	else
-		return createIndex(item->parent()->row(), 0,
-						   reinterpret_cast<void*>(item->parent()));
+	return indexOf(item->parent());
 }
 
 int FPTreeModel::rowCount(const QModelIndex &parent) const
@@ -372,6 +448,14 @@ QString FPTreeModel::path(const QModelIndex& index) const
 	return QString();
 }
 
+const void* FPTreeModel::key(const QModelIndex& index) const
+{
+	if (index.isValid())
+		return reinterpret_cast<TreeItem*>(
+					index.internalPointer())->key();
+	return NULL;
+}
+
 QUuid FPTreeModel::uuid(const QModelIndex& index) const
 {
 	if (index.isValid())
@@ -379,3 +463,47 @@ QUuid FPTreeModel::uuid(const QModelIndex& index) const
 					index.internalPointer())->uuid();
 	return QUuid();
 }
+
+/////////////////////////////////////////////////////
+
+bool FPProxyModel::lessThan(const QModelIndex &left,
+							const QModelIndex &right) const
+{
+	FPTreeModel* model = static_cast<FPTreeModel*>(sourceModel());
+	bool leftFolder = model->isFolder(left);
+	if (leftFolder != model->isFolder(right))
+		return leftFolder;
+	return QString::localeAwareCompare(left.data().toString(),
+									   right.data().toString()) < 0;
+}
+
+void FPProxyModel::setFilter(const QSet<const FPDBFile*> &files)
+{
+	mAccepted.clear();
+	foreach(const FPDBFile* f, files)
+	{
+		mAccepted.insert(f);
+		for(FPDBFolder* p = f->parent(); p && !mAccepted.contains(p);
+			p = p->parent())
+			mAccepted.insert(p);
+	}
+	mFiltered = true;
+	invalidateFilter();
+}
+
+void FPProxyModel::clearFilter()
+{
+	if (!mFiltered)
+		return;
+	mFiltered = false;
+	mAccepted.clear();
+	invalidateFilter();
+}
+
+bool FPProxyModel::filterAcceptsRow(int row, const QModelIndex &parent) const
+{
+	if (!mFiltered)
+		return true;
+	FPTreeModel* model = static_cast<FPTreeModel*>(sourceModel());
+	return mAccepted.contains(model->key(model->index(row, 0, parent)));
+}
@@ -21,35 +21,34 @@
 #define SELECTFPDIALOG_H
 
 #include <QUuid>
+#include <QSortFilterProxyModel>
 #include "Footprint.h"
 #include "Document.h"
 #include "ui_SelectFPDialog.h"
 
+/// Shows a preview of a footprint.  The previews are kept in
+/// FPPreviewCache.
 class FootprintPreview : public QWidget
 {
 public:
 	explicit FootprintPreview(QWidget* parent = 0);
 
-	void showFootprint(QString path);
+	void showFootprint(QString path, QUuid uuid);
 
 protected:
 	virtual void paintEvent(QPaintEvent *);
-	virtual void resizeEvent(QResizeEvent *) { mIsDirty = true; }
 
 private:
-	void updateTransform();
-
-	QSharedPointer<FPDoc> mDoc;
-	QRect mBbox;
-	QTransform mTransform;
-	bool mIsDirty;
+	QString mPath;
+	QUuid mUuid;
 
 };
 
 class TreeItem
 {
 public:
-	static QSharedPointer<TreeItem> makeTree();
+	TreeItem(QSharedPointer<FPDBFolder> folder, TreeItem* parent = NULL);
+	TreeItem(QSharedPointer<FPDBFile> file, TreeItem* parent = NULL);
 
 	bool isFolder() const { return !mFolder.isNull(); }
 	int row() const { return mRow; }
@@ -59,12 +58,13 @@ public:
 	QString data(int col) const;
 	QString path() const;
 	QUuid uuid() const;
-private:
-	TreeItem(QSharedPointer<FPDBFolder> folder, int row = 0,
-			 TreeItem* parent = NULL);
-	TreeItem(QSharedPointer<FPDBFile> file, int row = 0,
-			 TreeItem* parent = NULL);
+	/// Returns the database folder or file shown by this item
+	const void* key() const;
+
+	void appendChild(QSharedPointer<TreeItem> item);
+	void removeChild(int row);
 
+private:
 	QSharedPointer<FPDBFolder> mFolder;
 	QSharedPointer<FPDBFile> mFile;
 	int mRow;
@@ -72,8 +72,13 @@ private:
 	QList<QSharedPointer<TreeItem> > mChildren;
 };
 
+/// Tree model of the footprint library.  The model follows the footprint
+/// database as it is scanned and updated; new items are always appended,
+/// use FPProxyModel to sort them.
 class FPTreeModel : public QAbstractItemModel
 {
+	Q_OBJECT
+
 public:
 	FPTreeModel(QObject *parent = NULL);
 
@@ -94,10 +99,49 @@ public:
 	QUuid uuid(const QModelIndex& index) const;
 	/// Returns true if this is a folder
 	bool isFolder(const QModelIndex& index) const;
+	/// Returns the database folder or file at the index
+	const void* key(const QModelIndex& index) const;
+
+private slots:
+	void onFolderAdded(QSharedPointer<FPDBFolder> folder);
+	void onFolderRemoved(QSharedPointer<FPDBFolder> folder);
+	void onFilesAdded(QList<QSharedPointer<FPDBFile> > files);
+	void onFileRemoved(QSharedPointer<FPDBFile> file);
 
 private:
+	QModelIndex indexOf(TreeItem* item) const;
+	/// Adds a folder and everything in it
+	void addTree(TreeItem* parent, QSharedPointer<FPDBFolder> folder);
+	void removeItem(TreeItem* item);
+	/// Removes an item and its children from the item hash
+	void forget(TreeItem* item);
+
 	QSharedPointer<TreeItem> mRootItem;
+	/// Items of the database folders and files
+	QHash<const void*, TreeItem*> mItems;
+};
+
+/// Sorts the footprint tree by name, with folders first, and filters it
+/// by the results of a search.
+class FPProxyModel : public QSortFilterProxyModel
+{
+public:
+	FPProxyModel(QObject *parent = NULL)
+		: QSortFilterProxyModel(parent), mFiltered(false) {}
 
+	/// Shows only the given footprints and the folders containing them.
+	void setFilter(const QSet<const FPDBFile*> &files);
+	void clearFilter();
+
+protected:
+	virtual bool lessThan(const QModelIndex &left,
+						  const QModelIndex &right) const;
+	virtual bool filterAcceptsRow(int row, const QModelIndex &parent) const;
+
+private:
+	bool mFiltered;
+	/// Files and folders to show
+	QSet<const void*> mAccepted;
 };
 
 class SelectFPDialog : public QDialog, private Ui::SelectFPDialog
@@ -108,12 +152,13 @@ public:
 	explicit SelectFPDialog(QWidget *parent = 0);
 
 	bool isFpSelected() const { return mFpIndex.isValid(); }
-	QUuid uuid() const { return mModel.uuid(mFpIndex); }
-	QString path() const { return mModel.path(mFpIndex); }
+	QUuid uuid() const { return mModel.uuid(mProxy.mapToSource(mFpIndex)); }
+	QString path() const { return mModel.path(mProxy.mapToSource(mFpIndex)); }
 
 private slots:
 	void onSelChanged(const QModelIndex & current,
 					  const QModelIndex & previous);
+	void updateFilter();
 
 protected:
 	virtual void accept();
@@ -123,8 +168,11 @@ protected:
 private:
 	void saveGeom();
 	void loadGeom();
+	/// Prefetches the previews of the footprints next to the current one
+	void prefetchNeighbors(const QModelIndex &current);
 
 	FPTreeModel mModel;
+	FPProxyModel mProxy;
 	FootprintPreview mPreview;
 	QVBoxLayout* mPreviewLayout;
 	QPersistentModelIndex mFpIndex;
@@ -0,0 +1,517 @@
+/*
+	Copyright (C) 2010-2011 Igor Izyumin
+
+	This file is part of xpcb.
+
+	xpcb is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	xpcb is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with xpcb.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QtAlgorithms>
+#include <cmath>
+#include "SpatialIndex.h"
+
+// Bounding box of two rectangles.  Empty rectangles (such as the bbox of
+// an unattached segment) do not contribute.
+static inline QRect unite(const QRect &a, const QRect &b)
+{
+	if (!b.isValid())
+		return a;
+	if (!a.isValid())
+		return b;
+	return a | b;
+}
+
+// Areas are computed in floating point, since board coordinates
+// are large enough to overflow a 64-bit product.
+static inline double area(const QRect &r)
+{
+	return r.isValid() ? double(r.width()) * double(r.height()) : 0.0;
+}
+
+void SpatialIndex::Node::recalcBBox()
+{
+	bbox = QRect();
+	for(int i = 0; i < count(); i++)
+		bbox = unite(bbox, itemRect(i));
+}
+
+SpatialIndex::SpatialIndex()
+	: mRoot(new Node(true))
+{
+}
+
+SpatialIndex::~SpatialIndex()
+{
+	delete mRoot;
+}
+
+void SpatialIndex::clear()
+{
+	delete mRoot;
+	mRoot = new Node(true);
+	mLeaves.clear();
+}
+
+QRect SpatialIndex::indexedRect(const PCBObject *obj) const
+{
+	Node* leaf = mLeaves.value(obj, NULL);
+	if (!leaf)
+		return QRect();
+	foreach(const Entry &e, leaf->entries)
+	{
+		if (e.obj.data() == obj)
+			return e.rect;
+	}
+	return QRect();
+}
+
+QList<QSharedPointer<PCBObject> > SpatialIndex::query(const QRect &rect) const
+{
+	QList<QSharedPointer<PCBObject> > out;
+	QVector<const Node*> stack;
+	stack.append(mRoot);
+	while(!stack.isEmpty())
+	{
+		const Node* n = stack.last();
+		stack.pop_back();
+		if (!n->bbox.intersects(rect))
+			continue;
+		if (n->leaf)
+		{
+			foreach(const Entry &e, n->entries)
+			{
+				if (e.rect.intersects(rect))
+					out.append(e.obj);
+			}
+		}
+		else
+		{
+			foreach(const Node* c, n->children)
+				stack.append(c);
+		}
+	}
+	return out;
+}
+
+void SpatialIndex::insert(QSharedPointer<PCBObject> obj)
+{
+	if (mLeaves.contains(obj.data()))
+	{
+		update(obj);
+		return;
+	}
+	Entry e;
+	e.rect = obj->bbox();
+	e.obj = obj;
+	insertEntry(e);
+}
+
+bool SpatialIndex::remove(const PCBObject *obj)
+{
+	Node* leaf = mLeaves.take(obj);
+	if (!leaf)
+		return false;
+	for(int i = 0; i < leaf->entries.size(); i++)
+	{
+		if (leaf->entries[i].obj.data() == obj)
+		{
+			leaf->entries.remove(i);
+			break;
+		}
+	}
+	condenseTree(leaf);
+	return true;
+}
+
+bool SpatialIndex::update(QSharedPointer<PCBObject> obj)
+{
+	Node* leaf = mLeaves.value(obj.data(), NULL);
+	if (!leaf)
+		return false;
+	QRect r = obj->bbox();
+	for(int i = 0; i < leaf->entries.size(); i++)
+	{
+		if (leaf->entries[i].obj != obj)
+			continue;
+		if (leaf->entries[i].rect == r)
+			return true;
+		// shrinking in place keeps the tree valid; anything else is
+		// handled by reinserting the entry
+		if (leaf->bbox.contains(r) || !r.isValid())
+		{
+			leaf->entries[i].rect = r;
+			for(Node* n = leaf; n; n = n->parent)
+				n->recalcBBox();
+			return true;
+		}
+		break;
+	}
+	remove(obj.data());
+	Entry e;
+	e.rect = r;
+	e.obj = obj;
+	insertEntry(e);
+	return true;
+}
+
+void SpatialIndex::insertEntry(const Entry &e)
+{
+	Node* leaf = chooseLeaf(e.rect);
+	leaf->entries.append(e);
+	mLeaves.insert(e.obj.data(), leaf);
+	adjustTree(leaf);
+}
+
+SpatialIndex::Node* SpatialIndex::chooseLeaf(const QRect &rect) const
+{
+	Node* n = mRoot;
+	while(!n->leaf)
+	{
+		Node* best = NULL;
+		double bestGrowth = 0, bestArea = 0;
+		foreach(Node* c, n->children)
+		{
+			double a = area(c->bbox);
+			double growth = area(unite(c->bbox, rect)) - a;
+			if (!best || growth < bestGrowth
+				|| (growth == bestGrowth && a < bestArea))
+			{
+				best = c;
+				bestGrowth = growth;
+				bestArea = a;
+			}
+		}
+		n = best;
+	}
+	return n;
+}
+
+void SpatialIndex::adjustTree(Node *node)
+{
+	while(node)
+	{
+		if (node->count() <= MaxEntries)
+		{
+			node->recalcBBox();
+			node = node->parent;
+			continue;
+		}
+		Node* sibling = split(node);
+		if (node == mRoot)
+		{
+			Node* root = new Node(false);
+			root->children.append(node);
+			root->children.append(sibling);
+			node->parent = root;
+			sibling->parent = root;
+			root->recalcBBox();
+			mRoot = root;
+			return;
+		}
+		sibling->parent = node->parent;
+		node->parent->children.append(sibling);
+		node = node->parent;
+	}
+}
+
+/// Splits an overfull node using Guttman's quadratic split.  The node keeps
+/// one group of items; the returned sibling gets the other.
+SpatialIndex::Node* SpatialIndex::split(Node *node)
+{
+	const int n = node->count();
+	QVector<QRect> rects(n);
+	for(int i = 0; i < n; i++)
+		rects[i] = node->itemRect(i);
+
+	// pick the two items that would waste the most area if grouped together
+	int seed1 = 0, seed2 = 1;
+	double worst = -1;
+	for(int i = 0; i < n; i++)
+	{
+		for(int j = i + 1; j < n; j++)
+		{
+			double d = area(unite(rects[i], rects[j]))
+					   - area(rects[i]) - area(rects[j]);
+			if (d > worst)
+			{
+				worst = d;
+				seed1 = i;
+				seed2 = j;
+			}
+		}
+	}
+
+	// group[i] is 0 or 1 once assigned, -1 before
+	QVector<int> group(n, -1);
+	group[seed1] = 0;
+	group[seed2] = 1;
+	QRect bb[2] = { rects[seed1], rects[seed2] };
+	int size[2] = { 1, 1 };
+	int remaining = n - 2;
+
+	while(remaining > 0)
+	{
+		// if one group needs all of the remaining items to reach the
+		// minimum fill, it gets them
+		int forced = -1;
+		if (size[0] + remaining == MinEntries)
+			forced = 0;
+		else if (size[1] + remaining == MinEntries)
+			forced = 1;
+		if (forced >= 0)
+		{
+			for(int i = 0; i < n; i++)
+			{
+				if (group[i] < 0)
+				{
+					group[i] = forced;
+					bb[forced] = unite(bb[forced], rects[i]);
+					size[forced]++;
+				}
+			}
+			break;
+		}
+
+		// otherwise assign the item with the strongest preference
+		int next = -1;
+		double bestDiff = -1, d0 = 0, d1 = 0;
+		for(int i = 0; i < n; i++)
+		{
+			if (group[i] >= 0)
+				continue;
+			double g0 = area(unite(bb[0], rects[i])) - area(bb[0]);
+			double g1 = area(unite(bb[1], rects[i])) - area(bb[1]);
+			double diff = std::fabs(g0 - g1);
+			if (diff > bestDiff)
+			{
+				bestDiff = diff;
+				next = i;
+				d0 = g0;
+				d1 = g1;
+			}
+		}
+		int g;
+		if (d0 != d1)
+			g = d0 < d1 ? 0 : 1;
+		else if (area(bb[0]) != area(bb[1]))
+			g = area(bb[0]) < area(bb[1]) ? 0 : 1;
+		else
+			g = size[0] <= size[1] ? 0 : 1;
+		group[next] = g;
+		bb[g] = unite(bb[g], rects[next]);
+		size[g]++;
+		remaining--;
+	}
+
+	Node* sibling = new Node(node->leaf);
+	if (node->leaf)
+	{
+		QVector<Entry> keep;
+		for(int i = 0; i < n; i++)
+		{
+			if (group[i] == 0)
+				keep.append(node->entries[i]);
+			else
+			{
+				sibling->entries.append(node->entries[i]);
+				mLeaves.insert(node->entries[i].obj.data(), sibling);
+			}
+		}
+		node->entries = keep;
+	}
+	else
+	{
+		QVector<Node*> keep;
+		for(int i = 0; i < n; i++)
+		{
+			if (group[i] == 0)
+				keep.append(node->children[i]);
+			else
+			{
+				sibling->children.append(node->children[i]);
+				node->children[i]->parent = sibling;
+			}
+		}
+		node->children = keep;
+	}
+	node->bbox = bb[0];
+	sibling->bbox = bb[1];
+	return sibling;
+}
+
+void SpatialIndex::condenseTree(Node *leaf)
+{
+	QVector<Entry> orphans;
+	Node* n = leaf;
+	while(n != mRoot)
+	{
+		Node* parent = n->parent;
+		if (n->count() < MinEntries)
+		{
+			// dissolve the underfull node and reinsert its contents
+			parent->children.remove(parent->children.indexOf(n));
+			collectEntries(n, orphans);
+			delete n;
+		}
+		else
+			n->recalcBBox();
+		n = parent;
+	}
+	mRoot->recalcBBox();
+
+	// shorten the tree if the root has a single child
+	while(!mRoot->leaf && mRoot->children.size() <= 1)
+	{
+		Node* old = mRoot;
+		if (old->children.isEmpty())
+			mRoot = new Node(true);
+		else
+		{
+			mRoot = old->children.first();
+			mRoot->parent = NULL;
+			old->children.clear();
+		}
+		delete old;
+	}
+
+	foreach(const Entry &e, orphans)
+		insertEntry(e);
+}
+
+void SpatialIndex::collectEntries(Node *node, QVector<Entry> &out) const
+{
+	if (node->leaf)
+		out += node->entries;
+	else
+	{
+		foreach(Node* c, node->children)
+			collectEntries(c, out);
+	}
+}
+
+///////////////////////// BULK LOADING /////////////////////////
+
+namespace
+{
+/// Orders item indices by the x or y center of their rectangles.
+class CenterLess
+{
+public:
+	CenterLess(const QVector<QRect> &rects, bool byX)
+		: mRects(rects), mByX(byX) {}
+
+	bool operator()(int a, int b) const
+	{
+		const QRect &ra = mRects[a];
+		const QRect &rb = mRects[b];
+		if (mByX)
+			return qint64(ra.left()) + ra.right() < qint64(rb.left()) + rb.right();
+		else
+			return qint64(ra.top()) + ra.bottom() < qint64(rb.top()) + rb.bottom();
+	}
+
+private:
+	const QVector<QRect> &mRects;
+	bool mByX;
+};
+}
+
+/// Sort-Tile-Recursive ordering.  Items are sorted into vertical slices by
+/// x center, then each slice is sorted by y center, so that consecutive
+/// runs of nodeSize items are spatially compact.  Returns the item order.
+static QVector<int> strOrder(const QVector<QRect> &rects, int nodeSize)
+{
+	const int n = rects.size();
+	QVector<int> order(n);
+	for(int i = 0; i < n; i++)
+		order[i] = i;
+
+	const int numNodes = (n + nodeSize - 1) / nodeSize;
+	const int numSlices = int(std::ceil(std::sqrt(double(numNodes))));
+	const int sliceSize = numSlices * nodeSize;
+
+	qSort(order.begin(), order.end(), CenterLess(rects, true));
+	for(int start = 0; start < n; start += sliceSize)
+	{
+		int end = start + sliceSize < n ? start + sliceSize : n;
+		qSort(order.begin() + start, order.begin() + end, CenterLess(rects, false));
+	}
+	return order;
+}
+
+void SpatialIndex::load(const QList<QSharedPointer<PCBObject> > &objs)
+{
+	clear();
+	if (objs.isEmpty())
+		return;
+
+	QVector<Entry> entries;
+	QVector<QRect> rects;
+	entries.reserve(objs.size());
+	rects.reserve(objs.size());
+	foreach(QSharedPointer<PCBObject> obj, objs)
+	{
+		if (mLeaves.contains(obj.data()))
+			continue;
+		Entry e;
+		e.rect = obj->bbox();
+		e.obj = obj;
+		entries.append(e);
+		rects.append(e.rect);
+		mLeaves.insert(obj.data(), NULL);
+	}
+
+	// pack the leaves
+	QVector<int> order = strOrder(rects, MaxEntries);
+	QVector<Node*> level;
+	for(int i = 0; i < order.size(); i += MaxEntries)
+	{
+		Node* leaf = new Node(true);
+		for(int j = i; j < order.size() && j < i + MaxEntries; j++)
+		{
+			const Entry &e = entries[order[j]];
+			leaf->entries.append(e);
+			mLeaves[e.obj.data()] = leaf;
+		}
+		leaf->recalcBBox();
+		level.append(leaf);
+	}
+
+	// then pack each level of internal nodes until a single root remains
+	while(level.size() > 1)
+	{
+		rects.resize(level.size());
+		for(int i = 0; i < level.size(); i++)
+			rects[i] = level[i]->bbox;
+		order = strOrder(rects, MaxEntries);
+
+		QVector<Node*> upper;
+		for(int i = 0; i < order.size(); i += MaxEntries)
+		{
+			Node* n = new Node(false);
+			for(int j = i; j < order.size() && j < i + MaxEntries; j++)
+			{
+				Node* c = level[order[j]];
+				c->parent = n;
+				n->children.append(c);
+			}
+			n->recalcBBox();
+			upper.append(n);
+		}
+		level = upper;
+	}
+
+	delete mRoot;
+	mRoot = level.first();
+}
@@ -0,0 +1,111 @@
+/*
+	Copyright (C) 2010-2011 Igor Izyumin
+
+	This file is part of xpcb.
+
+	xpcb is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	xpcb is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with xpcb.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SPATIALINDEX_H
+#define SPATIALINDEX_H
+
+#include <QRect>
+#include <QList>
+#include <QVector>
+#include <QHash>
+#include <QSharedPointer>
+#include "PCBObject.h"
+
+/// An R-tree of PCB objects, keyed by bounding box.
+
+/// SpatialIndex answers rectangle queries in roughly O(log n + k) time.  The
+/// tree stores the bounding box each object had when it was inserted; when an
+/// object is moved or resized, update() must be called to refresh its entry.
+/// A large set of objects should be loaded with load(), which packs the tree
+/// using the Sort-Tile-Recursive algorithm and is much faster than inserting
+/// the objects one at a time.
+class SpatialIndex
+{
+public:
+	SpatialIndex();
+	~SpatialIndex();
+
+	/// Removes all objects from the index.
+	void clear();
+	/// Replaces the contents of the index with the given objects.
+	void load(const QList<QSharedPointer<PCBObject> > &objs);
+
+	/// Adds an object to the index.  If the object is already present, its
+	/// entry is updated instead.
+	void insert(QSharedPointer<PCBObject> obj);
+	/// Removes an object from the index.  Returns false if it was not present.
+	bool remove(const PCBObject* obj);
+	/// Refreshes the entry of an object whose bounding box has changed.
+	/// Returns false if the object is not in the index.
+	bool update(QSharedPointer<PCBObject> obj);
+
+	/// Returns true if the object is in the index.
+	bool contains(const PCBObject* obj) const { return mLeaves.contains(obj); }
+	/// Returns the bounding box that the object is indexed under.
+	QRect indexedRect(const PCBObject* obj) const;
+	/// Returns the number of objects in the index.
+	int size() const { return mLeaves.size(); }
+
+	/// Returns all objects whose indexed bounding box intersects rect.
+	QList<QSharedPointer<PCBObject> > query(const QRect &rect) const;
+
+private:
+	struct Entry
+	{
+		QRect rect;
+		QSharedPointer<PCBObject> obj;
+	};
+
+	struct Node
+	{
+		Node(bool isLeaf) : leaf(isLeaf), parent(NULL) {}
+		~Node() { qDeleteAll(children); }
+
+		int count() const { return leaf ? entries.size() : children.size(); }
+		QRect itemRect(int i) const { return leaf ? entries[i].rect : children[i]->bbox; }
+		void recalcBBox();
+
+		QRect bbox;
+		bool leaf;
+		Node* parent;
+		QVector<Node*> children;
+		QVector<Entry> entries;
+	};
+
+	/// Maximum number of items in a node.
+	static const int MaxEntries = 16;
+	/// Minimum number of items in a non-root node.
+	static const int MinEntries = 6;
+
+	SpatialIndex(const SpatialIndex&);
+	SpatialIndex& operator=(const SpatialIndex&);
+
+	void insertEntry(const Entry &e);
+	Node* chooseLeaf(const QRect &rect) const;
+	void adjustTree(Node* node);
+	Node* split(Node* node);
+	void condenseTree(Node* leaf);
+	void collectEntries(Node* node, QVector<Entry> &out) const;
+
+	Node* mRoot;
+	/// Maps each object to the leaf that holds its entry.
+	QHash<const PCBObject*, Node*> mLeaves;
+};
+
+#endif // SPATIALINDEX_H
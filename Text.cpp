@@ -20,6 +20,8 @@
 #include <QXmlStreamReader>
 #include <QXmlStreamWriter>
 #include <QMouseEvent>
+#include <QPainterPathStroker>
+#include <QImage>
 #include "Text.h"
 #include "Log.h"
 #include "smfontutil.h"
@@ -27,10 +29,12 @@
 #include "PCBView.h"
 #include "Document.h"
 #include "EditTextDialog.h"
+#include "XmlAttr.h"
 
 Text::Text(QObject* parent)
 	: PCBObject(parent), mAngle(0), mIsMirrored(false), mIsNegative(false),
-	mFontSize(XPcb::milToPcb(100)), mStrokeWidth(XPcb::milToPcb(10)), mIsDirty(true)
+	mFontSize(XPcb::milToPcb(100)), mStrokeWidth(XPcb::milToPcb(10)), mIsDirty(true),
+	mTransformDirty(true)
 {
 }
 
@@ -38,7 +42,8 @@ Text::Text( const QPoint &pos, int angle, bool mirror,
 			bool negative, const Layer& layer, int font_size, int stroke_width,
 			const QString &str, QObject* parent) :
 PCBObject(parent), mPos(pos), mLayer(layer), mAngle(angle), mIsMirrored(mirror), mIsNegative(negative),
-mFontSize(font_size), mStrokeWidth(stroke_width), mText(str), mIsDirty(true)
+mFontSize(font_size), mStrokeWidth(stroke_width), mText(str), mIsDirty(true),
+mTransformDirty(true)
 {
 
 }
@@ -57,13 +62,39 @@ void Text::setPos(const QPoint &newpos)
 	if (p)
 		mPos = p->transform().inverted().map(newpos);
 	else mPos = newpos;
-	changed();
+	moved();
+}
+
+/// Makes a path safe to draw from several threads at once.  QPainterPath
+/// computes its bounds, and the form the paint engine draws, the first time
+/// they are needed; drawing the path once fills in both.
+static void warmPath(const QPainterPath &path)
+{
+	path.boundingRect();
+	path.controlPointRect();
+	QImage img(1, 1, QImage::Format_ARGB32_Premultiplied);
+	QPainter painter(&img);
+	painter.drawPath(path);
 }
 
 void Text::rebuild() const
 {
-	SMFontUtil::instance().GetStrokes(text(), fontSize(), strokeWidth(),
-									  mStrokes, mStrokeBBox);
+	// the strokes are laid out in the text's own coordinates, so moving
+	// the text or its parent only changes the transform
+	if (mIsDirty)
+	{
+		QList<QPainterPath> strokes;
+		SMFontUtil::instance().GetStrokes(text(), fontSize(), strokeWidth(),
+										  strokes, mStrokeBBox);
+		mPath = QPainterPath();
+		foreach(const QPainterPath& stroke, strokes)
+			mPath.addPath(stroke);
+		warmPath(mPath);
+		mIsDirty = false;
+	}
+	if (!mTransformDirty)
+		return;
+	mTransformDirty = false;
 	double yoffset = 9.0*mFontSize/22.0;
 	PCBObject* p = dynamic_cast<PCBObject*>(parent());
 	if (p)
@@ -79,25 +110,38 @@ void Text::rebuild() const
 
 QRect Text::bbox() const
 {
-	if (mIsDirty)
-	{
+	if (mIsDirty || mTransformDirty)
 		rebuild();
-		mIsDirty = false;
-	}
 	return mTransform.mapRect(this->mStrokeBBox);
 }
 
+QPainterPath Text::outline(bool simple) const
+{
+	if (mIsDirty || mTransformDirty)
+		rebuild();
+
+	QPainterPath path;
+	if (simple)
+	{
+		path.addRect(mStrokeBBox);
+	}
+	else
+		path = mPath;
+	QPainterPathStroker stroker;
+	stroker.setWidth(mStrokeWidth);
+	stroker.setCapStyle(Qt::RoundCap);
+	stroker.setJoinStyle(Qt::RoundJoin);
+	return mTransform.map(stroker.createStroke(path));
+}
+
 void Text::draw(QPainter *painter, const Layer& layer) const
 {
 	if (layer != mLayer && layer != Layer::LAY_SELECTION)
 		return;
 
 	// reload strokes if text has changed
-	if (mIsDirty)
-	{
+	if (mIsDirty || mTransformDirty)
 		rebuild();
-		mIsDirty = false;
-	}
 
 	// save the painter state
 	painter->save();
@@ -111,10 +155,19 @@ void Text::draw(QPainter *painter, const Layer& layer) const
 	painter->setPen(pen);
 	painter->setBrush(Qt::NoBrush);
 
-	// now draw strokes
-	foreach(const QPainterPath& path, this->mStrokes)
+	XPcb::LOD lod = XPcb::lod(painter);
+	if (lod == XPcb::LOD_SIMPLE)
+	{
+		// the glyphs wouldn't be legible anyway
+		pen.setWidth(0);
+		painter->setPen(pen);
+		painter->drawRect(mStrokeBBox);
+	}
+	else if (lod == XPcb::LOD_FULL)
 	{
-		painter->drawPath(path);
+		// several tile threads may draw the path at once; rebuild() has
+		// warmed it, and bbox() has been called on the GUI thread
+		painter->drawPath(mPath);
 	}
 
 	// restore painter state
@@ -123,19 +176,20 @@ void Text::draw(QPainter *painter, const Layer& layer) const
 
 QSharedPointer<Text> Text::newFromXML(QXmlStreamReader &reader)
 {
-	Q_ASSERT(reader.isStartElement() && reader.name() == "text");
+	Q_ASSERT(reader.isStartElement() && Xml::is(reader.name(), "text"));
 
 	QXmlStreamAttributes attr = reader.attributes();
 	QSharedPointer<Text> t(new Text());
-	t->mLayer = Layer(attr.value("layer").toString().toInt());
+	t->mLayer = Layer(Xml::intAttr(attr, "layer"));
 	t->mPos = QPoint(
-			attr.value("x").toString().toInt(),
-			attr.value("y").toString().toInt());
-	t->mAngle = attr.value("rot").toString().toInt();
-	t->mStrokeWidth = attr.value("lineWidth").toString().toInt();
-	t->mFontSize = attr.value("textSize").toString().toInt();
+			Xml::intAttr(attr, "x"),
+			Xml::intAttr(attr, "y"));
+	t->mAngle = Xml::intAttr(attr, "rot");
+	t->mStrokeWidth = Xml::intAttr(attr, "lineWidth");
+	t->mFontSize = Xml::intAttr(attr, "textSize");
 	t->mText = reader.readElementText();
 	t->mIsDirty = true;
+	t->mTransformDirty = true;
 
 	return t;
 }
@@ -0,0 +1,111 @@
+/*
+	Copyright (C) 2010-2011 Igor Izyumin
+
+	This file is part of xpcb.
+
+	xpcb is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	xpcb is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with xpcb.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "TileCache.h"
+#include <QVector>
+#include <QPair>
+#include <QtAlgorithms>
+
+/// Returns the memory used by a tile.  Empty tiles still take up a hash entry.
+static int tileCost(const QImage &image)
+{
+	return image.byteCount() + 64;
+}
+
+TileCache::TileCache(int tileSize, int maxBytes)
+	: mTileSize(tileSize), mMaxBytes(maxBytes), mBytes(0), mClock(0)
+{
+}
+
+const QImage* TileCache::tile(const Key &key)
+{
+	QHash<Key, Tile>::iterator i = mTiles.find(key);
+	if (i == mTiles.end())
+		return NULL;
+	i->lastUsed = ++mClock;
+	return &i->image;
+}
+
+void TileCache::insert(const Key &key, const QImage &image, const QRect &area)
+{
+	QHash<Key, Tile>::iterator i = mTiles.find(key);
+	if (i != mTiles.end())
+		mBytes -= tileCost(i->image);
+	Tile t;
+	t.image = image;
+	t.area = area;
+	t.lastUsed = ++mClock;
+	mTiles.insert(key, t);
+	mBytes += tileCost(image);
+	if (mBytes > mMaxBytes)
+		evict();
+}
+
+void TileCache::invalidate(const QRect &area)
+{
+	QHash<Key, Tile>::iterator i = mTiles.begin();
+	while (i != mTiles.end())
+	{
+		if (i->area.intersects(area))
+		{
+			mBytes -= tileCost(i->image);
+			i = mTiles.erase(i);
+		}
+		else
+			++i;
+	}
+}
+
+void TileCache::clear()
+{
+	mTiles.clear();
+	mBytes = 0;
+}
+
+void TileCache::evict()
+{
+	// drop tiles down to 3/4 of the budget so that eviction does not run
+	// on every insert once the cache is full
+	QVector<QPair<quint32, int> > ages;
+	ages.reserve(mTiles.size());
+	foreach(const Tile &t, mTiles)
+		ages.append(qMakePair(t.lastUsed, tileCost(t.image)));
+	qSort(ages);
+
+	int target = mMaxBytes / 4 * 3;
+	int bytes = mBytes;
+	quint32 cutoff = 0;
+	for (int i = 0; i < ages.size() && bytes > target; i++)
+	{
+		cutoff = ages[i].first;
+		bytes -= ages[i].second;
+	}
+
+	QHash<Key, Tile>::iterator i = mTiles.begin();
+	while (i != mTiles.end())
+	{
+		if (i->lastUsed <= cutoff)
+		{
+			mBytes -= tileCost(i->image);
+			i = mTiles.erase(i);
+		}
+		else
+			++i;
+	}
+}
@@ -0,0 +1,101 @@
+/*
+	Copyright (C) 2010-2011 Igor Izyumin
+
+	This file is part of xpcb.
+
+	xpcb is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	xpcb is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with xpcb.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef TILECACHE_H
+#define TILECACHE_H
+
+#include <QImage>
+#include <QRect>
+#include <QHash>
+
+/// A cache of rendered view tiles.
+
+/// The view is divided into square tiles of tileSize() pixels, aligned to the
+/// world origin at the current zoom level so that panning does not move the
+/// tile grid.  Each layer is rendered into its own set of tiles: toggling
+/// layer visibility or changing the active layer only changes how the tiles
+/// are composited.  A tile is dropped when any part of the area it was
+/// rendered from is invalidated, and the least recently used tiles are
+/// evicted once the cache grows past its memory budget.
+class TileCache
+{
+public:
+	/// Identifies a tile.  Tiles are keyed by the exact view scale; x and y
+	/// are tile indices at that scale.
+	struct Key
+	{
+		Key(int layer = 0, double scale = 0, int x = 0, int y = 0)
+			: layer(layer), scale(scale), x(x), y(y) {}
+		bool operator==(const Key &other) const
+		{
+			return layer == other.layer && scale == other.scale
+					&& x == other.x && y == other.y;
+		}
+
+		int layer;
+		double scale;
+		int x;
+		int y;
+	};
+
+	/// Creates a cache of tileSize x tileSize pixel tiles that uses at most
+	/// maxBytes of image memory.
+	explicit TileCache(int tileSize = 256, int maxBytes = 128*1024*1024);
+
+	int tileSize() const { return mTileSize; }
+
+	/// Returns the cached tile for key, or NULL if it is not cached.  A null
+	/// image means that nothing was drawn in the tile.  The pointer is only
+	/// valid until the cache is modified.
+	const QImage* tile(const Key &key);
+	/// Stores a tile.  area is the world rectangle that the tile was rendered
+	/// from; the tile is dropped when any part of it is invalidated.
+	void insert(const Key &key, const QImage &image, const QRect &area);
+
+	/// Drops all tiles that were rendered from any part of area.
+	void invalidate(const QRect &area);
+	/// Drops all tiles.
+	void clear();
+
+private:
+	struct Tile
+	{
+		QImage image;
+		QRect area;
+		/// Value of mClock when the tile was last used
+		quint32 lastUsed;
+	};
+
+	/// Evicts least recently used tiles until the cache is within budget.
+	void evict();
+
+	int mTileSize;
+	int mMaxBytes;
+	int mBytes;
+	quint32 mClock;
+	QHash<Key, Tile> mTiles;
+};
+
+inline uint qHash(const TileCache::Key &key)
+{
+	// few zoom levels are cached at once, so the scale is left out
+	return (uint(key.x) * 73856093u) ^ (uint(key.y) * 19349663u) ^ uint(key.layer);
+}
+
+#endif // TILECACHE_H
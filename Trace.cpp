@@ -22,6 +22,8 @@
 #include "Trace.h"
 #include "Area.h"
 #include "Document.h"
+#include "Delaunay.h"
+#include "XmlAttr.h"
 #include <QDebug>
 
 Via::Via(QPoint pos, QSharedPointer<Padstack> ps, QObject *parent)
@@ -306,7 +308,17 @@ void TraceList::addSegment(QSharedPointer<Segment> s,
 	s->setV2(v2);
 	v1->addSegment(s);
 	v2->addSegment(s);
-	mIsDirty = true;
+
+	if (!mConnValid)
+		return;
+	updateVtxIndex(v1);
+	updateVtxIndex(v2);
+	// new vertices need to be attached to pins and vias
+	if (v1->segments().count() == 1)
+		attachVertex(v1.data());
+	if (v2->segments().count() == 1)
+		attachVertex(v2.data());
+	link(v1.data(), VertexNode, v2.data(), VertexNode);
 }
 
 void TraceList::removeSegment(QSharedPointer<Segment> s)
@@ -320,14 +332,26 @@ void TraceList::removeSegment(QSharedPointer<Segment> s)
 	if (s->v1()->segments().count() == 0)
 	{
 		myVtx.remove(s->v1());
+		s->v1()->detachAll();
 	}
 
 	if (s->v2()->segments().count() == 0)
 	{
 		myVtx.remove(s->v2());
+		s->v2()->detachAll();
 	}
 
-	mIsDirty = true;
+	if (!mConnValid)
+		return;
+	updateVtxIndex(s->v1());
+	updateVtxIndex(s->v2());
+	relink(QList<const PCBObject*>() << s->v1().data() << s->v2().data());
+	QList<const PCBObject*> gone;
+	if (!myVtx.contains(s->v1()))
+		gone.append(s->v1().data());
+	if (!myVtx.contains(s->v2()))
+		gone.append(s->v2().data());
+	dropNodes(gone);
 }
 
 void TraceList::swapVtx(QSharedPointer<Segment> s,
@@ -339,6 +363,7 @@ void TraceList::swapVtx(QSharedPointer<Segment> s,
 	if (vOld->segments().count() == 0)
 	{
 		myVtx.remove(vOld);
+		vOld->detachAll();
 	}
 	if (s->v1() == vOld)
 		s->setV1(vNew);
@@ -346,9 +371,111 @@ void TraceList::swapVtx(QSharedPointer<Segment> s,
 		s->setV2(vNew);
 	myVtx.insert(vNew);
 	vNew->addSegment(s);
+
+	if (!mConnValid)
+		return;
+	updateVtxIndex(vOld);
+	updateVtxIndex(vNew);
+	if (vNew->segments().count() == 1)
+		attachVertex(vNew.data());
+	relink(QList<const PCBObject*>() << vOld.data() << vNew.data());
+	if (!myVtx.contains(vOld))
+		dropNodes(QList<const PCBObject*>() << vOld.data());
+}
+
+void TraceList::partChanged(const Part *part, bool removed)
+{
+	if (!mConnValid)
+		return;
+
+	// disconnect the pins the part had when it was last attached; the
+	// footprint (and therefore the pin list) may have changed since then
+	QList<const PCBObject*> oldPins;
+	foreach(QSharedPointer<PartPin> pin, mPartPins.take(part))
+	{
+		detachPin(pin.data());
+		mPinIndex.remove(pin.data());
+		mLivePins.remove(pin.data());
+		mRemovedPins.insert(pin.data());
+		oldPins.append(pin.data());
+	}
+	relink(oldPins);
+
+	if (!removed)
+	{
+		// the pins have moved, so their ratlines need updating even if
+		// connectivity has not changed
+		foreach(QSharedPointer<PartPin> pin, part->pins())
+		{
+			mPinIndex.insert(pin);
+			mLivePins.insert(pin.data());
+			mTouched.insert(node(pin.data(), PinNode));
+			attachPin(pin.data());
+		}
+		mPartPins.insert(part, part->pins());
+	}
+	// forget pins that did not come back
+	QList<const PCBObject*> gone;
+	foreach(const PCBObject* pin, oldPins)
+	{
+		if (!mLivePins.contains(static_cast<const PartPin*>(pin)))
+			gone.append(pin);
+	}
+	dropNodes(gone);
 }
 
+void TraceList::vertexMoved(QSharedPointer<Vertex> vtx)
+{
+	if (!mConnValid)
+		return;
+	mVtxIndex.update(vtx);
+	vtx->detachAll();
+	relink(QList<const PCBObject*>() << vtx.data());
+	attachVertex(vtx.data());
+}
+
+bool TraceList::isConnected(const PCBObject *a, const PCBObject *b) const
+{
+	if (!mConnValid)
+		rebuildConnectivity();
+	int na = mNodeIds.value(a, -1);
+	int nb = mNodeIds.value(b, -1);
+	if (na < 0 || nb < 0)
+		return a == b;
+	return mConn.connected(na, nb);
+}
+
+QSet<const PartPin*> TraceList::shortedPins() const
+{
+	update();
+	QSet<const PartPin*> out;
+	foreach(const QList<ConnGroup> &groups, mConnections)
+	{
+		foreach(const ConnGroup &cg, groups)
+			out.unite(cg.shortedPins());
+	}
+	return out;
+}
 
+void TraceList::updateIndex(QSharedPointer<Segment> s,
+							QSharedPointer<Vertex> v1,
+							QSharedPointer<Vertex> v2) const
+{
+	if (!mDoc)
+		return;
+	if (mySeg.contains(s))
+		mDoc->objectAdded(s);
+	else
+		mDoc->objectRemoved(s);
+	if (myVtx.contains(v1))
+		mDoc->objectAdded(v1);
+	else
+		mDoc->objectRemoved(v1);
+	if (myVtx.contains(v2))
+		mDoc->objectAdded(v2);
+	else
+		mDoc->objectRemoved(v2);
+}
 
 void TraceList::clear()
 {
@@ -363,29 +490,47 @@ void TraceList::clear()
 		vtx->clearSegments();
 	}
 	myVtx.clear();
+
+	mConn.clear();
+	mNodeIds.clear();
+	mNodeObjs.clear();
+	mNodeKinds.clear();
+	mDeadNodes = 0;
+	mPartPins.clear();
+	mPinIndex.clear();
+	mViaIndex.clear();
+	mVtxIndex.clear();
+	mLivePins.clear();
+	mTouched.clear();
+	mRemovedPins.clear();
+	mConnValid = false;
+	mIsDirty = true;
 }
 
 void TraceList::loadFromXml(QXmlStreamReader &reader)
 {
-	Q_ASSERT(reader.isStartElement() && reader.name() == "traces");
-	clear();
+	Staging data;
+	parseXml(reader, data);
+	load(data);
+}
+
+void TraceList::parseXml(QXmlStreamReader &reader, Staging &data)
+{
+	Q_ASSERT(reader.isStartElement() && Xml::is(reader.name(), "traces"));
 
 	// read vertices
 	reader.readNextStartElement();
-	Q_ASSERT(reader.isStartElement() && reader.name() == "vertices");
-	QHash<int, QSharedPointer<Vertex> > vmap;
+	Q_ASSERT(reader.isStartElement() && Xml::is(reader.name(), "vertices"));
 	while(reader.readNextStartElement())
 	{
-		Q_ASSERT(reader.name() == "vertex");
+		Q_ASSERT(Xml::is(reader.name(), "vertex"));
 		QXmlStreamAttributes attr = reader.attributes();
-		int id = attr.value("id").toString().toInt();
-		QPoint pt = QPoint(
-				attr.value("x").toString().toInt(),
-				attr.value("y").toString().toInt());
-
-		QSharedPointer<Vertex> v(new Vertex(pt));
-		this->myVtx.insert(v);
-		vmap.insert(id, v);
+		Staging::Vtx v;
+		v.id = Xml::intAttr(attr, "id");
+		v.pos = QPoint(
+				Xml::intAttr(attr, "x"),
+				Xml::intAttr(attr, "y"));
+		data.vertices.append(v);
 		do
 				reader.readNext();
 		while(!reader.isEndElement());
@@ -393,21 +538,17 @@ void TraceList::loadFromXml(QXmlStreamReader &reader)
 
 	// read segments
 	reader.readNextStartElement();
-	Q_ASSERT(reader.isStartElement() && reader.name() == "segments");
+	Q_ASSERT(reader.isStartElement() && Xml::is(reader.name(), "segments"));
 	while(reader.readNextStartElement())
 	{
-		Q_ASSERT(reader.name() == "segment");
+		Q_ASSERT(Xml::is(reader.name(), "segment"));
 		QXmlStreamAttributes attr = reader.attributes();
-		int start = attr.value("start").toString().toInt();
-		int end = attr.value("end").toString().toInt();
-		Layer layer(static_cast<Layer::Type>(
-						attr.value("layer").toString().toInt()));
-		int width = attr.value("width").toString().toInt();
-
-		QSharedPointer<Segment> s(new Segment(layer, width));
-		addSegment(s,
-				   vmap.value(start, QSharedPointer<Vertex>()),
-				   vmap.value(end, QSharedPointer<Vertex>()));
+		Staging::Seg s;
+		s.start = Xml::intAttr(attr, "start");
+		s.end = Xml::intAttr(attr, "end");
+		s.layer = Xml::intAttr(attr, "layer");
+		s.width = Xml::intAttr(attr, "width");
+		data.segments.append(s);
 		do
 				reader.readNext();
 		while(!reader.isEndElement());
@@ -415,34 +556,66 @@ void TraceList::loadFromXml(QXmlStreamReader &reader)
 
 	// read vias
 	reader.readNextStartElement();
-	Q_ASSERT(reader.isStartElement() && reader.name() == "vias");
+	Q_ASSERT(reader.isStartElement() && Xml::is(reader.name(), "vias"));
 	while(reader.readNextStartElement())
 	{
-		Q_ASSERT(reader.name() == "via");
+		Q_ASSERT(Xml::is(reader.name(), "via"));
 		QXmlStreamAttributes attr = reader.attributes();
-		QPoint pt = QPoint(
-				attr.value("x").toString().toInt(),
-				attr.value("y").toString().toInt());
-		QUuid psuuid(attr.value("padstack").toString());
-
-		QSharedPointer<Via> via(new Via(pt, mDoc->padstack(psuuid)));
-		myVias.insert(via);
-
+		Staging::ViaRec v;
+		v.pos = QPoint(
+				Xml::intAttr(attr, "x"),
+				Xml::intAttr(attr, "y"));
+		v.padstack = Xml::uuidAttr(attr, "padstack");
+		data.vias.append(v);
 		do
 				reader.readNext();
 		while(!reader.isEndElement());
 	}
+}
+
+void TraceList::load(const Staging &data)
+{
+	clear();
+
+	QHash<int, QSharedPointer<Vertex> > vmap;
+	vmap.reserve(data.vertices.size());
+	foreach(const Staging::Vtx &v, data.vertices)
+	{
+		QSharedPointer<Vertex> vtx(new Vertex(v.pos));
+		myVtx.insert(vtx);
+		vmap.insert(v.id, vtx);
+	}
+
+	foreach(const Staging::Seg &seg, data.segments)
+	{
+		QSharedPointer<Segment> s(new Segment(
+				Layer(static_cast<Layer::Type>(seg.layer)), seg.width));
+		addSegment(s,
+				   vmap.value(seg.start, QSharedPointer<Vertex>()),
+				   vmap.value(seg.end, QSharedPointer<Vertex>()));
+	}
+
+	// padstacks are looked up once the document has loaded them
+	foreach(const Staging::ViaRec &v, data.vias)
+		myVias.insert(QSharedPointer<Via>(
+				new Via(v.pos, mDoc->padstack(v.padstack))));
 	mIsDirty = true;
 }
 
 void TraceList::toXML(QXmlStreamWriter &writer) const
 {
+	// vertices are numbered in the order they are written, as in binary
+	// boards (see BoardFile), so that both formats give the same XML
+	QHash<const Vertex*, int> ids;
+	ids.reserve(myVtx.size());
 	writer.writeStartElement("traces");
 	writer.writeStartElement("vertices");
 	foreach(QSharedPointer<Vertex> v, myVtx)
 	{
+		int id = ids.size();
+		ids.insert(v.data(), id);
 		writer.writeStartElement("vertex");
-		writer.writeAttribute("id", QString::number(v->getid()));
+		writer.writeAttribute("id", QString::number(id));
 		writer.writeAttribute("x", QString::number(v->pos().x()));
 		writer.writeAttribute("y", QString::number(v->pos().y()));
 		writer.writeEndElement();
@@ -453,8 +626,8 @@ void TraceList::toXML(QXmlStreamWriter &writer) const
 	foreach(QSharedPointer<Segment> s, mySeg)
 	{
 		writer.writeStartElement("segment");
-		writer.writeAttribute("start", QString::number(s->v1()->getid()));
-		writer.writeAttribute("end", QString::number(s->v2()->getid()));
+		writer.writeAttribute("start", QString::number(ids.value(s->v1().data(), -1)));
+		writer.writeAttribute("end", QString::number(ids.value(s->v2().data(), -1)));
 		writer.writeAttribute("layer", QString::number(s->layer().toInt()));
 		writer.writeAttribute("width", QString::number(s->width()));
 		writer.writeEndElement();
@@ -506,19 +679,14 @@ TraceList::AddSegCmd::AddSegCmd(QUndoCommand *parent,
 
 void TraceList::AddSegCmd::undo()
 {
-	mTl->mySeg.remove(mSeg);
-	mV1->removeSegment(mSeg);
-	mV2->removeSegment(mSeg);
-
-	if (mV1->segments().count() == 0)
-		mTl->myVtx.remove(mV1);
-	if (mV2->segments().count() == 0)
-		mTl->myVtx.remove(mV2);
+	mTl->removeSegment(mSeg);
+	mTl->updateIndex(mSeg, mV1, mV2);
 }
 
 void TraceList::AddSegCmd::redo()
 {
 	mTl->addSegment(mSeg, mV1, mV2);
+	mTl->updateIndex(mSeg, mV1, mV2);
 }
 
 
@@ -532,6 +700,7 @@ TraceList::DelSegCmd::DelSegCmd(QUndoCommand *parent,
 void TraceList::DelSegCmd::undo()
 {
 	mTl->addSegment(mSeg, mV1, mV2);
+	mTl->updateIndex(mSeg, mV1, mV2);
 }
 
 void TraceList::DelSegCmd::redo()
@@ -539,14 +708,8 @@ void TraceList::DelSegCmd::redo()
 	mV1 = mSeg->v1();
 	mV2 = mSeg->v2();
 
-	mTl->mySeg.remove(mSeg);
-	mV1->removeSegment(mSeg);
-	mV2->removeSegment(mSeg);
-
-	if (mV1->segments().count() == 0)
-		mTl->myVtx.remove(mV1);
-	if (mV2->segments().count() == 0)
-		mTl->myVtx.remove(mV2);
+	mTl->removeSegment(mSeg);
+	mTl->updateIndex(mSeg, mV1, mV2);
 }
 
 /////////////////
@@ -569,23 +732,14 @@ void TraceList::SwapVtxCmd::undo()
 	Q_ASSERT(mSeg->v1()->segments().contains(mSeg));
 	Q_ASSERT(mSeg->v2()->segments().contains(mSeg));
 
-
-	mVNew->removeSegment(mSeg);
-	if (mVNew->segments().count() == 0)
-	{
-		mTl->myVtx.remove(mVNew);
-	}
-	mTl->myVtx.insert(mVOld);
-	mVOld->addSegment(mSeg);
-	if (mSeg->v1() == mVNew)
-		mSeg->setV1(mVOld);
-	else
-		mSeg->setV2(mVOld);
+	mTl->swapVtx(mSeg, mVNew, mVOld);
 
 	Q_ASSERT(mSeg->v1()->segments().contains(mSeg));
 	Q_ASSERT(mSeg->v2()->segments().contains(mSeg));
 	Q_ASSERT((mSeg->v1() == mVOld && mSeg->v2() != mVOld)
 			 || (mSeg->v1() != mVOld && mSeg->v2() == mVOld));
+
+	mTl->updateIndex(mSeg, mVOld, mVNew);
 }
 
 void TraceList::SwapVtxCmd::redo()
@@ -595,68 +749,18 @@ void TraceList::SwapVtxCmd::redo()
 	Q_ASSERT(mSeg->v1()->segments().contains(mSeg));
 	Q_ASSERT(mSeg->v2()->segments().contains(mSeg));
 
-	mVOld->removeSegment(mSeg);
-	if (mVOld->segments().count() == 0)
-	{
-		mTl->myVtx.remove(mVOld);
-	}
-	if (mSeg->v1() == mVOld)
-	{
-		mSeg->setV1(mVNew);
-		Q_ASSERT(mSeg->v1() == mVNew);
-		Q_ASSERT(mSeg->v2() != mVNew);
-	}
-	else
-	{
-		mSeg->setV2(mVNew);
-		Q_ASSERT(mSeg->v1() != mVNew);
-		Q_ASSERT(mSeg->v2() == mVNew);
-	}
-	mVNew->addSegment(mSeg);
-	mTl->myVtx.insert(mVNew);
+	mTl->swapVtx(mSeg, mVOld, mVNew);
 
 	Q_ASSERT(mSeg->v1()->segments().contains(mSeg));
 	Q_ASSERT(mSeg->v2()->segments().contains(mSeg));
 	Q_ASSERT((mSeg->v1() == mVNew && mSeg->v2() != mVNew)
 			 || (mSeg->v1() != mVNew && mSeg->v2() == mVNew));
 
+	mTl->updateIndex(mSeg, mVOld, mVNew);
 }
 
 ///////////////////////////   LVS   ////////////////////////////////////
 
-TraceList::ConnGroup::ConnGroup(const PartPin *pin)
-{
-	mPins.insert(pin);
-	foreach(const Vertex* v, pin->vertices())
-	{
-		DFS(v);
-	}
-	update();
-}
-
-void TraceList::ConnGroup::DFS(const Vertex* currVtx)
-{
-        mVertices.insert(currVtx);
-	if (currVtx->partpin())
-		mPins.insert(currVtx->partpin());
-	if (currVtx->via())
-	{
-		mVias.insert(currVtx->via());
-		mPins.unite(currVtx->via()->partpins());
-		foreach(const Vertex* v, currVtx->via()->vertices())
-		{
-			if (!mVertices.contains(v))
-				DFS(v);
-		}
-	}
-	foreach(QSharedPointer<Segment> seg, currVtx->segments())
-	{
-		const Vertex* vtx = seg->otherVertex(currVtx);
-		if (!mVertices.contains(vtx))
-			DFS(vtx);
-	}
-}
-
 void TraceList::ConnGroup::update()
 {
 	mNet.clear();
@@ -692,7 +796,10 @@ void TraceList::ConnGroup::update()
 	for(i = hash.constBegin(); i != hash.constEnd(); i++)
 	{
 		if (i.value() > max)
+		{
+			max = i.value();
 			mNet = i.key();
+		}
 	}
 	// insert shorted pins into array
 	foreach(const PartPin* p, mPins)
@@ -705,6 +812,7 @@ void TraceList::ConnGroup::update()
 void TraceList::rebuildRats() const
 {
 	mRats.clear();
+	mRatsAllDirty = true;
 	foreach(QString net, mConnections.keys())
 	{
 		if (!net.isEmpty())
@@ -714,77 +822,190 @@ void TraceList::rebuildRats() const
 
 void TraceList::rebuildRatsForNet(QString netName) const
 {
-	// Prim's algorithm for building a minimum spanning tree
-	// very inefficient, but who cares (for now)
-	QList<ConnGroup> net = mConnections[netName];
-	QList<ConnGroup> connected;
-	connected.append(net.takeLast());
+	// Kruskal's algorithm over the Delaunay triangulation of the net's pins,
+	// which is guaranteed to contain the minimum spanning tree.  Pins that
+	// are already connected start out in the same set, so ratlines are only
+	// drawn between connection groups.
+	const QList<ConnGroup> groups = mConnections.value(netName);
 	QList<QPair<const PartPin*, const PartPin*> > rats;
-	while(!net.isEmpty())
+	if (groups.size() < 2)
 	{
-		// iterate over all pins in the connected set
-		int shortest_cg;
-		QPair<const PartPin*, const PartPin*> shortest;
-		double dist = 1e300; // really large value
-		foreach(ConnGroup cg, connected)
+		mRats[netName] = rats;
+		return;
+	}
+
+	QVector<QPoint> pts;
+	QVector<const PartPin*> pins;
+	QVector<int> pinGroup;
+	for(int g = 0; g < groups.size(); g++)
+	{
+		foreach(const PartPin* pin, groups[g].validPins())
 		{
-			foreach(const PartPin* pin, cg.validPins())
-			{
-				// now iterate over all pins in the remaining set and find the closest one
-				for(int i = 0; i < net.size(); i++)
-				{
-					ConnGroup curr(net[i]);
-					foreach(const PartPin* currPin, curr.validPins())
-					{
-						double newdist = XPcb::distance(pin->pos(), currPin->pos());
-						if (newdist < dist)
-						{
-							dist = newdist;
-							shortest.first = pin;
-							shortest.second = currPin;
-							shortest_cg = i;
-						}
-					}
-				}
-			}
+			pts.append(pin->pos());
+			pins.append(pin);
+			pinGroup.append(g);
 		}
-		// done with this cg
-		connected.append(net[shortest_cg]);
-		net.removeAt(shortest_cg);
-		Q_ASSERT(shortest.first && shortest.second);
-		rats.append(shortest);
 	}
 
+	// sort candidate edges by length
+	QVector<QPair<int, int> > edges = Delaunay(pts).edges();
+	QVector<QPair<qint64, int> > order(edges.size());
+	for(int i = 0; i < edges.size(); i++)
+	{
+		QPoint d = pts[edges[i].first] - pts[edges[i].second];
+		order[i] = qMakePair(qint64(d.x()) * d.x() + qint64(d.y()) * d.y(), i);
+	}
+	qSort(order);
+
+	UnionFind sets(groups.size());
+	int remaining = groups.size() - 1;
+	for(int i = 0; i < order.size() && remaining > 0; i++)
+	{
+		const QPair<int, int> &e = edges[order[i].second];
+		if (sets.unite(pinGroup[e.first], pinGroup[e.second]))
+		{
+			rats.append(qMakePair(pins[e.first], pins[e.second]));
+			remaining--;
+		}
+	}
 	mRats[netName] = rats;
 }
 
-/// Rebuild connection list
+/// Rebuild connection groups and ratsnest if anything has changed
 void TraceList::update() const
 {
-	if (!mIsDirty) return;
+	if (!mConnValid)
+		rebuildConnectivity();
+
+	int rev = mDoc->netlist() ? mDoc->netlist()->revision() : 0;
+	if (rev != mNetlistRev)
+	{
+		if (!mIsDirty)
+			touchNetChanges();
+		mNetlistRev = rev;
+	}
 
-	rebuildConnectivity();
+	if (mIsDirty)
+	{
+		regroup();
+		rebuildRats();
+		mIsDirty = false;
+		return;
+	}
+	if (mTouched.isEmpty() && mRemovedPins.isEmpty())
+		return;
 
-	// convert to regular pointers
-	QSet<const PartPin*> toVisit;
-	foreach(QSharedPointer<PartPin> pin, mDoc->partPins())
+	foreach(QString net, regroupTouched())
+	{
+		mRatsDirty.insert(net);
+		if (mConnections.value(net).isEmpty())
+		{
+			mConnections.remove(net);
+			mRats.remove(net);
+		}
+		else if (!net.isEmpty())
+			rebuildRatsForNet(net);
+	}
+}
+
+void TraceList::regroup() const
+{
+	// pins in the same connectivity set form a group
+	QHash<int, ConnGroup> groups;
+	foreach(const PartPin* pin, mLivePins)
+		groups[mConn.find(node(pin, PinNode))].addPin(pin);
+
+	mConnections.clear();
+	mPinNets.clear();
+	mPinGroupNets.clear();
+	QHash<int, ConnGroup>::iterator i;
+	for(i = groups.begin(); i != groups.end(); ++i)
+		addGroup(*i);
+
+	mTouched.clear();
+	mRemovedPins.clear();
+}
+
+QSet<QString> TraceList::regroupTouched() const
+{
+	// collect the pins whose connectivity sets have changed
+	QSet<const PartPin*> pins = mRemovedPins;
+	QSet<int> roots;
+	foreach(int n, mTouched)
+	{
+		int root = mConn.find(n);
+		if (roots.contains(root))
+			continue;
+		roots.insert(root);
+		foreach(int m, mConn.members(n))
+		{
+			if (mNodeKinds[m] == PinNode)
+				pins.insert(static_cast<const PartPin*>(mNodeObjs[m]));
+		}
+	}
+	mTouched.clear();
+	mRemovedPins.clear();
+
+	// drop the groups these pins used to belong to
+	QSet<QString> nets;
+	foreach(const PartPin* pin, pins)
 	{
-		toVisit.insert(pin.data());
+		QHash<const PartPin*, QString>::iterator i = mPinGroupNets.find(pin);
+		if (i != mPinGroupNets.end())
+		{
+			nets.insert(i.value());
+			mPinGroupNets.erase(i);
+		}
+		mPinNets.remove(pin);
+	}
+	foreach(QString net, nets)
+	{
+		QList<ConnGroup> &groups = mConnections[net];
+		for(int i = groups.size() - 1; i >= 0; i--)
+		{
+			foreach(const PartPin* pin, groups[i].pins())
+			{
+				if (pins.contains(pin))
+				{
+					groups.removeAt(i);
+					break;
+				}
+			}
+		}
 	}
 
-	this->mConnections.clear();
-	while(!toVisit.empty())
+	// and build new ones
+	QHash<int, ConnGroup> groups;
+	foreach(const PartPin* pin, pins)
 	{
-		const PartPin* pin = *toVisit.begin();
-		ConnGroup cg(pin);
-		// remove visited pins
-		toVisit.subtract(cg.pins());
-		mConnections[cg.net()].append(cg);
+		if (mLivePins.contains(pin))
+			groups[mConn.find(mNodeIds.value(pin))].addPin(pin);
 	}
+	QHash<int, ConnGroup>::iterator i;
+	for(i = groups.begin(); i != groups.end(); ++i)
+		nets.insert(addGroup(*i));
+	return nets;
+}
 
-	rebuildRats();
+QString TraceList::addGroup(ConnGroup &group) const
+{
+	group.update();
+	mConnections[group.net()].append(group);
+	foreach(const PartPin* pin, group.pins())
+	{
+		mPinNets.insert(pin, pin->net());
+		mPinGroupNets.insert(pin, group.net());
+	}
+	return group.net();
+}
 
-//	mIsDirty = false;
+void TraceList::touchNetChanges() const
+{
+	foreach(const PartPin* pin, mLivePins)
+	{
+		if (pin->net() != mPinNets.value(pin))
+			mTouched.insert(node(pin, PinNode));
+	}
 }
 
 void TraceList::draw(QPainter *painter, const Layer &layer) const
@@ -803,29 +1024,103 @@ void TraceList::draw(QPainter *painter, const Layer &layer) const
 			painter->drawLine(rat.first->pos(), rat.second->pos());
 		}
 	}
+	painter->setBrush(Qt::NoBrush);
+	foreach(const PartPin* pin, shortedPins())
+		painter->drawRect(pin->bbox());
 	painter->restore();
 }
 
+QRect TraceList::ratsArea(const QString &net) const
+{
+	typedef QPair<const PartPin*, const PartPin*> RatPair;
+	QRect r;
+	foreach(const RatPair &rat, mRats.value(net))
+		r |= QRect(rat.first->pos(), rat.second->pos()).normalized();
+	foreach(const ConnGroup &cg, mConnections.value(net))
+	{
+		foreach(const PartPin* pin, cg.shortedPins())
+			r |= pin->bbox();
+	}
+	return r;
+}
+
+QRect TraceList::takeRatsChangedArea() const
+{
+	update();
+	// only nets that have been regrouped can have changed; pins that move
+	// are touched and regrouped too
+	QSet<QString> nets = mRatsDirty;
+	if (mRatsAllDirty)
+	{
+		nets = QSet<QString>::fromList(mRatAreas.keys());
+		nets.unite(QSet<QString>::fromList(mConnections.keys()));
+	}
+	mRatsDirty.clear();
+	mRatsAllDirty = false;
+
+	QRect area;
+	foreach(const QString &net, nets)
+	{
+		QRect r = ratsArea(net);
+		area |= r | mRatAreas.value(net);
+		if (r.isNull())
+			mRatAreas.remove(net);
+		else
+			mRatAreas.insert(net, r);
+	}
+	return area;
+}
+
 void TraceList::rebuildConnectivity() const
 {
+	mConn.clear();
+	mNodeIds.clear();
+	mNodeObjs.clear();
+	mNodeKinds.clear();
+	mDeadNodes = 0;
+	mPartPins.clear();
+	mLivePins.clear();
+
 	// go through pins, clear everything
+	QList<QSharedPointer<PCBObject> > objs;
 	foreach(QSharedPointer<PartPin> pin, mDoc->partPins())
 	{
 		pin->detachAll();
+		mPartPins[pin->part()].append(pin);
+		mLivePins.insert(pin.data());
+		node(pin.data(), PinNode);
+		objs.append(pin);
 	}
+	mPinIndex.load(objs);
+
+	objs.clear();
+	foreach(QSharedPointer<Via> via, myVias)
+		objs.append(via);
+	mViaIndex.load(objs);
 
-	// go through vias, check against pins
+	objs.clear();
+	foreach(QSharedPointer<Vertex> vtx, myVtx)
+		objs.append(vtx);
+	mVtxIndex.load(objs);
+
+	// go through vias, check against the pins under them
 	QList<Layer> layers = mDoc->layerList(Document::ListOrder, Document::Copper);
 	foreach(QSharedPointer<Via> via, myVias)
 	{
 		via->detachAll();
-		foreach(QSharedPointer<PartPin> pin, mDoc->partPins())
+		QRect r(via->pos(), QSize(1, 1));
+		foreach(QSharedPointer<PCBObject> obj, mPinIndex.query(r))
 		{
+			const PartPin* pin = static_cast<const PartPin*>(obj.data());
 			foreach(Layer layer, layers)
 			{
 				if (via->onLayer(layer) &&
 						pin->testHit(via->pos(), 0, layer))
-					via->attach(pin.data());
+				{
+					via->attach(pin);
+					link(via.data(), ViaNode, pin, PinNode);
+					break;
+				}
 			}
 		}
 	}
@@ -834,19 +1129,190 @@ void TraceList::rebuildConnectivity() const
 	{
 		// clear any existing connections
 		vtx->detachAll();
-		QPoint pos = vtx->pos();
-		Layer layer = vtx->layer();
-		// check each vertex against pins and vias
-		foreach(QSharedPointer<PartPin> pin, mDoc->partPins())
+		attachVertex(vtx.data());
+	}
+	// and finally the segments
+	foreach(QSharedPointer<Segment> s, mySeg)
+		link(s->v1().data(), VertexNode, s->v2().data(), VertexNode);
+
+	mConnValid = true;
+	mIsDirty = true;
+}
+
+int TraceList::node(const PCBObject *obj, NodeKind kind) const
+{
+	QHash<const PCBObject*, int>::const_iterator i = mNodeIds.constFind(obj);
+	if (i != mNodeIds.constEnd())
+	{
+		// the address may have been reused by an object of another kind
+		// after the original was deleted; its node is a singleton by then
+		mNodeKinds[i.value()] = kind;
+		return i.value();
+	}
+	int n = mConn.add();
+	mNodeIds.insert(obj, n);
+	mNodeObjs.append(obj);
+	mNodeKinds.append(kind);
+	return n;
+}
+
+void TraceList::link(const PCBObject *a, NodeKind ka,
+					 const PCBObject *b, NodeKind kb) const
+{
+	unite(node(a, ka), node(b, kb));
+}
+
+void TraceList::unite(int a, int b) const
+{
+	if (mConn.unite(a, b))
+		mTouched.insert(a);
+}
+
+void TraceList::linkNode(int n) const
+{
+	const PCBObject* obj = mNodeObjs[n];
+	switch(mNodeKinds[n])
+	{
+	case VertexNode:
+	{
+		const Vertex* vtx = static_cast<const Vertex*>(obj);
+		foreach(QSharedPointer<Segment> s, vtx->segments())
+			unite(n, node(s->otherVertex(vtx), VertexNode));
+		if (vtx->partpin())
+			unite(n, node(vtx->partpin(), PinNode));
+		if (vtx->via())
+			unite(n, node(vtx->via(), ViaNode));
+		break;
+	}
+	case ViaNode:
+	{
+		const Via* via = static_cast<const Via*>(obj);
+		foreach(const PartPin* pin, via->partpins())
+			unite(n, node(pin, PinNode));
+		break;
+	}
+	case PinNode:
+		// pin attachments are recorded on the vertices and vias
+	case DeadNode:
+		break;
+	}
+}
+
+void TraceList::relink(const QList<const PCBObject*> &objs) const
+{
+	QList<int> members;
+	foreach(const PCBObject* obj, objs)
+	{
+		int n = mNodeIds.value(obj, -1);
+		if (n >= 0)
+			members.append(mConn.split(n));
+	}
+	foreach(int n, members)
+	{
+		mTouched.insert(n);
+		linkNode(n);
+	}
+}
+
+void TraceList::dropNodes(const QList<const PCBObject*> &objs) const
+{
+	foreach(const PCBObject* obj, objs)
+	{
+		QHash<const PCBObject*, int>::iterator i = mNodeIds.find(obj);
+		if (i == mNodeIds.end())
+			continue;
+		// the node was split off by relink(), so it is a singleton and
+		// can simply be left behind
+		mNodeObjs[i.value()] = NULL;
+		mNodeKinds[i.value()] = DeadNode;
+		mNodeIds.erase(i);
+		mDeadNodes++;
+	}
+	// renumber the live nodes once the dead ones dominate; the rebuild
+	// is linear in the board size, so this is amortized over the
+	// removals that led up to it
+	if (mDeadNodes > 1024 && mDeadNodes > mNodeIds.size())
+	{
+		mConnValid = false;
+		mTouched.clear();
+		mRemovedPins.clear();
+	}
+}
+
+void TraceList::attachVertex(const Vertex *vtx) const
+{
+	QPoint pos = vtx->pos();
+	Layer layer = vtx->layer();
+	QRect r(pos, QSize(1, 1));
+	int n = node(vtx, VertexNode);
+	// check vertex against the pins and vias under it
+	foreach(QSharedPointer<PCBObject> obj, mPinIndex.query(r))
+	{
+		const PartPin* pin = static_cast<const PartPin*>(obj.data());
+		if (pin->testHit(pos, 0, layer))
 		{
-			if (pin->testHit(pos, 0, layer))
-				vtx->attach(pin.data());
+			vtx->attach(pin);
+			unite(n, node(pin, PinNode));
+			break;
 		}
-		foreach(QSharedPointer<Via> via, myVias)
+	}
+	foreach(QSharedPointer<PCBObject> obj, mViaIndex.query(r))
+	{
+		const Via* via = static_cast<const Via*>(obj.data());
+		if (via->testHit(pos, 0, layer))
 		{
-			if (via->testHit(pos, 0, layer))
-				vtx->attach(via.data());
+			vtx->attach(via);
+			unite(n, node(via, ViaNode));
+			break;
 		}
 	}
+}
 
+void TraceList::attachPin(const PartPin *pin) const
+{
+	int n = node(pin, PinNode);
+	QRect r = pin->bbox();
+	QList<Layer> layers = mDoc->layerList(Document::ListOrder, Document::Copper);
+	foreach(QSharedPointer<PCBObject> obj, mViaIndex.query(r))
+	{
+		const Via* via = static_cast<const Via*>(obj.data());
+		foreach(Layer layer, layers)
+		{
+			if (via->onLayer(layer) && pin->testHit(via->pos(), 0, layer))
+			{
+				via->attach(pin);
+				unite(n, node(via, ViaNode));
+				break;
+			}
+		}
+	}
+	// vertices that are already on another pin keep their attachment
+	foreach(QSharedPointer<PCBObject> obj, mVtxIndex.query(r))
+	{
+		const Vertex* vtx = static_cast<const Vertex*>(obj.data());
+		if (!vtx->partpin() && pin->testHit(vtx->pos(), 0, vtx->layer()))
+		{
+			vtx->attach(pin);
+			unite(n, node(vtx, VertexNode));
+		}
+	}
+}
+
+void TraceList::detachPin(const PartPin *pin) const
+{
+	foreach(const Vertex* vtx, pin->vertices())
+		vtx->detachPin();
+	// the pin may have moved since it was attached, so look for vias
+	// around its old position
+	foreach(QSharedPointer<PCBObject> obj,
+			mViaIndex.query(mPinIndex.indexedRect(pin)))
+		static_cast<const Via*>(obj.data())->detach(pin);
+}
+
+void TraceList::updateVtxIndex(QSharedPointer<Vertex> vtx) const
+{
+	if (!myVtx.contains(vtx))
+		mVtxIndex.remove(vtx.data());
+	else if (!mVtxIndex.contains(vtx.data()))
+		mVtxIndex.insert(vtx);
 }
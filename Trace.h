@@ -22,9 +22,14 @@
 
 #include <QList>
 #include <QSet>
+#include <QVector>
+#include <QUuid>
+#include <QLine>
 #include "PCBObject.h"
 #include "Footprint.h"
 #include "Net.h"
+#include "UnionFind.h"
+#include "SpatialIndex.h"
 
 class QXmlStreamReader;
 class QXmlStreamWriter;
@@ -35,6 +40,7 @@ class Padstack;
 class TraceList;
 class Segment;
 class PCBDoc;
+class Part;
 
 
 /// Vias are objects that make electrical connections between layers.
@@ -50,6 +56,8 @@ public:
 		QObject *parent = NULL);
 
 	virtual void draw(QPainter *painter, const Layer& layer) const;
+	/// Vias only draw their pads, which may be on any copper layer.
+	virtual LayerMask layers() const { return LayerMask::copper(); }
 	virtual QRect bbox() const;
 	virtual bool testHit(QPoint p, int dist, const Layer &l) const;
 
@@ -115,6 +123,7 @@ public:
 	Vertex(QPoint pos = QPoint(0, 0), QObject *parent = NULL);
 
 	virtual void draw(QPainter *painter, const Layer& layer) const;
+	virtual LayerMask layers() const { return LayerMask(); }
 	virtual QRect bbox() const;
 	virtual bool testHit(QPoint p, int dist, const Layer &l) const;
 
@@ -183,6 +192,7 @@ public:
 	Segment(const Layer& layer, int w = 0, QObject* parent = NULL);
 
 	virtual void draw(QPainter *painter, const Layer& layer) const;
+	virtual LayerMask layers() const { return LayerMask(mLayer) | Layer::LAY_SELECTION; }
 	virtual QRect bbox() const;
 	virtual bool testHit(QPoint p, int dist, const Layer &l) const;
 	virtual PCBObjState getState() const
@@ -275,10 +285,24 @@ private:
 
 /// A trace consists of a set of connected segments and
 /// vertices, which form a graph structure.
+///
+/// Electrical connectivity between vertices, vias and part pins is kept in a
+/// union-find structure.  Adding a segment merges two sets in near-constant
+/// time; deleting a segment or moving an object splits only the affected set
+/// and re-links its members.  The connection groups used for net assignment,
+/// short detection and the ratsnest are derived from these sets.  Pins, vias
+/// and vertices are kept in spatial indexes, so attaching an object only
+/// tests the few objects underneath it.
 class TraceList
 {
+	friend class TraceListTest;
+	friend class BoardFileTest;
+	friend class BoardFile;
+	friend class Journal;
 public:
-	TraceList(PCBDoc* doc) : mDoc(doc), mIsDirty(false) {}
+	TraceList(PCBDoc* doc)
+		: mDoc(doc), mIsDirty(true), mConnValid(false), mNetlistRev(-1),
+		  mDeadNodes(0), mRatsAllDirty(true) {}
 	~TraceList() { clear(); }
 
 //	QSet<Vertex*> getConnectedVertices(Vertex* vtx) const;
@@ -286,6 +310,10 @@ public:
 
 	/// Draws ratlines and highlights shorted pins
 	void draw(QPainter *painter, const Layer& layer) const;
+	/// Returns the area covered by ratlines and shorted pin highlights that
+	/// have been added, removed or moved since the last call.  Only nets
+	/// that have been regrouped since then are looked at.
+	QRect takeRatsChangedArea() const;
 
 	void addSegment(QSharedPointer<Segment> s,
 					QSharedPointer<Vertex> v1,
@@ -323,6 +351,36 @@ public:
 
 	QSet<QSharedPointer<Segment> > segments() const {return mySeg;}
 	QSet<QSharedPointer<Vertex> > vertices() const {return myVtx;}
+
+	/// Updates connectivity after a part was added, moved or removed.
+	void partChanged(const Part* part, bool removed = false);
+	/// Updates connectivity after a vertex was moved.
+	void vertexMoved(QSharedPointer<Vertex> vtx);
+	/// Returns true if two vertices, vias or part pins are electrically
+	/// connected.
+	bool isConnected(const PCBObject* a, const PCBObject* b) const;
+	/// Returns the pins that are connected to a pin of a different net.
+	QSet<const PartPin*> shortedPins() const;
+
+	/// Trace data read from a file.  Reading it does not create any objects,
+	/// so it can be done on any thread; load() then builds the traces.
+	struct Staging
+	{
+		struct Vtx { int id; QPoint pos; };
+		struct Seg { int start; int end; int layer; int width; };
+		struct ViaRec { QPoint pos; QUuid padstack; };
+
+		QVector<Vtx> vertices;
+		QVector<Seg> segments;
+		QVector<ViaRec> vias;
+	};
+
+	/// Reads the traces element of a file into staging data.
+	static void parseXml(QXmlStreamReader &reader, Staging &data);
+	/// Replaces the contents of the trace list with staged traces.  Vias
+	/// get their padstacks from the document.
+	void load(const Staging &data);
+
 	void loadFromXml(QXmlStreamReader &reader);
 	void toXML(QXmlStreamWriter &writer) const;
 private:
@@ -373,48 +431,127 @@ private:
 		QSharedPointer<Vertex> mVOld, mVNew;
 	};
 
+	/// A set of part pins that are connected by copper.
 	class ConnGroup
 	{
 	public:
-		ConnGroup(const PartPin* pin);
+		void addPin(const PartPin* pin) { mPins.insert(pin); }
+		/// Assigns the group to a net and finds any shorted pins.
+		void update();
 
-		QSet<const Vertex*> vertices() const { return mVertices; }
 		QSet<const PartPin*> pins() const { return mPins; }
 		QSet<const PartPin*> validPins() const { return mPins - mShortedPins; }
-		QSet<const Via*> vias() const { return mVias; }
 		QSet<const PartPin*> shortedPins() const { return mShortedPins; }
 		QString net() const { return mNet; }
 
 	private:
-		void DFS(const Vertex* currVtx);
-		void update();
-
-
 		QString mNet;
-		QSet<const Vertex*> mVertices;
 		QSet<const PartPin*> mPins;
-		QSet<const Via*> mVias;
 		QSet<const PartPin*> mShortedPins;
 	};
 
+	/// Kinds of objects tracked by the connectivity structure.  Nodes of
+	/// objects that have left the board are marked dead until the next
+	/// rebuild.
+	enum NodeKind { VertexNode, ViaNode, PinNode, DeadNode };
+
 	friend class AddSegCmd;
 	friend class DelSegCmd;
 	friend class SwapVtxCmd;
 	void clear();
+	/// Brings the document's spatial index in line with the trace list
+	/// after an undo command has added, removed or rewired a segment.
+	void updateIndex(QSharedPointer<Segment> s,
+					 QSharedPointer<Vertex> v1,
+					 QSharedPointer<Vertex> v2) const;
 	void update() const;
 	void rebuildConnectivity() const;
+	void regroup() const;
+	/// Rebuilds the connection groups of touched pins.  Returns the nets
+	/// whose groups have changed.
+	QSet<QString> regroupTouched() const;
+	/// Assigns a group to a net and adds it to the connection list.
+	QString addGroup(ConnGroup &group) const;
+	/// Touches pins whose netlist net has changed.
+	void touchNetChanges() const;
 	void rebuildRats() const;
 	void rebuildRatsForNet(QString net) const;
+	/// Returns the area covered by the ratlines and shorted pin highlights
+	/// of a net.
+	QRect ratsArea(const QString &net) const;
+
+	/// Returns the connectivity node of an object, creating it if needed.
+	int node(const PCBObject* obj, NodeKind kind) const;
+	/// Merges the sets of two objects.
+	void link(const PCBObject* a, NodeKind ka,
+			  const PCBObject* b, NodeKind kb) const;
+	/// Merges the sets of two nodes, touching them if they were separate.
+	void unite(int a, int b) const;
+	/// Merges a node with the sets of all objects it is attached to.
+	void linkNode(int n) const;
+	/// Splits the sets containing the given objects and re-links their
+	/// members.  Used after a connection has been removed.
+	void relink(const QList<const PCBObject*> &objs) const;
+	/// Forgets the nodes of objects that have left the board.  The
+	/// connectivity structure is rebuilt once most nodes are dead.
+	void dropNodes(const QList<const PCBObject*> &objs) const;
+	/// Attaches a vertex to the pin and via under it.
+	void attachVertex(const Vertex* vtx) const;
+	/// Attaches a pin to the vertices and vias over it.
+	void attachPin(const PartPin* pin) const;
+	/// Detaches a pin from all vertices and vias.
+	void detachPin(const PartPin* pin) const;
+	/// Adds a vertex to, or removes it from, the vertex index to match
+	/// the vertex set.
+	void updateVtxIndex(QSharedPointer<Vertex> vtx) const;
 
 	PCBDoc* mDoc;
 	QSet<QSharedPointer<Segment> > mySeg;		// set of segments
 	QSet<QSharedPointer<Vertex> > myVtx;		// set of vertices
 	QSet<QSharedPointer<Via> > myVias;			// set of vias
 
+	/// True if all connection groups need to be rebuilt
 	mutable bool mIsDirty;
+	/// True if the attachments and connectivity sets are up to date
+	mutable bool mConnValid;
+	/// Netlist revision that the connection groups were built against
+	mutable int mNetlistRev;
+
+	/// Connectivity sets of vertices, vias and part pins
+	mutable UnionFind mConn;
+	mutable QHash<const PCBObject*, int> mNodeIds;
+	mutable QVector<const PCBObject*> mNodeObjs;
+	mutable QVector<NodeKind> mNodeKinds;
+	/// Number of dead nodes in the connectivity sets
+	mutable int mDeadNodes;
+	/// Pins of each part, as they were when the part was last attached
+	mutable QHash<const Part*, QList<QSharedPointer<PartPin> > > mPartPins;
+	/// Pins that are currently on the board
+	mutable QSet<const PartPin*> mLivePins;
+	/// Nodes whose connectivity set has changed since the last update
+	mutable QSet<int> mTouched;
+	/// Pins removed from the board since the last update
+	mutable QSet<const PartPin*> mRemovedPins;
+	/// Netlist net of each pin, and net of the group it belongs to, as of
+	/// the last update
+	mutable QHash<const PartPin*, QString> mPinNets;
+	mutable QHash<const PartPin*, QString> mPinGroupNets;
+	/// Spatial indexes used to find attachments
+	mutable SpatialIndex mPinIndex;
+	mutable SpatialIndex mViaIndex;
+	mutable SpatialIndex mVtxIndex;
+
 	/// Master list of connections (maps net->list of conns)
 	mutable QHash<QString, QList<ConnGroup> > mConnections;
 	mutable QHash<QString, QList<QPair<const PartPin*,const PartPin*> > > mRats;
+	/// Nets whose ratlines or shorted pins may have changed since the last
+	/// call to takeRatsChangedArea()
+	mutable QSet<QString> mRatsDirty;
+	/// True if all ratlines have been rebuilt since the last call to
+	/// takeRatsChangedArea()
+	mutable bool mRatsAllDirty;
+	/// Area drawn for each net as of the last call to takeRatsChangedArea()
+	mutable QHash<QString, QRect> mRatAreas;
 };
 
 
@@ -0,0 +1,102 @@
+/*
+	Copyright (C) 2010-2011 Igor Izyumin
+
+	This file is part of xpcb.
+
+	xpcb is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	xpcb is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with xpcb.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "UnionFind.h"
+
+void UnionFind::resize(int n)
+{
+	int old = mParent.size();
+	mParent.resize(n);
+	mRank.resize(n);
+	mNext.resize(n);
+	for(int i = old; i < n; i++)
+	{
+		mParent[i] = i;
+		mRank[i] = 0;
+		mNext[i] = i;
+	}
+}
+
+int UnionFind::add()
+{
+	int x = size();
+	resize(x + 1);
+	return x;
+}
+
+void UnionFind::clear()
+{
+	mParent.clear();
+	mRank.clear();
+	mNext.clear();
+}
+
+int UnionFind::find(int x)
+{
+	while(mParent[x] != x)
+	{
+		mParent[x] = mParent[mParent[x]];
+		x = mParent[x];
+	}
+	return x;
+}
+
+bool UnionFind::unite(int a, int b)
+{
+	int ra = find(a);
+	int rb = find(b);
+	if (ra == rb)
+		return false;
+	if (mRank[ra] < mRank[rb])
+		mParent[ra] = rb;
+	else if (mRank[ra] > mRank[rb])
+		mParent[rb] = ra;
+	else
+	{
+		mParent[rb] = ra;
+		mRank[ra]++;
+	}
+	// splicing two distinct circular lists joins them into one
+	qSwap(mNext[a], mNext[b]);
+	return true;
+}
+
+QList<int> UnionFind::members(int x) const
+{
+	QList<int> out;
+	int i = x;
+	do
+	{
+		out.append(i);
+		i = mNext[i];
+	} while(i != x);
+	return out;
+}
+
+QList<int> UnionFind::split(int x)
+{
+	QList<int> out = members(x);
+	foreach(int i, out)
+	{
+		mParent[i] = i;
+		mRank[i] = 0;
+		mNext[i] = i;
+	}
+	return out;
+}
@@ -0,0 +1,67 @@
+/*
+	Copyright (C) 2010-2011 Igor Izyumin
+
+	This file is part of xpcb.
+
+	xpcb is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	xpcb is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with xpcb.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef UNIONFIND_H
+#define UNIONFIND_H
+
+#include <QVector>
+#include <QList>
+
+/// A disjoint-set forest over the elements 0 .. size()-1.
+
+/// Uses union by rank and path halving, so find() and unite() run in
+/// near-constant amortized time.  The members of each set are also threaded
+/// on a circular list, which allows a set to be enumerated, or split back
+/// into singletons, in time proportional to its size.
+class UnionFind
+{
+public:
+	UnionFind(int n = 0) { resize(n); }
+
+	/// Returns the number of elements.
+	int size() const { return mParent.size(); }
+	/// Grows the forest to n elements; new elements are singletons.
+	void resize(int n);
+	/// Adds a new singleton element and returns it.
+	int add();
+	/// Removes all elements.
+	void clear();
+
+	/// Returns the representative element of the set containing x.
+	int find(int x);
+	/// Merges the sets containing a and b.  Returns false if they were
+	/// already in the same set.
+	bool unite(int a, int b);
+	/// Returns true if a and b are in the same set.
+	bool connected(int a, int b) { return find(a) == find(b); }
+
+	/// Returns all members of the set containing x.
+	QList<int> members(int x) const;
+	/// Splits the set containing x into singletons and returns its former
+	/// members.
+	QList<int> split(int x);
+
+private:
+	QVector<int> mParent;
+	QVector<int> mRank;
+	/// Next member of the same set (circular list)
+	QVector<int> mNext;
+};
+
+#endif // UNIONFIND_H
@@ -0,0 +1,109 @@
+/*
+	Copyright (C) 2010-2011 Igor Izyumin
+
+	This file is part of xpcb.
+
+	xpcb is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	xpcb is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with xpcb.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "XmlAttr.h"
+#include <climits>
+
+static bool isSpace(ushort c)
+{
+	return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+/// Returns the value of a hex digit, or -1.
+static int hexValue(ushort c)
+{
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+	return -1;
+}
+
+int Xml::toInt(const QStringRef &text, int def)
+{
+	const QChar* p = text.unicode();
+	const QChar* end = p + text.size();
+	while(p < end && isSpace(p->unicode()))
+		p++;
+	while(end > p && isSpace(end[-1].unicode()))
+		end--;
+
+	bool neg = false;
+	if (p < end && (p->unicode() == '-' || p->unicode() == '+'))
+	{
+		neg = p->unicode() == '-';
+		p++;
+	}
+	if (p == end)
+		return def;
+
+	qint64 val = 0;
+	for(; p < end; p++)
+	{
+		ushort c = p->unicode();
+		if (c < '0' || c > '9')
+			return def;
+		val = val * 10 + (c - '0');
+		if (val > qint64(INT_MAX) + 1)
+			return def;
+	}
+	if (neg)
+		val = -val;
+	if (val > INT_MAX)
+		return def;
+	return int(val);
+}
+
+QUuid Xml::toUuid(const QStringRef &text)
+{
+	const QChar* p = text.unicode();
+	int len = text.size();
+	if (len == 38)
+	{
+		if (p[0] != QLatin1Char('{') || p[37] != QLatin1Char('}'))
+			return QUuid();
+		p++;
+	}
+	else if (len != 36)
+		return QUuid();
+
+	// 8-4-4-4-12 hex digits; the dashes are at fixed positions
+	uchar b[16];
+	int n = 0;
+	for(int i = 0; i < 36; i++)
+	{
+		if (i == 8 || i == 13 || i == 18 || i == 23)
+		{
+			if (p[i] != QLatin1Char('-'))
+				return QUuid();
+			continue;
+		}
+		int hi = hexValue(p[i].unicode());
+		int lo = hexValue(p[++i].unicode());
+		if (hi < 0 || lo < 0)
+			return QUuid();
+		b[n++] = uchar(hi << 4 | lo);
+	}
+	return QUuid((uint(b[0]) << 24) | (uint(b[1]) << 16) | (uint(b[2]) << 8) | b[3],
+				 ushort(b[4] << 8 | b[5]), ushort(b[6] << 8 | b[7]),
+				 b[8], b[9], b[10], b[11], b[12], b[13], b[14], b[15]);
+}
@@ -0,0 +1,85 @@
+/*
+	Copyright (C) 2010-2011 Igor Izyumin
+
+	This file is part of xpcb.
+
+	xpcb is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	xpcb is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with xpcb.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef XMLATTR_H
+#define XMLATTR_H
+
+#include <QStringRef>
+#include <QUuid>
+#include <QXmlStreamAttributes>
+
+/// Helpers for reading XML attributes and element names.
+
+/// The loaders read a few attributes for every object in a file.  The usual
+/// attrs.value("x").toString().toInt() creates a temporary QString for the
+/// attribute name and another for its value; these helpers look attributes
+/// up by Latin-1 name and parse values in place, so reading numbers, UUIDs,
+/// flags and enumerations does not allocate.  QXmlStreamReader does not
+/// intern names, so element names are compared against Latin-1 literals
+/// with is(), which does not allocate either.
+namespace Xml
+{
+	/// Parses a decimal integer, allowing surrounding whitespace.  Returns
+	/// def if the text is not an integer.
+	int toInt(const QStringRef &text, int def = 0);
+	/// Parses a UUID, with or without braces.  Returns a null UUID if the
+	/// text is not a UUID.
+	QUuid toUuid(const QStringRef &text);
+
+	/// Returns true if a name is equal to the given Latin-1 string.
+	inline bool is(const QStringRef &name, const char* str)
+	{ return name == QLatin1String(str); }
+
+	/// Returns the value of an attribute, or a null reference if it is absent.
+	inline QStringRef attr(const QXmlStreamAttributes &attrs, const char* name)
+	{ return attrs.value(QLatin1String(name)); }
+	inline bool hasAttr(const QXmlStreamAttributes &attrs, const char* name)
+	{ return attrs.hasAttribute(QLatin1String(name)); }
+
+	inline int intAttr(const QXmlStreamAttributes &attrs, const char* name,
+					   int def = 0)
+	{ return toInt(attr(attrs, name), def); }
+	inline QUuid uuidAttr(const QXmlStreamAttributes &attrs, const char* name)
+	{ return toUuid(attr(attrs, name)); }
+	/// Reads a "1"/"0" flag.  Returns def if the attribute is absent.
+	inline bool boolAttr(const QXmlStreamAttributes &attrs, const char* name,
+						 bool def = false)
+	{
+		QStringRef v = attr(attrs, name);
+		return v.isNull() ? def : is(v, "1");
+	}
+	/// Reads an attribute whose value is one of a list of names, and returns
+	/// the index of the name.  Returns def if the attribute is absent or
+	/// has another value.
+	template <int N>
+	int enumAttr(const QXmlStreamAttributes &attrs, const char* name,
+				 const char* const (&names)[N], int def)
+	{
+		QStringRef v = attr(attrs, name);
+		for(int i = 0; i < N; i++)
+		{
+			if (is(v, names[i]))
+				return i;
+		}
+		return def;
+	}
+}
+
+#endif // XMLATTR_H
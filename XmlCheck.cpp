@@ -0,0 +1,234 @@
+/*
+	Copyright (C) 2010-2011 Igor Izyumin
+
+	This file is part of xpcb.
+
+	xpcb is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	xpcb is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with xpcb.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QFile>
+#include <QMutex>
+#include "XmlCheck.h"
+#include "Log.h"
+
+static QMutex sXpcbLock;
+static XmlStructure* sXpcb = NULL;
+
+const XmlStructure& XmlStructure::xpcb()
+{
+	QMutexLocker lock(&sXpcbLock);
+	if (!sXpcb)
+	{
+		QFile schema(":/xpcbschema.xsd");
+		if (!schema.open(QIODevice::ReadOnly))
+			Log::instance().error(QString("Error loading XML schema: %1").arg(schema.errorString()));
+		sXpcb = new XmlStructure(schema);
+	}
+	return *sXpcb;
+}
+
+XmlStructure::XmlStructure(QIODevice &schema)
+{
+	QXmlStreamReader reader(&schema);
+	if (!reader.readNextStartElement() || !readNode(reader, mSchema))
+	{
+		Log::instance().error("Error reading XML schema");
+		return;
+	}
+
+	for(int i = 0; i < mSchema.children.size(); i++)
+	{
+		const Node &n = mSchema.children.at(i);
+		QString name = n.attrs.value("name").toString();
+		if (n.tag == "element")
+			mGlobalNodes.insert(name, &n);
+		else if (n.tag == "group")
+			mGroups.insert(name, &n);
+		else if (n.tag == "attributeGroup")
+			mAttrGroups.insert(name, &n);
+		else if (n.tag == "complexType")
+			mTypes.insert(name, &n);
+	}
+	foreach(QString name, mGlobalNodes.keys())
+		global(name);
+}
+
+XmlStructure::~XmlStructure()
+{
+	qDeleteAll(mElements);
+}
+
+bool XmlStructure::readNode(QXmlStreamReader &reader, Node &node)
+{
+	node.tag = reader.name().toString();
+	node.attrs = reader.attributes();
+	while(!reader.atEnd())
+	{
+		QXmlStreamReader::TokenType tok = reader.readNext();
+		if (tok == QXmlStreamReader::EndElement)
+			return true;
+		if (tok == QXmlStreamReader::StartElement)
+		{
+			node.children.append(Node());
+			if (!readNode(reader, node.children.last()))
+				return false;
+		}
+	}
+	return false;
+}
+
+const XmlStructure::Element* XmlStructure::global(const QString &name)
+{
+	if (mGlobals.contains(name))
+		return mGlobals.value(name);
+	const Node* decl = mGlobalNodes.value(name);
+	if (!decl)
+		return NULL;
+	// register the declaration before compiling it, since elements can
+	// contain themselves
+	Element* e = new Element();
+	mElements.append(e);
+	mGlobals.insert(name, e);
+	const Node* type = mTypes.value(decl->attrs.value("type").toString());
+	if (type)
+		collect(*type, *e);
+	collect(*decl, *e);
+	return e;
+}
+
+const XmlStructure::Element* XmlStructure::element(const Node &decl)
+{
+	if (decl.attrs.hasAttribute("ref"))
+		return global(decl.attrs.value("ref").toString());
+	Element* e = new Element();
+	mElements.append(e);
+	const Node* type = mTypes.value(decl.attrs.value("type").toString());
+	if (type)
+		collect(*type, *e);
+	collect(decl, *e);
+	return e;
+}
+
+void XmlStructure::collect(const Node &node, Element &elem)
+{
+	for(int i = 0; i < node.children.size(); i++)
+	{
+		const Node &n = node.children.at(i);
+		if (n.tag == "element")
+		{
+			QString name = n.attrs.hasAttribute("ref") ? n.attrs.value("ref").toString()
+													   : n.attrs.value("name").toString();
+			const Element* child = element(n);
+			if (child)
+				elem.children.insert(name, child);
+		}
+		else if (n.tag == "attribute")
+		{
+			if (n.attrs.value("use") == "required")
+				elem.requiredAttrs.append(n.attrs.value("name").toString());
+		}
+		else if (n.tag == "group" || n.tag == "attributeGroup")
+		{
+			const QHash<QString, const Node*> &defs = n.tag == "group" ? mGroups : mAttrGroups;
+			const Node* def = defs.value(n.attrs.value("ref").toString());
+			if (def)
+				collect(*def, elem);
+		}
+		else if (n.tag != "simpleType" && n.tag != "annotation")
+		{
+			// sequence, choice, complexType, etc.
+			collect(n, elem);
+		}
+	}
+}
+
+/////////////////////////////////////////////////////
+
+XmlCheckDevice::XmlCheckDevice(QIODevice *source, const XmlStructure &structure,
+							   const QString &parent)
+	: mSource(source), mStructure(structure), mFailed(false)
+{
+	open(QIODevice::ReadOnly);
+	const XmlStructure::Element* e = parent.isEmpty() ? NULL : structure.root(parent);
+	if (e)
+	{
+		mStack.append(e);
+		mNames.append(parent);
+	}
+}
+
+qint64 XmlCheckDevice::readData(char *data, qint64 maxSize)
+{
+	if (mFailed)
+		return -1;
+	qint64 n = mSource->read(data, maxSize);
+	if (n > 0)
+	{
+		mReader.addData(QByteArray(data, n));
+		if (!check())
+			return -1;
+	}
+	return n;
+}
+
+bool XmlCheckDevice::check()
+{
+	while(!mReader.atEnd())
+	{
+		QXmlStreamReader::TokenType tok = mReader.readNext();
+		if (tok == QXmlStreamReader::Invalid)
+		{
+			// either we need more data, or the document is not well-formed,
+			// which the parser will report
+			return true;
+		}
+		else if (tok == QXmlStreamReader::StartElement)
+		{
+			QString name = mReader.name().toString();
+			const XmlStructure::Element* e = mStack.isEmpty()
+					? mStructure.root(name) : mStack.last()->children.value(name);
+			if (!e)
+			{
+				if (mStack.isEmpty())
+					fail(QString("unexpected document element <%1>").arg(name));
+				else
+					fail(QString("unexpected element <%1> in <%2>").arg(name).arg(mNames.last()));
+				return false;
+			}
+			QXmlStreamAttributes attrs = mReader.attributes();
+			foreach(const QString &attr, e->requiredAttrs)
+			{
+				if (!attrs.hasAttribute(attr))
+				{
+					fail(QString("<%1> is missing the %2 attribute").arg(name).arg(attr));
+					return false;
+				}
+			}
+			mStack.append(e);
+			mNames.append(name);
+		}
+		else if (tok == QXmlStreamReader::EndElement)
+		{
+			mStack.pop_back();
+			mNames.removeLast();
+		}
+	}
+	return true;
+}
+
+void XmlCheckDevice::fail(const QString &msg)
+{
+	mFailed = true;
+	setErrorString(QString("line %1: %2").arg(mReader.lineNumber()).arg(msg));
+}
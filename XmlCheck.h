@@ -0,0 +1,128 @@
+/*
+	Copyright (C) 2010-2011 Igor Izyumin
+
+	This file is part of xpcb.
+
+	xpcb is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	xpcb is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with xpcb.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef XMLCHECK_H
+#define XMLCHECK_H
+
+#include <QIODevice>
+#include <QXmlStreamReader>
+#include <QHash>
+#include <QStringList>
+#include <QVector>
+
+/// The element structure of the xpcb file format.
+
+/// XmlStructure is compiled from the XML schema.  It describes which
+/// elements may appear inside each element, and which attributes are
+/// required.  It does not describe the order or number of elements, or
+/// the types of values; that is left to the full schema validator.
+class XmlStructure
+{
+public:
+	/// An element declaration
+	struct Element
+	{
+		/// Declarations of the allowed child elements, by name
+		QHash<QString, const Element*> children;
+		QStringList requiredAttrs;
+	};
+
+	/// Returns the structure of the xpcb schema.  Thread-safe.
+	static const XmlStructure& xpcb();
+
+	/// Returns the declaration of a top-level element, or NULL.
+	const Element* root(const QString &name) const { return mGlobals.value(name); }
+
+	~XmlStructure();
+
+private:
+	/// A node of the schema document
+	struct Node
+	{
+		QString tag;
+		QXmlStreamAttributes attrs;
+		QList<Node> children;
+	};
+
+	XmlStructure(QIODevice &schema);
+	XmlStructure(const XmlStructure&);
+	XmlStructure& operator=(const XmlStructure&);
+
+	static bool readNode(QXmlStreamReader &reader, Node &node);
+	/// Returns the declaration of a top-level element, compiling it if needed
+	const Element* global(const QString &name);
+	/// Compiles an element declaration or reference
+	const Element* element(const Node &decl);
+	/// Adds the children and attributes declared in a schema node
+	void collect(const Node &node, Element &elem);
+
+	QHash<QString, const Node*> mGlobalNodes;
+	QHash<QString, const Node*> mGroups;
+	QHash<QString, const Node*> mAttrGroups;
+	QHash<QString, const Node*> mTypes;
+	QHash<QString, const Element*> mGlobals;
+	/// Owns all declarations
+	QVector<Element*> mElements;
+	Node mSchema;
+};
+
+/// A read-only device that checks the structure of an XML document as it
+/// is read.
+
+/// XmlCheckDevice passes through the data of another device, while
+/// checking it against an XmlStructure.  When the check fails, the read
+/// fails, before the offending data reaches the reader; errorString()
+/// explains the failure.  This lets a file be checked during the one
+/// streaming parse that loads it, instead of being validated in a separate
+/// pass.  Well-formedness errors are left to the reader of the device.
+class XmlCheckDevice : public QIODevice
+{
+public:
+	/// Creates a device that checks the data of source.  If parent is given,
+	/// the data is checked as the contents of a top-level element of that
+	/// name, which lets one section of a file be checked on its own.
+	XmlCheckDevice(QIODevice *source, const XmlStructure &structure,
+				   const QString &parent = QString());
+
+	/// Returns true if the data read so far violates the structure.
+	bool failed() const { return mFailed; }
+
+	virtual bool isSequential() const { return true; }
+	virtual qint64 bytesAvailable() const
+	{ return QIODevice::bytesAvailable() + mSource->bytesAvailable(); }
+
+protected:
+	virtual qint64 readData(char *data, qint64 maxSize);
+	virtual qint64 writeData(const char *, qint64) { return -1; }
+
+private:
+	/// Checks the data received so far
+	bool check();
+	void fail(const QString &msg);
+
+	QIODevice* mSource;
+	const XmlStructure& mStructure;
+	QXmlStreamReader mReader;
+	/// Declarations and names of the open elements
+	QVector<const XmlStructure::Element*> mStack;
+	QStringList mNames;
+	bool mFailed;
+};
+
+#endif // XMLCHECK_H
@@ -18,10 +18,14 @@
 */
 
 #include "global.h"
+#include "Palette.h"
 #include <QSettings>
 #include <QPainter>
+#include <QPainterPath>
 
-void XPcb::drawArc(QPainter* painter, QPoint start, QPoint end, bool cw)
+/// Computes the ellipse rectangle and start angle (in 1/16 degrees) of
+/// the quarter-ellipse arc from start to end.
+static void arcGeometry(QPoint start, QPoint end, bool cw, QRect &r, int &startAngle)
 {
 	int x1, x2, y1, y2;
 
@@ -40,9 +44,6 @@ void XPcb::drawArc(QPainter* painter, QPoint start, QPoint end, bool cw)
 		x1 = end.x();
 		y1 = end.y();
 	}
-	QRect r;
-	int startAngle;
-
 	// figure out quadrant
 	if (x1 < x2 && y1 > y2)
 	{
@@ -68,10 +69,62 @@ void XPcb::drawArc(QPainter* painter, QPoint start, QPoint end, bool cw)
 		r = QRect(2*x2-x1, y2, 2*(x1-x2), 2*(y1-y2));
 		startAngle = 0;
 	}
+}
 
+void XPcb::drawArc(QPainter* painter, QPoint start, QPoint end, bool cw)
+{
+	QRect r;
+	int startAngle;
+	arcGeometry(start, end, cw, r, startAngle);
 	painter->drawArc(r, startAngle, 90*16);
 }
 
+void XPcb::arcTo(QPainterPath &path, QPoint start, QPoint end, bool cw)
+{
+	QRect r;
+	int startAngle;
+	arcGeometry(start, end, cw, r, startAngle);
+	// the arc starts at startAngle on the clockwise start point (x1, y1)
+	if (cw)
+		path.arcTo(r, startAngle / 16.0, 90);
+	else
+		path.arcTo(r, startAngle / 16.0 + 90, -90);
+}
+
+// view scales (in pixels per inch) below which the simplified levels of
+// detail are used
+static double lodSimpleScale = 60;
+static double lodBoxScale = 20;
+
+double XPcb::pixelSize(const QPainter *painter)
+{
+	double det = qAbs(painter->worldTransform().determinant());
+	return det > 0 ? 1.0 / std::sqrt(det) : 0;
+}
+
+XPcb::LOD XPcb::lod(const QPainter *painter)
+{
+	return lod(painter->worldTransform());
+}
+
+XPcb::LOD XPcb::lod(const QTransform &transform)
+{
+	double det = qAbs(transform.determinant());
+	double ppi = std::sqrt(det) * inchToPcb(1);
+	if (ppi < lodBoxScale)
+		return LOD_BOX;
+	else if (ppi < lodSimpleScale)
+		return LOD_SIMPLE;
+	return LOD_FULL;
+}
+
+void XPcb::loadLodSettings()
+{
+	QSettings s;
+	lodSimpleScale = s.value("view/lodSimpleScale", 60).toDouble();
+	lodBoxScale = s.value("view/lodBoxScale", 20).toDouble();
+}
+
 Dimension::Dimension(double value, Unit unit)
 	: mUnit(unit)
 {
@@ -186,6 +239,5 @@ QString Layer::name(Type c)
 
 QColor Layer::color(Type c)
 {
-	QSettings s;
-	return s.value(QString("colors/%1").arg(Layer::name(c))).value<QColor>();
+	return Palette::instance().color(c);
 }
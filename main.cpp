@@ -21,6 +21,7 @@
 #include "mainwindow.h"
 #include "ManagePadstacksDialog.h"
 #include "Document.h"
+#include "Palette.h"
 #include <QSettings>
 #include "WidgetTestDialog.h"
 
@@ -72,6 +73,14 @@ void initSettings()
 	setDefaultValue(s, "colors/unknown layer", QColor(255, 0, 0));
 }
 
+/// Converts a board between the XML and binary formats.  The format of the
+/// output file is chosen by its extension.
+bool convertBoard(const QString &in, const QString &out)
+{
+	PCBDoc doc;
+	return doc.loadFromFile(in) && doc.saveToFile(out);
+}
+
 int main(int argc, char *argv[])
 {
 	QApplication a(argc, argv);
@@ -81,6 +90,16 @@ int main(int argc, char *argv[])
 
 	// initialize the app settings with defaults, if they do not exist
 	initSettings();
+	// load the layer colors; rendering threads only read them
+	Palette::instance();
+
+	// xpcb --convert <input> <output>
+	QStringList args = a.arguments();
+	if (args.size() == 4 && args[1] == "--convert")
+		return convertBoard(args[2], args[3]) ? 0 : 1;
+
+	// start scanning the footprint library in the background
+	FPDatabase::instance();
 
 //	WidgetTestDialog d;
 //	d.exec();
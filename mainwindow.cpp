@@ -23,6 +23,7 @@
 #include <QMessageBox>
 #include <QFileDialog>
 #include <QCloseEvent>
+#include <QDir>
 #include <QSettings>
 #include "GridToolbarWidget.h"
 #include "ActionBar.h"
@@ -275,6 +276,8 @@ void PCBEditWindow::newDoc()
 			this, SLOT(onRedoAvailableChanged(bool)));
 	connect(this->mDoc, SIGNAL(partsChanged()),
 			this->mPartPlacer, SLOT(updateList()));
+	connect(this->mDoc, SIGNAL(saveFinished(QString,bool)),
+			this, SLOT(onSaveFinished(QString,bool)));
 	ctrl()->registerDoc(mDoc);
 	setCurrentFile("");
 }
@@ -284,6 +287,7 @@ void PCBEditWindow::closeDoc()
 	if (mDoc)
 	{
 		ctrl()->registerDoc(NULL);
+		mDoc->stopJournal();
 		delete mDoc;
 		mDoc = NULL;
 	}
@@ -312,6 +316,79 @@ Document* PCBEditWindow::doc()
 	return mDoc;
 }
 
+void PCBEditWindow::closeEvent(QCloseEvent *event)
+{
+	MainWindow::closeEvent(event);
+	if (event->isAccepted())
+		closeDoc();
+}
+
+bool PCBEditWindow::maybeSave()
+{
+	// the result of a running save decides whether the board is modified;
+	// the board may be closed next, so also wait for a save started here
+	if (mDoc)
+		mDoc->waitForSave();
+	return MainWindow::maybeSave() && (!mDoc || mDoc->waitForSave());
+}
+
+bool PCBEditWindow::loadFile(const QString &fileName)
+{
+	bool journal = true;
+	if (mDoc && PCBDoc::hasJournal(fileName)
+			&& QMessageBox::question(this, tr("xpcb"),
+					tr("%1 has unsaved changes from a session that did not end normally.\n"
+					   "Do you want to recover them?").arg(strippedName(fileName)),
+					QMessageBox::Yes | QMessageBox::No) == QMessageBox::Yes)
+	{
+		if (mDoc->recoverJournal(fileName))
+		{
+			setCurrentFile(fileName);
+			statusBar()->showMessage(tr("Unsaved changes recovered"), 2000);
+			emit documentHasChanged();
+			mDoc->startJournal(fileName);
+			return true;
+		}
+		// a new journal would replace the old one, and with it the
+		// changes the user asked for
+		QString kept = PCBDoc::setJournalAside(fileName);
+		journal = !kept.isEmpty();
+		QMessageBox::warning(this, tr("xpcb"), journal
+				? tr("The unsaved changes to %1 could not be recovered.\n"
+					 "They were kept in %2.").arg(strippedName(fileName))
+						.arg(QDir::toNativeSeparators(kept))
+				: tr("The unsaved changes to %1 could not be recovered.\n"
+					 "Changes will not be recorded for crash recovery until "
+					 "the board is reopened.").arg(strippedName(fileName)));
+	}
+	if (!MainWindow::loadFile(fileName))
+		return false;
+	if (journal)
+		mDoc->startJournal(fileName);
+	return true;
+}
+
+bool PCBEditWindow::saveFile(const QString &fileName)
+{
+	if (!mDoc || !mDoc->saveInBackground(fileName))
+		return false;
+	statusBar()->showMessage(tr("Saving..."));
+	return true;
+}
+
+void PCBEditWindow::onSaveFinished(const QString &fileName, bool ok)
+{
+	if (ok)
+	{
+		setCurrentFile(fileName);
+		// the journal follows the board to its new file
+		mDoc->startJournal(fileName);
+		statusBar()->showMessage(tr("File saved"), 2000);
+	}
+	else
+		statusBar()->showMessage(tr("Unable to save file"), 2000);
+}
+
 void PCBEditWindow::loadGeom()
 {
 	// restore geometry
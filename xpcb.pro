@@ -60,17 +60,42 @@ SOURCES += PCBView.cpp \
     NetlistDialog.cpp \
     PartPlacer.cpp \
     AreaEditor.cpp \
-    EditPart.cpp
+    EditPart.cpp \
+    SpatialIndex.cpp \
+    UnionFind.cpp \
+    Delaunay.cpp \
+    TileCache.cpp \
+    Palette.cpp \
+    FPSearchIndex.cpp \
+    FPPreviewCache.cpp \
+    FootprintCache.cpp \
+    XmlCheck.cpp \
+    BoardFile.cpp \
+    XmlAttr.cpp \
+    AtomicFile.cpp \
+    Journal.cpp
 
 unittest {
 	QT += testlib
 	SOURCES +=	xpcbtests/tst_XmlLoadTest.cpp \
 				xpcbtests/testmain.cpp \
 				xpcbtests/tst_TextTest.cpp \
-				xpcbtests/tst_UnitSpinboxTest.cpp
+				xpcbtests/tst_UnitSpinboxTest.cpp \
+				xpcbtests/tst_SpatialIndexTest.cpp \
+				xpcbtests/tst_TraceListTest.cpp \
+				xpcbtests/tst_FPSearchIndexTest.cpp \
+				xpcbtests/tst_BoardFileTest.cpp \
+				xpcbtests/tst_DocumentSaveTest.cpp \
+				xpcbtests/tst_JournalTest.cpp
 	HEADERS += xpcbtests/tst_XmlLoadTest.h \
 			   xpcbtests/tst_TextTest.h \
-			   xpcbtests/tst_UnitSpinboxTest.h
+			   xpcbtests/tst_UnitSpinboxTest.h \
+			   xpcbtests/tst_SpatialIndexTest.h \
+			   xpcbtests/tst_TraceListTest.h \
+			   xpcbtests/tst_FPSearchIndexTest.h \
+			   xpcbtests/tst_BoardFileTest.h \
+			   xpcbtests/tst_DocumentSaveTest.h \
+			   xpcbtests/tst_JournalTest.h
 
 } else {
 	SOURCES += main.cpp
@@ -121,7 +146,20 @@ HEADERS  += PCBView.h \
     PartPlacer.h \
     AreaEditor.h \
     EditPart.h \
-    CtrlAction.h
+    CtrlAction.h \
+    SpatialIndex.h \
+    UnionFind.h \
+    Delaunay.h \
+    TileCache.h \
+    Palette.h \
+    FPSearchIndex.h \
+    FPPreviewCache.h \
+    FootprintCache.h \
+    XmlCheck.h \
+    BoardFile.h \
+    XmlAttr.h \
+    AtomicFile.h \
+    Journal.h
 
 
 FORMS    += GridToolbarWidget.ui \
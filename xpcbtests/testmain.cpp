@@ -1,6 +1,12 @@
 #include "tst_XmlLoadTest.h"
 #include "tst_TextTest.h"
 #include "tst_UnitSpinboxTest.h"
+#include "tst_SpatialIndexTest.h"
+#include "tst_TraceListTest.h"
+#include "tst_FPSearchIndexTest.h"
+#include "tst_BoardFileTest.h"
+#include "tst_DocumentSaveTest.h"
+#include "tst_JournalTest.h"
 
 int main(int argc, char* argv[])
 {
@@ -12,6 +18,18 @@ int main(int argc, char* argv[])
 	QTest::qExec(&textTest);
 	UnitLineEditTest sbTest;
 	QTest::qExec(&sbTest);
+	SpatialIndexTest indexTest;
+	QTest::qExec(&indexTest);
+	TraceListTest traceTest;
+	QTest::qExec(&traceTest);
+	FPSearchIndexTest searchTest;
+	QTest::qExec(&searchTest);
+	BoardFileTest boardTest;
+	QTest::qExec(&boardTest);
+	DocumentSaveTest saveTest;
+	QTest::qExec(&saveTest);
+	JournalTest journalTest;
+	QTest::qExec(&journalTest);
 
 	return 0;
 }
@@ -0,0 +1,217 @@
+/*
+	Copyright (C) 2010-2011 Igor Izyumin
+
+	This file is part of xpcb.
+
+	xpcb is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	xpcb is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with xpcb.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <QBuffer>
+#include "tst_BoardFileTest.h"
+#include "BoardFile.h"
+#include "Document.h"
+
+BoardFileTest::BoardFileTest()
+{
+}
+
+void BoardFileTest::makeBoard(PCBDoc &doc)
+{
+	doc.mName = "test";
+	doc.mNumLayers = 4;
+
+	QSharedPointer<Padstack> ps(new Padstack());
+	ps->startPad() = Pad(Pad::PAD_ROUND, XPcb::milToPcb(60));
+	doc.addPadstack(ps);
+
+	QSharedPointer<Footprint> fp(new Footprint());
+	fp->addPadstack(ps);
+	for(int i = 0; i < 2; i++)
+	{
+		QSharedPointer<Pin> pin(new Pin(fp.data()));
+		pin->setName(QString::number(i + 1));
+		pin->setPos(QPoint(XPcb::milToPcb(100 * i), 0));
+		pin->setPadstack(ps);
+		fp->addPin(pin);
+	}
+	doc.mFootprints.insert(fp->uuid(), fp);
+
+	QSharedPointer<Part> part(new Part(&doc));
+	part->setFootprint(fp->uuid());
+	part->setPos(QPoint(XPcb::milToPcb(500), XPcb::milToPcb(200)));
+	part->setAngle(90);
+	part->setSide(Part::SIDE_BOTTOM);
+	part->setLocked(true);
+	part->setRefVisible(true);
+	part->refdesText()->setText("R1");
+	part->refdesText()->setPos(QPoint(XPcb::milToPcb(500), XPcb::milToPcb(300)));
+	part->valueText()->setText("10k");
+	doc.addPart(part);
+
+	doc.netlist()->addPart(NLPart("R1", "RES0805", "10k"));
+	NLNet net("GND");
+	net.addPin(NLPin("R1", "1"));
+	net.addPin(NLPin("R1", "2"));
+	doc.netlist()->addNet(net);
+
+	QSharedPointer<Vertex> v1(new Vertex(QPoint(0, 0)));
+	QSharedPointer<Vertex> v2(new Vertex(QPoint(XPcb::milToPcb(1000), 0)));
+	doc.traceList()->addSegment(QSharedPointer<Segment>(
+			new Segment(Layer::LAY_TOP_COPPER, XPcb::milToPcb(10))), v1, v2);
+
+	PolyContour hole;
+	hole.appendSegment(PolyContour::Segment(PolyContour::Segment::START, QPoint(10, 10)));
+	hole.appendSegment(PolyContour::Segment(PolyContour::Segment::LINE, QPoint(20, 10)));
+	hole.appendSegment(PolyContour::Segment(PolyContour::Segment::LINE, QPoint(20, 20)));
+	QSharedPointer<Area> area(new Area(&doc));
+	area->setLayer(Layer::LAY_BOTTOM_COPPER);
+	PolyContour* outline = area->poly().outline();
+	outline->appendSegment(PolyContour::Segment(PolyContour::Segment::START, QPoint(0, 0)));
+	outline->appendSegment(PolyContour::Segment(PolyContour::Segment::LINE, QPoint(100, 0)));
+	outline->appendSegment(PolyContour::Segment(PolyContour::Segment::ARC_CW, QPoint(100, 100)));
+	area->poly().appendHole(hole);
+	doc.addArea(area);
+
+	doc.addText(QSharedPointer<Text>(new Text(QPoint(100, 200), 0, false, false,
+											  Layer::LAY_SILK_TOP, 1000, 100,
+											  QString::fromUtf8("h\xc3\xa9llo"))));
+}
+
+void BoardFileTest::testRoundTrip()
+{
+	PCBDoc doc;
+	makeBoard(doc);
+	QBuffer buf;
+	buf.open(QIODevice::ReadWrite);
+	QVERIFY(BoardFile::save(doc, buf));
+	buf.seek(0);
+	QVERIFY(BoardFile::isBinary(buf));
+
+	PCBDoc loaded;
+	const QByteArray &data = buf.data();
+	QVERIFY(BoardFile::load(loaded, reinterpret_cast<const uchar*>(data.constData()),
+							data.size()));
+
+	QCOMPARE(loaded.name(), QString("test"));
+	QCOMPARE(loaded.numLayers(), 4);
+	QCOMPARE(loaded.padstacks().size(), 1);
+	QCOMPARE(loaded.footprints().size(), 1);
+
+	QSharedPointer<Part> orig = doc.part("R1");
+	QSharedPointer<Part> part = loaded.part("R1");
+	QVERIFY(part);
+	QCOMPARE(part->value(), QString("10k"));
+	QCOMPARE(part->pos(), orig->pos());
+	QCOMPARE(part->angle(), 90);
+	QCOMPARE(part->side(), Part::SIDE_BOTTOM);
+	QVERIFY(part->locked());
+	QCOMPARE(part->refdesText()->pos(), orig->refdesText()->pos());
+	QCOMPARE(part->pins().size(), 2);
+
+	QString gnd("GND");
+	QCOMPARE(loaded.netlist()->net(gnd).pins().size(), 2);
+	QCOMPARE(loaded.netlist()->part("R1").footprint(), QString("RES0805"));
+
+	QSharedPointer<TraceList> tl = loaded.traceList();
+	QCOMPARE(tl->vertices().size(), 2);
+	QCOMPARE(tl->segments().size(), 1);
+	QCOMPARE(tl->segments().values().first()->width(), XPcb::milToPcb(10));
+
+	QCOMPARE(loaded.mAreas.size(), 1);
+	Polygon &poly = loaded.mAreas.first()->poly();
+	QCOMPARE(poly.outline()->numSegs(), 3);
+	QCOMPARE(poly.outline()->segment(2).type, PolyContour::Segment::ARC_CW);
+	QCOMPARE(poly.numHoles(), 1);
+	QCOMPARE(poly.hole(0)->segment(1).end, QPoint(20, 10));
+
+	QCOMPARE(loaded.mTexts.size(), 1);
+	QCOMPARE(loaded.mTexts.first()->text(), QString::fromUtf8("h\xc3\xa9llo"));
+}
+
+void BoardFileTest::testMissingFootprint()
+{
+	// a part whose footprint is neither in the board nor in the library
+	// must survive a save and reload
+	PCBDoc doc;
+	makeBoard(doc);
+	QUuid uuid = QUuid::createUuid();
+	QSharedPointer<Part> part(new Part(&doc));
+	part->setFootprint(uuid);
+	QVERIFY(!part->footprint());
+	part->setPos(QPoint(XPcb::milToPcb(100), XPcb::milToPcb(100)));
+	part->refdesText()->setText("U1");
+	doc.addPart(part);
+
+	QBuffer buf;
+	buf.open(QIODevice::ReadWrite);
+	QVERIFY(BoardFile::save(doc, buf));
+
+	PCBDoc loaded;
+	const QByteArray &data = buf.data();
+	QVERIFY(BoardFile::load(loaded, reinterpret_cast<const uchar*>(data.constData()),
+							data.size()));
+	QSharedPointer<Part> p = loaded.part("U1");
+	QVERIFY(p);
+	QCOMPARE(p->fpUuid(), uuid);
+	QCOMPARE(p->pos(), part->pos());
+	QVERIFY(p->pins().isEmpty());
+	QVERIFY(loaded.part("R1"));
+}
+
+void BoardFileTest::testCorrupt()
+{
+	PCBDoc doc;
+	makeBoard(doc);
+	QBuffer buf;
+	buf.open(QIODevice::ReadWrite);
+	QVERIFY(BoardFile::save(doc, buf));
+	QByteArray data = buf.data();
+
+	PCBDoc loaded;
+	QByteArray truncated = data.left(data.size() / 2);
+	QVERIFY(!BoardFile::load(loaded, reinterpret_cast<const uchar*>(truncated.constData()),
+							 truncated.size()));
+	QByteArray garbage(64, 'x');
+	QVERIFY(!BoardFile::load(loaded, reinterpret_cast<const uchar*>(garbage.constData()),
+							 garbage.size()));
+}
+
+void BoardFileTest::testWriteXml()
+{
+	PCBDoc doc;
+	makeBoard(doc);
+	QSharedPointer<Padstack> ps = doc.padstacks().first();
+	doc.traceList()->myVias.insert(QSharedPointer<Via>(
+			new Via(QPoint(XPcb::milToPcb(300), 0), ps)));
+
+	QByteArray expected;
+	QBuffer expectedBuf(&expected);
+	expectedBuf.open(QIODevice::WriteOnly);
+	QXmlStreamWriter expectedWriter(&expectedBuf);
+	QVERIFY(doc.saveToXml(expectedWriter));
+
+	// background saves convert the binary image instead of calling the
+	// objects' toXML(); the two must not drift apart
+	QBuffer image;
+	image.open(QIODevice::WriteOnly);
+	QVERIFY(BoardFile::save(doc, image));
+	QByteArray xml;
+	QBuffer xmlBuf(&xml);
+	xmlBuf.open(QIODevice::WriteOnly);
+	QXmlStreamWriter writer(&xmlBuf);
+	QVERIFY(BoardFile::writeXml(reinterpret_cast<const uchar*>(image.data().constData()),
+								image.data().size(), writer));
+	QCOMPARE(QString::fromUtf8(xml), QString::fromUtf8(expected));
+}
@@ -0,0 +1,155 @@
+/*
+	Copyright (C) 2010-2011 Igor Izyumin
+
+	This file is part of xpcb.
+
+	xpcb is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	xpcb is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with xpcb.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <QDir>
+#include "tst_DocumentSaveTest.h"
+#include "tst_BoardFileTest.h"
+#include "Document.h"
+#include "AtomicFile.h"
+
+DocumentSaveTest::DocumentSaveTest()
+{
+}
+
+void DocumentSaveTest::testBackgroundSave()
+{
+	QString path = QDir::temp().filePath("xpcb_bgsave_test.xpcb");
+	QFile old(path);
+	QVERIFY(old.open(QIODevice::WriteOnly));
+	old.write("old contents");
+	old.close();
+
+	PCBDoc doc;
+	BoardFileTest::makeBoard(doc);
+	QSignalSpy finished(&doc, SIGNAL(saveFinished(QString,bool)));
+	QVERIFY(doc.saveInBackground(path));
+	// an edit made while the board is saved is not in the file
+	doc.doCommand(new QUndoCommand());
+	QVERIFY(doc.waitForSave());
+	QCOMPARE(finished.count(), 1);
+	QVERIFY(doc.isModified());
+	QVERIFY(!doc.isSaving());
+
+	PCBDoc loaded;
+	QVERIFY(loaded.loadFromFile(path));
+	QVERIFY(loaded.part("R1"));
+	QCOMPARE(loaded.traceList()->segments().size(), 1);
+	QCOMPARE(loaded.mTexts.size(), 1);
+
+	QVERIFY(doc.saveInBackground(path));
+	QVERIFY(doc.waitForSave());
+	QVERIFY(!doc.isModified());
+	// the temporary files were renamed over the target
+	QStringList files = QDir::temp().entryList(QStringList("xpcb_bgsave_test.xpcb*"));
+	QCOMPARE(files, QStringList("xpcb_bgsave_test.xpcb"));
+	QFile::remove(path);
+}
+
+void DocumentSaveTest::testEditWhileSaving()
+{
+	QString path = QDir::temp().filePath("xpcb_editsave_test.xpcb");
+	PCBDoc doc;
+	BoardFileTest::makeBoard(doc);
+	QSharedPointer<Part> part = doc.part("R1");
+	QPoint oldPos = part->pos();
+	QVERIFY(doc.saveInBackground(path));
+
+	// edit the board while the worker writes its snapshot
+	PCBObjState prev = part->getState();
+	part->setPos(QPoint(XPcb::milToPcb(900), XPcb::milToPcb(200)));
+	doc.doCommand(new PCBObjEditCmd(NULL, part, prev));
+	QSharedPointer<Segment> seg = doc.traceList()->segments().values().first();
+	doc.doCommand(doc.traceList()->removeSegmentCmd(seg));
+	QCOMPARE(doc.traceList()->segments().size(), 0);
+	QRect partRect = part->bbox();
+	QRect segRect = seg->bbox();
+	QVERIFY(doc.findObjs(partRect).contains(part));
+	QVERIFY(!doc.findObjs(segRect).contains(seg));
+
+	QVERIFY(doc.waitForSave());
+	QVERIFY(doc.isModified());
+	// the edits are still there, and the file has the board as it was
+	QCOMPARE(part->pos(), QPoint(XPcb::milToPcb(900), XPcb::milToPcb(200)));
+	PCBDoc saved;
+	QVERIFY(saved.loadFromFile(path));
+	QCOMPARE(saved.part("R1")->pos(), oldPos);
+	QCOMPARE(saved.traceList()->segments().size(), 1);
+
+	doc.undo();
+	doc.undo();
+	QCOMPARE(part->pos(), oldPos);
+	QCOMPARE(doc.traceList()->segments().size(), 1);
+	partRect = part->bbox();
+	QVERIFY(doc.findObjs(partRect).contains(part));
+	QFile::remove(path);
+}
+
+void DocumentSaveTest::testMissingFootprint()
+{
+	// a part whose footprint can't be found is written to XML as is
+	QString path = QDir::temp().filePath("xpcb_missingfp_test.xpcb");
+	PCBDoc doc;
+	BoardFileTest::makeBoard(doc);
+	QUuid uuid = QUuid::createUuid();
+	QSharedPointer<Part> part(new Part(&doc));
+	part->setFootprint(uuid);
+	part->setPos(QPoint(XPcb::milToPcb(100), XPcb::milToPcb(100)));
+	part->refdesText()->setText("U1");
+	doc.addPart(part);
+	QVERIFY(doc.saveInBackground(path));
+	QVERIFY(doc.waitForSave());
+
+	PCBDoc loaded;
+	QVERIFY(loaded.loadFromFile(path));
+	QSharedPointer<Part> p = loaded.part("U1");
+	QVERIFY(p);
+	QCOMPARE(p->fpUuid(), uuid);
+	QCOMPARE(p->pos(), part->pos());
+	QSharedPointer<Part> r1 = loaded.part("R1");
+	QVERIFY(r1);
+	QCOMPARE(r1->pos(), doc.part("R1")->pos());
+	QCOMPARE(r1->pins().size(), 2);
+	QString gnd("GND");
+	QCOMPARE(loaded.netlist()->net(gnd).pins().size(), 2);
+	QCOMPARE(loaded.traceList()->segments().size(), 1);
+	QCOMPARE(loaded.mAreas.size(), 1);
+	QCOMPARE(loaded.mAreas.first()->poly().numHoles(), 1);
+	QCOMPARE(loaded.mTexts.size(), 1);
+	QFile::remove(path);
+}
+
+void DocumentSaveTest::testNewFileMode()
+{
+	// a new board gets the same permissions as any other new file
+	QString ref = QDir::temp().filePath("xpcb_mode_ref.txt");
+	QString path = QDir::temp().filePath("xpcb_mode_test.xpcbb");
+	QFile::remove(path);
+	QFile refFile(ref);
+	QVERIFY(refFile.open(QIODevice::WriteOnly));
+	refFile.close();
+
+	AtomicFile file(path);
+	QVERIFY(file.open());
+	file.write("data");
+	QVERIFY(file.commit());
+	QCOMPARE(QFile::permissions(path), QFile::permissions(ref));
+	QFile::remove(ref);
+	QFile::remove(path);
+}
@@ -0,0 +1,124 @@
+/*
+	Copyright (C) 2010-2011 Igor Izyumin
+
+	This file is part of xpcb.
+
+	xpcb is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	xpcb is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with xpcb.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "tst_FPSearchIndexTest.h"
+#include "FPSearchIndex.h"
+
+static FPSearchIndex::Entry entry(QString name, QString desc,
+								  int pins = 0, int padTypes = 0)
+{
+	FPSearchIndex::Entry e;
+	e.name = name;
+	e.desc = desc;
+	e.author = "xpcb";
+	e.pinCount = pins;
+	e.padTypes = padTypes;
+	return e;
+}
+
+FPSearchIndexTest::FPSearchIndexTest()
+{
+}
+
+void FPSearchIndexTest::testText()
+{
+	FPSearchIndex index;
+	int soic8 = index.add(entry("SOIC-8", "Small outline IC"));
+	int soic16 = index.add(entry("SOIC-16W", "Small outline IC, wide body"));
+	int r0402 = index.add(entry("R0402", "Chip resistor"));
+
+	// name substrings, with and without the trigram index
+	QCOMPARE(index.search("oic"), QSet<int>() << soic8 << soic16);
+	QCOMPARE(index.search("16"), QSet<int>() << soic16);
+	QCOMPARE(index.search("0402"), QSet<int>() << r0402);
+	// description word prefixes, case insensitive
+	QCOMPARE(index.search("Resist"), QSet<int>() << r0402);
+	QCOMPARE(index.search("wide"), QSet<int>() << soic16);
+	// all terms must match
+	QCOMPARE(index.search("soic outline"), QSet<int>() << soic8 << soic16);
+	QCOMPARE(index.search("soic chip"), QSet<int>());
+	QCOMPARE(index.search("xyzzy"), QSet<int>());
+	QCOMPARE(index.search("xpcb").size(), 3);
+}
+
+void FPSearchIndexTest::testFacets()
+{
+	FPSearchIndex index;
+	int soic8 = index.add(entry("SOIC-8", "", 8, FPSearchIndex::PAD_SMD
+								| FPSearchIndex::PAD_RECT));
+	int dip8 = index.add(entry("DIP-8", "", 8, FPSearchIndex::PAD_TH
+							   | FPSearchIndex::PAD_ROUND));
+	int dip14 = index.add(entry("DIP-14", "", 14, FPSearchIndex::PAD_TH
+								| FPSearchIndex::PAD_ROUND));
+
+	QCOMPARE(index.search("pins:8"), QSet<int>() << soic8 << dip8);
+	QCOMPARE(index.search("pins:10-20"), QSet<int>() << dip14);
+	QCOMPARE(index.search("pins:9-"), QSet<int>() << dip14);
+	QCOMPARE(index.search("pad:th"), QSet<int>() << dip8 << dip14);
+	QCOMPARE(index.search("pad:smd pad:rect"), QSet<int>() << soic8);
+	QCOMPARE(index.search("dip pins:8"), QSet<int>() << dip8);
+	// incomplete facets are ignored
+	QCOMPARE(index.search("pins:").size(), 3);
+	QCOMPARE(index.search("pad:sm").size(), 3);
+}
+
+void FPSearchIndexTest::testRemove()
+{
+	FPSearchIndex index;
+	int a = index.add(entry("QFN-32", "Quad flat no-lead"));
+	int b = index.add(entry("QFN-48", "Quad flat no-lead"));
+	QCOMPARE(index.size(), 2);
+	index.remove(a);
+	QCOMPARE(index.size(), 1);
+	QCOMPARE(index.search("qfn"), QSet<int>() << b);
+	QCOMPARE(index.search("quad"), QSet<int>() << b);
+	QCOMPARE(index.search("q"), QSet<int>() << b);
+	// ids are not reused
+	int c = index.add(entry("QFN-32", "Quad flat no-lead"));
+	QVERIFY(c != a);
+	QCOMPARE(index.search("qfn-32"), QSet<int>() << c);
+}
+
+void FPSearchIndexTest::testCompact()
+{
+	FPSearchIndex index;
+	QList<int> ids;
+	for(int i = 0; i < 10; i++)
+		ids.append(index.add(entry(QString("SOT-%1").arg(i), "Small outline transistor",
+								   i, FPSearchIndex::PAD_SMD)));
+	// removing most of the footprints compacts the index, which must not
+	// change the ids of the others
+	for(int i = 0; i < 8; i++)
+		index.remove(ids[i]);
+	QCOMPARE(index.size(), 2);
+	QCOMPARE(index.search("sot"), QSet<int>() << ids[8] << ids[9]);
+	QCOMPARE(index.search("transistor"), QSet<int>() << ids[8] << ids[9]);
+	QCOMPARE(index.search("9"), QSet<int>() << ids[9]);
+	QCOMPARE(index.search("pins:9"), QSet<int>() << ids[9]);
+	QCOMPARE(index.search("sot-3"), QSet<int>());
+	// removed ids stay removed
+	index.remove(ids[0]);
+	QCOMPARE(index.size(), 2);
+
+	int c = index.add(entry("SOT-3", "Small outline transistor"));
+	QVERIFY(!ids.contains(c));
+	QCOMPARE(index.search("sot-3"), QSet<int>() << c);
+	index.remove(ids[8]);
+	QCOMPARE(index.search("small"), QSet<int>() << ids[9] << c);
+}
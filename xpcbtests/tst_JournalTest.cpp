@@ -0,0 +1,161 @@
+/*
+	Copyright (C) 2010-2011 Igor Izyumin
+
+	This file is part of xpcb.
+
+	xpcb is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	xpcb is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with xpcb.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <QDir>
+#include "tst_JournalTest.h"
+#include "tst_BoardFileTest.h"
+#include "Document.h"
+#include "ManagePadstacksDialog.h"
+
+JournalTest::JournalTest()
+{
+}
+
+void JournalTest::testRecover()
+{
+	QString path = QDir::temp().filePath("xpcb_journal_test.xpcb");
+	PCBDoc doc;
+	BoardFileTest::makeBoard(doc);
+	QVERIFY(doc.startJournal(path));
+	doc.mJournal->waitForSnapshot();
+	QVERIFY(QFile::exists(Journal::fileFor(path)));
+	// the snapshot of an unmodified board has nothing to recover
+	QVERIFY(!PCBDoc::hasJournal(path));
+
+	QSharedPointer<Part> part = doc.part("R1");
+	PCBObjState prev = part->getState();
+	part->setPos(QPoint(XPcb::milToPcb(700), XPcb::milToPcb(200)));
+	doc.doCommand(new PCBObjEditCmd(NULL, part, prev));
+	QSharedPointer<Segment> seg = doc.traceList()->segments().values().first();
+	doc.doCommand(doc.traceList()->removeSegmentCmd(seg));
+	QVERIFY(PCBDoc::hasJournal(path));
+
+	PCBDoc recovered;
+	QVERIFY(recovered.recoverJournal(path));
+	QVERIFY(recovered.isModified());
+	QCOMPARE(recovered.part("R1")->pos(), part->pos());
+	QCOMPARE(recovered.part("R1")->refdesText()->text(), QString("R1"));
+	QCOMPARE(recovered.traceList()->segments().size(), 0);
+	QCOMPARE(recovered.traceList()->vertices().size(), 0);
+	QCOMPARE(recovered.mAreas.size(), 1);
+	QCOMPARE(recovered.mTexts.size(), 1);
+	QCOMPARE(recovered.padstacks().size(), 1);
+
+	// undoing the edits brings the segment back
+	doc.undo();
+	doc.undo();
+	// a record torn by a crash is ignored
+	QFile journal(Journal::fileFor(path));
+	QVERIFY(journal.open(QIODevice::Append));
+	journal.write("\x02");
+	journal.close();
+	PCBDoc undone;
+	QVERIFY(undone.recoverJournal(path));
+	QCOMPARE(undone.traceList()->segments().size(), 1);
+	QCOMPARE(undone.part("R1")->pos(), QPoint(XPcb::milToPcb(500), XPcb::milToPcb(200)));
+
+	doc.stopJournal();
+	QVERIFY(!QFile::exists(Journal::fileFor(path)));
+}
+
+void JournalTest::testPadstacks()
+{
+	QString path = QDir::temp().filePath("xpcb_journal_test.xpcb");
+	PCBDoc doc;
+	BoardFileTest::makeBoard(doc);
+	QVERIFY(doc.startJournal(path));
+	doc.mJournal->waitForSnapshot();
+
+	// padstacks are edited in place, then reported to the document
+	QSharedPointer<Padstack> ps = doc.padstacks().first();
+	Padstack edited(*ps);
+	edited.setHoleSize(XPcb::milToPcb(30));
+	doc.doCommand(new EditPadstackCmd(NULL, &doc, ps, edited));
+	Padstack added;
+	added.setName("VIA");
+	doc.doCommand(new NewPadstackCmd(NULL, &doc, added));
+
+	PCBDoc recovered;
+	QVERIFY(recovered.recoverJournal(path));
+	QCOMPARE(recovered.padstacks().size(), 2);
+	QCOMPARE(recovered.padstack(ps->uuid())->holeSize(), XPcb::milToPcb(30));
+
+	doc.undo();
+	PCBDoc undone;
+	QVERIFY(undone.recoverJournal(path));
+	QCOMPARE(undone.padstacks().size(), 1);
+
+	doc.stopJournal();
+}
+
+void JournalTest::testCompact()
+{
+	QString path = QDir::temp().filePath("xpcb_journal_test.xpcb");
+	PCBDoc doc;
+	BoardFileTest::makeBoard(doc);
+	QSharedPointer<Part> part = doc.part("R1");
+	QPoint pos = part->pos();
+	// edits made before the first snapshot is written are kept
+	QVERIFY(doc.startJournal(path));
+	PCBObjState prev = part->getState();
+	part->setPos(pos + QPoint(100, 0));
+	doc.doCommand(new PCBObjEditCmd(NULL, part, prev));
+	doc.mJournal->waitForSnapshot();
+
+	// and so are edits made while the journal is compacted, which refer to
+	// objects by the ids they had before
+	doc.mJournal->startSnapshot();
+	prev = part->getState();
+	part->setPos(pos + QPoint(200, 0));
+	doc.doCommand(new PCBObjEditCmd(NULL, part, prev));
+	QSharedPointer<Segment> seg = doc.traceList()->segments().values().first();
+	doc.doCommand(doc.traceList()->removeSegmentCmd(seg));
+	doc.mJournal->waitForSnapshot();
+	QVERIFY(!QFile::exists(doc.mJournal->snapshotFile()));
+
+	PCBDoc recovered;
+	QVERIFY(recovered.recoverJournal(path));
+	QCOMPARE(recovered.mParts.size(), 1);
+	QCOMPARE(recovered.part("R1")->pos(), pos + QPoint(200, 0));
+	QCOMPARE(recovered.traceList()->segments().size(), 0);
+
+	doc.stopJournal();
+	QVERIFY(!QFile::exists(Journal::fileFor(path)));
+}
+
+void JournalTest::testSetAside()
+{
+	QString path = QDir::temp().filePath("xpcb_journal_test.xpcb");
+	PCBDoc doc;
+	BoardFileTest::makeBoard(doc);
+	QVERIFY(doc.startJournal(path));
+	doc.mJournal->waitForSnapshot();
+	doc.doCommand(new QUndoCommand());
+	// leave the journal behind, as a crash would
+	doc.mJournal.reset();
+	QVERIFY(PCBDoc::hasJournal(path));
+
+	QString kept = PCBDoc::setJournalAside(path);
+	QVERIFY(!kept.isEmpty());
+	QVERIFY(!QFile::exists(Journal::fileFor(path)));
+	QVERIFY(QFile::exists(kept));
+	QVERIFY(Journal::hasUnsaved(kept));
+	QFile::remove(kept);
+}
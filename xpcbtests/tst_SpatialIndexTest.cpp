@@ -0,0 +1,164 @@
+/*
+	Copyright (C) 2010-2011 Igor Izyumin
+
+	This file is part of xpcb.
+
+	xpcb is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	xpcb is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with xpcb.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "tst_SpatialIndexTest.h"
+#include "SpatialIndex.h"
+
+/// Object with a settable bounding box
+class RectDummy : public PCBObject
+{
+public:
+	RectDummy(const QRect &r = QRect()) : PCBObject(NULL), mRect(r) {}
+	virtual void draw(QPainter *, const Layer&) const {}
+	virtual QRect bbox() const { return mRect; }
+	virtual PCBObjState getState() const { return PCBObjState(); }
+	virtual bool loadState(PCBObjState &) { return false; }
+
+	QRect mRect;
+};
+
+typedef QSharedPointer<PCBObject> ObjPtr;
+
+static QRect randomRect()
+{
+	return QRect(qrand() % 100000, qrand() % 100000,
+				 qrand() % 3000 + 1, qrand() % 3000 + 1);
+}
+
+/// Checks the index against a linear scan of the objects in it.
+static bool checkQuery(const SpatialIndex &index, const QList<ObjPtr> &objs,
+					   const QRect &rect)
+{
+	QSet<ObjPtr> expected;
+	foreach(ObjPtr o, objs)
+	{
+		if (o->bbox().intersects(rect))
+			expected.insert(o);
+	}
+	QList<ObjPtr> found = index.query(rect);
+	return found.size() == expected.size()
+			&& QSet<ObjPtr>::fromList(found) == expected;
+}
+
+SpatialIndexTest::SpatialIndexTest()
+{
+}
+
+void SpatialIndexTest::testQuery()
+{
+	SpatialIndex index;
+	ObjPtr a(new RectDummy(QRect(0, 0, 100, 100)));
+	ObjPtr b(new RectDummy(QRect(200, 200, 10, 10)));
+	ObjPtr empty(new RectDummy(QRect()));
+	index.insert(a);
+	index.insert(b);
+	index.insert(empty);
+
+	QCOMPARE(index.size(), 3);
+	QCOMPARE(index.query(QRect(50, 50, 10, 10)), QList<ObjPtr>() << a);
+	QCOMPARE(index.query(QRect(205, 205, 1, 1)), QList<ObjPtr>() << b);
+	QCOMPARE(index.query(QRect(100, 100, 100, 100)).size(), 0);
+	QCOMPARE(index.query(QRect(-10, -10, 1000, 1000)).size(), 2);
+}
+
+void SpatialIndexTest::testInsertRemove()
+{
+	qsrand(1);
+	SpatialIndex index;
+	QList<ObjPtr> objs;
+	for(int i = 0; i < 5000; i++)
+	{
+		ObjPtr o(new RectDummy(randomRect()));
+		objs.append(o);
+		index.insert(o);
+	}
+	QCOMPARE(index.size(), objs.size());
+	for(int i = 0; i < 50; i++)
+		QVERIFY(checkQuery(index, objs, randomRect()));
+
+	// remove every other object
+	for(int i = objs.size() - 1; i >= 0; i -= 2)
+	{
+		QVERIFY(index.remove(objs[i].data()));
+		QVERIFY(!index.contains(objs[i].data()));
+		objs.removeAt(i);
+	}
+	QCOMPARE(index.size(), objs.size());
+	QVERIFY(!index.remove(NULL));
+	for(int i = 0; i < 50; i++)
+		QVERIFY(checkQuery(index, objs, randomRect()));
+
+	foreach(ObjPtr o, objs)
+		QVERIFY(index.remove(o.data()));
+	QCOMPARE(index.size(), 0);
+	QCOMPARE(index.query(QRect(0, 0, 200000, 200000)).size(), 0);
+}
+
+void SpatialIndexTest::testUpdate()
+{
+	qsrand(2);
+	SpatialIndex index;
+	QList<ObjPtr> objs;
+	for(int i = 0; i < 2000; i++)
+	{
+		ObjPtr o(new RectDummy(randomRect()));
+		objs.append(o);
+		index.insert(o);
+	}
+	foreach(ObjPtr o, objs)
+	{
+		QRect old = o->bbox();
+		static_cast<RectDummy*>(o.data())->mRect = randomRect();
+		QCOMPARE(index.indexedRect(o.data()), old);
+		QVERIFY(index.update(o));
+		QCOMPARE(index.indexedRect(o.data()), o->bbox());
+	}
+	QCOMPARE(index.size(), objs.size());
+	for(int i = 0; i < 50; i++)
+		QVERIFY(checkQuery(index, objs, randomRect()));
+
+	ObjPtr notIndexed(new RectDummy(randomRect()));
+	QVERIFY(!index.update(notIndexed));
+}
+
+void SpatialIndexTest::testBulkLoad()
+{
+	qsrand(3);
+	QList<ObjPtr> objs;
+	for(int i = 0; i < 20000; i++)
+		objs.append(ObjPtr(new RectDummy(randomRect())));
+
+	SpatialIndex index;
+	index.load(objs);
+	QCOMPARE(index.size(), objs.size());
+	for(int i = 0; i < 50; i++)
+		QVERIFY(checkQuery(index, objs, randomRect()));
+
+	// the packed tree must stay consistent under incremental edits
+	for(int i = 0; i < 1000; i++)
+	{
+		QVERIFY(index.remove(objs.first().data()));
+		objs.removeFirst();
+		ObjPtr o(new RectDummy(randomRect()));
+		objs.append(o);
+		index.insert(o);
+	}
+	for(int i = 0; i < 50; i++)
+		QVERIFY(checkQuery(index, objs, randomRect()));
+}
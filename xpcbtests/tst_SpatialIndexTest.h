@@ -0,0 +1,20 @@
+#ifndef TST_SPATIALINDEXTEST_H
+#define TST_SPATIALINDEXTEST_H
+
+#include <QtTest/QtTest>
+
+class SpatialIndexTest : public QObject
+{
+	Q_OBJECT
+
+public:
+	SpatialIndexTest();
+
+private Q_SLOTS:
+	void testQuery();
+	void testInsertRemove();
+	void testUpdate();
+	void testBulkLoad();
+};
+
+#endif // TST_SPATIALINDEXTEST_H
@@ -0,0 +1,283 @@
+/*
+	Copyright (C) 2010-2011 Igor Izyumin
+
+	This file is part of xpcb.
+
+	xpcb is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	xpcb is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with xpcb.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "tst_TraceListTest.h"
+#include "Document.h"
+#include "Part.h"
+#include "Trace.h"
+
+TraceListTest::TraceListTest()
+{
+}
+
+/// Adds a footprint with a row of SMT pins on a 100 mil pitch.
+QSharedPointer<Footprint> TraceListTest::addFootprint(PCBDoc &doc, int numPins)
+{
+	QSharedPointer<Padstack> ps(new Padstack());
+	ps->startPad() = Pad(Pad::PAD_ROUND, XPcb::milToPcb(60));
+
+	QSharedPointer<Footprint> fp(new Footprint());
+	fp->addPadstack(ps);
+	for(int i = 0; i < numPins; i++)
+	{
+		QSharedPointer<Pin> pin(new Pin(fp.data()));
+		pin->setName(QString::number(i + 1));
+		pin->setPos(QPoint(XPcb::milToPcb(100 * i), 0));
+		pin->setPadstack(ps);
+		fp->addPin(pin);
+	}
+	doc.mFootprints.insert(fp->uuid(), fp);
+	return fp;
+}
+
+QSharedPointer<Part> TraceListTest::addPart(PCBDoc &doc,
+											QSharedPointer<Footprint> fp,
+											QPoint pos)
+{
+	QSharedPointer<Part> p(new Part(&doc));
+	p->setFootprint(fp->uuid());
+	p->setPos(pos);
+	doc.addPart(p);
+	return p;
+}
+
+void TraceListTest::testConnect()
+{
+	PCBDoc doc;
+	QSharedPointer<Part> part = addPart(doc, addFootprint(doc, 3), QPoint());
+	const PartPin* p1 = part->pins()[0].data();
+	const PartPin* p2 = part->pins()[1].data();
+	const PartPin* p3 = part->pins()[2].data();
+	TraceList* tl = doc.traceList().data();
+	QVERIFY(!tl->isConnected(p1, p2));
+
+	QSharedPointer<Vertex> v1(new Vertex(p1->pos()));
+	QSharedPointer<Vertex> v2(new Vertex(p2->pos()));
+	QSharedPointer<Vertex> v3(new Vertex(p3->pos()));
+	QSharedPointer<Segment> s1(new Segment(Layer::LAY_TOP_COPPER));
+	QSharedPointer<Segment> s2(new Segment(Layer::LAY_TOP_COPPER));
+	tl->addSegment(s1, v1, v2);
+	tl->addSegment(s2, v2, v3);
+	QVERIFY(tl->isConnected(p1, p2));
+	QVERIFY(tl->isConnected(p1, p3));
+	// none of the pins are on a net, so they are all shorted
+	QCOMPARE(tl->shortedPins().size(), 3);
+
+	tl->removeSegment(s1);
+	QVERIFY(!tl->isConnected(p1, p2));
+	QVERIFY(tl->isConnected(p2, p3));
+
+	QSharedPointer<Vertex> v4(new Vertex(p1->pos()));
+	tl->swapVtx(s2, v3, v4);
+	QVERIFY(tl->isConnected(p1, p2));
+	QVERIFY(!tl->isConnected(p2, p3));
+	QCOMPARE(tl->shortedPins().size(), 2);
+}
+
+void TraceListTest::testPartMove()
+{
+	PCBDoc doc;
+	QSharedPointer<Footprint> fp = addFootprint(doc, 1);
+	QSharedPointer<Part> a = addPart(doc, fp, QPoint());
+	QSharedPointer<Part> b = addPart(doc, fp, QPoint(XPcb::milToPcb(1000), 0));
+	const PartPin* pa = a->pins()[0].data();
+	const PartPin* pb = b->pins()[0].data();
+	TraceList* tl = doc.traceList().data();
+
+	QSharedPointer<Vertex> v1(new Vertex(pa->pos()));
+	QSharedPointer<Vertex> v2(new Vertex(pb->pos()));
+	tl->addSegment(QSharedPointer<Segment>(new Segment(Layer::LAY_TOP_COPPER)),
+				   v1, v2);
+	QVERIFY(tl->isConnected(pa, pb));
+
+	b->setPos(QPoint(XPcb::milToPcb(1000), XPcb::milToPcb(500)));
+	doc.objectChanged(b);
+	QVERIFY(!tl->isConnected(pa, pb));
+
+	b->setPos(QPoint(XPcb::milToPcb(1000), 0));
+	doc.objectChanged(b);
+	QVERIFY(tl->isConnected(pa, pb));
+
+	doc.removePart(b);
+	QVERIFY(!tl->isConnected(pa, pb));
+	QVERIFY(tl->isConnected(pa, v2.data()));
+}
+
+void TraceListTest::testRatsChangedArea()
+{
+	PCBDoc doc;
+	QSharedPointer<Footprint> fp = addFootprint(doc, 1);
+	QSharedPointer<Part> a = addPart(doc, fp, QPoint());
+	QSharedPointer<Part> b = addPart(doc, fp, QPoint(XPcb::milToPcb(1000), 0));
+	const PartPin* pa = a->pins()[0].data();
+	const PartPin* pb = b->pins()[0].data();
+	TraceList* tl = doc.traceList().data();
+	tl->takeRatsChangedArea();
+	QVERIFY(tl->takeRatsChangedArea().isNull());
+
+	// connecting the pins shorts them, so their highlights must be painted
+	QSharedPointer<Vertex> v1(new Vertex(pa->pos()));
+	QSharedPointer<Vertex> v2(new Vertex(pb->pos()));
+	QSharedPointer<Segment> s(new Segment(Layer::LAY_TOP_COPPER));
+	tl->addSegment(s, v1, v2);
+	QCOMPARE(tl->shortedPins().size(), 2);
+	QRect area = tl->takeRatsChangedArea();
+	QVERIFY(area.contains(pa->bbox()));
+	QVERIFY(area.contains(pb->bbox()));
+	QVERIFY(tl->takeRatsChangedArea().isNull());
+
+	// and erased again once the short is gone
+	tl->removeSegment(s);
+	area = tl->takeRatsChangedArea();
+	QVERIFY(area.contains(pa->bbox()));
+	QVERIFY(area.contains(pb->bbox()));
+}
+
+void TraceListTest::testNetUpdate()
+{
+	PCBDoc doc;
+	QSharedPointer<Footprint> fp = addFootprint(doc, 1);
+	QList<const PartPin*> pins;
+	NLNet a("A"), b("B");
+	for(int i = 0; i < 4; i++)
+	{
+		QSharedPointer<Part> part = addPart(doc, fp,
+				QPoint(XPcb::milToPcb(1000 * i), 0));
+		part->refdesText()->setText(QString("R%1").arg(i));
+		pins.append(part->pins()[0].data());
+		NLNet &net = (i < 2) ? a : b;
+		net.addPin(NLPin(part->refdes(), "1"));
+	}
+	doc.netlist()->addNet(a);
+	doc.netlist()->addNet(b);
+
+	TraceList* tl = doc.traceList().data();
+	tl->update();
+	QCOMPARE(tl->mRats.value("A").size(), 1);
+	QCOMPARE(tl->mRats.value("B").size(), 1);
+
+	// routing net A leaves net B alone
+	QSharedPointer<Vertex> v1(new Vertex(pins[0]->pos()));
+	QSharedPointer<Vertex> v2(new Vertex(pins[1]->pos()));
+	QSharedPointer<Segment> s(new Segment(Layer::LAY_TOP_COPPER));
+	tl->addSegment(s, v1, v2);
+	tl->update();
+	QCOMPARE(tl->mRats.value("A").size(), 0);
+	QCOMPARE(tl->mRats.value("B").size(), 1);
+	QCOMPARE(tl->mConnections.value("A").size(), 1);
+
+	tl->removeSegment(s);
+	tl->update();
+	QCOMPARE(tl->mRats.value("A").size(), 1);
+	QCOMPARE(tl->mConnections.value("A").size(), 2);
+
+	doc.netlist()->removeNet("B");
+	tl->update();
+	QVERIFY(!tl->mRats.contains("B"));
+	QCOMPARE(tl->mRats.value("A").size(), 1);
+}
+
+/// Times a full attachment pass on a board with 50k pins and 200k vertices.
+/// Every pin has a three-segment trace running off it, and every fourth
+/// trace ends on a via.
+void TraceListTest::benchAttach()
+{
+	const int numParts = 5000;
+	const int pinsPerPart = 10;
+	const int tracesPerVia = 4;
+	const int pitch = XPcb::milToPcb(1000);
+	const int step = XPcb::milToPcb(100);
+
+	PCBDoc doc;
+	QSharedPointer<Footprint> fp = addFootprint(doc, pinsPerPart);
+	QSharedPointer<Padstack> viaPs(new Padstack());
+	viaPs->setHoleSize(XPcb::milToPcb(20));
+	viaPs->startPad() = Pad(Pad::PAD_ROUND, XPcb::milToPcb(40));
+	viaPs->endPad() = Pad(Pad::PAD_ROUND, XPcb::milToPcb(40));
+
+	TraceList* tl = doc.traceList().data();
+	const PartPin* firstPin = NULL;
+	const Via* firstVia = NULL;
+	int cols = 71;
+	int n = 0;
+	for(int i = 0; i < numParts; i++)
+	{
+		QSharedPointer<Part> part = addPart(doc, fp,
+				QPoint((i % cols) * pitch, (i / cols) * pitch));
+		foreach(QSharedPointer<PartPin> pin, part->pins())
+		{
+			QSharedPointer<Vertex> prev(new Vertex(pin->pos()));
+			for(int j = 1; j <= 3; j++)
+			{
+				QSharedPointer<Vertex> v(new Vertex(pin->pos() + QPoint(0, j * step)));
+				tl->addSegment(QSharedPointer<Segment>(new Segment(Layer::LAY_TOP_COPPER)),
+							   prev, v);
+				prev = v;
+			}
+			if (n++ % tracesPerVia == 0)
+			{
+				QSharedPointer<Via> via(new Via(prev->pos(), viaPs));
+				tl->myVias.insert(via);
+				if (!firstVia)
+				{
+					firstPin = pin.data();
+					firstVia = via.data();
+				}
+			}
+		}
+	}
+	QCOMPARE(doc.partPins().size(), numParts * pinsPerPart);
+	QCOMPARE(tl->vertices().size(), numParts * pinsPerPart * 4);
+
+	QBENCHMARK {
+		tl->rebuildConnectivity();
+	}
+
+	// spot check the result
+	QCOMPARE(firstPin->vertices().size(), 1);
+	QVERIFY(tl->isConnected(firstPin, firstVia));
+	QVERIFY(!tl->isConnected(firstPin, doc.partPins()[1].data()));
+}
+
+/// Times the ratsnest of a 5,000-pin net with no traces.
+void TraceListTest::benchRatsnest()
+{
+	const int numPins = 5000;
+	PCBDoc doc;
+	QSharedPointer<Footprint> fp = addFootprint(doc, 1);
+	NLNet gnd("GND");
+	qsrand(1);
+	for(int i = 0; i < numPins; i++)
+	{
+		QPoint pos(XPcb::milToPcb(qrand() % 10000), XPcb::milToPcb(qrand() % 10000));
+		QSharedPointer<Part> part = addPart(doc, fp, pos);
+		part->refdesText()->setText(QString("U%1").arg(i));
+		gnd.addPin(NLPin(part->refdes(), "1"));
+	}
+	doc.netlist()->addNet(gnd);
+
+	TraceList* tl = doc.traceList().data();
+	tl->update();
+	QCOMPARE(tl->mConnections.value("GND").size(), numPins);
+
+	QBENCHMARK {
+		tl->rebuildRatsForNet("GND");
+	}
+	QCOMPARE(tl->mRats.value("GND").size(), numPins - 1);
+}
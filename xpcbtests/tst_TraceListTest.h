@@ -0,0 +1,32 @@
+#ifndef TST_TRACELISTTEST_H
+#define TST_TRACELISTTEST_H
+
+#include <QtTest/QtTest>
+#include <QSharedPointer>
+
+class PCBDoc;
+class Part;
+class Footprint;
+
+class TraceListTest : public QObject
+{
+	Q_OBJECT
+
+public:
+	TraceListTest();
+
+private Q_SLOTS:
+	void testConnect();
+	void testPartMove();
+	void testRatsChangedArea();
+	void testNetUpdate();
+	void benchAttach();
+	void benchRatsnest();
+
+private:
+	QSharedPointer<Footprint> addFootprint(PCBDoc &doc, int numPins);
+	QSharedPointer<Part> addPart(PCBDoc &doc, QSharedPointer<Footprint> fp,
+								 QPoint pos);
+};
+
+#endif // TST_TRACELISTTEST_H
@@ -1,5 +1,6 @@
 #include <QtCore/QString>
 #include <QtTest/QtTest>
+#include <climits>
 #include "tst_XmlLoadTest.h"
 #include "Line.h"
 #include "Text.h"
@@ -10,6 +11,7 @@
 #include "Trace.h"
 #include "Polygon.h"
 #include "Area.h"
+#include "XmlAttr.h"
 
 XmlLoadTest::XmlLoadTest()
 {
@@ -653,3 +655,185 @@ void XmlLoadTest::testDoc()
 	file.close();
 }
 #endif
+
+void XmlLoadTest::testSections()
+{
+	// the second file has a document type, so it is loaded in one pass
+	QStringList prologs;
+	prologs << "<!-- saved by <xpcb> -->" << "<!DOCTYPE xpcbBoard>";
+	foreach(const QString &prolog, prologs)
+	{
+		QTemporaryFile file;
+		QVERIFY(file.open());
+		file.write("<?xml version='1.0' encoding='UTF-8'?>");
+		file.write(prolog.toUtf8());
+		file.write("<xpcbBoard>"
+				   "<props><name>sections</name><units>mm</units><numLayers>2</numLayers>"
+				   "<defaultPadstack>{00000000-0000-0000-0000-000000000000}</defaultPadstack></props>"
+				   "<padstacks/><footprints></footprints><outline/><parts/>"
+				   "<netlist><net name='a&gt;b'><pinRef partref='R1' pinname='1'/></net></netlist>"
+				   "<traces><vertices><vertex id='1' x='0' y='0'/><vertex id='2' x='100' y='0'/></vertices>"
+				   "<segments><segment start='1' end='2' layer='2' width='10'/></segments><vias/></traces>"
+				   "<areas/>"
+				   "<texts><text layer='2' x='1' y='2' rot='0' lineWidth='3' textSize='4'>"
+				   "<![CDATA[a </texts> b]]></text></texts>"
+				   "</xpcbBoard>");
+		file.close();
+
+		PCBDoc doc;
+		QVERIFY(doc.loadFromFile(file.fileName()));
+		QCOMPARE(doc.name(), QString("sections"));
+		QCOMPARE(doc.traceList()->vertices().size(), 2);
+		QCOMPARE(doc.traceList()->segments().size(), 1);
+		QString net("a>b");
+		QCOMPARE(doc.netlist()->net(net).pins().size(), 1);
+		QCOMPARE(doc.mTexts.size(), 1);
+		QCOMPARE(doc.mTexts.first()->text(), QString("a </texts> b"));
+	}
+}
+
+void XmlLoadTest::testCheckedSections_data()
+{
+	QTest::addColumn<QString>("props");
+	QTest::addColumn<QString>("traces");
+	QTest::newRow("valid") << "" << "";
+	// props are read on the calling thread, traces on the thread pool
+	QTest::newRow("props") << "<bogus/>" << "";
+	QTest::newRow("traces") << "" << "<bogus/>";
+}
+
+void XmlLoadTest::testCheckedSections()
+{
+	QFETCH(QString, props);
+	QFETCH(QString, traces);
+
+	// a file xpcb didn't write is checked as its sections are parsed
+	QTemporaryFile file;
+	QVERIFY(file.open());
+	file.write("<?xml version='1.0' encoding='UTF-8'?><xpcbBoard>"
+			   "<props><name>checked</name><units>mm</units><numLayers>2</numLayers>"
+			   "<defaultPadstack>{00000000-0000-0000-0000-000000000000}</defaultPadstack>");
+	file.write(props.toUtf8());
+	file.write("</props><padstacks/><footprints/><outline/><parts/><netlist/>"
+			   "<traces><vertices/><segments/><vias/>");
+	file.write(traces.toUtf8());
+	file.write("</traces><areas/><texts/></xpcbBoard>");
+	file.close();
+
+	PCBDoc doc;
+	QCOMPARE(doc.loadFromFile(file.fileName()), props.isEmpty() && traces.isEmpty());
+}
+
+void XmlLoadTest::testAttributes()
+{
+	QXmlStreamReader reader("<a i=' -42 ' big='2147483648' min='-2147483648' bad='12x' "
+							"u='{12345678-9abc-DEF0-1234-56789abcdef0}' "
+							"nobraces='12345678-9abc-def0-1234-56789abcdef0' "
+							"badu='{12345678-9abc-def0-1234-56789abcdefg}' "
+							"flag='1' off='0' hatch='edge'/>");
+	reader.readNextStartElement();
+	QVERIFY(Xml::is(reader.name(), "a"));
+	QVERIFY(!Xml::is(reader.name(), "ab"));
+	QXmlStreamAttributes attr = reader.attributes();
+	QCOMPARE(Xml::intAttr(attr, "i"), -42);
+	QCOMPARE(Xml::intAttr(attr, "big", -1), -1);
+	QCOMPARE(Xml::intAttr(attr, "min"), INT_MIN);
+	QCOMPARE(Xml::intAttr(attr, "bad", 7), 7);
+	QCOMPARE(Xml::intAttr(attr, "missing", 5), 5);
+	QUuid u("{12345678-9abc-def0-1234-56789abcdef0}");
+	QCOMPARE(Xml::uuidAttr(attr, "u"), u);
+	QCOMPARE(Xml::uuidAttr(attr, "nobraces"), u);
+	QVERIFY(Xml::uuidAttr(attr, "badu").isNull());
+	QVERIFY(Xml::boolAttr(attr, "flag"));
+	QVERIFY(!Xml::boolAttr(attr, "off", true));
+	QVERIFY(Xml::boolAttr(attr, "missing", true));
+	static const char* const hatch[] = { "none", "full", "edge" };
+	QCOMPARE(Xml::enumAttr(attr, "hatch", hatch, -1), 2);
+	QCOMPARE(Xml::enumAttr(attr, "flag", hatch, -1), -1);
+}
+
+/// Reads a traces element the way the loaders did before XmlAttr, creating
+/// a QString for every attribute name and value.
+static void parseTracesWithStrings(QXmlStreamReader &reader,
+								   TraceList::Staging &data)
+{
+	reader.readNextStartElement();
+	while(reader.readNextStartElement())
+	{
+		QXmlStreamAttributes attr = reader.attributes();
+		TraceList::Staging::Vtx v;
+		v.id = attr.value("id").toString().toInt();
+		v.pos = QPoint(attr.value("x").toString().toInt(),
+					   attr.value("y").toString().toInt());
+		data.vertices.append(v);
+		reader.skipCurrentElement();
+	}
+	reader.readNextStartElement();
+	while(reader.readNextStartElement())
+	{
+		QXmlStreamAttributes attr = reader.attributes();
+		TraceList::Staging::Seg s;
+		s.start = attr.value("start").toString().toInt();
+		s.end = attr.value("end").toString().toInt();
+		s.layer = attr.value("layer").toString().toInt();
+		s.width = attr.value("width").toString().toInt();
+		data.segments.append(s);
+		reader.skipCurrentElement();
+	}
+	reader.readNextStartElement();
+	while(reader.readNextStartElement())
+	{
+		QXmlStreamAttributes attr = reader.attributes();
+		TraceList::Staging::ViaRec v;
+		v.pos = QPoint(attr.value("x").toString().toInt(),
+					   attr.value("y").toString().toInt());
+		v.padstack = QUuid(attr.value("padstack").toString());
+		data.vias.append(v);
+		reader.skipCurrentElement();
+	}
+}
+
+void XmlLoadTest::benchParseTraces_data()
+{
+	QTest::addColumn<bool>("helpers");
+	QTest::newRow("QString temporaries") << false;
+	QTest::newRow("XmlAttr") << true;
+}
+
+/// Times parsing the traces of a synthetic board with 1,000,000 elements:
+/// 400,000 vertices, 400,000 segments and 200,000 vias.
+void XmlLoadTest::benchParseTraces()
+{
+	QFETCH(bool, helpers);
+	const int numVtx = 400000;
+	QByteArray xml("<traces><vertices>");
+	for(int i = 0; i < numVtx; i++)
+		xml += QString("<vertex id='%1' x='%2' y='%3'/>")
+			   .arg(i).arg(i * 2540).arg(-i * 1270).toAscii();
+	xml += "</vertices><segments>";
+	for(int i = 0; i < numVtx; i++)
+		xml += QString("<segment start='%1' end='%2' layer='%3' width='254000'/>")
+			   .arg(i).arg((i + 1) % numVtx).arg(2 + i % 2).toAscii();
+	xml += "</segments><vias>";
+	QByteArray ps = QUuid::createUuid().toString().toAscii();
+	for(int i = 0; i < numVtx / 2; i++)
+		xml += "<via x='" + QByteArray::number(i * 5080) + "' y='0' padstack='"
+			   + ps + "'/>";
+	xml += "</vias></traces>";
+
+	TraceList::Staging data;
+	QBENCHMARK {
+		data = TraceList::Staging();
+		QXmlStreamReader reader(xml);
+		reader.readNextStartElement();
+		if (helpers)
+			TraceList::parseXml(reader, data);
+		else
+			parseTracesWithStrings(reader, data);
+	}
+	QCOMPARE(data.vertices.size(), numVtx);
+	QCOMPARE(data.segments.size(), numVtx);
+	QCOMPARE(data.vias.size(), numVtx / 2);
+	QCOMPARE(data.segments.last().end, 0);
+	QCOMPARE(data.vias.last().padstack, QUuid(QString(ps)));
+}
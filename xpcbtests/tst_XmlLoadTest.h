@@ -19,6 +19,12 @@ private Q_SLOTS:
 	void testPolygon();
 	void testFootprint();
 	void testPart();
+	void testSections();
+	void testCheckedSections_data();
+	void testCheckedSections();
+	void testAttributes();
+	void benchParseTraces_data();
+	void benchParseTraces();
 #if 0
 	void testNet();
 	void testArea();